@@ -2,8 +2,13 @@
 #include <memory>
 #include <string>
 #include <algorithm>
+#include <ctime>
 #include "platform.hpp"
 #include "discord/discord.hpp"
+#include "discord/log.hpp"
+#include "discord/loopprofiler.hpp"
+#include "discord/tracer.hpp"
+#include "discord/metrics.hpp"
 #include "dialogs/token.hpp"
 #include "dialogs/editmessage.hpp"
 #include "dialogs/confirm.hpp"
@@ -16,6 +21,7 @@
 #include "windows/profilewindow.hpp"
 #include "windows/pinnedwindow.hpp"
 #include "windows/threadswindow.hpp"
+#include "windows/metricswindow.hpp"
 #include "startup.hpp"
 
 #ifdef WITH_LIBHANDY
@@ -28,8 +34,15 @@
 
 Abaddon::Abaddon()
     : m_settings(Platform::FindConfigFile())
-    , m_discord(GetSettings().UseMemoryDB) // stupid but easy
-    , m_emojis(GetResPath("/emojis.bin")) {
+    , m_discord(GetSettings().UseMemoryDB, nullptr, GetSettings().UseMemoryDB ? "" : GetStateCachePath("/outbox.db")) // stupid but easy
+    , m_emojis(GetResPath("/emojis.bin"))
+    , m_completion_index(m_discord, m_emojis)
+    , m_member_search(m_discord)
+    , m_history_prefetcher(m_discord, m_img_mgr) {
+    Log::Configure(GetSettings().LogLevels);
+    if (const char *env = std::getenv("ABADDON_LOG"); env != nullptr)
+        Log::Configure(env);
+
     LoadFromSettings();
 
     // todo: set user agent for non-client(?)
@@ -52,6 +65,26 @@ Abaddon::Abaddon()
         if (!accessible)
             m_channels_requested.erase(id);
     });
+    m_discord.signal_channel_backfilled().connect([this](Snowflake id) {
+        // the open view still has what it had before the disconnect
+        m_channels_requested.insert(id);
+        if (const auto channel = m_discord.GetChannel(id); channel.has_value())
+            CheckMessagesForMembers(*channel, m_discord.GetMessagesForChannel(id, 50));
+        m_main_window->UpdateChatBackfilled(id);
+    });
+    m_history_prefetcher.signal_prefetched().connect([this](Snowflake id, const std::vector<Message> &msgs) {
+        // same as if it was opened, the chat window just loads from the store
+        m_channels_requested.insert(id);
+        if (const auto channel = m_discord.GetChannel(id); channel.has_value())
+            CheckMessagesForMembers(*channel, msgs);
+        // opened while it was still loading
+        if (id == m_main_window->GetChatActiveChannel())
+            m_main_window->UpdateChatWindowContents();
+    });
+    m_history_prefetcher.signal_adopted_failed().connect([this](Snowflake id) {
+        if (id == m_main_window->GetChatActiveChannel() && m_channels_requested.find(id) == m_channels_requested.end())
+            FetchOpenedChannel(id);
+    });
     if (GetSettings().Prefetch)
         m_discord.signal_message_create().connect([this](const Message &message) {
             if (message.Author.HasAvatar())
@@ -244,6 +277,7 @@ int Abaddon::StartGTK() {
     m_main_window->signal_action_view_threads().connect(sigc::mem_fun(*this, &Abaddon::ActionViewThreads));
 
     m_main_window->GetChannelList()->signal_action_channel_item_select().connect(sigc::bind(sigc::mem_fun(*this, &Abaddon::ActionChannelOpened), true));
+    m_main_window->GetChannelList()->signal_channel_hovered().connect(sigc::mem_fun(m_history_prefetcher, &HistoryPrefetcher::HintHovered));
     m_main_window->GetChannelList()->signal_action_guild_leave().connect(sigc::mem_fun(*this, &Abaddon::ActionLeaveGuild));
     m_main_window->GetChannelList()->signal_action_guild_settings().connect(sigc::mem_fun(*this, &Abaddon::ActionGuildSettings));
 
@@ -277,14 +311,25 @@ int Abaddon::StartGTK() {
     m_gtk_app->hold();
     m_main_window->show();
 
+    LoopProfiler::Get().Start(static_cast<unsigned>(std::max(0, GetSettings().StallThreshold)));
+
+    auto &rss = Metrics::Get().GetGauge("abaddon_resident_memory_bytes", "resident set size of the process");
+    Metrics::Get().AddCollector([&rss] { rss.Set(static_cast<double>(Platform::GetResidentMemory())); });
+    if (!GetSettings().MetricsSocket.empty())
+        Metrics::Get().Serve(GetSettings().MetricsSocket);
+
     RunFirstTimeDiscordStartup();
 
     return m_gtk_app->run(*m_main_window);
 }
 
 void Abaddon::OnShutdown() {
-    StopDiscord();
+    StopDiscord(true);
+    LoopProfiler::Get().Stop();
+    Metrics::Get().StopServing();
+    SetTracing(false);
     m_settings.Close();
+    Log::Get().Stop();
 }
 
 void Abaddon::LoadFromSettings() {
@@ -296,16 +341,36 @@ void Abaddon::LoadFromSettings() {
 }
 
 void Abaddon::StartDiscord() {
+    m_discord.SetAPIURL(GetSettings().APIBaseURL);
+    m_discord.SetGatewayURL(GetSettings().GatewayURL);
+    m_discord.SetSessionCacheDirectory(GetSettings().ResumeSession ? GetStateCachePath() : "");
     m_discord.Start();
     m_main_window->UpdateMenus();
 }
 
-void Abaddon::StopDiscord() {
-    if (m_discord.Stop())
+void Abaddon::StopDiscord(bool keep_session) {
+    if (m_discord.Stop(keep_session))
         SaveState();
     m_main_window->UpdateMenus();
 }
 
+void Abaddon::SetTracing(bool enabled) {
+    auto &tracer = Tracer::Get();
+    if (enabled == tracer.IsEnabled()) return;
+    if (enabled) {
+        LOG_INFO(Tracing, "recording trace");
+        tracer.Start();
+        return;
+    }
+
+    std::string path;
+    if (const char *env = std::getenv("ABADDON_TRACE"); env != nullptr && *env != '\0')
+        path = env;
+    else
+        path = Platform::FindStateCacheFolder() + "/trace-" + std::to_string(std::time(nullptr)) + ".json";
+    tracer.Stop(path);
+}
+
 bool Abaddon::IsDiscordActive() const {
     return m_discord.IsStarted();
 }
@@ -325,8 +390,17 @@ const DiscordClient &Abaddon::GetDiscordClient() const {
 }
 
 void Abaddon::DiscordOnReady() {
+    m_history_prefetcher.Clear();
     m_main_window->UpdateComponents();
     LoadState();
+
+    // after the state so the active channel isnt fetched twice
+#ifdef WITH_LIBHANDY
+    for (const auto channel_id : m_main_window->GetChatWindow()->GetTabsState().Channels)
+        m_history_prefetcher.Hint(channel_id, HistoryPrefetcher::Reason::Tab);
+#endif
+    for (const auto channel_id : m_discord.GetChannelsWithMentions())
+        m_history_prefetcher.Hint(channel_id, HistoryPrefetcher::Reason::Mention);
 }
 
 void Abaddon::DiscordOnMessageCreate(const Message &message) {
@@ -369,9 +443,11 @@ void Abaddon::DiscordOnMessageSent(const Message &data) {
 }
 
 void Abaddon::DiscordOnDisconnect(bool is_reconnecting, GatewayCloseCode close_code) {
-    m_channels_history_loaded.clear();
     m_channels_history_loading.clear();
     m_channels_requested.clear();
+    m_history_prefetcher.Clear();
+    // anything could have been missed while disconnected
+    m_main_window->ClearCachedViews();
     if (is_reconnecting) return;
     m_main_window->set_title(APP_TITLE);
     m_main_window->UpdateComponents();
@@ -531,6 +607,15 @@ void Abaddon::CheckMessagesForMembers(const ChannelData &chan, const std::vector
     m_discord.RequestMembers(*chan.GuildID, fetch.begin(), fetch.end());
 }
 
+void Abaddon::FetchOpenedChannel(Snowflake id) {
+    m_discord.FetchMessagesInChannel(id, [this, id](const std::vector<Message> &msgs) {
+        if (const auto channel = m_discord.GetChannel(id); channel.has_value())
+            CheckMessagesForMembers(*channel, msgs);
+        m_main_window->UpdateChatWindowContents();
+        m_channels_requested.insert(id);
+    });
+}
+
 void Abaddon::SetupUserMenu() {
     m_user_menu = Gtk::manage(new Gtk::Menu);
     m_user_menu_insert_mention = Gtk::manage(new Gtk::MenuItem("Insert Mention"));
@@ -739,15 +824,11 @@ void Abaddon::ActionChannelOpened(Snowflake id, bool expand_to) {
         m_main_window->set_title(std::string(APP_TITLE) + " - " + display);
     }
     m_main_window->UpdateChatActiveChannel(id, expand_to);
+    const bool prefetching = m_history_prefetcher.OnChannelOpened(id, can_access && m_channels_requested.find(id) == m_channels_requested.end());
     if (m_channels_requested.find(id) == m_channels_requested.end()) {
-        // dont fire requests we know will fail
-        if (can_access) {
-            m_discord.FetchMessagesInChannel(id, [channel, this, id](const std::vector<Message> &msgs) {
-                CheckMessagesForMembers(*channel, msgs);
-                m_main_window->UpdateChatWindowContents();
-                m_channels_requested.insert(id);
-            });
-        }
+        // dont fire requests we know will fail, or ones the prefetcher already has out
+        if (can_access && !prefetching)
+            FetchOpenedChannel(id);
     } else {
         m_main_window->UpdateChatWindowContents();
     }
@@ -767,37 +848,27 @@ void Abaddon::ActionChannelOpened(Snowflake id, bool expand_to) {
 
     m_main_window->UpdateMenus();
     m_discord.SetReferringChannel(id);
+    if (can_access)
+        m_discord.MarkChannelViewed(id);
 }
 
 void Abaddon::ActionChatLoadHistory(Snowflake id) {
-    if (m_channels_history_loaded.find(id) != m_channels_history_loaded.end())
-        return;
-
     if (m_channels_history_loading.find(id) != m_channels_history_loading.end())
         return;
 
-    Snowflake before_id = m_main_window->GetChatOldestListedMessage();
-    auto msgs = m_discord.GetMessagesBefore(id, before_id);
-
-    if (msgs.size() >= 50) {
-        m_main_window->UpdateChatPrependHistory(msgs);
-        return;
-    }
-
     m_channels_history_loading.insert(id);
 
-    m_discord.FetchMessagesInChannelBefore(id, before_id, [this, id](const std::vector<Message> &msgs) {
+    // the store knows which spans it has so this only hits the api for gaps (can call back right away)
+    const Snowflake before_id = m_main_window->GetChatOldestListedMessage();
+    m_discord.LoadMessagesBefore(id, before_id, [this, id](const std::vector<Message> &msgs) {
         m_channels_history_loading.erase(id);
 
         const auto channel = m_discord.GetChannel(id);
         if (channel.has_value())
             CheckMessagesForMembers(*channel, msgs);
 
-        if (msgs.empty()) {
-            m_channels_history_loaded.insert(id);
-        } else {
+        if (!msgs.empty())
             m_main_window->UpdateChatPrependHistory(msgs);
-        }
     });
 }
 
@@ -904,6 +975,12 @@ void Abaddon::ActionViewPins(Snowflake channel_id) {
     window->show();
 }
 
+void Abaddon::ActionViewMetrics() {
+    auto window = new MetricsWindow;
+    ManageHeapWindow(window);
+    window->show();
+}
+
 void Abaddon::ActionViewThreads(Snowflake channel_id) {
     auto data = m_discord.GetChannel(channel_id);
     if (!data.has_value()) return;
@@ -955,6 +1032,18 @@ EmojiResource &Abaddon::GetEmojis() {
     return m_emojis;
 }
 
+CompletionIndex &Abaddon::GetCompletionIndex() {
+    return m_completion_index;
+}
+
+MemberSearch &Abaddon::GetMemberSearch() {
+    return m_member_search;
+}
+
+HistoryPrefetcher &Abaddon::GetHistoryPrefetcher() {
+    return m_history_prefetcher;
+}
+
 void Abaddon::on_tray_click() {
     m_main_window->set_visible(!m_main_window->is_visible());
 }
@@ -971,6 +1060,10 @@ void Abaddon::on_window_hide() {
 }
 
 int main(int argc, char **argv) {
+    Tracer::SetThreadName("main");
+    if (const char *trace = std::getenv("ABADDON_TRACE"); trace != nullptr && *trace != '\0')
+        Tracer::Get().Start();
+
     if (std::getenv("ABADDON_NO_FC") == nullptr)
         Platform::SetupFonts();
 
@@ -9,6 +9,9 @@
 #include "settings.hpp"
 #include "imgmanager.hpp"
 #include "emojis.hpp"
+#include "completionindex.hpp"
+#include "membersearch.hpp"
+#include "historyprefetcher.hpp"
 
 #define APP_TITLE "Abaddon"
 
@@ -28,7 +31,10 @@ public:
     void OnShutdown();
 
     void StartDiscord();
-    void StopDiscord();
+    void StopDiscord(bool keep_session = false);
+
+    // written to ABADDON_TRACE or the state cache folder when turned off
+    void SetTracing(bool enabled);
 
     void LoadFromSettings();
 
@@ -51,6 +57,7 @@ public:
     void ActionAddRecipient(Snowflake channel_id);
     void ActionViewPins(Snowflake channel_id);
     void ActionViewThreads(Snowflake channel_id);
+    void ActionViewMetrics();
 
     std::optional<Glib::ustring> ShowTextPrompt(const Glib::ustring &prompt, const Glib::ustring &title, const Glib::ustring &placeholder = "", Gtk::Window *window = nullptr);
     bool ShowConfirm(const Glib::ustring &prompt, Gtk::Window *window = nullptr);
@@ -59,6 +66,9 @@ public:
 
     ImageManager &GetImageManager();
     EmojiResource &GetEmojis();
+    CompletionIndex &GetCompletionIndex();
+    MemberSearch &GetMemberSearch();
+    HistoryPrefetcher &GetHistoryPrefetcher();
 
     std::string GetDiscordToken() const;
     bool IsDiscordActive() const;
@@ -99,6 +109,7 @@ protected:
     void ShowGuildVerificationGateDialog(Snowflake guild_id);
 
     void CheckMessagesForMembers(const ChannelData &chan, const std::vector<Message> &msgs);
+    void FetchOpenedChannel(Snowflake id);
 
     void SetupUserMenu();
     void SaveState();
@@ -138,11 +149,13 @@ private:
     std::string m_discord_token;
 
     std::unordered_set<Snowflake> m_channels_requested;
-    std::unordered_set<Snowflake> m_channels_history_loaded;
     std::unordered_set<Snowflake> m_channels_history_loading;
 
     ImageManager m_img_mgr;
     EmojiResource m_emojis;
+    CompletionIndex m_completion_index;
+    MemberSearch m_member_search;
+    HistoryPrefetcher m_history_prefetcher;
 
     mutable std::mutex m_mutex;
     Glib::RefPtr<Gtk::Application> m_gtk_app;
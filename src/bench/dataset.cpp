@@ -0,0 +1,409 @@
+#include "dataset.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <nlohmann/json.hpp>
+#include <zlib.h>
+#include "discord/sessioncache.hpp"
+
+namespace {
+// std distributions arent the same across standard libraries, the engine is
+class Random {
+public:
+    explicit Random(uint64_t seed)
+        : m_engine(seed) {}
+
+    uint64_t Below(uint64_t n) {
+        return m_engine() % n;
+    }
+
+    bool Chance(unsigned percent) {
+        return Below(100) < percent;
+    }
+
+    template<typename T>
+    const T &Pick(const std::vector<T> &items) {
+        return items[Below(items.size())];
+    }
+
+private:
+    std::mt19937_64 m_engine;
+};
+
+constexpr uint64_t DiscordEpoch = 1420070400000;
+constexpr uint64_t StartTime = 1640995200000; // 2022-01-01, unix ms
+
+const std::vector<std::string> Words {
+    "the", "a", "and", "to", "of", "is", "it", "that", "you", "this", "for", "on", "with", "have", "be", "just",
+    "lol", "yeah", "no", "what", "why", "how", "when", "build", "crash", "fixed", "works", "broken", "patch", "release",
+    "server", "client", "message", "channel", "thread", "emoji", "gtk", "linux", "windows", "compile", "cmake", "tonight",
+};
+
+const std::vector<std::string> Syllables {
+    "ka", "zu", "mi", "ro", "ten", "vo", "shi", "da", "nel", "qua", "ix", "or", "pe", "lu", "gar", "fen",
+};
+
+std::string ID(uint64_t ms, uint64_t increment) {
+    return std::to_string(((ms - DiscordEpoch) << 22) | (increment & 0xFFF));
+}
+
+std::string FormatTimestamp(uint64_t ms) {
+    const auto secs = static_cast<std::time_t>(ms / 1000);
+    const std::tm *tm = std::gmtime(&secs);
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d.%03d000+00:00",
+                  tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec, static_cast<int>(ms % 1000));
+    return buf;
+}
+
+std::string EncodeUTF8(uint32_t cp) {
+    std::string out;
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    return out;
+}
+
+// roughly the shape of the real set: plain pictographs, skin tone modifiers and zwj sequences
+std::vector<std::string> MakeStockEmojis() {
+    std::vector<std::string> patterns;
+    for (uint32_t cp = 0x1F300; cp <= 0x1F64F; cp++)
+        patterns.push_back(EncodeUTF8(cp));
+    for (uint32_t cp = 0x2600; cp <= 0x26FF; cp++)
+        patterns.push_back(EncodeUTF8(cp) + EncodeUTF8(0xFE0F));
+    for (uint32_t cp = 0x1F466; cp <= 0x1F469; cp++)
+        for (uint32_t tone = 0x1F3FB; tone <= 0x1F3FF; tone++)
+            patterns.push_back(EncodeUTF8(cp) + EncodeUTF8(tone));
+    const auto zwj = EncodeUTF8(0x200D);
+    patterns.push_back(EncodeUTF8(0x1F468) + zwj + EncodeUTF8(0x1F469) + zwj + EncodeUTF8(0x1F467));
+    patterns.push_back(EncodeUTF8(0x1F469) + zwj + EncodeUTF8(0x1F4BB));
+    patterns.push_back(EncodeUTF8(0x1F3F3) + EncodeUTF8(0xFE0F) + zwj + EncodeUTF8(0x1F308));
+    return patterns;
+}
+
+std::string MakeName(Random &rng) {
+    std::string name;
+    const auto syllables = 2 + rng.Below(3);
+    for (uint64_t i = 0; i < syllables; i++)
+        name += rng.Pick(Syllables);
+    if (rng.Chance(30)) name += "_" + rng.Pick(Words);
+    if (rng.Chance(30)) name += std::to_string(rng.Below(1000));
+    return name;
+}
+
+nlohmann::json MakeUser(const std::string &id, const std::string &name) {
+    return {
+        { "id", id },
+        { "username", name },
+        { "discriminator", "0001" },
+        { "avatar", nullptr },
+    };
+}
+
+std::string Compress(const std::vector<std::string> &messages, std::vector<std::string> &out) {
+    z_stream zs {};
+    deflateInit(&zs, Z_DEFAULT_COMPRESSION);
+    std::vector<uint8_t> buf;
+    for (const auto &msg : messages) {
+        buf.resize(deflateBound(&zs, static_cast<uLong>(msg.size())) + 16);
+        zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(msg.data()));
+        zs.avail_in = static_cast<uInt>(msg.size());
+        zs.next_out = buf.data();
+        zs.avail_out = static_cast<uInt>(buf.size());
+        if (deflate(&zs, Z_SYNC_FLUSH) != Z_OK) {
+            deflateEnd(&zs);
+            return "deflate failed";
+        }
+        out.emplace_back(buf.begin(), buf.begin() + (buf.size() - zs.avail_out));
+    }
+    deflateEnd(&zs);
+    return "";
+}
+
+// fills in everything but Gateway and Source
+void Index(Dataset &data) {
+    data.StockEmojis = MakeStockEmojis();
+
+    std::unordered_set<std::string> names;
+    std::unordered_set<Snowflake> channels;
+    for (const auto &str : data.Gateway) {
+        data.GatewayBytes += str.size();
+        const auto j = nlohmann::json::parse(str, nullptr, false);
+        if (j.is_discarded() || !j.contains("t") || !j.at("t").is_string()) continue;
+        const auto &type = j.at("t").get_ref<const std::string &>();
+        const auto &d = j.at("d");
+
+        if (type == "READY") {
+            if (d.contains("users"))
+                for (const auto &user : d.at("users"))
+                    names.insert(user.at("username").get<std::string>());
+            for (const auto &guild : d.at("guilds")) {
+                if (!guild.contains("channels")) continue;
+                for (const auto &channel : guild.at("channels"))
+                    if (channel.contains("name") && channel.at("name").is_string())
+                        names.insert(channel.at("name").get<std::string>());
+            }
+            if (d.contains("merged_members") && d.at("merged_members").is_array()) {
+                const auto &guilds = d.at("guilds");
+                const auto &merged = d.at("merged_members");
+                for (size_t i = 0; i < merged.size() && i < guilds.size(); i++) {
+                    const Snowflake guild_id = guilds[i].at("id").get<Snowflake>();
+                    for (const auto &member : merged[i]) {
+                        data.Members.emplace_back(member.at("user_id").get<Snowflake>(), guild_id);
+                        if (member.contains("nick") && member.at("nick").is_string())
+                            names.insert(member.at("nick").get<std::string>());
+                    }
+                }
+            }
+        } else if (type == "MESSAGE_CREATE") {
+            data.MessagePayloads.push_back(d.dump());
+            data.Contents.push_back(d.at("content").get<std::string>());
+            data.Timestamps.push_back(d.at("timestamp").get<std::string>());
+            names.insert(d.at("author").at("username").get<std::string>());
+            channels.insert(d.at("channel_id").get<Snowflake>());
+        }
+    }
+
+    data.Names.assign(names.begin(), names.end());
+    std::sort(data.Names.begin(), data.Names.end());
+    data.Channels.assign(channels.begin(), channels.end());
+    std::sort(data.Channels.begin(), data.Channels.end());
+}
+} // namespace
+
+Dataset MakeSyntheticDataset(const SyntheticOptions &options) {
+    Random rng(options.Seed);
+    Dataset data;
+    data.Source = "synthetic (seed " + std::to_string(options.Seed) + ")";
+    const auto stock_emojis = MakeStockEmojis();
+
+    uint64_t increment = 0;
+    const auto self_id = ID(StartTime - 1000000000, increment++);
+
+    struct GuildInfo {
+        std::string ID;
+        std::vector<std::string> Channels;
+        std::vector<std::string> Roles;
+        std::vector<std::string> Members;
+        std::vector<std::pair<std::string, std::string>> Emojis; // name, id
+    };
+    std::vector<GuildInfo> guilds;
+    nlohmann::json users = nlohmann::json::array();
+    nlohmann::json ready_guilds = nlohmann::json::array();
+    nlohmann::json merged_members = nlohmann::json::array();
+
+    for (size_t g = 0; g < options.Guilds; g++) {
+        GuildInfo info;
+        info.ID = ID(StartTime - 500000000 + g * 1000, increment++);
+
+        nlohmann::json roles = nlohmann::json::array();
+        // @everyone shares the guilds id
+        roles.push_back({ { "id", info.ID }, { "name", "@everyone" }, { "color", 0 }, { "hoist", false }, { "position", 0 }, { "permissions", "1071698660929" }, { "managed", false }, { "mentionable", false } });
+        for (size_t r = 1; r < options.RolesPerGuild; r++) {
+            const auto role_id = ID(StartTime - 400000000 + g * 1000 + r, increment++);
+            info.Roles.push_back(role_id);
+            // one admin role, the rest just add a permission or two
+            const uint64_t perms = r == 1 ? 8 : (uint64_t(1) << rng.Below(40));
+            roles.push_back({ { "id", role_id }, { "name", MakeName(rng) }, { "color", rng.Below(0xFFFFFF) }, { "hoist", rng.Chance(20) }, { "position", r }, { "permissions", std::to_string(perms) }, { "managed", false }, { "mentionable", rng.Chance(50) } });
+        }
+
+        nlohmann::json channels = nlohmann::json::array();
+        std::string category;
+        for (size_t c = 0; c < options.ChannelsPerGuild; c++) {
+            const auto channel_id = ID(StartTime - 300000000 + g * 1000 + c, increment++);
+            nlohmann::json overwrites = nlohmann::json::array();
+            overwrites.push_back({ { "id", info.ID }, { "type", 0 }, { "allow", "0" }, { "deny", rng.Chance(20) ? "1024" : "0" } });
+            if (!info.Roles.empty())
+                overwrites.push_back({ { "id", rng.Pick(info.Roles) }, { "type", 0 }, { "allow", "1024" }, { "deny", "0" } });
+
+            nlohmann::json channel = {
+                { "id", channel_id },
+                { "type", c % 8 == 0 ? 4 : 0 },
+                { "name", MakeName(rng) },
+                { "position", c },
+                { "permission_overwrites", overwrites },
+            };
+            if (c % 8 == 0) {
+                category = channel_id;
+            } else {
+                channel["parent_id"] = category;
+                info.Channels.push_back(channel_id);
+            }
+            channels.push_back(std::move(channel));
+        }
+
+        nlohmann::json emojis = nlohmann::json::array();
+        for (size_t e = 0; e < 10; e++) {
+            const auto emoji_id = ID(StartTime - 200000000 + g * 1000 + e, increment++);
+            const auto name = MakeName(rng);
+            info.Emojis.emplace_back(name, emoji_id);
+            emojis.push_back({ { "id", emoji_id }, { "name", name }, { "animated", rng.Chance(10) } });
+        }
+
+        nlohmann::json members = nlohmann::json::array();
+        for (size_t m = 0; m < options.MembersPerGuild; m++) {
+            const auto user_id = m == 0 ? self_id : ID(StartTime - 100000000 + g * 100000 + m, increment++);
+            info.Members.push_back(user_id);
+            if (m > 0) users.push_back(MakeUser(user_id, MakeName(rng)));
+
+            nlohmann::json member_roles = nlohmann::json::array();
+            const auto role_count = rng.Below(4);
+            for (uint64_t r = 0; r < role_count && info.Roles.size() > 1; r++)
+                member_roles.push_back(info.Roles[1 + rng.Below(info.Roles.size() - 1)]);
+            nlohmann::json member = {
+                { "user_id", user_id },
+                { "roles", member_roles },
+                { "joined_at", FormatTimestamp(StartTime - 50000000) },
+                { "deaf", false },
+                { "mute", false },
+            };
+            if (rng.Chance(15)) member["nick"] = MakeName(rng);
+            members.push_back(std::move(member));
+        }
+        merged_members.push_back(std::move(members));
+
+        ready_guilds.push_back({
+            { "id", info.ID },
+            { "name", MakeName(rng) },
+            { "icon", nullptr },
+            { "splash", nullptr },
+            { "owner_id", info.Members.size() > 1 ? info.Members[1] : self_id },
+            { "joined_at", FormatTimestamp(StartTime - 50000000) },
+            { "roles", roles },
+            { "emojis", emojis },
+            { "channels", channels },
+            { "threads", nlohmann::json::array() },
+            { "member_count", options.MembersPerGuild },
+        });
+        guilds.push_back(std::move(info));
+    }
+
+    nlohmann::json ready = {
+        { "op", 0 },
+        { "s", 1 },
+        { "t", "READY" },
+        { "d", {
+                   { "v", 9 },
+                   { "user", MakeUser(self_id, "benchmark") },
+                   { "guilds", ready_guilds },
+                   { "session_id", "benchmark" },
+                   { "user_settings", { { "guild_folders", nlohmann::json::array() } } },
+                   { "private_channels", nlohmann::json::array() },
+                   { "users", users },
+                   { "merged_members", merged_members },
+                   { "read_state", { { "entries", nlohmann::json::array() } } },
+                   { "user_guild_settings", { { "version", 0 }, { "partial", false }, { "entries", nlohmann::json::array() } } },
+               } },
+    };
+    data.Gateway.push_back(ready.dump());
+
+    uint64_t now = StartTime;
+    for (size_t i = 0; i < options.Messages && !guilds.empty(); i++) {
+        const auto &guild = rng.Pick(guilds);
+        if (guild.Channels.empty() || guild.Members.size() < 2) continue;
+        const auto &channel_id = rng.Pick(guild.Channels);
+        const auto &author_id = guild.Members[1 + rng.Below(guild.Members.size() - 1)];
+
+        std::string content;
+        const auto length = rng.Chance(5) ? 100 + rng.Below(200) : 1 + rng.Below(20);
+        for (uint64_t w = 0; w < length; w++) {
+            if (!content.empty()) content += ' ';
+            const auto roll = rng.Below(100);
+            if (roll < 6)
+                content += "<@" + rng.Pick(guild.Members) + ">";
+            else if (roll < 9)
+                content += "<#" + rng.Pick(guild.Channels) + ">";
+            else if (roll < 11 && !guild.Roles.empty())
+                content += "<@&" + rng.Pick(guild.Roles) + ">";
+            else if (roll < 15) {
+                const auto &[name, id] = rng.Pick(guild.Emojis);
+                content += "<:" + name + ":" + id + ">";
+            } else if (roll < 18)
+                content += "https://example.com/" + rng.Pick(Words) + "/" + std::to_string(rng.Below(100000));
+            else if (roll < 26)
+                content += rng.Pick(stock_emojis);
+            else
+                content += rng.Pick(Words);
+        }
+
+        now += rng.Below(5000);
+        nlohmann::json msg = {
+            { "op", 0 },
+            { "s", i + 2 },
+            { "t", "MESSAGE_CREATE" },
+            { "d", {
+                       { "id", ID(now, increment++) },
+                       { "channel_id", channel_id },
+                       { "guild_id", guild.ID },
+                       { "author", MakeUser(author_id, "") },
+                       { "content", content },
+                       { "timestamp", FormatTimestamp(now) },
+                       { "edited_timestamp", nullptr },
+                       { "tts", false },
+                       { "mention_everyone", false },
+                       { "mentions", nlohmann::json::array() },
+                       { "mention_roles", nlohmann::json::array() },
+                       { "attachments", nlohmann::json::array() },
+                       { "embeds", nlohmann::json::array() },
+                       { "pinned", false },
+                       { "type", 0 },
+                   } },
+        };
+        data.Gateway.push_back(msg.dump());
+    }
+
+    // authors were written without names to keep the loop simple, fill them in from the users list
+    std::unordered_map<std::string, std::string> usernames;
+    for (const auto &user : users)
+        usernames[user.at("id").get<std::string>()] = user.at("username").get<std::string>();
+    for (size_t i = 1; i < data.Gateway.size(); i++) {
+        auto j = nlohmann::json::parse(data.Gateway[i]);
+        auto &author = j["d"]["author"];
+        author["username"] = usernames[author.at("id").get<std::string>()];
+        data.Gateway[i] = j.dump();
+    }
+
+    if (const auto err = Compress(data.Gateway, data.Compressed); !err.empty())
+        fprintf(stderr, "%s\n", err.c_str());
+    Index(data);
+    return data;
+}
+
+std::optional<Dataset> LoadJournalDataset(const std::string &dir) {
+    Dataset data;
+    data.Source = dir;
+
+    SessionCache cache;
+    cache.SetDirectory(dir);
+    const bool complete = cache.Replay([&data](std::string message) {
+        data.Gateway.push_back(std::move(message));
+    });
+    if (data.Gateway.empty()) {
+        fprintf(stderr, "no journal in %s\n", dir.c_str());
+        return std::nullopt;
+    }
+    if (!complete)
+        fprintf(stderr, "journal in %s was cut off, using the %zu messages before that\n", dir.c_str(), data.Gateway.size());
+
+    if (const auto err = Compress(data.Gateway, data.Compressed); !err.empty()) {
+        fprintf(stderr, "%s\n", err.c_str());
+        return std::nullopt;
+    }
+    Index(data);
+    return data;
+}
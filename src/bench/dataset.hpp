@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "discord/snowflake.hpp"
+
+// gateway traffic for the benchmarks to chew on, either generated from a seed or read from a recorded session
+// everything the benchmarks need is pulled out of the same messages so both kinds of dataset are measured the same way
+struct Dataset {
+    std::string Source;
+
+    std::vector<std::string> Gateway;    // json gateway messages in the order they arrived, ready first
+    std::vector<std::string> Compressed; // Gateway as one zlib stream, flushed after each message like discord sends it
+    size_t GatewayBytes = 0;
+
+    std::vector<std::string> MessagePayloads; // d of every MESSAGE_CREATE
+    std::vector<std::string> Contents;
+    std::vector<std::string> Timestamps;
+    std::vector<std::string> Names; // users, nicknames and channels
+    std::vector<std::pair<Snowflake, Snowflake>> Members; // user id, guild id
+    std::vector<Snowflake> Channels;                      // ones with messages
+    std::vector<std::string> StockEmojis;
+};
+
+struct SyntheticOptions {
+    uint64_t Seed = 1;
+    size_t Guilds = 4;
+    size_t ChannelsPerGuild = 25;
+    size_t RolesPerGuild = 30;
+    size_t MembersPerGuild = 400;
+    size_t Messages = 20000;
+};
+
+Dataset MakeSyntheticDataset(const SyntheticOptions &options);
+// dir is where the client keeps its session (the state folder in the cache folder), recorded while it was running
+std::optional<Dataset> LoadJournalDataset(const std::string &dir);
@@ -0,0 +1,566 @@
+// benchmarks for the hot paths in abaddon-core
+// runs against a synthetic dataset generated from a seed or against a session the client recorded
+// prints a table and optionally writes the results as json so runs can be compared over time
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glibmm.h>
+#include <nlohmann/json.hpp>
+#include "dataset.hpp"
+#include "completionindex.hpp"
+#include "discord/contenttokenizer.hpp"
+#include "discord/discord.hpp"
+#include "discord/flatmap.hpp"
+#include "discord/store.hpp"
+
+namespace {
+// results go here so the compiler cant throw the work away
+volatile uint64_t Sink = 0;
+
+void Consume(uint64_t value) {
+    Sink = Sink + value;
+}
+
+// takes everything and does nothing so only inflating is measured
+class DroppingDispatcher : public Dispatcher {
+public:
+    void Post(std::function<void()> func) override {}
+    void PostDelayed(std::function<void()> func, unsigned int msec) override {}
+};
+
+struct Prepared {
+    size_t Items = 0;
+    size_t Bytes = 0; // processed per run, 0 if it doesnt make sense
+    std::function<void()> Run;
+};
+
+struct Benchmark {
+    const char *Name;
+    const char *Description;
+    std::function<Prepared(const Dataset &)> Prepare;
+};
+
+struct Result {
+    std::string Name;
+    size_t Items = 0;
+    size_t Bytes = 0;
+    uint64_t Runs = 0;
+    std::vector<double> NanosPerItem; // one per repetition
+};
+
+struct Config {
+    unsigned Repetitions = 5;
+    double MinTime = 0.2; // seconds per repetition
+};
+
+// parsed once and shared by everything that needs messages in the store
+std::vector<Message> ParseMessages(const Dataset &data) {
+    std::vector<Message> messages;
+    messages.reserve(data.MessagePayloads.size());
+    for (const auto &payload : data.MessagePayloads)
+        messages.push_back(nlohmann::json::parse(payload).get<Message>());
+    return messages;
+}
+
+std::shared_ptr<Store> MakeFilledStore(const std::vector<Message> &messages) {
+    auto store = std::make_shared<Store>(true);
+    store->BeginTransaction();
+    for (const auto &msg : messages)
+        store->SetMessage(msg.ID, msg);
+    store->EndTransaction();
+    return store;
+}
+
+std::vector<Snowflake> MessageIDs(const Dataset &data) {
+    std::vector<Snowflake> ids;
+    ids.reserve(data.MessagePayloads.size());
+    for (const auto &payload : data.MessagePayloads)
+        ids.push_back(nlohmann::json::parse(payload).at("id").get<Snowflake>());
+    return ids;
+}
+
+// the same inserts and lookups against what the client used before SnowflakeMap
+template<typename Map>
+Benchmark MakeMapInsertBenchmark(const char *name, const char *description) {
+    return { name, description, [](const Dataset &data) {
+                auto ids = std::make_shared<std::vector<Snowflake>>(MessageIDs(data));
+                return Prepared { ids->size(), 0, [ids] {
+                                     Map map;
+                                     for (size_t i = 0; i < ids->size(); i++)
+                                         map.emplace((*ids)[i], i);
+                                     Consume(map.size());
+                                 } };
+            } };
+}
+
+template<typename Map>
+Benchmark MakeMapFindBenchmark(const char *name, const char *description) {
+    return { name, description, [](const Dataset &data) {
+                auto ids = std::make_shared<std::vector<Snowflake>>(MessageIDs(data));
+                auto map = std::make_shared<Map>();
+                for (size_t i = 0; i < ids->size(); i++)
+                    map->emplace((*ids)[i], i);
+                return Prepared { ids->size(), 0, [ids, map] {
+                                     for (const auto id : *ids)
+                                         Consume(map->find(id) != map->end());
+                                 } };
+            } };
+}
+
+// counts what a standard container allocates so its footprint can be compared with the flat table
+size_t AllocatedBytes = 0;
+
+template<typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+    template<typename U>
+    CountingAllocator(const CountingAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+        AllocatedBytes += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *p, size_t n) {
+        AllocatedBytes -= n * sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template<typename U>
+    bool operator==(const CountingAllocator<U> &) const {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const CountingAllocator<U> &) const {
+        return false;
+    }
+};
+
+struct Footprint {
+    const char *Container;
+    size_t Entries;
+    size_t Bytes; // heap only, leaves out malloc overhead per allocation
+};
+
+template<typename Map>
+size_t MeasureStandard(const std::vector<Snowflake> &ids) {
+    const auto before = AllocatedBytes;
+    Map map;
+    for (size_t i = 0; i < ids.size(); i++)
+        map.emplace(ids[i], i);
+    return AllocatedBytes - before;
+}
+
+std::vector<Footprint> MeasureFootprints(const Dataset &data) {
+    using value_type = std::pair<const Snowflake, size_t>;
+    const auto ids = MessageIDs(data);
+
+    SnowflakeMap<size_t> flat;
+    for (size_t i = 0; i < ids.size(); i++)
+        flat.emplace(ids[i], i);
+
+    return {
+        { "SnowflakeMap", flat.size(), flat.bucket_count() * sizeof(std::pair<Snowflake, size_t>) },
+        { "std::map", ids.size(), MeasureStandard<std::map<Snowflake, size_t, std::less<Snowflake>, CountingAllocator<value_type>>>(ids) },
+        { "std::unordered_map", ids.size(), MeasureStandard<std::unordered_map<Snowflake, size_t, std::hash<Snowflake>, std::equal_to<Snowflake>, CountingAllocator<value_type>>>(ids) },
+    };
+}
+
+std::vector<Benchmark> MakeBenchmarks() {
+    std::vector<Benchmark> benchmarks;
+
+    benchmarks.push_back({ "gateway/inflate", "zlib-stream inflate of every gateway message", [](const Dataset &data) {
+                              auto client = std::make_shared<DiscordClient>(true, std::make_shared<DroppingDispatcher>());
+                              size_t bytes = 0;
+                              for (const auto &chunk : data.Compressed)
+                                  bytes += chunk.size();
+                              return Prepared { data.Compressed.size(), bytes, [client, &data] {
+                                                   for (size_t i = 0; i < data.Compressed.size(); i++)
+                                                       client->FeedGatewayData(data.Compressed[i], i == 0);
+                                               } };
+                          } });
+
+    benchmarks.push_back({ "gateway/decode", "json parse into GatewayMessage", [](const Dataset &data) {
+                              return Prepared { data.Gateway.size(), data.GatewayBytes, [&data] {
+                                                   for (const auto &str : data.Gateway) {
+                                                       const auto msg = nlohmann::json::parse(str).get<GatewayMessage>();
+                                                       Consume(msg.Data.size());
+                                                   }
+                                               } };
+                          } });
+
+    benchmarks.push_back({ "json/message", "json parse into Message", [](const Dataset &data) {
+                              size_t bytes = 0;
+                              for (const auto &payload : data.MessagePayloads)
+                                  bytes += payload.size();
+                              return Prepared { data.MessagePayloads.size(), bytes, [&data] {
+                                                   for (const auto &payload : data.MessagePayloads) {
+                                                       const auto msg = nlohmann::json::parse(payload).get<Message>();
+                                                       Consume(msg.Content.size());
+                                                   }
+                                               } };
+                          } });
+
+    benchmarks.push_back({ "gateway/dispatch", "inflate, decode and handle every gateway message", [](const Dataset &data) {
+                              auto dispatcher = std::make_shared<ManualDispatcher>();
+                              auto client = std::make_shared<DiscordClient>(true, dispatcher);
+                              return Prepared { data.Compressed.size(), data.GatewayBytes, [client, dispatcher, &data] {
+                                                   for (size_t i = 0; i < data.Compressed.size(); i++)
+                                                       client->FeedGatewayData(data.Compressed[i], i == 0);
+                                                   dispatcher->RunPending();
+                                               } };
+                          } });
+
+    benchmarks.push_back({ "store/set_message", "Store::SetMessage outside a transaction", [](const Dataset &data) {
+                              auto messages = std::make_shared<std::vector<Message>>(ParseMessages(data));
+                              auto store = std::make_shared<Store>(true);
+                              return Prepared { messages->size(), 0, [messages, store] {
+                                                   for (const auto &msg : *messages)
+                                                       store->SetMessage(msg.ID, msg);
+                                               } };
+                          } });
+
+    benchmarks.push_back({ "store/get_message", "Store::GetMessage", [](const Dataset &data) {
+                              auto messages = std::make_shared<std::vector<Message>>(ParseMessages(data));
+                              auto store = MakeFilledStore(*messages);
+                              return Prepared { messages->size(), 0, [messages, store] {
+                                                   for (const auto &msg : *messages)
+                                                       Consume(store->GetMessage(msg.ID).has_value());
+                                               } };
+                          } });
+
+    benchmarks.push_back({ "store/message_snapshot", "Store::GetMessageSnapshot", [](const Dataset &data) {
+                              auto messages = std::make_shared<std::vector<Message>>(ParseMessages(data));
+                              auto store = MakeFilledStore(*messages);
+                              return Prepared { messages->size(), 0, [messages, store] {
+                                                   for (const auto &msg : *messages)
+                                                       Consume(store->GetMessageSnapshot(msg.ID) != nullptr);
+                                               } };
+                          } });
+
+    benchmarks.push_back({ "store/last_messages", "Store::GetLastMessages page of 50 per channel", [](const Dataset &data) {
+                              auto store = MakeFilledStore(ParseMessages(data));
+                              return Prepared { data.Channels.size(), 0, [store, &data] {
+                                                   for (const auto channel_id : data.Channels)
+                                                       Consume(store->GetLastMessages(channel_id, 50).size());
+                                               } };
+                          } });
+
+    benchmarks.push_back({ "store/messages_before", "Store::GetMessagesBefore page of 50, scrolling back through each channel", [](const Dataset &data) {
+                              auto messages = std::make_shared<std::vector<Message>>(ParseMessages(data));
+                              auto store = MakeFilledStore(*messages);
+                              // every 50th message is where a page load would start from
+                              auto anchors = std::make_shared<std::vector<std::pair<Snowflake, Snowflake>>>();
+                              for (size_t i = 0; i < messages->size(); i += 50)
+                                  anchors->emplace_back((*messages)[i].ChannelID, (*messages)[i].ID);
+                              return Prepared { anchors->size(), 0, [store, anchors] {
+                                                   for (const auto &[channel_id, message_id] : *anchors)
+                                                       Consume(store->GetMessagesBefore(channel_id, message_id, 50).size());
+                                               } };
+                          } });
+
+    benchmarks.push_back({ "flatmap/insert", "SnowflakeMap inserts of every message id", [](const Dataset &data) {
+                              auto messages = std::make_shared<std::vector<Message>>(ParseMessages(data));
+                              return Prepared { messages->size(), 0, [messages] {
+                                                   SnowflakeMap<size_t> map;
+                                                   for (size_t i = 0; i < messages->size(); i++)
+                                                       map.emplace((*messages)[i].ID, i);
+                                                   Consume(map.size());
+                                               } };
+                          } });
+
+    benchmarks.push_back({ "flatmap/find", "SnowflakeMap lookups of every message id", [](const Dataset &data) {
+                              auto messages = std::make_shared<std::vector<Message>>(ParseMessages(data));
+                              auto map = std::make_shared<SnowflakeMap<size_t>>();
+                              for (size_t i = 0; i < messages->size(); i++)
+                                  map->emplace((*messages)[i].ID, i);
+                              return Prepared { messages->size(), 0, [messages, map] {
+                                                   for (const auto &msg : *messages)
+                                                       Consume(map->find(msg.ID) != map->end());
+                                               } };
+                          } });
+
+    benchmarks.push_back(MakeMapInsertBenchmark<std::map<Snowflake, size_t>>("flatmap/insert_std_map", "std::map inserts of every message id (baseline)"));
+    benchmarks.push_back(MakeMapFindBenchmark<std::map<Snowflake, size_t>>("flatmap/find_std_map", "std::map lookups of every message id (baseline)"));
+    benchmarks.push_back(MakeMapInsertBenchmark<std::unordered_map<Snowflake, size_t>>("flatmap/insert_unordered_map", "std::unordered_map inserts of every message id (baseline)"));
+    benchmarks.push_back(MakeMapFindBenchmark<std::unordered_map<Snowflake, size_t>>("flatmap/find_unordered_map", "std::unordered_map lookups of every message id (baseline)"));
+
+    benchmarks.push_back({ "permissions/compute", "DiscordClient::ComputePermissions for every member", [](const Dataset &data) {
+                              auto dispatcher = std::make_shared<ManualDispatcher>();
+                              auto client = std::make_shared<DiscordClient>(true, dispatcher);
+                              for (size_t i = 0; i < data.Compressed.size(); i++)
+                                  client->FeedGatewayData(data.Compressed[i], i == 0);
+                              dispatcher->RunPending();
+                              return Prepared { data.Members.size(), 0, [client, &data] {
+                                                   for (const auto &[user_id, guild_id] : data.Members)
+                                                       Consume(static_cast<uint64_t>(client->ComputePermissions(user_id, guild_id)));
+                                               } };
+                          } });
+
+    benchmarks.push_back({ "tokenize/content", "TokenizeContent with every span type", [](const Dataset &data) {
+                              auto matcher = std::make_shared<StockEmojiMatcher>();
+                              for (const auto &pattern : data.StockEmojis)
+                                  matcher->Add(pattern);
+                              const auto flags = ContentTokenFlags::UserMentions | ContentTokenFlags::RoleMentions | ContentTokenFlags::ChannelMentions |
+                                                 ContentTokenFlags::CustomEmojis | ContentTokenFlags::Links | ContentTokenFlags::StockEmojis;
+                              size_t bytes = 0;
+                              for (const auto &content : data.Contents)
+                                  bytes += content.size();
+                              return Prepared { data.Contents.size(), bytes, [matcher, flags, &data] {
+                                                   for (const auto &content : data.Contents)
+                                                       Consume(TokenizeContent(content, flags, matcher.get()).size());
+                                               } };
+                          } });
+
+    benchmarks.push_back({ "tokenize/stock_emoji", "TokenizeContent with only stock emojis", [](const Dataset &data) {
+                              auto matcher = std::make_shared<StockEmojiMatcher>();
+                              for (const auto &pattern : data.StockEmojis)
+                                  matcher->Add(pattern);
+                              size_t bytes = 0;
+                              for (const auto &content : data.Contents)
+                                  bytes += content.size();
+                              return Prepared { data.Contents.size(), bytes, [matcher, &data] {
+                                                   for (const auto &content : data.Contents)
+                                                       Consume(TokenizeContent(content, ContentTokenFlags::StockEmojis, matcher.get()).size());
+                                               } };
+                          } });
+
+    benchmarks.push_back({ "completion/find", "CompletionTable lookups by prefix and substring", [](const Dataset &data) {
+                              auto table = std::make_shared<CompletionTable<Snowflake>>();
+                              for (size_t i = 0; i < data.Names.size(); i++)
+                                  table->Set(Snowflake(i + 1), data.Names[i]);
+                              // what someone would have typed so far: the first few characters or a piece from the middle
+                              auto terms = std::make_shared<std::vector<Glib::ustring>>();
+                              for (size_t i = 0; i < data.Names.size(); i += 7) {
+                                  const Glib::ustring name = data.Names[i];
+                                  terms->push_back(name.substr(0, std::min<size_t>(3, name.size())));
+                                  if (name.size() > 4)
+                                      terms->push_back(name.substr(name.size() / 2, 3));
+                              }
+                              return Prepared { terms->size(), 0, [table, terms] {
+                                                   for (const auto &term : *terms)
+                                                       Consume(table->Find(term, 15).size());
+                                               } };
+                          } });
+
+    benchmarks.push_back({ "snowflake/from_iso8601", "Snowflake::FromISO8601 on message timestamps", [](const Dataset &data) {
+                              size_t bytes = 0;
+                              for (const auto &ts : data.Timestamps)
+                                  bytes += ts.size();
+                              return Prepared { data.Timestamps.size(), bytes, [&data] {
+                                                   for (const auto &ts : data.Timestamps)
+                                                       Consume(static_cast<uint64_t>(Snowflake::FromISO8601(ts)));
+                                               } };
+                          } });
+
+    return benchmarks;
+}
+
+Result Measure(const char *name, const Prepared &prepared, const Config &config) {
+    using clock = std::chrono::steady_clock;
+
+    Result result;
+    result.Name = name;
+    result.Items = prepared.Items;
+    result.Bytes = prepared.Bytes;
+    if (prepared.Items == 0) return result;
+
+    prepared.Run(); // warm up caches and the store
+
+    for (unsigned rep = 0; rep < config.Repetitions; rep++) {
+        uint64_t runs = 0;
+        const auto start = clock::now();
+        std::chrono::duration<double> elapsed {};
+        do {
+            prepared.Run();
+            runs++;
+            elapsed = clock::now() - start;
+        } while (elapsed.count() < config.MinTime);
+        result.Runs += runs;
+        result.NanosPerItem.push_back(elapsed.count() * 1e9 / static_cast<double>(runs * prepared.Items));
+    }
+    return result;
+}
+
+double Median(std::vector<double> values) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    const auto mid = values.size() / 2;
+    return values.size() % 2 == 0 ? (values[mid - 1] + values[mid]) / 2.0 : values[mid];
+}
+
+nlohmann::json ToJSON(const Result &result) {
+    const double median = Median(result.NanosPerItem);
+    nlohmann::json j = {
+        { "name", result.Name },
+        { "items", result.Items },
+        { "bytes", result.Bytes },
+        { "runs", result.Runs },
+        { "ns_per_item", {
+                             { "median", median },
+                             { "min", result.NanosPerItem.empty() ? 0.0 : *std::min_element(result.NanosPerItem.begin(), result.NanosPerItem.end()) },
+                             { "max", result.NanosPerItem.empty() ? 0.0 : *std::max_element(result.NanosPerItem.begin(), result.NanosPerItem.end()) },
+                             { "repetitions", result.NanosPerItem },
+                         } },
+        { "items_per_second", median > 0.0 ? 1e9 / median : 0.0 },
+    };
+    if (result.Bytes > 0 && median > 0.0)
+        j["bytes_per_second"] = static_cast<double>(result.Bytes) / static_cast<double>(result.Items) * 1e9 / median;
+    return j;
+}
+
+void PrintResult(FILE *out, const Result &result) {
+    if (result.NanosPerItem.empty()) {
+        fprintf(out, "%-30s %12s\n", result.Name.c_str(), "no data");
+        return;
+    }
+    const double median = Median(result.NanosPerItem);
+    const double min = *std::min_element(result.NanosPerItem.begin(), result.NanosPerItem.end());
+    const double max = *std::max_element(result.NanosPerItem.begin(), result.NanosPerItem.end());
+    fprintf(out, "%-30s %12.1f %12.1f %12.1f %14.0f", result.Name.c_str(), median, min, max, 1e9 / median);
+    if (result.Bytes > 0)
+        fprintf(out, " %10.1f", static_cast<double>(result.Bytes) / static_cast<double>(result.Items) * 1e3 / median);
+    fprintf(out, "\n");
+}
+
+void PrintUsage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--seed N] [--messages N] [--journal DIR] [--filter SUBSTRING] [--repetitions N] [--min-time SECONDS] [--json PATH] [--list]\n", argv0);
+    fprintf(stderr, "--journal runs on a session recorded by the client (the state folder in its cache folder) instead of a synthetic one\n");
+    fprintf(stderr, "--json - writes the results to stdout\n");
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    SyntheticOptions synthetic;
+    Config config;
+    std::string journal;
+    std::string filter;
+    std::string json_path;
+    bool list = false;
+
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--seed") == 0 && has_value) {
+            synthetic.Seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--messages") == 0 && has_value) {
+            synthetic.Messages = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--journal") == 0 && has_value) {
+            journal = argv[++i];
+        } else if (std::strcmp(argv[i], "--filter") == 0 && has_value) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--repetitions") == 0 && has_value) {
+            config.Repetitions = std::max(1u, static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10)));
+        } else if (std::strcmp(argv[i], "--min-time") == 0 && has_value) {
+            config.MinTime = std::strtod(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--json") == 0 && has_value) {
+            json_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--list") == 0) {
+            list = true;
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    const auto benchmarks = MakeBenchmarks();
+    if (list) {
+        for (const auto &benchmark : benchmarks)
+            printf("%-30s %s\n", benchmark.Name, benchmark.Description);
+        return 0;
+    }
+
+    Glib::init();
+
+    // the table goes to stderr when the json is going to stdout so it can be piped
+    FILE *out = json_path == "-" ? stderr : stdout;
+
+    std::optional<Dataset> data;
+    if (journal.empty())
+        data = MakeSyntheticDataset(synthetic);
+    else
+        data = LoadJournalDataset(journal);
+    if (!data.has_value()) return 1;
+
+    size_t compressed_bytes = 0;
+    for (const auto &chunk : data->Compressed)
+        compressed_bytes += chunk.size();
+    fprintf(out, "dataset: %s, %zu gateway messages (%zu bytes, %zu compressed), %zu messages, %zu members, %zu channels\n\n",
+            data->Source.c_str(), data->Gateway.size(), data->GatewayBytes, compressed_bytes, data->MessagePayloads.size(), data->Members.size(), data->Channels.size());
+    fprintf(out, "%-30s %12s %12s %12s %14s %10s\n", "benchmark", "ns/item", "min", "max", "items/s", "MB/s");
+    fflush(out);
+
+    std::vector<Result> results;
+    for (const auto &benchmark : benchmarks) {
+        if (!filter.empty() && std::string(benchmark.Name).find(filter) == std::string::npos) continue;
+        const auto prepared = benchmark.Prepare(*data);
+        results.push_back(Measure(benchmark.Name, prepared, config));
+        PrintResult(out, results.back());
+        fflush(out);
+    }
+
+    std::vector<Footprint> footprints;
+    if (filter.empty() || std::string("flatmap").find(filter) != std::string::npos || filter.find("flatmap") != std::string::npos) {
+        footprints = MeasureFootprints(*data);
+        fprintf(out, "\n%-30s %12s %14s %12s\n", "container", "entries", "bytes", "bytes/entry");
+        for (const auto &footprint : footprints)
+            fprintf(out, "%-30s %12zu %14zu %12.1f\n", footprint.Container, footprint.Entries, footprint.Bytes,
+                    footprint.Entries == 0 ? 0.0 : static_cast<double>(footprint.Bytes) / static_cast<double>(footprint.Entries));
+    }
+
+    if (json_path.empty()) return 0;
+
+    nlohmann::json j = {
+        { "schema", 1 },
+        { "dataset", {
+                         { "source", data->Source },
+                         { "gateway_messages", data->Gateway.size() },
+                         { "gateway_bytes", data->GatewayBytes },
+                         { "compressed_bytes", compressed_bytes },
+                         { "messages", data->MessagePayloads.size() },
+                         { "members", data->Members.size() },
+                         { "channels", data->Channels.size() },
+                     } },
+        { "config", {
+                        { "seed", synthetic.Seed },
+                        { "journal", journal },
+                        { "repetitions", config.Repetitions },
+                        { "min_time", config.MinTime },
+                    } },
+        { "results", nlohmann::json::array() },
+    };
+    for (const auto &result : results)
+        j["results"].push_back(ToJSON(result));
+    if (!footprints.empty()) {
+        j["memory"] = nlohmann::json::array();
+        for (const auto &footprint : footprints)
+            j["memory"].push_back({ { "container", footprint.Container }, { "entries", footprint.Entries }, { "bytes", footprint.Bytes } });
+    }
+
+    if (json_path == "-") {
+        std::cout << j.dump(4) << std::endl;
+    } else {
+        std::ofstream file(json_path);
+        if (!file.is_open()) {
+            fprintf(stderr, "couldnt open %s to write the results\n", json_path.c_str());
+            return 1;
+        }
+        file << j.dump(4) << '\n';
+    }
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+// headless client on top of abaddon-core
+// connects, prints gateway events as they come in and optionally exits after a while
+// for soak testing and profiling the networking and storage stack without a display
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <glibmm.h>
+#include "discord/discord.hpp"
+#include "discord/log.hpp"
+
+static void PrintUsage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--token TOKEN] [--duration SECONDS] [--api URL] [--gateway URL] [--disk-store] [--quiet]\n", argv0);
+    fprintf(stderr, "token is read from ABADDON_TOKEN if not given, log levels from ABADDON_LOG (like warn,gateway=debug)\n");
+}
+
+int main(int argc, char **argv) {
+    std::string token;
+    std::string api_url;
+    std::string gateway_url;
+    unsigned int duration = 0;
+    bool mem_store = true;
+    bool quiet = false;
+
+    if (const char *env = std::getenv("ABADDON_TOKEN"); env != nullptr)
+        token = env;
+
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--token") == 0 && has_value) {
+            token = argv[++i];
+        } else if (std::strcmp(argv[i], "--duration") == 0 && has_value) {
+            duration = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--api") == 0 && has_value) {
+            api_url = argv[++i];
+        } else if (std::strcmp(argv[i], "--gateway") == 0 && has_value) {
+            gateway_url = argv[++i];
+        } else if (std::strcmp(argv[i], "--disk-store") == 0) {
+            mem_store = false;
+        } else if (std::strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (token.empty()) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    if (const char *env = std::getenv("ABADDON_LOG"); env != nullptr)
+        Log::Configure(env);
+
+    Glib::init();
+    auto loop = Glib::MainLoop::create();
+
+    DiscordClient discord(mem_store);
+    if (!discord.IsStoreValid()) {
+        fprintf(stderr, "failed to open store\n");
+        return 1;
+    }
+
+    if (!api_url.empty()) discord.SetAPIURL(api_url);
+    if (!gateway_url.empty()) discord.SetGatewayURL(gateway_url);
+    discord.SetUserAgent("Abaddon");
+    discord.UpdateToken(token);
+
+    size_t message_count = 0;
+
+    discord.signal_connected().connect([] {
+        printf("connected\n");
+    });
+    discord.signal_disconnected().connect([&loop](bool is_reconnecting, GatewayCloseCode code) {
+        printf("disconnected (%d)%s\n", static_cast<int>(code), is_reconnecting ? ", reconnecting" : "");
+        if (!is_reconnecting) loop->quit();
+    });
+    discord.signal_gateway_ready().connect([&discord] {
+        const auto &user = discord.GetUserData();
+        printf("ready as %s (%" PRIu64 "), %zu guilds\n", user.Username.c_str(), static_cast<uint64_t>(user.ID), discord.GetGuilds().size());
+    });
+    discord.signal_guild_create().connect([quiet](const GuildData &guild) {
+        if (!quiet) printf("guild create %s (%" PRIu64 ")\n", guild.Name.c_str(), static_cast<uint64_t>(guild.ID));
+    });
+    discord.signal_message_create().connect([quiet, &message_count](const Message &msg) {
+        message_count++;
+        if (!quiet) printf("message %" PRIu64 " in %" PRIu64 " from %s: %s\n", static_cast<uint64_t>(msg.ID), static_cast<uint64_t>(msg.ChannelID), msg.Author.Username.c_str(), msg.Content.c_str());
+    });
+
+    if (duration > 0) {
+        Glib::signal_timeout().connect_seconds_once([&loop] {
+            loop->quit();
+        }, duration);
+    }
+
+    discord.Start();
+    loop->run();
+    discord.Stop();
+
+    Log::Get().Stop();
+    printf("%zu messages received\n", message_count);
+
+    return 0;
+}
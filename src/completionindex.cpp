@@ -0,0 +1,245 @@
+#include "completionindex.hpp"
+#include "discord/discord.hpp"
+#include "emojis.hpp"
+
+CompletionIndex::CompletionIndex(DiscordClient &discord, EmojiResource &emojis)
+    : m_discord(discord)
+    , m_emojis(emojis) {
+    m_discord.signal_gateway_ready().connect(sigc::mem_fun(*this, &CompletionIndex::Clear));
+    m_discord.signal_guild_create().connect(sigc::mem_fun(*this, &CompletionIndex::OnGuildCreate));
+    m_discord.signal_guild_delete().connect(sigc::mem_fun(*this, &CompletionIndex::OnGuildDelete));
+    m_discord.signal_guild_emojis_update().connect(sigc::mem_fun(*this, &CompletionIndex::OnGuildEmojisUpdate));
+    m_discord.signal_guild_user_added().connect(sigc::mem_fun(*this, &CompletionIndex::OnGuildUserAdded));
+    m_discord.signal_guild_member_update().connect(sigc::mem_fun(*this, &CompletionIndex::OnGuildMemberUpdate));
+    m_discord.signal_channel_create().connect(sigc::mem_fun(*this, &CompletionIndex::OnChannelCreate));
+    m_discord.signal_channel_update().connect(sigc::mem_fun(*this, &CompletionIndex::OnChannelUpdate));
+    m_discord.signal_channel_delete().connect(sigc::mem_fun(*this, &CompletionIndex::OnChannelDelete));
+}
+
+void CompletionIndex::Clear() {
+    m_users.clear();
+    m_members.clear();
+    m_emojis_built = false;
+    m_emoji_data.clear();
+    m_all_emojis.Clear();
+    m_guild_emojis.clear();
+    m_channels.clear();
+    m_channel_guild.clear();
+}
+
+std::vector<Snowflake> CompletionIndex::FindMembers(Snowflake guild_id, const Glib::ustring &term, size_t limit) {
+    return GetMemberTable(guild_id).Find(term, limit);
+}
+
+bool CompletionIndex::UserMatches(Snowflake user_id, const Glib::ustring &term) {
+    const auto *user = CacheUser(user_id);
+    if (user == nullptr) return false;
+    return Glib::ustring(user->Username).casefold().raw().find(term.casefold().raw()) != std::string::npos;
+}
+
+const CompletionIndex::User *CompletionIndex::GetUser(Snowflake user_id) {
+    return CacheUser(user_id);
+}
+
+std::vector<Snowflake> CompletionIndex::FindEmojis(std::optional<Snowflake> guild_id, const Glib::ustring &term, size_t limit, bool allow_animated) {
+    BuildEmojis();
+
+    CompletionTable<Snowflake>::filter_type filter;
+    if (!allow_animated) {
+        filter = [this](Snowflake id) {
+            return !m_emoji_data.at(id).IsAnimated;
+        };
+    }
+
+    if (!guild_id.has_value())
+        return m_all_emojis.Find(term, limit, filter);
+
+    const auto it = m_guild_emojis.find(*guild_id);
+    if (it == m_guild_emojis.end()) return {};
+    return it->second.Find(term, limit, filter);
+}
+
+const CompletionIndex::Emoji *CompletionIndex::GetEmoji(Snowflake emoji_id) const {
+    if (const auto it = m_emoji_data.find(emoji_id); it != m_emoji_data.end())
+        return &it->second;
+    return nullptr;
+}
+
+std::vector<Snowflake> CompletionIndex::FindChannels(Snowflake guild_id, const Glib::ustring &term, size_t limit) {
+    return GetChannelTable(guild_id).Find(term, limit);
+}
+
+const std::string *CompletionIndex::GetChannelName(Snowflake guild_id, Snowflake channel_id) const {
+    if (const auto it = m_channels.find(guild_id); it != m_channels.end())
+        return it->second.GetName(channel_id);
+    return nullptr;
+}
+
+std::vector<std::pair<std::string, std::string>> CompletionIndex::FindShortCodes(const Glib::ustring &term, size_t limit) {
+    const auto &shortcodes = m_emojis.GetShortCodes();
+    if (!m_shortcodes_built) {
+        m_shortcodes_built = true;
+        for (const auto &[shortcode, pattern] : shortcodes)
+            m_shortcodes.Set(shortcode, shortcode);
+    }
+
+    // several shortcodes can map to the same emoji, only the best ranked one is kept
+    std::vector<std::pair<std::string, std::string>> ret;
+    std::unordered_set<std::string> seen_patterns;
+    const auto filter = [&](const std::string &shortcode) {
+        return seen_patterns.insert(shortcodes.at(shortcode)).second;
+    };
+    for (auto &shortcode : m_shortcodes.Find(term, limit, filter)) {
+        auto pattern = shortcodes.at(shortcode);
+        ret.emplace_back(std::move(shortcode), std::move(pattern));
+    }
+    return ret;
+}
+
+CompletionTable<Snowflake> &CompletionIndex::GetMemberTable(Snowflake guild_id) {
+    if (const auto it = m_members.find(guild_id); it != m_members.end())
+        return it->second;
+
+    auto &table = m_members[guild_id];
+    for (const auto user_id : m_discord.GetUsersInGuild(guild_id))
+        if (const auto *user = CacheUser(user_id); user != nullptr)
+            table.Set(user_id, user->Username);
+    return table;
+}
+
+CompletionTable<Snowflake> &CompletionIndex::GetChannelTable(Snowflake guild_id) {
+    if (const auto it = m_channels.find(guild_id); it != m_channels.end())
+        return it->second;
+
+    auto &table = m_channels[guild_id];
+    for (const auto channel_id : m_discord.GetChannelsInGuild(guild_id))
+        if (const auto channel = m_discord.GetChannel(channel_id); channel.has_value())
+            IndexChannel(*channel);
+    return table;
+}
+
+void CompletionIndex::BuildEmojis() {
+    if (m_emojis_built) return;
+    m_emojis_built = true;
+
+    for (const auto guild_id : m_discord.GetGuilds()) {
+        const auto guild = m_discord.GetGuild(guild_id);
+        if (!guild.has_value() || !guild->Emojis.has_value()) continue;
+        std::vector<EmojiData> emojis;
+        for (const auto &tmp : *guild->Emojis)
+            if (auto emoji = m_discord.GetEmoji(tmp.ID); emoji.has_value())
+                emojis.push_back(std::move(*emoji));
+        SetGuildEmojis(guild_id, emojis);
+    }
+}
+
+void CompletionIndex::SetGuildEmojis(Snowflake guild_id, const std::vector<EmojiData> &emojis) {
+    RemoveGuildEmojis(guild_id);
+
+    auto &table = m_guild_emojis[guild_id];
+    for (const auto &emoji : emojis) {
+        if (emoji.IsAvailable.has_value() && !*emoji.IsAvailable) continue;
+        if (emoji.Roles.has_value() && !emoji.Roles->empty()) continue;
+
+        m_emoji_data[emoji.ID] = { guild_id, emoji.Name, emoji.IsAnimated.has_value() && *emoji.IsAnimated };
+        table.Set(emoji.ID, emoji.Name);
+        m_all_emojis.Set(emoji.ID, emoji.Name);
+    }
+}
+
+void CompletionIndex::RemoveGuildEmojis(Snowflake guild_id) {
+    const auto it = m_guild_emojis.find(guild_id);
+    if (it == m_guild_emojis.end()) return;
+
+    for (auto data = m_emoji_data.begin(); data != m_emoji_data.end();) {
+        if (data->second.GuildID == guild_id) {
+            m_all_emojis.Remove(data->first);
+            data = m_emoji_data.erase(data);
+        } else {
+            data++;
+        }
+    }
+    m_guild_emojis.erase(it);
+}
+
+const CompletionIndex::User *CompletionIndex::CacheUser(Snowflake user_id) {
+    if (const auto it = m_users.find(user_id); it != m_users.end())
+        return &it->second;
+
+    const auto user = m_discord.GetUser(user_id);
+    if (!user.has_value()) return nullptr;
+    auto &cached = m_users[user_id];
+    cached.Username = user->Username;
+    cached.Discriminator = user->Discriminator;
+    cached.AvatarURL = user->GetAvatarURL();
+    return &cached;
+}
+
+void CompletionIndex::IndexChannel(const ChannelData &channel) {
+    if (!channel.GuildID.has_value()) return;
+    const auto it = m_channels.find(*channel.GuildID);
+    if (it == m_channels.end()) return;
+
+    if (channel.Type == ChannelType::GUILD_VOICE || channel.Type == ChannelType::GUILD_CATEGORY || !channel.Name.has_value()) {
+        it->second.Remove(channel.ID);
+        return;
+    }
+    it->second.Set(channel.ID, *channel.Name);
+    m_channel_guild[channel.ID] = *channel.GuildID;
+}
+
+void CompletionIndex::OnGuildCreate(const GuildData &guild) {
+    if (!m_emojis_built || !guild.Emojis.has_value()) return;
+    std::vector<EmojiData> emojis;
+    for (const auto &tmp : *guild.Emojis)
+        if (auto emoji = m_discord.GetEmoji(tmp.ID); emoji.has_value())
+            emojis.push_back(std::move(*emoji));
+    SetGuildEmojis(guild.ID, emojis);
+}
+
+void CompletionIndex::OnGuildDelete(Snowflake guild_id) {
+    m_members.erase(guild_id);
+    m_channels.erase(guild_id);
+    RemoveGuildEmojis(guild_id);
+}
+
+void CompletionIndex::OnGuildEmojisUpdate(Snowflake guild_id, const std::vector<EmojiData> &emojis) {
+    if (m_emojis_built)
+        SetGuildEmojis(guild_id, emojis);
+}
+
+void CompletionIndex::OnGuildUserAdded(Snowflake guild_id, Snowflake user_id) {
+    const auto it = m_members.find(guild_id);
+    if (it == m_members.end()) return;
+    if (const auto *user = CacheUser(user_id); user != nullptr)
+        it->second.Set(user_id, user->Username);
+}
+
+void CompletionIndex::OnGuildMemberUpdate(Snowflake guild_id, Snowflake user_id) {
+    // user data might have changed along with the member so refetch it
+    if (m_users.erase(user_id) == 0) return;
+    const auto *user = CacheUser(user_id);
+    for (auto &[id, table] : m_members) {
+        if (user == nullptr)
+            table.Remove(user_id);
+        else if (table.GetName(user_id) != nullptr)
+            table.Set(user_id, user->Username);
+    }
+}
+
+void CompletionIndex::OnChannelCreate(const ChannelData &channel) {
+    IndexChannel(channel);
+}
+
+void CompletionIndex::OnChannelUpdate(Snowflake channel_id) {
+    if (const auto channel = m_discord.GetChannel(channel_id); channel.has_value())
+        IndexChannel(*channel);
+}
+
+void CompletionIndex::OnChannelDelete(Snowflake channel_id) {
+    const auto it = m_channel_guild.find(channel_id);
+    if (it == m_channel_guild.end()) return;
+    if (const auto table = m_channels.find(it->second); table != m_channels.end())
+        table->second.Remove(channel_id);
+    m_channel_guild.erase(it);
+}
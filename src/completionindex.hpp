@@ -0,0 +1,223 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <glibmm/ustring.h>
+#include "discord/snowflake.hpp"
+
+class DiscordClient;
+class EmojiResource;
+struct GuildData;
+struct ChannelData;
+struct EmojiData;
+
+// casefolded names for one kind of thing, looked up by prefix then substring
+// the sorted views are rebuilt on the first lookup after a change so bulk updates stay cheap
+template<typename T>
+class CompletionTable {
+public:
+    using filter_type = std::function<bool(const T &)>;
+
+    void Set(const T &id, const Glib::ustring &name) {
+        auto &entry = m_entries[id];
+        entry.Name = name;
+        entry.Key = name.casefold().raw();
+        m_dirty = true;
+    }
+
+    void Remove(const T &id) {
+        if (m_entries.erase(id) > 0)
+            m_dirty = true;
+    }
+
+    void Clear() {
+        m_entries.clear();
+        m_dirty = true;
+    }
+
+    [[nodiscard]] size_t Size() const {
+        return m_entries.size();
+    }
+
+    [[nodiscard]] const std::string *GetName(const T &id) const {
+        if (const auto it = m_entries.find(id); it != m_entries.end())
+            return &it->second.Name;
+        return nullptr;
+    }
+
+    // term has to be casefolded already
+    [[nodiscard]] bool Matches(const T &id, std::string_view folded_term) const {
+        if (const auto it = m_entries.find(id); it != m_entries.end())
+            return it->second.Key.find(folded_term) != std::string::npos;
+        return false;
+    }
+
+    // ranked: whole name starts with term, a word in it does, term appears anywhere
+    // alphabetical within a rank so an exact match comes first
+    [[nodiscard]] std::vector<T> Find(const Glib::ustring &term, size_t limit, const filter_type &filter = {}) const {
+        Rebuild();
+
+        std::vector<T> ret;
+        if (limit == 0) return ret;
+        const std::string folded = term.casefold().raw();
+
+        std::unordered_set<const T *> seen;
+        const auto add = [&](const T *id) -> bool {
+            if (!seen.insert(id).second) return false;
+            if (filter && !filter(*id)) return false;
+            ret.push_back(*id);
+            return ret.size() >= limit;
+        };
+
+        const auto find_prefix = [&](const std::vector<Start> &starts) -> bool {
+            auto it = std::lower_bound(starts.begin(), starts.end(), folded, [](const Start &start, const std::string &s) {
+                return start.Key < s;
+            });
+            for (; it != starts.end() && it->Key.compare(0, folded.size(), folded) == 0; it++)
+                if (add(it->ID)) return true;
+            return false;
+        };
+
+        if (find_prefix(m_names) || find_prefix(m_words) || folded.empty()) return ret;
+
+        for (size_t pos = m_blob.find(folded); pos != std::string::npos; pos = m_blob.find(folded, pos + 1)) {
+            const auto it = std::upper_bound(m_blob_ids.begin(), m_blob_ids.end(), pos, [](size_t p, const auto &e) {
+                return p < e.first;
+            });
+            if (add(std::prev(it)->second)) break;
+        }
+
+        return ret;
+    }
+
+private:
+    struct Entry {
+        std::string Name;
+        std::string Key;
+    };
+
+    struct Start {
+        std::string_view Key;
+        const T *ID;
+    };
+
+    static bool IsWordSeparator(char c) {
+        return c == ' ' || c == '_' || c == '-' || c == '.' || c == '\'';
+    }
+
+    void Rebuild() const {
+        if (!m_dirty) return;
+        m_dirty = false;
+
+        m_names.clear();
+        m_words.clear();
+        m_blob.clear();
+        m_blob_ids.clear();
+        m_names.reserve(m_entries.size());
+        m_blob_ids.reserve(m_entries.size());
+
+        for (const auto &[id, entry] : m_entries) {
+            const std::string_view key = entry.Key;
+            m_names.push_back({ key, &id });
+            for (size_t i = 1; i < key.size(); i++)
+                if (IsWordSeparator(key[i - 1]) && !IsWordSeparator(key[i]))
+                    m_words.push_back({ key.substr(i), &id });
+
+            // separator that cant appear in a casefolded term so matches never span two names
+            m_blob_ids.emplace_back(m_blob.size(), &id);
+            m_blob += entry.Key;
+            m_blob += '\n';
+        }
+
+        const auto cmp = [](const Start &a, const Start &b) {
+            return a.Key < b.Key;
+        };
+        std::sort(m_names.begin(), m_names.end(), cmp);
+        std::sort(m_words.begin(), m_words.end(), cmp);
+    }
+
+    std::unordered_map<T, Entry> m_entries;
+
+    mutable bool m_dirty = false;
+    mutable std::vector<Start> m_names;
+    mutable std::vector<Start> m_words;
+    mutable std::string m_blob;
+    mutable std::vector<std::pair<size_t, const T *>> m_blob_ids; // offset into m_blob
+};
+
+// indexes for the chat input completer, kept up to date from gateway events
+// everything per guild is built the first time that guild is searched
+class CompletionIndex {
+public:
+    struct User {
+        std::string Username;
+        std::string Discriminator;
+        std::string AvatarURL;
+    };
+
+    struct Emoji {
+        Snowflake GuildID;
+        std::string Name;
+        bool IsAnimated;
+    };
+
+    CompletionIndex(DiscordClient &discord, EmojiResource &emojis);
+
+    void Clear();
+
+    std::vector<Snowflake> FindMembers(Snowflake guild_id, const Glib::ustring &term, size_t limit);
+    bool UserMatches(Snowflake user_id, const Glib::ustring &term);
+    const User *GetUser(Snowflake user_id);
+
+    // only emojis that can be used anywhere (available, no role restrictions)
+    // searches every guild if guild_id isnt given
+    std::vector<Snowflake> FindEmojis(std::optional<Snowflake> guild_id, const Glib::ustring &term, size_t limit, bool allow_animated);
+    const Emoji *GetEmoji(Snowflake emoji_id) const;
+
+    // text channels and the like, no voice or categories
+    std::vector<Snowflake> FindChannels(Snowflake guild_id, const Glib::ustring &term, size_t limit);
+    const std::string *GetChannelName(Snowflake guild_id, Snowflake channel_id) const;
+
+    // shortcode -> pattern, one shortcode per stock emoji
+    std::vector<std::pair<std::string, std::string>> FindShortCodes(const Glib::ustring &term, size_t limit);
+
+private:
+    CompletionTable<Snowflake> &GetMemberTable(Snowflake guild_id);
+    CompletionTable<Snowflake> &GetChannelTable(Snowflake guild_id);
+    void BuildEmojis();
+    void SetGuildEmojis(Snowflake guild_id, const std::vector<EmojiData> &emojis);
+    void RemoveGuildEmojis(Snowflake guild_id);
+    const User *CacheUser(Snowflake user_id);
+    void IndexChannel(const ChannelData &channel);
+
+    void OnGuildCreate(const GuildData &guild);
+    void OnGuildDelete(Snowflake guild_id);
+    void OnGuildEmojisUpdate(Snowflake guild_id, const std::vector<EmojiData> &emojis);
+    void OnGuildUserAdded(Snowflake guild_id, Snowflake user_id);
+    void OnGuildMemberUpdate(Snowflake guild_id, Snowflake user_id);
+    void OnChannelCreate(const ChannelData &channel);
+    void OnChannelUpdate(Snowflake channel_id);
+    void OnChannelDelete(Snowflake channel_id);
+
+    DiscordClient &m_discord;
+    EmojiResource &m_emojis;
+
+    std::unordered_map<Snowflake, User> m_users;
+    std::unordered_map<Snowflake, CompletionTable<Snowflake>> m_members; // guild id -> usernames
+
+    bool m_emojis_built = false;
+    std::unordered_map<Snowflake, Emoji> m_emoji_data;
+    CompletionTable<Snowflake> m_all_emojis;
+    std::unordered_map<Snowflake, CompletionTable<Snowflake>> m_guild_emojis;
+
+    std::unordered_map<Snowflake, CompletionTable<Snowflake>> m_channels; // guild id -> channel names
+    std::unordered_map<Snowflake, Snowflake> m_channel_guild;
+
+    bool m_shortcodes_built = false;
+    CompletionTable<std::string> m_shortcodes;
+};
@@ -3,6 +3,7 @@
 #include "imgmanager.hpp"
 #include "statusindicator.hpp"
 #include "util.hpp"
+#include "discord/tracer.hpp"
 #include <algorithm>
 #include <map>
 #include <unordered_map>
@@ -34,6 +35,9 @@ ChannelList::ChannelList()
     const auto cb = [this](const Gtk::TreeModel::Path &path, Gtk::TreeViewColumn *column) {
         auto row = *m_model->get_iter(path);
         const auto type = row[m_columns.m_type];
+        // cant expand without children
+        if (type == RenderType::Guild)
+            PopulateGuildIfNeeded(static_cast<Snowflake>(row[m_columns.m_id]));
         // text channels should not be allowed to be collapsed
         // maybe they should be but it seems a little difficult to handle expansion to permit this
         if (type != RenderType::TextChannel) {
@@ -59,6 +63,9 @@ ChannelList::ChannelList()
     m_view.get_selection()->set_mode(Gtk::SELECTION_SINGLE);
     m_view.get_selection()->set_select_function(sigc::mem_fun(*this, &ChannelList::SelectionFunc));
     m_view.signal_button_press_event().connect(sigc::mem_fun(*this, &ChannelList::OnButtonPressEvent), false);
+    m_view.add_events(Gdk::POINTER_MOTION_MASK | Gdk::LEAVE_NOTIFY_MASK);
+    m_view.signal_motion_notify_event().connect(sigc::mem_fun(*this, &ChannelList::OnMotionNotifyEvent), false);
+    m_view.signal_leave_notify_event().connect(sigc::mem_fun(*this, &ChannelList::OnLeaveNotifyEvent), false);
 
     m_view.set_hexpand(true);
     m_view.set_vexpand(true);
@@ -79,6 +86,11 @@ ChannelList::ChannelList()
 
     add(m_view);
 
+    get_vadjustment()->signal_value_changed().connect([this]() {
+        if (!m_pending_guild_icons.empty())
+            QueueIdlePopulate();
+    });
+
     auto *column = Gtk::manage(new Gtk::TreeView::Column("display"));
     auto *renderer = Gtk::manage(new CellRendererChannels);
     column->pack_start(*renderer);
@@ -256,8 +268,14 @@ void ChannelList::OnPanedPositionChanged() {
 }
 
 void ChannelList::UpdateListing() {
+    Tracer::Span span("build channel list");
     m_updating_listing = true;
 
+    m_guild_rows.clear();
+    m_channel_rows.clear();
+    m_populate_queue.clear();
+    m_unpopulated_guilds.clear();
+    m_pending_guild_icons.clear();
     m_model->clear();
 
     auto &discord = Abaddon::Get().GetDiscordClient();
@@ -268,13 +286,18 @@ void ChannelList::UpdateListing() {
         const auto guild = discord.GetGuild(guild_id);
         if (!guild.has_value()) continue;
 
-        auto iter = AddGuild(*guild);
+        auto iter = AddGuildRow(*guild);
         (*iter)[m_columns.m_sort] = sortnum++;
+        m_populate_queue.push_back(guild_id);
+        m_unpopulated_guilds.insert(guild_id);
+        m_pending_guild_icons.insert(guild_id);
     }
 
     m_updating_listing = false;
 
     AddPrivateChannels();
+
+    QueueIdlePopulate();
 }
 
 void ChannelList::UpdateNewGuild(const GuildData &guild) {
@@ -325,8 +348,10 @@ void ChannelList::UpdateChannel(Snowflake id) {
 }
 
 void ChannelList::UpdateCreateChannel(const ChannelData &channel) {
-    if (channel.Type == ChannelType::GUILD_CATEGORY) return (void)UpdateCreateChannelCategory(channel);
     if (channel.Type == ChannelType::DM || channel.Type == ChannelType::GROUP_DM) return UpdateCreateDMChannel(channel);
+    // it will be picked up from the store when the guild is populated
+    if (channel.GuildID.has_value() && m_unpopulated_guilds.find(*channel.GuildID) != m_unpopulated_guilds.end()) return;
+    if (channel.Type == ChannelType::GUILD_CATEGORY) return (void)UpdateCreateChannelCategory(channel);
     if (channel.Type != ChannelType::GUILD_TEXT && channel.Type != ChannelType::GUILD_NEWS) return;
 
     Gtk::TreeRow channel_row;
@@ -342,6 +367,7 @@ void ChannelList::UpdateCreateChannel(const ChannelData &channel) {
     }
     channel_row[m_columns.m_type] = RenderType::TextChannel;
     channel_row[m_columns.m_id] = channel.ID;
+    IndexRow(channel_row);
     channel_row[m_columns.m_name] = "#" + Glib::Markup::escape_text(*channel.Name);
     channel_row[m_columns.m_nsfw] = channel.NSFW();
     if (orphan)
@@ -358,20 +384,8 @@ void ChannelList::UpdateGuild(Snowflake id) {
 
     (*iter)[m_columns.m_name] = "<b>" + Glib::Markup::escape_text(guild->Name) + "</b>";
     (*iter)[m_columns.m_icon] = img.GetPlaceholder(GuildIconSize);
-    if (Abaddon::Get().GetSettings().ShowAnimations && guild->HasAnimatedIcon()) {
-        const auto cb = [this, id](const Glib::RefPtr<Gdk::PixbufAnimation> &pb) {
-            auto iter = GetIteratorForGuildFromID(id);
-            if (iter) (*iter)[m_columns.m_icon_anim] = pb;
-        };
-        img.LoadAnimationFromURL(guild->GetIconURL("gif", "32"), GuildIconSize, GuildIconSize, sigc::track_obj(cb, *this));
-    } else if (guild->HasIcon()) {
-        const auto cb = [this, id](const Glib::RefPtr<Gdk::Pixbuf> &pb) {
-            // iter might be invalid
-            auto iter = GetIteratorForGuildFromID(id);
-            if (iter) (*iter)[m_columns.m_icon] = pb->scale_simple(GuildIconSize, GuildIconSize, Gdk::INTERP_BILINEAR);
-        };
-        img.LoadFromURL(guild->GetIconURL("png", "32"), sigc::track_obj(cb, *this));
-    }
+    m_pending_guild_icons.erase(id);
+    LoadGuildIcon(*guild);
 }
 
 void ChannelList::OnThreadJoined(Snowflake id) {
@@ -469,6 +483,10 @@ void ChannelList::SetActiveChannel(Snowflake id, bool expand_to) {
 
     m_active_channel = id;
 
+    if (!m_unpopulated_guilds.empty())
+        if (const auto channel = Abaddon::Get().GetDiscordClient().GetChannel(id); channel.has_value() && channel->GuildID.has_value())
+            PopulateGuildIfNeeded(*channel->GuildID);
+
     if (m_temporary_thread_row) {
         const auto thread_id = static_cast<Snowflake>((*m_temporary_thread_row)[m_columns.m_id]);
         const auto thread = Abaddon::Get().GetDiscordClient().GetChannel(thread_id);
@@ -495,14 +513,20 @@ void ChannelList::SetActiveChannel(Snowflake id, bool expand_to) {
 }
 
 void ChannelList::UseExpansionState(const ExpansionStateRoot &root) {
+    // guilds that stay collapsed arent populated yet so their rows dont exist
+    // PopulateGuild picks this up whenever they are
+    m_saved_expansion.clear();
+    for (const auto &[id, state] : root.Children)
+        m_saved_expansion[id] = state.Children;
+
     auto recurse = [this](auto &self, const ExpansionStateRoot &root) -> void {
         // and these are only channels
         for (const auto &[id, state] : root.Children) {
-            if (const auto iter = m_tmp_channel_map.find(id); iter != m_tmp_channel_map.end()) {
+            if (const auto iter = GetIteratorForChannelFromID(id)) {
                 if (state.IsExpanded)
-                    m_view.expand_row(m_model->get_path(iter->second), false);
+                    m_view.expand_row(m_model->get_path(iter), false);
                 else
-                    m_view.collapse_row(m_model->get_path(iter->second));
+                    m_view.collapse_row(m_model->get_path(iter));
             }
 
             self(self, state.Children);
@@ -511,6 +535,8 @@ void ChannelList::UseExpansionState(const ExpansionStateRoot &root) {
 
     // top level is guild
     for (const auto &[id, state] : root.Children) {
+        if (state.IsExpanded)
+            PopulateGuildIfNeeded(id);
         if (const auto iter = GetIteratorForGuildFromID(id)) {
             if (state.IsExpanded)
                 m_view.expand_row(m_model->get_path(iter), false);
@@ -520,8 +546,6 @@ void ChannelList::UseExpansionState(const ExpansionStateRoot &root) {
 
         recurse(recurse, state.Children);
     }
-
-    m_tmp_channel_map.clear();
 }
 
 ExpansionStateRoot ChannelList::GetExpansionState() const {
@@ -541,21 +565,37 @@ ExpansionStateRoot ChannelList::GetExpansionState() const {
         const auto id = static_cast<Snowflake>(child[m_columns.m_id]);
         if (static_cast<uint64_t>(id) == 0ULL) continue; // dont save DM header
         r.Children[id] = recurse(recurse, child);
+        // not built yet, keep what was loaded instead of saving it as empty
+        if (const auto it = m_saved_expansion.find(id); it != m_saved_expansion.end())
+            r.Children[id].Children = it->second;
     }
 
     return r;
 }
 
 Gtk::TreeModel::iterator ChannelList::AddGuild(const GuildData &guild) {
-    auto &discord = Abaddon::Get().GetDiscordClient();
+    auto guild_row = AddGuildRow(guild);
+    LoadGuildIcon(guild);
+    PopulateGuild(guild_row, guild);
+    return guild_row;
+}
+
+Gtk::TreeModel::iterator ChannelList::AddGuildRow(const GuildData &guild) {
     auto &img = Abaddon::Get().GetImageManager();
 
     auto guild_row = *m_model->append();
     guild_row[m_columns.m_type] = RenderType::Guild;
     guild_row[m_columns.m_id] = guild.ID;
+    IndexRow(guild_row);
     guild_row[m_columns.m_name] = "<b>" + Glib::Markup::escape_text(guild.Name) + "</b>";
     guild_row[m_columns.m_icon] = img.GetPlaceholder(GuildIconSize);
 
+    return guild_row;
+}
+
+void ChannelList::LoadGuildIcon(const GuildData &guild) {
+    auto &img = Abaddon::Get().GetImageManager();
+
     if (Abaddon::Get().GetSettings().ShowAnimations && guild.HasAnimatedIcon()) {
         const auto cb = [this, id = guild.ID](const Glib::RefPtr<Gdk::PixbufAnimation> &pb) {
             auto iter = GetIteratorForGuildFromID(id);
@@ -564,13 +604,30 @@ Gtk::TreeModel::iterator ChannelList::AddGuild(const GuildData &guild) {
         img.LoadAnimationFromURL(guild.GetIconURL("gif", "32"), GuildIconSize, GuildIconSize, sigc::track_obj(cb, *this));
     } else if (guild.HasIcon()) {
         const auto cb = [this, id = guild.ID](const Glib::RefPtr<Gdk::Pixbuf> &pb) {
+            // iter might be invalid
             auto iter = GetIteratorForGuildFromID(id);
             if (iter) (*iter)[m_columns.m_icon] = pb->scale_simple(GuildIconSize, GuildIconSize, Gdk::INTERP_BILINEAR);
         };
         img.LoadFromURL(guild.GetIconURL("png", "32"), sigc::track_obj(cb, *this));
     }
+}
+
+void ChannelList::PopulateGuild(const Gtk::TreeModel::iterator &guild_iter, const GuildData &guild) {
+    auto &discord = Abaddon::Get().GetDiscordClient();
+    auto guild_row = *guild_iter;
 
-    if (!guild.Channels.has_value()) return guild_row;
+    if (!guild.Channels.has_value()) return;
+
+    // anything without saved state starts out expanded
+    ExpansionStateRoot saved;
+    if (const auto it = m_saved_expansion.find(guild.ID); it != m_saved_expansion.end()) {
+        saved = std::move(it->second);
+        m_saved_expansion.erase(it);
+    }
+    const auto get_saved = [](const ExpansionStateRoot &root, Snowflake id) -> const ExpansionState * {
+        const auto it = root.Children.find(id);
+        return it == root.Children.end() ? nullptr : &it->second;
+    };
 
     // separate out the channels
     std::vector<ChannelData> orphan_channels;
@@ -595,25 +652,26 @@ Gtk::TreeModel::iterator ChannelList::AddGuild(const GuildData &guild) {
         if (thread.has_value())
             threads[*thread->ParentID].push_back(*thread);
     }
-    const auto add_threads = [&](const ChannelData &channel, const Gtk::TreeRow &row) {
-        row[m_columns.m_expanded] = true;
+    const auto add_threads = [&](const ChannelData &channel, const Gtk::TreeRow &row, const ExpansionStateRoot &parent) {
+        const auto *state = get_saved(parent, channel.ID);
+        row[m_columns.m_expanded] = state == nullptr || state->IsExpanded;
 
         const auto it = threads.find(channel.ID);
         if (it == threads.end()) return;
 
         for (const auto &thread : it->second)
-            m_tmp_channel_map[thread.ID] = CreateThreadRow(row.children(), thread);
+            CreateThreadRow(row.children(), thread);
     };
 
     for (const auto &channel : orphan_channels) {
         auto channel_row = *m_model->append(guild_row.children());
         channel_row[m_columns.m_type] = RenderType::TextChannel;
         channel_row[m_columns.m_id] = channel.ID;
+        IndexRow(channel_row);
         channel_row[m_columns.m_name] = "#" + Glib::Markup::escape_text(*channel.Name);
         channel_row[m_columns.m_sort] = *channel.Position + OrphanChannelSortOffset;
         channel_row[m_columns.m_nsfw] = channel.NSFW();
-        add_threads(channel, channel_row);
-        m_tmp_channel_map[channel.ID] = channel_row;
+        add_threads(channel, channel_row, saved);
     }
 
     for (const auto &[category_id, channels] : categories) {
@@ -622,25 +680,84 @@ Gtk::TreeModel::iterator ChannelList::AddGuild(const GuildData &guild) {
         auto cat_row = *m_model->append(guild_row.children());
         cat_row[m_columns.m_type] = RenderType::Category;
         cat_row[m_columns.m_id] = category_id;
+        IndexRow(cat_row);
         cat_row[m_columns.m_name] = Glib::Markup::escape_text(*category->Name);
         cat_row[m_columns.m_sort] = *category->Position;
-        cat_row[m_columns.m_expanded] = true;
-        m_tmp_channel_map[category_id] = cat_row;
+        const auto *cat_state = get_saved(saved, category_id);
+        cat_row[m_columns.m_expanded] = cat_state == nullptr || cat_state->IsExpanded;
         // m_view.expand_row wont work because it might not have channels
+        static const ExpansionStateRoot empty;
+        const auto &cat_saved = cat_state == nullptr ? empty : cat_state->Children;
 
         for (const auto &channel : channels) {
             auto channel_row = *m_model->append(cat_row.children());
             channel_row[m_columns.m_type] = RenderType::TextChannel;
             channel_row[m_columns.m_id] = channel.ID;
+            IndexRow(channel_row);
             channel_row[m_columns.m_name] = "#" + Glib::Markup::escape_text(*channel.Name);
             channel_row[m_columns.m_sort] = *channel.Position;
             channel_row[m_columns.m_nsfw] = channel.NSFW();
-            add_threads(channel, channel_row);
-            m_tmp_channel_map[channel.ID] = channel_row;
+            add_threads(channel, channel_row, cat_saved);
         }
     }
+}
 
-    return guild_row;
+bool ChannelList::PopulateGuildIfNeeded(Snowflake id) {
+    if (m_unpopulated_guilds.erase(id) == 0) return false;
+
+    const auto guild = Abaddon::Get().GetDiscordClient().GetGuild(id);
+    const auto iter = GetIteratorForGuildFromID(id);
+    if (!guild.has_value() || !iter) return false;
+
+    PopulateGuild(iter, *guild);
+    return true;
+}
+
+void ChannelList::QueueIdlePopulate() {
+    if (!m_idle_populate_conn.connected())
+        m_idle_populate_conn = Glib::signal_idle().connect(sigc::mem_fun(*this, &ChannelList::OnIdlePopulate));
+}
+
+bool ChannelList::OnIdlePopulate() {
+    LoadVisibleGuildIcons();
+
+    // then some offscreen ones
+    for (int i = 0; i < IconsPerPopulateChunk && !m_pending_guild_icons.empty(); i++) {
+        const auto id = *m_pending_guild_icons.begin();
+        m_pending_guild_icons.erase(m_pending_guild_icons.begin());
+        if (const auto guild = Abaddon::Get().GetDiscordClient().GetGuild(id))
+            LoadGuildIcon(*guild);
+    }
+
+    // dont want the row_inserted handler expanding stuff for rows nobody has looked at
+    m_updating_listing = true;
+    for (int i = 0; i < GuildsPerPopulateChunk && !m_populate_queue.empty();) {
+        const auto id = m_populate_queue.front();
+        m_populate_queue.pop_front();
+        if (PopulateGuildIfNeeded(id)) i++;
+    }
+    m_updating_listing = false;
+
+    return !m_populate_queue.empty() || !m_pending_guild_icons.empty();
+}
+
+void ChannelList::LoadVisibleGuildIcons() {
+    if (m_pending_guild_icons.empty()) return;
+
+    Gtk::TreeModel::Path start, end;
+    if (!m_view.get_visible_range(start, end)) return;
+    // only care about top level rows
+    while (start.size() > 1) start.up();
+    while (end.size() > 1) end.up();
+
+    auto &discord = Abaddon::Get().GetDiscordClient();
+    for (auto iter = m_model->get_iter(start); iter; iter++) {
+        const auto id = static_cast<Snowflake>((*iter)[m_columns.m_id]);
+        if ((*iter)[m_columns.m_type] == RenderType::Guild && m_pending_guild_icons.erase(id) > 0)
+            if (const auto guild = discord.GetGuild(id))
+                LoadGuildIcon(*guild);
+        if (m_model->get_path(iter) == end) break;
+    }
 }
 
 Gtk::TreeModel::iterator ChannelList::UpdateCreateChannelCategory(const ChannelData &channel) {
@@ -650,6 +767,7 @@ Gtk::TreeModel::iterator ChannelList::UpdateCreateChannelCategory(const ChannelD
     auto cat_row = *m_model->append(iter->children());
     cat_row[m_columns.m_type] = RenderType::Category;
     cat_row[m_columns.m_id] = channel.ID;
+    IndexRow(cat_row);
     cat_row[m_columns.m_name] = Glib::Markup::escape_text(*channel.Name);
     cat_row[m_columns.m_sort] = *channel.Position;
     cat_row[m_columns.m_expanded] = true;
@@ -662,6 +780,7 @@ Gtk::TreeModel::iterator ChannelList::CreateThreadRow(const Gtk::TreeNodeChildre
     auto thread_row = *thread_iter;
     thread_row[m_columns.m_type] = RenderType::Thread;
     thread_row[m_columns.m_id] = channel.ID;
+    IndexRow(thread_iter);
     thread_row[m_columns.m_name] = "- " + Glib::Markup::escape_text(*channel.Name);
     thread_row[m_columns.m_sort] = static_cast<int64_t>(channel.ID);
     thread_row[m_columns.m_nsfw] = false;
@@ -678,28 +797,29 @@ void ChannelList::UpdateChannelCategory(const ChannelData &channel) {
 }
 
 Gtk::TreeModel::iterator ChannelList::GetIteratorForGuildFromID(Snowflake id) {
-    for (const auto &child : m_model->children()) {
-        if (child[m_columns.m_id] == id)
-            return child;
-    }
-    return {};
+    return GetIteratorFromIndex(m_guild_rows, id);
 }
 
 Gtk::TreeModel::iterator ChannelList::GetIteratorForChannelFromID(Snowflake id) {
-    std::queue<Gtk::TreeModel::iterator> queue;
-    for (const auto &child : m_model->children())
-        for (const auto &child2 : child.children())
-            queue.push(child2);
+    return GetIteratorFromIndex(m_channel_rows, id);
+}
 
-    while (!queue.empty()) {
-        auto item = queue.front();
-        if ((*item)[m_columns.m_id] == id) return item;
-        for (const auto &child : item->children())
-            queue.push(child);
-        queue.pop();
-    }
+void ChannelList::IndexRow(const Gtk::TreeModel::iterator &iter) {
+    const auto id = static_cast<Snowflake>((*iter)[m_columns.m_id]);
+    const auto type = static_cast<RenderType>((*iter)[m_columns.m_type]);
+    auto &index = type == RenderType::Guild ? m_guild_rows : m_channel_rows;
+    index[id] = Gtk::TreeRowReference(m_model, m_model->get_path(iter));
+}
 
-    return {};
+Gtk::TreeModel::iterator ChannelList::GetIteratorFromIndex(std::unordered_map<Snowflake, Gtk::TreeRowReference> &index, Snowflake id) {
+    const auto it = index.find(id);
+    if (it == index.end()) return {};
+    // row (or one of its parents) was erased so drop the entry
+    if (!it->second.is_valid()) {
+        index.erase(it);
+        return {};
+    }
+    return m_model->get_iter(it->second.get_path());
 }
 
 bool ChannelList::IsTextChannel(ChannelType type) {
@@ -745,7 +865,7 @@ void ChannelList::AddPrivateChannels() {
     auto &discord = Abaddon::Get().GetDiscordClient();
     auto &img = Abaddon::Get().GetImageManager();
 
-    const auto dm_ids = discord.GetPrivateChannels();
+    const auto &dm_ids = discord.GetPrivateChannels();
     for (const auto dm_id : dm_ids) {
         const auto dm = discord.GetChannel(dm_id);
         if (!dm.has_value()) continue;
@@ -759,6 +879,7 @@ void ChannelList::AddPrivateChannels() {
         auto row = *iter;
         row[m_columns.m_type] = RenderType::DM;
         row[m_columns.m_id] = dm_id;
+        IndexRow(iter);
         row[m_columns.m_sort] = static_cast<int64_t>(-(dm->LastMessageID.has_value() ? *dm->LastMessageID : dm_id));
         row[m_columns.m_icon] = img.GetPlaceholder(DMIconSize);
 
@@ -767,17 +888,14 @@ void ChannelList::AddPrivateChannels() {
         else if (dm->Type == ChannelType::GROUP_DM)
             row[m_columns.m_name] = std::to_string(recipients.size()) + " members";
 
+        // iter might be invalid by the time these run
+        const auto cb = [this, dm_id](const Glib::RefPtr<Gdk::Pixbuf> &pb) {
+            if (auto iter = GetIteratorForChannelFromID(dm_id))
+                (*iter)[m_columns.m_icon] = pb->scale_simple(DMIconSize, DMIconSize, Gdk::INTERP_BILINEAR);
+        };
         if (dm->HasIcon()) {
-            const auto cb = [this, iter](const Glib::RefPtr<Gdk::Pixbuf> &pb) {
-                if (iter)
-                    (*iter)[m_columns.m_icon] = pb->scale_simple(DMIconSize, DMIconSize, Gdk::INTERP_BILINEAR);
-            };
             img.LoadFromURL(dm->GetIconURL(), sigc::track_obj(cb, *this));
         } else if (top_recipient.has_value()) {
-            const auto cb = [this, iter](const Glib::RefPtr<Gdk::Pixbuf> &pb) {
-                if (iter)
-                    (*iter)[m_columns.m_icon] = pb->scale_simple(DMIconSize, DMIconSize, Gdk::INTERP_BILINEAR);
-            };
             img.LoadFromURL(top_recipient->GetAvatarURL("png", "32"), sigc::track_obj(cb, *this));
         }
     }
@@ -796,6 +914,7 @@ void ChannelList::UpdateCreateDMChannel(const ChannelData &dm) {
     auto row = *iter;
     row[m_columns.m_type] = RenderType::DM;
     row[m_columns.m_id] = dm.ID;
+    IndexRow(iter);
     row[m_columns.m_sort] = static_cast<int64_t>(-(dm.LastMessageID.has_value() ? *dm.LastMessageID : dm.ID));
     row[m_columns.m_icon] = img.GetPlaceholder(DMIconSize);
 
@@ -805,8 +924,8 @@ void ChannelList::UpdateCreateDMChannel(const ChannelData &dm) {
         row[m_columns.m_name] = std::to_string(recipients.size()) + " members";
 
     if (top_recipient.has_value()) {
-        const auto cb = [this, iter](const Glib::RefPtr<Gdk::Pixbuf> &pb) {
-            if (iter)
+        const auto cb = [this, id = dm.ID](const Glib::RefPtr<Gdk::Pixbuf> &pb) {
+            if (auto iter = GetIteratorForChannelFromID(id))
                 (*iter)[m_columns.m_icon] = pb->scale_simple(DMIconSize, DMIconSize, Gdk::INTERP_BILINEAR);
         };
         img.LoadFromURL(top_recipient->GetAvatarURL("png", "32"), sigc::track_obj(cb, *this));
@@ -880,6 +999,39 @@ bool ChannelList::OnButtonPressEvent(GdkEventButton *ev) {
     return false;
 }
 
+bool ChannelList::OnMotionNotifyEvent(GdkEventMotion *ev) {
+    Gtk::TreeModel::Path path;
+    if (!m_view.get_path_at_pos(static_cast<int>(ev->x), static_cast<int>(ev->y), path)) {
+        SetHoveredChannel(Snowflake::Invalid);
+        return false;
+    }
+
+    auto row = (*m_model->get_iter(path));
+    switch (static_cast<RenderType>(row[m_columns.m_type])) {
+        case RenderType::TextChannel:
+        case RenderType::Thread:
+        case RenderType::DM:
+            SetHoveredChannel(static_cast<Snowflake>(row[m_columns.m_id]));
+            break;
+        default:
+            SetHoveredChannel(Snowflake::Invalid);
+            break;
+    }
+    return false;
+}
+
+bool ChannelList::OnLeaveNotifyEvent(GdkEventCrossing *ev) {
+    SetHoveredChannel(Snowflake::Invalid);
+    return false;
+}
+
+void ChannelList::SetHoveredChannel(Snowflake id) {
+    // motion events come in constantly, only tell anyone when the row changes
+    if (id == m_hovered_channel) return;
+    m_hovered_channel = id;
+    m_signal_channel_hovered.emit(id);
+}
+
 void ChannelList::MoveRow(const Gtk::TreeModel::iterator &iter, const Gtk::TreeModel::iterator &new_parent) {
     // duplicate the row data under the new parent and then delete the old row
     auto row = *m_model->append(new_parent->children());
@@ -895,6 +1047,7 @@ void ChannelList::MoveRow(const Gtk::TreeModel::iterator &iter, const Gtk::TreeM
     M(m_nsfw);
     M(m_expanded);
 #undef M
+    IndexRow(row);
 
     // recursively move children
     // weird construct to work around iterator invalidation (at least i think thats what the problem was)
@@ -991,6 +1144,10 @@ ChannelList::type_signal_action_guild_settings ChannelList::signal_action_guild_
     return m_signal_action_guild_settings;
 }
 
+ChannelList::type_signal_channel_hovered ChannelList::signal_channel_hovered() {
+    return m_signal_channel_hovered;
+}
+
 #ifdef WITH_LIBHANDY
 ChannelList::type_signal_action_open_new_tab ChannelList::signal_action_open_new_tab() {
     return m_signal_action_open_new_tab;
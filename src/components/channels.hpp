@@ -2,6 +2,7 @@
 #include <gtkmm.h>
 #include <string>
 #include <queue>
+#include <deque>
 #include <mutex>
 #include <unordered_set>
 #include <unordered_map>
@@ -13,6 +14,8 @@
 constexpr static int GuildIconSize = 24;
 constexpr static int DMIconSize = 20;
 constexpr static int OrphanChannelSortOffset = -100; // forces orphan channels to the top of the list
+constexpr static int GuildsPerPopulateChunk = 4;      // guilds filled in per idle callback
+constexpr static int IconsPerPopulateChunk = 8;       // offscreen guild icons started per idle callback
 
 class ChannelList : public Gtk::ScrolledWindow {
 public:
@@ -73,6 +76,21 @@ protected:
     Glib::RefPtr<Gtk::TreeStore> m_model;
 
     Gtk::TreeModel::iterator AddGuild(const GuildData &guild);
+    Gtk::TreeModel::iterator AddGuildRow(const GuildData &guild);
+    void PopulateGuild(const Gtk::TreeModel::iterator &guild_iter, const GuildData &guild);
+    void LoadGuildIcon(const GuildData &guild);
+
+    // UpdateListing only creates guild rows, channels are built on expand or in idle chunks
+    // icons are loaded in idle chunks too, ones that are on screen first
+    bool PopulateGuildIfNeeded(Snowflake id);
+    void QueueIdlePopulate();
+    bool OnIdlePopulate();
+    void LoadVisibleGuildIcons();
+    std::deque<Snowflake> m_populate_queue;
+    std::unordered_set<Snowflake> m_unpopulated_guilds;
+    std::unordered_set<Snowflake> m_pending_guild_icons;
+    std::unordered_map<Snowflake, ExpansionStateRoot> m_saved_expansion; // for guilds that werent populated yet when it was loaded
+    sigc::connection m_idle_populate_conn;
     Gtk::TreeModel::iterator UpdateCreateChannelCategory(const ChannelData &channel);
     Gtk::TreeModel::iterator CreateThreadRow(const Gtk::TreeNodeChildren &children, const ChannelData &channel);
 
@@ -82,12 +100,22 @@ protected:
     Gtk::TreeModel::iterator GetIteratorForGuildFromID(Snowflake id);
     Gtk::TreeModel::iterator GetIteratorForChannelFromID(Snowflake id);
 
+    // must be called for every row once its type and id are set
+    // references follow the row through re-sorts and go invalid when its deleted (directly or with a parent)
+    void IndexRow(const Gtk::TreeModel::iterator &iter);
+    Gtk::TreeModel::iterator GetIteratorFromIndex(std::unordered_map<Snowflake, Gtk::TreeRowReference> &index, Snowflake id);
+    std::unordered_map<Snowflake, Gtk::TreeRowReference> m_guild_rows;
+    std::unordered_map<Snowflake, Gtk::TreeRowReference> m_channel_rows; // categories, channels, threads, dms
+
     bool IsTextChannel(ChannelType type);
 
     void OnRowCollapsed(const Gtk::TreeModel::iterator &iter, const Gtk::TreeModel::Path &path) const;
     void OnRowExpanded(const Gtk::TreeModel::iterator &iter, const Gtk::TreeModel::Path &path);
     bool SelectionFunc(const Glib::RefPtr<Gtk::TreeModel> &model, const Gtk::TreeModel::Path &path, bool is_currently_selected);
     bool OnButtonPressEvent(GdkEventButton *ev);
+    bool OnMotionNotifyEvent(GdkEventMotion *ev);
+    bool OnLeaveNotifyEvent(GdkEventCrossing *ev);
+    void SetHoveredChannel(Snowflake id);
 
     void MoveRow(const Gtk::TreeModel::iterator &iter, const Gtk::TreeModel::iterator &new_parent);
 
@@ -151,15 +179,13 @@ protected:
     bool m_updating_listing = false;
 
     Snowflake m_active_channel;
-
-    // (GetIteratorForChannelFromID is rather slow)
-    // only temporary since i dont want to worry about maintaining this map
-    std::unordered_map<Snowflake, Gtk::TreeModel::iterator> m_tmp_channel_map;
+    Snowflake m_hovered_channel;
 
 public:
     using type_signal_action_channel_item_select = sigc::signal<void, Snowflake>;
     using type_signal_action_guild_leave = sigc::signal<void, Snowflake>;
     using type_signal_action_guild_settings = sigc::signal<void, Snowflake>;
+    using type_signal_channel_hovered = sigc::signal<void, Snowflake>; // invalid when the pointer leaves
 
 #ifdef WITH_LIBHANDY
     using type_signal_action_open_new_tab = sigc::signal<void, Snowflake>;
@@ -169,11 +195,13 @@ public:
     type_signal_action_channel_item_select signal_action_channel_item_select();
     type_signal_action_guild_leave signal_action_guild_leave();
     type_signal_action_guild_settings signal_action_guild_settings();
+    type_signal_channel_hovered signal_channel_hovered();
 
 private:
     type_signal_action_channel_item_select m_signal_action_channel_item_select;
     type_signal_action_guild_leave m_signal_action_guild_leave;
     type_signal_action_guild_settings m_signal_action_guild_settings;
+    type_signal_channel_hovered m_signal_channel_hovered;
 
 #ifdef WITH_LIBHANDY
     type_signal_action_open_new_tab m_signal_action_open_new_tab;
@@ -1,5 +1,6 @@
 #include "chatinput.hpp"
 #include "abaddon.hpp"
+#include "gtkutil.hpp"
 #include "constants.hpp"
 #include <filesystem>
 
@@ -209,6 +210,7 @@ void ChatInputAttachmentContainer::Clear() {
         delete item;
     }
     m_attachments.clear();
+    m_encoding.clear();
 }
 
 void ChatInputAttachmentContainer::ClearNoPurge() {
@@ -216,23 +218,23 @@ void ChatInputAttachmentContainer::ClearNoPurge() {
         delete item;
     }
     m_attachments.clear();
+    m_encoding.clear();
 }
 
 bool ChatInputAttachmentContainer::AddImage(const Glib::RefPtr<Gdk::Pixbuf> &pb) {
     if (m_attachments.size() == 10) return false;
 
+    // kept out of the temp cache since a message still in the outbox on exit needs it next time
+    // so the name has to be unique across runs too
     static unsigned go_up = 0;
-    std::string dest_name = "pasted-image-" + std::to_string(go_up++);
-    const auto path = (std::filesystem::temp_directory_path() / "abaddon-cache" / dest_name).string();
-
-    try {
-        pb->save(path, "png");
-    } catch (...) {
-        fprintf(stderr, "pasted image save error\n");
-        return false;
-    }
-
-    auto *item = Gtk::make_managed<ChatInputAttachmentItem>(Gio::File::create_for_path(path), pb);
+    std::string dest_name = "pasted-image-" + std::to_string(Snowflake::FromNow()) + "-" + std::to_string(go_up++);
+    const auto dir = std::filesystem::path(Abaddon::GetStateCachePath("/pasted"));
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    const auto path_stem = (dir / dest_name).string();
+
+    // show it right away, the file shows up once the encoder is done
+    auto *item = Gtk::make_managed<ChatInputAttachmentItem>(Glib::RefPtr<Gio::File>(), pb);
     item->set_valign(Gtk::ALIGN_FILL);
     item->set_vexpand(true);
     item->set_margin_bottom(5);
@@ -243,6 +245,7 @@ bool ChatInputAttachmentContainer::AddImage(const Glib::RefPtr<Gdk::Pixbuf> &pb)
 
     item->signal_item_removed().connect([this, item] {
         item->RemoveIfTemp();
+        StopEncoding(item);
         if (auto it = std::find(m_attachments.begin(), m_attachments.end(), item); it != m_attachments.end())
             m_attachments.erase(it);
         delete item;
@@ -250,9 +253,50 @@ bool ChatInputAttachmentContainer::AddImage(const Glib::RefPtr<Gdk::Pixbuf> &pb)
             m_signal_emptied.emit();
     });
 
+    const auto id = m_next_encode_id++;
+    m_encoding[id] = item;
+    const size_t size_target = Abaddon::Get().GetSettings().PasteJPEGFallback ? BaseAttachmentSizeLimit : 0;
+    m_encoder.Encode(pb, path_stem, size_target, [this, id](const PasteEncoder::Result &result) {
+        OnEncoded(id, result);
+    });
+
     return true;
 }
 
+void ChatInputAttachmentContainer::OnEncoded(uint64_t id, const PasteEncoder::Result &result) {
+    const auto it = m_encoding.find(id);
+    if (it == m_encoding.end()) {
+        // removed or sent off while it was being written
+        if (result.Success) Gio::File::create_for_path(result.Path)->remove();
+        return;
+    }
+    auto *item = it->second;
+    m_encoding.erase(it);
+
+    if (result.Success) {
+        item->SetEncodedFile(Gio::File::create_for_path(result.Path), result.Extension);
+    } else {
+        if (auto pos = std::find(m_attachments.begin(), m_attachments.end(), item); pos != m_attachments.end())
+            m_attachments.erase(pos);
+        delete item;
+    }
+
+    if (m_attachments.empty())
+        m_signal_emptied.emit();
+    if (m_encoding.empty())
+        m_signal_encoded.emit();
+}
+
+void ChatInputAttachmentContainer::StopEncoding(ChatInputAttachmentItem *item) {
+    for (auto it = m_encoding.begin(); it != m_encoding.end(); it++) {
+        if (it->second != item) continue;
+        m_encoding.erase(it);
+        if (m_encoding.empty())
+            m_signal_encoded.emit();
+        return;
+    }
+}
+
 bool ChatInputAttachmentContainer::AddFile(const Glib::RefPtr<Gio::File> &file, Glib::RefPtr<Gdk::Pixbuf> pb) {
     if (m_attachments.size() == 10) return false;
 
@@ -283,6 +327,7 @@ bool ChatInputAttachmentContainer::AddFile(const Glib::RefPtr<Gio::File> &file,
 std::vector<ChatSubmitParams::Attachment> ChatInputAttachmentContainer::GetAttachments() const {
     std::vector<ChatSubmitParams::Attachment> ret;
     for (auto *x : m_attachments) {
+        if (!x->IsReady()) continue;
         if (!x->GetFile()->query_exists())
             puts("bad!");
         ret.push_back({ x->GetFile(), x->GetType(), x->GetFilename() });
@@ -290,10 +335,18 @@ std::vector<ChatSubmitParams::Attachment> ChatInputAttachmentContainer::GetAttac
     return ret;
 }
 
+bool ChatInputAttachmentContainer::IsEncoding() const {
+    return !m_encoding.empty();
+}
+
 ChatInputAttachmentContainer::type_signal_emptied ChatInputAttachmentContainer::signal_emptied() {
     return m_signal_emptied;
 }
 
+ChatInputAttachmentContainer::type_signal_encoded ChatInputAttachmentContainer::signal_encoded() {
+    return m_signal_encoded;
+}
+
 ChatInputAttachmentItem::ChatInputAttachmentItem(const Glib::RefPtr<Gio::File> &file)
     : m_file(file)
     , m_img(Gtk::make_managed<Gtk::Image>())
@@ -362,6 +415,8 @@ ChatInputAttachmentItem::ChatInputAttachmentItem(const Glib::RefPtr<Gio::File> &
 
     if (is_extant)
         SetFilenameFromFile();
+    else if (!m_file)
+        set_opacity(0.5); // still encoding
 
     SetupMenu();
     UpdateTooltip();
@@ -383,11 +438,26 @@ bool ChatInputAttachmentItem::IsTemp() const noexcept {
     return m_type == ChatSubmitParams::PastedImage;
 }
 
+bool ChatInputAttachmentItem::IsReady() const noexcept {
+    return static_cast<bool>(m_file);
+}
+
 void ChatInputAttachmentItem::RemoveIfTemp() {
-    if (IsTemp())
+    if (IsTemp() && m_file)
         m_file->remove();
 }
 
+void ChatInputAttachmentItem::SetEncodedFile(const Glib::RefPtr<Gio::File> &file, const std::string &extension) {
+    m_file = file;
+    // keep a name the user picked, otherwise match what it actually got encoded as
+    if (m_filename == "unknown.png") {
+        m_filename = "unknown." + extension;
+        m_label.set_text(m_filename);
+        UpdateTooltip();
+    }
+    set_opacity(1.0);
+}
+
 void ChatInputAttachmentItem::SetFilenameFromFile() {
     auto info = m_file->query_info(G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME);
     m_filename = info->get_attribute_string(G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME);
@@ -437,22 +507,27 @@ ChatInput::ChatInput()
     m_input.signal_add_attachment().connect(sigc::mem_fun(*this, &ChatInput::AddAttachment));
 
     m_input.Get().signal_escape().connect([this] {
+        m_submit_when_encoded = false;
         m_attachments.Clear();
         m_attachments_revealer.set_reveal_child(false);
         m_signal_escape.emit();
     });
 
     m_input.Get().signal_submit().connect([this](const Glib::ustring &input) -> bool {
-        ChatSubmitParams data;
-        data.Message = input;
-        data.Attachments = m_attachments.GetAttachments();
-
-        bool b = m_signal_submit.emit(data);
-        if (b) {
-            m_attachments_revealer.set_reveal_child(false);
-            m_attachments.ClearNoPurge();
+        if (m_attachments.IsEncoding()) {
+            // the text stays in the box and goes out once the pastes are written
+            m_submit_when_encoded = true;
+            return false;
         }
-        return b;
+        return Submit(input);
+    });
+
+    m_attachments.signal_encoded().connect([this] {
+        if (!m_submit_when_encoded) return;
+        m_submit_when_encoded = false;
+        auto buf = m_input.Get().GetBuffer();
+        if (Submit(buf->get_text()))
+            buf->set_text("");
     });
 
     m_attachments.set_vexpand(false);
@@ -481,6 +556,19 @@ ChatInput::ChatInput()
     SetActiveChannel(Snowflake::Invalid);
 }
 
+bool ChatInput::Submit(const Glib::ustring &text) {
+    ChatSubmitParams data;
+    data.Message = text;
+    data.Attachments = m_attachments.GetAttachments();
+
+    bool b = m_signal_submit.emit(data);
+    if (b) {
+        m_attachments_revealer.set_reveal_child(false);
+        m_attachments.ClearNoPurge();
+    }
+    return b;
+}
+
 void ChatInput::InsertText(const Glib::ustring &text) {
     m_input.Get().InsertText(text);
 }
@@ -534,6 +622,10 @@ void ChatInput::IndicateTooLarge() {
 }
 
 void ChatInput::SetActiveChannel(Snowflake id) {
+    // a submit waiting on the encoder was meant for the old channel
+    // the text and attachments stay in the box so it can just be sent again
+    if (id != m_active_channel)
+        m_submit_when_encoded = false;
     m_active_channel = id;
     if (CanAttachFiles()) {
         m_input.Get().get_style_context()->add_class("with-browse-icon");
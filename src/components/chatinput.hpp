@@ -1,7 +1,9 @@
 #pragma once
+#include <unordered_map>
 #include <gtkmm.h>
 #include "discord/chatsubmitparams.hpp"
 #include "discord/permissions.hpp"
+#include "pasteencoder.hpp"
 
 class ChatInputAttachmentItem : public Gtk::EventBox {
 public:
@@ -12,7 +14,10 @@ public:
     [[nodiscard]] ChatSubmitParams::AttachmentType GetType() const;
     [[nodiscard]] std::string GetFilename() const;
     [[nodiscard]] bool IsTemp() const noexcept;
+    [[nodiscard]] bool IsReady() const noexcept;
     void RemoveIfTemp();
+    // pasted images dont have a file until the encoder is done with them
+    void SetEncodedFile(const Glib::RefPtr<Gio::File> &file, const std::string &extension);
 
 private:
     void SetFilenameFromFile();
@@ -49,19 +54,30 @@ public:
     bool AddImage(const Glib::RefPtr<Gdk::Pixbuf> &pb);
     bool AddFile(const Glib::RefPtr<Gio::File> &file, Glib::RefPtr<Gdk::Pixbuf> pb = {});
     [[nodiscard]] std::vector<ChatSubmitParams::Attachment> GetAttachments() const;
+    [[nodiscard]] bool IsEncoding() const;
 
 private:
+    void OnEncoded(uint64_t id, const PasteEncoder::Result &result);
+    void StopEncoding(ChatInputAttachmentItem *item);
+
     std::vector<ChatInputAttachmentItem *> m_attachments;
 
     Gtk::Box m_box;
 
+    PasteEncoder m_encoder;
+    std::unordered_map<uint64_t, ChatInputAttachmentItem *> m_encoding; // pastes still being written
+    uint64_t m_next_encode_id = 0;
+
 private:
     using type_signal_emptied = sigc::signal<void>;
+    using type_signal_encoded = sigc::signal<void>;
 
     type_signal_emptied m_signal_emptied;
+    type_signal_encoded m_signal_encoded;
 
 public:
     type_signal_emptied signal_emptied();
+    type_signal_encoded signal_encoded(); // nothing is being encoded anymore
 };
 
 class ChatInputText : public Gtk::ScrolledWindow {
@@ -140,6 +156,9 @@ public:
 private:
     bool AddFileAsImageAttachment(const Glib::RefPtr<Gio::File> &file);
     bool CanAttachFiles();
+    bool Submit(const Glib::ustring &text);
+
+    bool m_submit_when_encoded = false;
 
     Gtk::Revealer m_attachments_revealer;
     ChatInputAttachmentContainer m_attachments;
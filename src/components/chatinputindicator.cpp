@@ -37,21 +37,45 @@ ChatInputIndicator::ChatInputIndicator()
     } catch (...) {}
 }
 
-void ChatInputIndicator::AddUser(Snowflake channel_id, const UserData &user, int timeout) {
-    auto current_connection_it = m_typers[channel_id].find(user.ID);
-    if (current_connection_it != m_typers.at(channel_id).end()) {
-        current_connection_it->second.disconnect();
-        m_typers.at(channel_id).erase(current_connection_it);
+void ChatInputIndicator::AddUser(Snowflake channel_id, Snowflake user_id) {
+    const auto expiry = m_tick + TypingIndicatorTimeout;
+    m_typers[channel_id][user_id] = expiry;
+    m_wheel[expiry % WheelSlots].emplace_back(channel_id, user_id);
+    if (!m_wheel_conn.connected())
+        m_wheel_conn = Glib::signal_timeout().connect_seconds(sigc::mem_fun(*this, &ChatInputIndicator::OnWheelTick), 1);
+
+    if (channel_id == m_active_channel)
+        ComputeTypingString();
+}
+
+bool ChatInputIndicator::OnWheelTick() {
+    m_tick++;
+    auto &slot = m_wheel[m_tick % WheelSlots];
+    bool active_changed = false;
+    for (const auto &[channel_id, user_id] : slot) {
+        auto channel_it = m_typers.find(channel_id);
+        if (channel_it == m_typers.end()) continue;
+        auto user_it = channel_it->second.find(user_id);
+        if (user_it == channel_it->second.end() || user_it->second != m_tick) continue;
+        channel_it->second.erase(user_it);
+        if (channel_it->second.empty())
+            m_typers.erase(channel_it);
+        if (channel_id == m_active_channel)
+            active_changed = true;
     }
+    slot.clear();
 
-    Snowflake user_id = user.ID;
-    auto cb = [this, user_id, channel_id]() -> bool {
-        m_typers.at(channel_id).erase(user_id);
+    if (active_changed)
         ComputeTypingString();
+
+    // nobody typing anywhere so anything left in the wheel is stale
+    if (m_typers.empty()) {
+        for (auto &s : m_wheel)
+            s.clear();
         return false;
-    };
-    m_typers[channel_id][user.ID] = Glib::signal_timeout().connect_seconds(cb, timeout);
-    ComputeTypingString();
+    }
+
+    return true;
 }
 
 void ChatInputIndicator::SetActiveChannel(Snowflake id) {
@@ -70,16 +94,19 @@ void ChatInputIndicator::ClearCustom() {
 }
 
 void ChatInputIndicator::OnUserTypingStart(Snowflake user_id, Snowflake channel_id) {
-    const auto &discord = Abaddon::Get().GetDiscordClient();
-    const auto user = discord.GetUser(user_id);
-    if (!user.has_value()) return;
-
-    AddUser(channel_id, *user, 10);
+    // just bookkeeping unless its the channel on screen
+    AddUser(channel_id, user_id);
 }
 
 void ChatInputIndicator::OnMessageCreate(const Message &message) {
-    m_typers[message.ChannelID].erase(message.Author.ID);
-    ComputeTypingString();
+    auto it = m_typers.find(message.ChannelID);
+    if (it == m_typers.end()) return;
+    // the wheel entry goes stale and gets dropped on its tick
+    it->second.erase(message.Author.ID);
+    if (it->second.empty())
+        m_typers.erase(it);
+    if (message.ChannelID == m_active_channel)
+        ComputeTypingString();
 }
 
 void ChatInputIndicator::SetTypingString(const Glib::ustring &str) {
@@ -99,10 +126,12 @@ void ChatInputIndicator::ComputeTypingString() {
 
     const auto &discord = Abaddon::Get().GetDiscordClient();
     std::vector<UserData> typers;
-    for (const auto &[id, conn] : m_typers[m_active_channel]) {
-        const auto user = discord.GetUser(id);
-        if (user.has_value())
-            typers.push_back(*user);
+    if (const auto it = m_typers.find(m_active_channel); it != m_typers.end()) {
+        for (const auto &[id, expiry] : it->second) {
+            const auto user = discord.GetUser(id);
+            if (user.has_value())
+                typers.push_back(*user);
+        }
     }
     if (typers.empty()) {
         SetTypingString("");
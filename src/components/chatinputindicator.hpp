@@ -1,8 +1,11 @@
 #pragma once
 #include <gtkmm.h>
+#include <array>
 #include <unordered_map>
+#include <vector>
 #include "discord/message.hpp"
 #include "discord/user.hpp"
+#include "constants.hpp"
 
 class ChatInputIndicator : public Gtk::Box {
 public:
@@ -12,9 +15,10 @@ public:
     void ClearCustom();
 
 private:
-    void AddUser(Snowflake channel_id, const UserData &user, int timeout);
+    void AddUser(Snowflake channel_id, Snowflake user_id);
     void OnUserTypingStart(Snowflake user_id, Snowflake channel_id);
     void OnMessageCreate(const Message &message);
+    bool OnWheelTick();
     void SetTypingString(const Glib::ustring &str);
     void ComputeTypingString();
 
@@ -24,5 +28,13 @@ private:
     Glib::ustring m_custom_markup;
 
     Snowflake m_active_channel;
-    std::unordered_map<Snowflake, std::unordered_map<Snowflake, sigc::connection>> m_typers; // channel id -> [user id -> connection]
+    std::unordered_map<Snowflake, std::unordered_map<Snowflake, uint64_t>> m_typers; // channel id -> [user id -> expiry tick]
+
+    // one timer ticking every second instead of one per typer
+    // entries are (channel id, user id) and are stale if the typer's expiry tick doesnt match anymore
+    static constexpr int WheelSlots = 16;
+    static_assert(WheelSlots > TypingIndicatorTimeout);
+    std::array<std::vector<std::pair<Snowflake, Snowflake>>, WheelSlots> m_wheel;
+    uint64_t m_tick = 0;
+    sigc::connection m_wheel_conn;
 };
@@ -2,6 +2,8 @@
 #include "abaddon.hpp"
 #include "chatmessage.hpp"
 #include "constants.hpp"
+#include "discord/loopprofiler.hpp"
+#include "discord/tracer.hpp"
 
 ChatList::ChatList() {
     m_list.get_style_context()->add_class("messages");
@@ -35,27 +37,48 @@ void ChatList::Clear() {
         it++;
     }
     m_id_to_widget.clear();
+    m_pending_nonces.clear();
     m_num_messages = 0;
     m_num_rows = 0;
+
+    m_renderer.Cancel();
+    m_awaiting_page = false;
+    m_deferred_messages.clear();
+    m_deferred_updates.clear();
+    m_deferred_failed_nonces.clear();
 }
 
 void ChatList::SetActiveChannel(Snowflake id) {
     m_active_channel = id;
 }
 
+ContentTokenFlags ChatList::GetRenderFlags() {
+    return ChatMessageItemContainer::GetContentFlags();
+}
+
 void ChatList::ProcessNewMessage(const Message &data, bool prepend) {
+    if (!prepend && m_awaiting_page) {
+        m_deferred_messages.push_back(data);
+        return;
+    }
+    ProcessNewMessage(data, prepend, nullptr);
+}
+
+void ChatList::ProcessNewMessage(const Message &data, bool prepend, std::shared_ptr<const ChatRenderModel> model) {
+    LoopProfiler::Scope scope("chatlist message");
+    Tracer::Span span("build message");
     auto &discord = Abaddon::Get().GetDiscordClient();
     if (!discord.IsStarted()) return;
     if (!prepend) m_ignore_next_upper = true;
 
     // delete preview message when gateway sends it back
     if (!data.IsPending && data.Nonce.has_value() && data.Author.ID == discord.GetUserData().ID) {
-        for (auto [id, widget] : m_id_to_widget) {
-            if (dynamic_cast<ChatMessageItemContainer *>(widget)->Nonce == *data.Nonce) {
-                RemoveMessageAndHeader(widget);
-                m_id_to_widget.erase(id);
-                break;
+        if (const auto nonce_it = m_pending_nonces.find(*data.Nonce); nonce_it != m_pending_nonces.end()) {
+            if (const auto it = m_id_to_widget.find(nonce_it->second); it != m_id_to_widget.end()) {
+                RemoveMessageAndHeader(it->second);
+                m_id_to_widget.erase(it);
             }
+            m_pending_nonces.erase(nonce_it);
         }
     }
 
@@ -108,10 +131,12 @@ void ChatList::ProcessNewMessage(const Message &data, bool prepend) {
         m_num_rows++;
     }
 
-    auto *content = ChatMessageItemContainer::FromMessage(data);
+    auto *content = ChatMessageItemContainer::FromMessage(data, std::move(model));
     if (content != nullptr) {
         header->AddContent(content, prepend);
         m_id_to_widget[data.ID] = content;
+        if (data.IsPending && data.Nonce.has_value())
+            m_pending_nonces[*data.Nonce] = data.ID;
 
         const auto cb = [this, id = data.ID](GdkEventButton *ev) -> bool {
             if (ev->type == GDK_BUTTON_PRESS && ev->button == GDK_BUTTON_SECONDARY) {
@@ -173,7 +198,10 @@ void ChatList::ProcessNewMessage(const Message &data, bool prepend) {
 
 void ChatList::DeleteMessage(Snowflake id) {
     auto widget = m_id_to_widget.find(id);
-    if (widget == m_id_to_widget.end()) return;
+    if (widget == m_id_to_widget.end()) {
+        DeferUpdate(id);
+        return;
+    }
 
     auto *x = dynamic_cast<ChatMessageItemContainer *>(widget->second);
     if (x != nullptr)
@@ -182,7 +210,10 @@ void ChatList::DeleteMessage(Snowflake id) {
 
 void ChatList::RefetchMessage(Snowflake id) {
     auto widget = m_id_to_widget.find(id);
-    if (widget == m_id_to_widget.end()) return;
+    if (widget == m_id_to_widget.end()) {
+        DeferUpdate(id);
+        return;
+    }
 
     auto *x = dynamic_cast<ChatMessageItemContainer *>(widget->second);
     if (x != nullptr) {
@@ -198,21 +229,33 @@ Snowflake ChatList::GetOldestListedMessage() {
         return Snowflake::Invalid;
 }
 
+int ChatList::GetNumMessages() const {
+    return m_num_messages;
+}
+
 void ChatList::UpdateMessageReactions(Snowflake id) {
     auto it = m_id_to_widget.find(id);
-    if (it == m_id_to_widget.end()) return;
+    if (it == m_id_to_widget.end()) {
+        DeferUpdate(id);
+        return;
+    }
     auto *widget = dynamic_cast<ChatMessageItemContainer *>(it->second);
     if (widget == nullptr) return;
     widget->UpdateReactions();
 }
 
 void ChatList::SetFailedByNonce(const std::string &nonce) {
-    for (auto [id, widget] : m_id_to_widget) {
-        if (auto *container = dynamic_cast<ChatMessageItemContainer *>(widget); container->Nonce == nonce) {
-            container->SetFailed();
-            break;
-        }
+    const auto nonce_it = m_pending_nonces.find(nonce);
+    if (nonce_it == m_pending_nonces.end()) {
+        // the preview might be waiting on the page
+        if (m_awaiting_page || m_renderer.IsBusy())
+            m_deferred_failed_nonces.insert(nonce);
+        return;
     }
+    const auto it = m_id_to_widget.find(nonce_it->second);
+    if (it == m_id_to_widget.end()) return;
+    if (auto *container = dynamic_cast<ChatMessageItemContainer *>(it->second); container != nullptr)
+        container->SetFailed();
 }
 
 std::vector<Snowflake> ChatList::GetRecentAuthors() {
@@ -232,7 +275,7 @@ std::vector<Snowflake> ChatList::GetRecentAuthors() {
 
     const auto chan = discord.GetChannel(m_active_channel);
     if (chan->GuildID.has_value()) {
-        const auto others = discord.GetUsersInGuild(*chan->GuildID);
+        const auto &others = discord.GetUsersInGuild(*chan->GuildID);
         for (const auto id : others)
             if (std::find(ret.begin(), ret.end(), id) == ret.end())
                 ret.push_back(id);
@@ -315,7 +358,8 @@ void ChatList::ScrollToBottom() {
 
 void ChatList::OnVAdjustmentValueChanged() {
     auto v = get_vadjustment();
-    if (m_history_timer.elapsed() > 1 && v->get_value() < 500) {
+    // dont ask for more while the last page is still rendering, the oldest listed message hasnt moved yet
+    if (m_history_timer.elapsed() > 1 && v->get_value() < 500 && !m_renderer.IsBusy()) {
         m_history_timer.start();
         m_signal_action_chat_load_history.emit(m_active_channel);
     }
@@ -351,6 +395,45 @@ void ChatList::RemoveMessageAndHeader(Gtk::Widget *widget) {
     m_num_messages--;
 }
 
+void ChatList::DeferUpdate(Snowflake id) {
+    if (m_awaiting_page || m_renderer.IsBusy())
+        m_deferred_updates.insert(id);
+}
+
+void ChatList::ApplyDeferredUpdates() {
+    // the page was built from a copy taken before it started rendering, catch up on whatever changed since
+    const auto &discord = Abaddon::Get().GetDiscordClient();
+    for (auto it = m_deferred_updates.begin(); it != m_deferred_updates.end();) {
+        const auto widget = m_id_to_widget.find(*it);
+        if (widget == m_id_to_widget.end()) {
+            it++;
+            continue;
+        }
+        auto *x = dynamic_cast<ChatMessageItemContainer *>(widget->second);
+        if (x != nullptr && discord.GetMessage(*it).has_value()) {
+            x->UpdateContent();
+            x->UpdateAttributes();
+            x->UpdateReactions();
+        }
+        it = m_deferred_updates.erase(it);
+    }
+
+    for (auto it = m_deferred_failed_nonces.begin(); it != m_deferred_failed_nonces.end();) {
+        if (m_pending_nonces.find(*it) == m_pending_nonces.end()) {
+            it++;
+            continue;
+        }
+        SetFailedByNonce(*it);
+        it = m_deferred_failed_nonces.erase(it);
+    }
+
+    // nothing else is coming, anything left over was never going to be listed
+    if (!m_awaiting_page && !m_renderer.IsBusy()) {
+        m_deferred_updates.clear();
+        m_deferred_failed_nonces.clear();
+    }
+}
+
 ChatList::type_signal_action_message_edit ChatList::signal_action_message_edit() {
     return m_signal_action_message_edit;
 }
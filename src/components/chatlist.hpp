@@ -1,9 +1,12 @@
 #pragma once
 #include <gtkmm.h>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include "discord/message.hpp"
 #include "discord/snowflake.hpp"
+#include "chatrender.hpp"
 
 class ChatList : public Gtk::ScrolledWindow {
 public:
@@ -18,6 +21,7 @@ public:
     void DeleteMessage(Snowflake id);
     void RefetchMessage(Snowflake id);
     Snowflake GetOldestListedMessage();
+    int GetNumMessages() const;
     void UpdateMessageReactions(Snowflake id);
     void SetFailedByNonce(const std::string &nonce);
     std::vector<Snowflake> GetRecentAuthors();
@@ -28,10 +32,14 @@ public:
 private:
     void SetupMenu();
     void ScrollToBottom();
+    void ProcessNewMessage(const Message &data, bool prepend, std::shared_ptr<const ChatRenderModel> model);
+    static ContentTokenFlags GetRenderFlags();
     void OnVAdjustmentValueChanged();
     void OnVAdjustmentUpperChanged();
     void OnListSizeAllocate(Gtk::Allocation &allocation);
     void RemoveMessageAndHeader(Gtk::Widget *widget);
+    void DeferUpdate(Snowflake id);
+    void ApplyDeferredUpdates();
 
     bool m_use_pinned_menu = false;
 
@@ -50,6 +58,7 @@ private:
     int m_num_messages = 0;
     int m_num_rows = 0;
     std::map<Snowflake, Gtk::Widget *> m_id_to_widget;
+    std::unordered_map<std::string, Snowflake> m_pending_nonces; // previews of our own messages, the id they are listed under
 
     bool m_ignore_next_upper = false;
     double m_old_upper = -1.0;
@@ -60,6 +69,15 @@ private:
 
     Glib::Timer m_history_timer;
 
+    // pages are rendered off the main thread, live messages that arrive while the initial page is
+    // still rendering wait for it so they dont end up above it
+    ChatRenderer m_renderer;
+    bool m_awaiting_page = false;
+    std::vector<Message> m_deferred_messages;
+    // edits, deletes, reactions and failures for messages that werent listed yet because their page was rendering
+    std::unordered_set<Snowflake> m_deferred_updates;
+    std::unordered_set<std::string> m_deferred_failed_nonces;
+
 public:
     // these are all forwarded by the parent
     using type_signal_action_message_edit = sigc::signal<void, Snowflake, Snowflake>;
@@ -98,14 +116,29 @@ inline void ChatList::SetMessages(Iter begin, Iter end) {
     m_num_messages = 0;
     m_id_to_widget.clear();
 
-    for (Iter it = begin; it != end; it++)
-        ProcessNewMessage(*it, false);
-
-    ScrollToBottom();
+    std::vector<Message> messages(begin, end);
+    m_awaiting_page = true;
+    m_renderer.Render(messages, GetRenderFlags(), [this, messages](const ChatRenderer::models_type &models) {
+        m_awaiting_page = false;
+        for (size_t i = 0; i < messages.size(); i++)
+            ProcessNewMessage(messages[i], false, models[i]);
+
+        auto deferred = std::move(m_deferred_messages);
+        m_deferred_messages.clear();
+        for (const auto &msg : deferred)
+            ProcessNewMessage(msg, false);
+        ApplyDeferredUpdates();
+
+        ScrollToBottom();
+    });
 }
 
 template<typename Iter>
 inline void ChatList::PrependMessages(Iter begin, Iter end) {
-    for (Iter it = begin; it != end; it++)
-        ProcessNewMessage(*it, true);
+    std::vector<Message> messages(begin, end);
+    m_renderer.Render(messages, GetRenderFlags(), [this, messages](const ChatRenderer::models_type &models) {
+        for (size_t i = 0; i < messages.size(); i++)
+            ProcessNewMessage(messages[i], true, models[i]);
+        ApplyDeferredUpdates();
+    });
 }
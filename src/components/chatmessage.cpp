@@ -2,6 +2,7 @@
 #include "chatmessage.hpp"
 #include "lazyimage.hpp"
 #include "util.hpp"
+#include "gtkutil.hpp"
 #include <unordered_map>
 
 constexpr static int EmojiSize = 24; // settings eventually
@@ -22,10 +23,11 @@ ChatMessageItemContainer::ChatMessageItemContainer()
     m_link_menu.show_all();
 }
 
-ChatMessageItemContainer *ChatMessageItemContainer::FromMessage(const Message &data) {
+ChatMessageItemContainer *ChatMessageItemContainer::FromMessage(const Message &data, std::shared_ptr<const ChatRenderModel> model) {
     auto *container = Gtk::manage(new ChatMessageItemContainer);
     container->ID = data.ID;
     container->ChannelID = data.ChannelID;
+    container->m_render_model = std::move(model);
 
     if (data.Nonce.has_value())
         container->Nonce = *data.Nonce;
@@ -90,8 +92,12 @@ ChatMessageItemContainer *ChatMessageItemContainer::FromMessage(const Message &d
 // this doesnt rly make sense
 void ChatMessageItemContainer::UpdateContent() {
     const auto data = Abaddon::Get().GetDiscordClient().GetMessage(ID);
+    if (!data.has_value()) return;
+
+    // content changed so the model has to be redone
+    m_render_model = nullptr;
     if (m_text_component != nullptr)
-        UpdateTextComponent(m_text_component);
+        UpdateTextComponent(m_text_component, *data);
 
     if (m_embed_component != nullptr) {
         delete m_embed_component;
@@ -174,28 +180,20 @@ Gtk::TextView *ChatMessageItemContainer::CreateTextComponent(const Message &data
 
     tv->signal_button_press_event().connect(sigc::mem_fun(*this, &ChatMessageItemContainer::OnTextViewButtonPress), false);
 
-    UpdateTextComponent(tv);
+    UpdateTextComponent(tv, data);
 
     return tv;
 }
 
-void ChatMessageItemContainer::UpdateTextComponent(Gtk::TextView *tv) {
-    const auto data = Abaddon::Get().GetDiscordClient().GetMessage(ID);
-    if (!data.has_value()) return;
-
+void ChatMessageItemContainer::UpdateTextComponent(Gtk::TextView *tv, const Message &data) {
     auto b = tv->get_buffer();
     b->set_text("");
     Gtk::TextBuffer::iterator s, e;
     b->get_bounds(s, e);
-    switch (data->Type) {
+    switch (data.Type) {
         case MessageType::DEFAULT:
         case MessageType::INLINE_REPLY:
-            b->insert(s, data->Content);
-            HandleRoleMentions(b);
-            HandleUserMentions(b);
-            HandleLinks(*tv);
-            HandleChannelMentions(tv);
-            HandleEmojis(*tv);
+            InsertRenderModel(*tv, GetRenderModel(data));
             break;
         case MessageType::USER_PREMIUM_GUILD_SUBSCRIPTION:
             b->insert_markup(s, "<span color='#999999'><i>[boosted server]</i></span>");
@@ -207,56 +205,52 @@ void ChatMessageItemContainer::UpdateTextComponent(Gtk::TextView *tv) {
             b->insert_markup(s, "<span color='#999999'><i>[message pinned]</i></span>");
             break;
         case MessageType::APPLICATION_COMMAND: {
-            if (data->Application.has_value()) {
+            if (data.Application.has_value()) {
                 static const auto regex = Glib::Regex::create(R"(</(.*?):(\d+)>)");
                 Glib::MatchInfo match;
-                if (regex->match(data->Content, match)) {
+                if (regex->match(data.Content, match)) {
                     const auto cmd = match.fetch(1);
-                    const auto app = data->Application->Name;
+                    const auto app = data.Application->Name;
                     b->insert_markup(s, "<i>used <span color='#697ec4'>" + cmd + "</span> with " + app + "</i>");
                 }
             } else {
-                b->insert(s, data->Content);
-                HandleUserMentions(b);
-                HandleLinks(*tv);
-                HandleChannelMentions(tv);
-                HandleEmojis(*tv);
+                InsertRenderModel(*tv, GetRenderModel(data));
             }
         } break;
         case MessageType::RECIPIENT_ADD: {
-            if (data->Mentions.empty()) break;
-            const auto &adder = Abaddon::Get().GetDiscordClient().GetUser(data->Author.ID);
-            const auto &added = data->Mentions[0];
+            if (data.Mentions.empty()) break;
+            const auto &adder = Abaddon::Get().GetDiscordClient().GetUser(data.Author.ID);
+            const auto &added = data.Mentions[0];
             b->insert_markup(s, "<i><span color='#999999'><span color='#eeeeee'>" + adder->Username + "</span> added <span color='#eeeeee'>" + added.Username + "</span></span></i>");
         } break;
         case MessageType::RECIPIENT_REMOVE: {
-            if (data->Mentions.empty()) break;
-            const auto &adder = Abaddon::Get().GetDiscordClient().GetUser(data->Author.ID);
-            const auto &added = data->Mentions[0];
+            if (data.Mentions.empty()) break;
+            const auto &adder = Abaddon::Get().GetDiscordClient().GetUser(data.Author.ID);
+            const auto &added = data.Mentions[0];
             if (adder->ID == added.ID)
                 b->insert_markup(s, "<i><span color='#999999'><span color='#eeeeee'>" + adder->Username + "</span> left</span></i>");
             else
                 b->insert_markup(s, "<i><span color='#999999'><span color='#eeeeee'>" + adder->Username + "</span> removed <span color='#eeeeee'>" + added.Username + "</span></span></i>");
         } break;
         case MessageType::CHANNEL_NAME_CHANGE: {
-            const auto author = Abaddon::Get().GetDiscordClient().GetUser(data->Author.ID);
-            b->insert_markup(s, "<i><span color='#999999'>" + author->GetEscapedBoldName() + " changed the name to <b>" + Glib::Markup::escape_text(data->Content) + "</b></span></i>");
+            const auto author = Abaddon::Get().GetDiscordClient().GetUser(data.Author.ID);
+            b->insert_markup(s, "<i><span color='#999999'>" + author->GetEscapedBoldName() + " changed the name to <b>" + Glib::Markup::escape_text(data.Content) + "</b></span></i>");
         } break;
         case MessageType::CHANNEL_ICON_CHANGE: {
-            const auto author = Abaddon::Get().GetDiscordClient().GetUser(data->Author.ID);
+            const auto author = Abaddon::Get().GetDiscordClient().GetUser(data.Author.ID);
             b->insert_markup(s, "<i><span color='#999999'>" + author->GetEscapedBoldName() + " changed the channel icon</span></i>");
         } break;
         case MessageType::USER_PREMIUM_GUILD_SUBSCRIPTION_TIER_1:
         case MessageType::USER_PREMIUM_GUILD_SUBSCRIPTION_TIER_2:
         case MessageType::USER_PREMIUM_GUILD_SUBSCRIPTION_TIER_3: {
-            const auto author = Abaddon::Get().GetDiscordClient().GetUser(data->Author.ID);
-            const auto guild = Abaddon::Get().GetDiscordClient().GetGuild(*data->GuildID);
-            b->insert_markup(s, "<i><span color='#999999'>" + author->GetEscapedBoldName() + " just boosted the server <b>" + Glib::Markup::escape_text(data->Content) + "</b> times! " +
-                                    Glib::Markup::escape_text(guild->Name) + " has achieved <b>Level " + std::to_string(static_cast<int>(data->Type) - 8) + "!</b></span></i>"); // oo cheeky me !!!
+            const auto author = Abaddon::Get().GetDiscordClient().GetUser(data.Author.ID);
+            const auto guild = Abaddon::Get().GetDiscordClient().GetGuild(*data.GuildID);
+            b->insert_markup(s, "<i><span color='#999999'>" + author->GetEscapedBoldName() + " just boosted the server <b>" + Glib::Markup::escape_text(data.Content) + "</b> times! " +
+                                    Glib::Markup::escape_text(guild->Name) + " has achieved <b>Level " + std::to_string(static_cast<int>(data.Type) - 8) + "!</b></span></i>"); // oo cheeky me !!!
         } break;
         case MessageType::CHANNEL_FOLLOW_ADD: {
-            const auto author = Abaddon::Get().GetDiscordClient().GetUser(data->Author.ID);
-            b->insert_markup(s, "<i><span color='#999999'>" + author->GetEscapedBoldName() + " has added <b>" + Glib::Markup::escape_text(data->Content) + "</b> to this channel. Its most important updates will show up here.</span></i>");
+            const auto author = Abaddon::Get().GetDiscordClient().GetUser(data.Author.ID);
+            b->insert_markup(s, "<i><span color='#999999'>" + author->GetEscapedBoldName() + " has added <b>" + Glib::Markup::escape_text(data.Content) + "</b> to this channel. Its most important updates will show up here.</span></i>");
         } break;
         case MessageType::CALL: {
             b->insert_markup(s, "<span color='#999999'><i>[started a call]</i></span>");
@@ -274,15 +268,15 @@ void ChatMessageItemContainer::UpdateTextComponent(Gtk::TextView *tv) {
             b->insert_markup(s, "<i><span color='#999999'>This server has failed Discovery activity requirements for 3 weeks in a row. If this server fails for 1 more week, it will be removed from Discovery.</span></i>");
         } break;
         case MessageType::THREAD_CREATED: {
-            const auto author = Abaddon::Get().GetDiscordClient().GetUser(data->Author.ID);
-            if (data->MessageReference.has_value() && data->MessageReference->ChannelID.has_value()) {
+            const auto author = Abaddon::Get().GetDiscordClient().GetUser(data.Author.ID);
+            if (data.MessageReference.has_value() && data.MessageReference->ChannelID.has_value()) {
                 auto iter = b->insert_markup(s, "<i><span color='#999999'>" + author->GetEscapedBoldName() + " started a thread: </span></i>");
                 auto tag = b->create_tag();
                 tag->property_weight() = Pango::WEIGHT_BOLD;
-                m_channel_tagmap[tag] = *data->MessageReference->ChannelID;
-                b->insert_with_tag(iter, data->Content, tag);
+                m_channel_tagmap[tag] = *data.MessageReference->ChannelID;
+                b->insert_with_tag(iter, data.Content, tag);
             } else {
-                b->insert_markup(s, "<i><span color='#999999'>" + author->GetEscapedBoldName() + " started a thread: </span><b>" + Glib::Markup::escape_text(data->Content) + "</b></i>");
+                b->insert_markup(s, "<i><span color='#999999'>" + author->GetEscapedBoldName() + " started a thread: </span><b>" + Glib::Markup::escape_text(data.Content) + "</b></i>");
             }
         } break;
         default: break;
@@ -702,14 +696,7 @@ Gtk::Widget *ChatMessageItemContainer::CreateReplyComponent(const Message &data)
                     text = "<i>embed</i>";
                 }
             } else {
-                auto buf = Gtk::TextBuffer::create();
-                Gtk::TextBuffer::iterator start, end;
-                buf->get_bounds(start, end);
-                buf->set_text(referenced.Content);
-                CleanupEmojis(buf);
-                HandleUserMentions(buf);
-                HandleChannelMentions(buf);
-                text = Glib::Markup::escape_text(buf->get_text());
+                text = Glib::Markup::escape_text(GetPlainContent(referenced.Content));
             }
             // getting markup out of a textbuffer seems like something that to me should be really simple
             // but actually is horribly annoying. replies won't have mention colors because you can't do this
@@ -729,13 +716,6 @@ Gtk::Widget *ChatMessageItemContainer::CreateReplyComponent(const Message &data)
     return box;
 }
 
-Glib::ustring ChatMessageItemContainer::GetText(const Glib::RefPtr<Gtk::TextBuffer> &buf) {
-    Gtk::TextBuffer::iterator a, b;
-    buf->get_bounds(a, b);
-    auto slice = buf->get_slice(a, b, true);
-    return slice;
-}
-
 bool ChatMessageItemContainer::IsEmbedImageOnly(const EmbedData &data) {
     if (!data.Thumbnail.has_value()) return false;
     if (data.Author.has_value()) return false;
@@ -747,238 +727,149 @@ bool ChatMessageItemContainer::IsEmbedImageOnly(const EmbedData &data) {
     return data.Thumbnail->ProxyURL.has_value() && data.Thumbnail->URL.has_value() && data.Thumbnail->Width.has_value() && data.Thumbnail->Height.has_value();
 }
 
-void ChatMessageItemContainer::HandleRoleMentions(const Glib::RefPtr<Gtk::TextBuffer> &buf) {
-    constexpr static const auto mentions_regex = R"(<@&(\d+)>)";
-
-    static auto rgx = Glib::Regex::create(mentions_regex);
+ContentTokenFlags ChatMessageItemContainer::GetContentFlags() {
+    const auto &settings = Abaddon::Get().GetSettings();
+    auto flags = ContentTokenFlags::UserMentions | ContentTokenFlags::ChannelMentions | ContentTokenFlags::Links;
+    if (settings.ShowStockEmojis) flags |= ContentTokenFlags::StockEmojis;
+    if (settings.ShowCustomEmojis) flags |= ContentTokenFlags::CustomEmojis;
+    return flags;
+}
 
-    Glib::ustring text = GetText(buf);
-    const auto &discord = Abaddon::Get().GetDiscordClient();
+const ChatRenderModel &ChatMessageItemContainer::GetRenderModel(const Message &data) {
+    if (m_render_model == nullptr)
+        m_render_model = ChatRenderer::RenderNow(data, GetContentFlags());
+    return *m_render_model;
+}
 
-    int startpos = 0;
-    Glib::MatchInfo match;
-    while (rgx->match(text, startpos, match)) {
-        int mstart, mend;
-        if (!match.fetch_pos(0, mstart, mend)) break;
-        const Glib::ustring role_id = match.fetch(1);
-        const auto role = discord.GetRole(role_id);
-        if (!role.has_value()) {
-            startpos = mend;
-            continue;
-        }
+void ChatMessageItemContainer::InsertRenderModel(Gtk::TextView &tv, const ChatRenderModel &model) {
+    auto buf = tv.get_buffer();
+    auto &emojis = Abaddon::Get().GetEmojis();
 
-        Glib::ustring replacement;
-        if (role->HasColor()) {
-            replacement = "<b><span color=\"#" + IntToCSSColor(role->Color) + "\">@" + role->GetEscapedName() + "</span></b>";
-        } else {
-            replacement = "<b>@" + role->GetEscapedName() + "</b>";
+    std::unordered_map<std::string, Glib::RefPtr<Gdk::Pixbuf>> stock_pixbufs;
+    for (const auto &span : model.Spans) {
+        switch (span.Type) {
+            case ContentSpanType::RoleMention:
+            case ContentSpanType::UserMention:
+                buf->insert_markup(buf->end(), span.Markup);
+                break;
+            case ContentSpanType::ChannelMention: {
+                auto tag = buf->create_tag();
+                if (span.IsClickable) {
+                    m_channel_tagmap[tag] = span.ID;
+                    tag->property_weight() = Pango::WEIGHT_BOLD;
+                }
+                buf->insert_with_tag(buf->end(), span.Text, tag);
+            } break;
+            case ContentSpanType::Link: {
+                auto tag = buf->create_tag();
+                m_link_tagmap[tag] = span.URL;
+                tag->property_foreground_rgba() = Gdk::RGBA(Abaddon::Get().GetSettings().LinkColor);
+                tag->set_property("underline", 1); // stupid workaround for vcpkg bug (i think)
+                buf->insert_with_tag(buf->end(), span.Text, tag);
+            } break;
+            case ContentSpanType::CustomEmoji:
+                InsertCustomEmoji(tv, span);
+                break;
+            case ContentSpanType::StockEmoji: {
+                auto &pixbuf = stock_pixbufs[span.Text];
+                if (!pixbuf) {
+                    pixbuf = emojis.GetPixBuf(span.Text);
+                    if (pixbuf)
+                        pixbuf = pixbuf->scale_simple(EmojiSize, EmojiSize, Gdk::INTERP_BILINEAR);
+                }
+                if (pixbuf)
+                    buf->insert_pixbuf(buf->end(), pixbuf);
+                else
+                    buf->insert(buf->end(), span.Text);
+            } break;
+            case ContentSpanType::Text:
+            default:
+                buf->insert(buf->end(), span.Text);
+                break;
         }
-
-        const auto chars_start = g_utf8_pointer_to_offset(text.c_str(), text.c_str() + mstart);
-        const auto chars_end = g_utf8_pointer_to_offset(text.c_str(), text.c_str() + mend);
-        const auto start_it = buf->get_iter_at_offset(chars_start);
-        const auto end_it = buf->get_iter_at_offset(chars_end);
-
-        auto it = buf->erase(start_it, end_it);
-        buf->insert_markup(it, replacement);
-
-        text = GetText(buf);
-        startpos = 0;
     }
 }
 
-void ChatMessageItemContainer::HandleUserMentions(const Glib::RefPtr<Gtk::TextBuffer> &buf) const {
-    constexpr static const auto mentions_regex = R"(<@!?(\d+)>)";
-
-    static auto rgx = Glib::Regex::create(mentions_regex);
-
-    Glib::ustring text = GetText(buf);
+Glib::ustring ChatMessageItemContainer::GetPlainContent(const std::string &content) const {
     const auto &discord = Abaddon::Get().GetDiscordClient();
-
-    int startpos = 0;
-    Glib::MatchInfo match;
-    while (rgx->match(text, startpos, match)) {
-        int mstart, mend;
-        if (!match.fetch_pos(0, mstart, mend)) break;
-        const Glib::ustring user_id = match.fetch(1);
-        const auto user = discord.GetUser(user_id);
-        const auto channel = discord.GetChannel(ChannelID);
-        if (!user.has_value() || !channel.has_value()) {
-            startpos = mend;
-            continue;
-        }
-
-        Glib::ustring replacement;
-
-        if (channel->Type == ChannelType::DM || channel->Type == ChannelType::GROUP_DM)
-            replacement = user->GetEscapedBoldString<true>();
-        else {
-            const auto role_id = user->GetHoistedRole(*channel->GuildID, true);
-            const auto role = discord.GetRole(role_id);
-            if (!role.has_value())
-                replacement = user->GetEscapedBoldString<true>();
-            else
-                replacement = "<span color=\"#" + IntToCSSColor(role->Color) + "\">" + user->GetEscapedBoldString<true>() + "</span>";
+    const auto channel = discord.GetChannel(ChannelID);
+
+    const auto flags = ContentTokenFlags::UserMentions | ContentTokenFlags::ChannelMentions | ContentTokenFlags::CustomEmojis;
+    std::string ret;
+    ret.reserve(content.size());
+    for (const auto &span : TokenizeContent(content, flags)) {
+        switch (span.Type) {
+            case ContentSpanType::UserMention: {
+                const auto user = discord.GetUser(span.ID);
+                if (user.has_value() && channel.has_value())
+                    ret += "@" + user->Username + "#" + user->Discriminator;
+                else
+                    ret += span.Text;
+            } break;
+            case ContentSpanType::ChannelMention: {
+                const auto chan = discord.GetChannel(span.ID);
+                if (chan.has_value())
+                    ret += "#" + *chan->Name;
+                else
+                    ret += span.Text;
+            } break;
+            case ContentSpanType::CustomEmoji:
+                ret += ":";
+                ret += span.Name;
+                ret += ":";
+                break;
+            default:
+                ret += span.Text;
+                break;
         }
-
-        // regex returns byte positions and theres no straightforward way in the c++ bindings to deal with that :(
-        const auto chars_start = g_utf8_pointer_to_offset(text.c_str(), text.c_str() + mstart);
-        const auto chars_end = g_utf8_pointer_to_offset(text.c_str(), text.c_str() + mend);
-        const auto start_it = buf->get_iter_at_offset(chars_start);
-        const auto end_it = buf->get_iter_at_offset(chars_end);
-
-        auto it = buf->erase(start_it, end_it);
-        buf->insert_markup(it, replacement);
-
-        text = GetText(buf);
-        startpos = 0;
     }
+    return ret;
 }
 
-void ChatMessageItemContainer::HandleStockEmojis(Gtk::TextView &tv) {
-    Abaddon::Get().GetEmojis().ReplaceEmojis(tv.get_buffer(), EmojiSize);
-}
-
-void ChatMessageItemContainer::HandleCustomEmojis(Gtk::TextView &tv) {
-    static auto rgx = Glib::Regex::create(R"(<a?:([\w\d_]+):(\d+)>)");
-
+void ChatMessageItemContainer::InsertCustomEmoji(Gtk::TextView &tv, const ChatRenderSpan &span) {
     auto &img = Abaddon::Get().GetImageManager();
-
     auto buf = tv.get_buffer();
-    auto text = GetText(buf);
-
-    Glib::MatchInfo match;
-    int startpos = 0;
-    while (rgx->match(text, startpos, match)) {
-        int mstart, mend;
-        if (!match.fetch_pos(0, mstart, mend)) break;
-        const bool is_animated = match.fetch(0)[1] == 'a';
-
-        const auto chars_start = g_utf8_pointer_to_offset(text.c_str(), text.c_str() + mstart);
-        const auto chars_end = g_utf8_pointer_to_offset(text.c_str(), text.c_str() + mend);
-        auto start_it = buf->get_iter_at_offset(chars_start);
-        auto end_it = buf->get_iter_at_offset(chars_end);
-
-        startpos = mend;
-        if (is_animated && Abaddon::Get().GetSettings().ShowAnimations) {
-            const auto mark_start = buf->create_mark(start_it, false);
-            end_it.backward_char();
-            const auto mark_end = buf->create_mark(end_it, false);
-            const auto cb = [&tv, buf, mark_start, mark_end](const Glib::RefPtr<Gdk::PixbufAnimation> &pixbuf) {
-                auto start_it = mark_start->get_iter();
-                auto end_it = mark_end->get_iter();
-                end_it.forward_char();
-                buf->delete_mark(mark_start);
-                buf->delete_mark(mark_end);
-                auto it = buf->erase(start_it, end_it);
-                const auto anchor = buf->create_child_anchor(it);
-                auto img = Gtk::manage(new Gtk::Image(pixbuf));
-                img->show();
-                tv.add_child_at_anchor(*img, anchor);
-            };
-            img.LoadAnimationFromURL(EmojiData::URLFromID(match.fetch(2), "gif"), EmojiSize, EmojiSize, sigc::track_obj(cb, tv));
-        } else {
-            // can't erase before pixbuf is ready or else marks that are in the same pos get mixed up
-            const auto mark_start = buf->create_mark(start_it, false);
-            end_it.backward_char();
-            const auto mark_end = buf->create_mark(end_it, false);
-            const auto cb = [buf, mark_start, mark_end](const Glib::RefPtr<Gdk::Pixbuf> &pixbuf) {
-                auto start_it = mark_start->get_iter();
-                auto end_it = mark_end->get_iter();
-                end_it.forward_char();
-                buf->delete_mark(mark_start);
-                buf->delete_mark(mark_end);
-                auto it = buf->erase(start_it, end_it);
-                int width, height;
-                GetImageDimensions(pixbuf->get_width(), pixbuf->get_height(), width, height, EmojiSize, EmojiSize);
-                buf->insert_pixbuf(it, pixbuf->scale_simple(width, height, Gdk::INTERP_BILINEAR));
-            };
-            img.LoadFromURL(EmojiData::URLFromID(match.fetch(2)), sigc::track_obj(cb, tv));
-        }
-
-        text = GetText(buf);
-    }
-}
-
-void ChatMessageItemContainer::HandleEmojis(Gtk::TextView &tv) {
-    if (Abaddon::Get().GetSettings().ShowStockEmojis) HandleStockEmojis(tv);
-    if (Abaddon::Get().GetSettings().ShowCustomEmojis) HandleCustomEmojis(tv);
-}
-
-void ChatMessageItemContainer::CleanupEmojis(const Glib::RefPtr<Gtk::TextBuffer> &buf) {
-    static auto rgx = Glib::Regex::create(R"(<a?:([\w\d_]+):(\d+)>)");
-
-    auto text = GetText(buf);
-
-    Glib::MatchInfo match;
-    int startpos = 0;
-    while (rgx->match(text, startpos, match)) {
-        int mstart, mend;
-        if (!match.fetch_pos(0, mstart, mend)) break;
-
-        const auto new_term = ":" + match.fetch(1) + ":";
-
-        const auto chars_start = g_utf8_pointer_to_offset(text.c_str(), text.c_str() + mstart);
-        const auto chars_end = g_utf8_pointer_to_offset(text.c_str(), text.c_str() + mend);
-        auto start_it = buf->get_iter_at_offset(chars_start);
-        auto end_it = buf->get_iter_at_offset(chars_end);
-
-        startpos = mend;
-        const auto it = buf->erase(start_it, end_it);
-        const int alen = static_cast<int>(text.size());
-        text = GetText(buf);
-        const int blen = static_cast<int>(text.size());
-        startpos -= (alen - blen);
-
-        buf->insert(it, new_term);
-
-        text = GetText(buf);
-    }
-}
 
-void ChatMessageItemContainer::HandleChannelMentions(const Glib::RefPtr<Gtk::TextBuffer> &buf) {
-    static auto rgx = Glib::Regex::create(R"(<#(\d+)>)");
-
-    Glib::ustring text = GetText(buf);
-
-    const auto &discord = Abaddon::Get().GetDiscordClient();
-
-    int startpos = 0;
-    Glib::MatchInfo match;
-    while (rgx->match(text, startpos, match)) {
-        int mstart, mend;
-        match.fetch_pos(0, mstart, mend);
-        std::string channel_id = match.fetch(1);
-        const auto chan = discord.GetChannel(channel_id);
-        if (!chan.has_value()) {
-            startpos = mend;
-            continue;
-        }
-
-        auto tag = buf->create_tag();
-        if (chan->Type == ChannelType::GUILD_TEXT) {
-            m_channel_tagmap[tag] = channel_id;
-            tag->property_weight() = Pango::WEIGHT_BOLD;
-        }
-
-        const auto chars_start = g_utf8_pointer_to_offset(text.c_str(), text.c_str() + mstart);
-        const auto chars_end = g_utf8_pointer_to_offset(text.c_str(), text.c_str() + mend);
-        const auto erase_from = buf->get_iter_at_offset(chars_start);
-        const auto erase_to = buf->get_iter_at_offset(chars_end);
-        auto it = buf->erase(erase_from, erase_to);
-        const std::string replacement = "#" + *chan->Name;
-        it = buf->insert_with_tag(it, "#" + *chan->Name, tag);
-
-        // rescan the whole thing so i dont have to deal with fixing match positions
-        text = GetText(buf);
-        startpos = 0;
+    // raw text stays until the image is loaded
+    const int start_offset = buf->end().get_offset();
+    buf->insert(buf->end(), span.Text);
+
+    // can't erase before pixbuf is ready or else marks that are in the same pos get mixed up
+    const auto mark_start = buf->create_mark(buf->get_iter_at_offset(start_offset), false);
+    auto end_it = buf->end();
+    end_it.backward_char();
+    const auto mark_end = buf->create_mark(end_it, false);
+
+    if (span.IsAnimated) {
+        const auto cb = [&tv, buf, mark_start, mark_end](const Glib::RefPtr<Gdk::PixbufAnimation> &pixbuf) {
+            auto start_it = mark_start->get_iter();
+            auto end_it = mark_end->get_iter();
+            end_it.forward_char();
+            buf->delete_mark(mark_start);
+            buf->delete_mark(mark_end);
+            auto it = buf->erase(start_it, end_it);
+            const auto anchor = buf->create_child_anchor(it);
+            auto img = Gtk::manage(new Gtk::Image(pixbuf));
+            img->show();
+            tv.add_child_at_anchor(*img, anchor);
+        };
+        img.LoadAnimationFromURL(span.URL, EmojiSize, EmojiSize, sigc::track_obj(cb, tv));
+    } else {
+        const auto cb = [buf, mark_start, mark_end](const Glib::RefPtr<Gdk::Pixbuf> &pixbuf) {
+            auto start_it = mark_start->get_iter();
+            auto end_it = mark_end->get_iter();
+            end_it.forward_char();
+            buf->delete_mark(mark_start);
+            buf->delete_mark(mark_end);
+            auto it = buf->erase(start_it, end_it);
+            int width, height;
+            GetImageDimensions(pixbuf->get_width(), pixbuf->get_height(), width, height, EmojiSize, EmojiSize);
+            buf->insert_pixbuf(it, pixbuf->scale_simple(width, height, Gdk::INTERP_BILINEAR));
+        };
+        img.LoadFromURL(span.URL, sigc::track_obj(cb, tv));
     }
 }
 
-void ChatMessageItemContainer::HandleChannelMentions(Gtk::TextView *tv) {
-    HandleChannelMentions(tv->get_buffer());
-}
-
 // a lot of repetition here so there should probably just be one slot for textview's button-press
 bool ChatMessageItemContainer::OnClickChannel(GdkEventButton *ev) {
     if (m_text_component == nullptr) return false;
@@ -1027,34 +918,6 @@ void ChatMessageItemContainer::on_link_menu_copy() {
     Gtk::Clipboard::get()->set_text(m_selected_link);
 }
 
-void ChatMessageItemContainer::HandleLinks(Gtk::TextView &tv) {
-    const auto rgx = Glib::Regex::create(R"(\bhttps?:\/\/[^\s]+\.[^\s]+\b)");
-
-    auto buf = tv.get_buffer();
-    Glib::ustring text = GetText(buf);
-
-    int startpos = 0;
-    Glib::MatchInfo match;
-    while (rgx->match(text, startpos, match)) {
-        int mstart, mend;
-        match.fetch_pos(0, mstart, mend);
-        std::string link = match.fetch(0);
-        auto tag = buf->create_tag();
-        m_link_tagmap[tag] = link;
-        tag->property_foreground_rgba() = Gdk::RGBA(Abaddon::Get().GetSettings().LinkColor);
-        tag->set_property("underline", 1); // stupid workaround for vcpkg bug (i think)
-
-        const auto chars_start = g_utf8_pointer_to_offset(text.c_str(), text.c_str() + mstart);
-        const auto chars_end = g_utf8_pointer_to_offset(text.c_str(), text.c_str() + mend);
-        const auto erase_from = buf->get_iter_at_offset(chars_start);
-        const auto erase_to = buf->get_iter_at_offset(chars_end);
-        auto it = buf->erase(erase_from, erase_to);
-        it = buf->insert_with_tag(it, link, tag);
-
-        startpos = mend;
-    }
-}
-
 bool ChatMessageItemContainer::OnLinkClick(GdkEventButton *ev) {
     if (m_text_component == nullptr) return false;
     if (ev->type != GDK_BUTTON_PRESS) return false;
@@ -1215,8 +1078,8 @@ ChatMessageHeader::ChatMessageHeader(const Message &data)
     auto &discord = Abaddon::Get().GetDiscordClient();
     auto role_update_cb = [this](...) { UpdateName(); };
     discord.signal_role_update().connect(sigc::track_obj(role_update_cb, *this));
-    auto guild_member_update_cb = [this](const auto &, const auto &) { UpdateName(); };
-    discord.signal_guild_member_update().connect(sigc::track_obj(guild_member_update_cb, *this));
+    auto guild_member_update_cb = [this](Snowflake) { UpdateName(); };
+    discord.signal_guild_member_update_by_user().connect(UserID, sigc::track_obj(guild_member_update_cb, *this));
     UpdateName();
     AttachUserMenuHandler(m_meta_ev);
     AttachUserMenuHandler(m_avatar_ev);
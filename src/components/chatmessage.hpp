@@ -1,6 +1,8 @@
 #pragma once
 #include <gtkmm.h>
 #include "discord/discord.hpp"
+#include "discord/contenttokenizer.hpp"
+#include "chatrender.hpp"
 
 class ChatMessageItemContainer : public Gtk::EventBox {
 public:
@@ -10,7 +12,9 @@ public:
     std::string Nonce;
 
     ChatMessageItemContainer();
-    static ChatMessageItemContainer *FromMessage(const Message &data);
+    // model is rendered on the spot if not given
+    static ChatMessageItemContainer *FromMessage(const Message &data, std::shared_ptr<const ChatRenderModel> model = nullptr);
+    static ContentTokenFlags GetContentFlags(); // everything but role mentions, emojis depending on settings
 
     // attributes = edited, deleted
     void UpdateAttributes();
@@ -21,7 +25,7 @@ public:
 protected:
     static void AddClickHandler(Gtk::Widget *widget, const std::string &);
     Gtk::TextView *CreateTextComponent(const Message &data); // Message.Content
-    void UpdateTextComponent(Gtk::TextView *tv);
+    void UpdateTextComponent(Gtk::TextView *tv, const Message &data);
     Gtk::Widget *CreateEmbedsComponent(const std::vector<EmbedData> &embeds);
     static Gtk::Widget *CreateEmbedComponent(const EmbedData &data); // Message.Embeds[0]
     Gtk::Widget *CreateImageComponent(const std::string &proxy_url, const std::string &url, int inw, int inh);
@@ -30,19 +34,14 @@ protected:
     Gtk::Widget *CreateReactionsComponent(const Message &data);
     Gtk::Widget *CreateReplyComponent(const Message &data);
 
-    static Glib::ustring GetText(const Glib::RefPtr<Gtk::TextBuffer> &buf);
-
     static bool IsEmbedImageOnly(const EmbedData &data);
 
-    static void HandleRoleMentions(const Glib::RefPtr<Gtk::TextBuffer> &buf);
-    void HandleUserMentions(const Glib::RefPtr<Gtk::TextBuffer> &buf) const;
-    static void HandleStockEmojis(Gtk::TextView &tv);
-    static void HandleCustomEmojis(Gtk::TextView &tv);
-    static void HandleEmojis(Gtk::TextView &tv);
-    static void CleanupEmojis(const Glib::RefPtr<Gtk::TextBuffer> &buf);
+    // content comes pre-resolved from ChatRenderer, the buffer is just filled from its spans
+    const ChatRenderModel &GetRenderModel(const Message &data);
+    void InsertRenderModel(Gtk::TextView &tv, const ChatRenderModel &model);
+    static void InsertCustomEmoji(Gtk::TextView &tv, const ChatRenderSpan &span);
+    Glib::ustring GetPlainContent(const std::string &content) const; // mentions resolved, custom emojis as :name:
 
-    void HandleChannelMentions(const Glib::RefPtr<Gtk::TextBuffer> &buf);
-    void HandleChannelMentions(Gtk::TextView *tv);
     bool OnClickChannel(GdkEventButton *ev);
     bool OnTextViewButtonPress(GdkEventButton *ev);
 
@@ -53,11 +52,12 @@ protected:
     void on_link_menu_copy();
     Glib::ustring m_selected_link;
 
-    void HandleLinks(Gtk::TextView &tv);
     bool OnLinkClick(GdkEventButton *ev);
     std::map<Glib::RefPtr<Gtk::TextTag>, std::string> m_link_tagmap;
     std::map<Glib::RefPtr<Gtk::TextTag>, Snowflake> m_channel_tagmap;
 
+    std::shared_ptr<const ChatRenderModel> m_render_model;
+
     Gtk::EventBox *_ev;
     Gtk::Box m_main;
     Gtk::Label *m_attrib_label = nullptr;
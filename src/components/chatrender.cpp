@@ -0,0 +1,263 @@
+#include "chatrender.hpp"
+#include "abaddon.hpp"
+#include "util.hpp"
+#include "discord/tracer.hpp"
+
+ChatRenderer::ChatRenderer()
+    : m_worker(GetWorker())
+    , m_state(std::make_shared<State>()) {}
+
+ChatRenderer::~ChatRenderer() {
+    // anything still queued sees it went stale and skips its callback
+    Cancel();
+}
+
+std::shared_ptr<ChatRenderer::Worker> ChatRenderer::GetWorker() {
+    static std::weak_ptr<Worker> shared;
+    auto worker = shared.lock();
+    if (!worker) {
+        worker = std::make_shared<Worker>();
+        shared = worker;
+    }
+    return worker;
+}
+
+void ChatRenderer::Render(std::vector<Message> messages, ContentTokenFlags flags, callback_type callback) {
+    auto job = CreateJob(std::move(messages), flags);
+    job->Generation = m_state->Generation;
+    job->Callback = std::move(callback);
+    m_state->InFlight++;
+
+    // the worker is alive for as long as anything it runs, main thread work included since its dispatcher goes with it
+    auto *worker = m_worker.get();
+    const auto state = m_state;
+    const auto is_stale = [state, job] {
+        return job->Generation != state->Generation;
+    };
+
+    worker->Queue([worker, state, job, is_stale] {
+        if (is_stale()) {
+            worker->Main.Post([state] { state->InFlight--; });
+            return;
+        }
+        Tokenize(*job);
+        worker->Main.Post([worker, state, job, is_stale] {
+            if (is_stale()) {
+                state->InFlight--;
+                return;
+            }
+            Resolve(*job);
+            worker->Queue([worker, state, job, is_stale] {
+                if (!is_stale()) Build(*job);
+                worker->Main.Post([state, job, is_stale] {
+                    state->InFlight--;
+                    if (!is_stale()) job->Callback(std::move(job->Models));
+                });
+            });
+        });
+    });
+}
+
+void ChatRenderer::Cancel() {
+    m_state->Generation++;
+}
+
+bool ChatRenderer::IsBusy() const {
+    return m_state->InFlight > 0;
+}
+
+std::shared_ptr<const ChatRenderModel> ChatRenderer::RenderNow(const Message &message, ContentTokenFlags flags) {
+    auto job = CreateJob({ message }, flags);
+    Tokenize(*job);
+    Resolve(*job);
+    Build(*job);
+    return job->Models.front();
+}
+
+std::shared_ptr<ChatRenderer::Job> ChatRenderer::CreateJob(std::vector<Message> messages, ContentTokenFlags flags) {
+    // settings and the emoji index are read here on the main thread, the matcher itself is immutable after load
+    auto job = std::make_shared<Job>();
+    job->Flags = flags;
+    job->ShowAnimations = Abaddon::Get().GetSettings().ShowAnimations;
+    job->StockEmojis = &Abaddon::Get().GetEmojis().GetMatcher();
+    job->Messages = std::move(messages);
+    return job;
+}
+
+ContentTokenFlags ChatRenderer::GetFlagsForMessage(const Message &message, ContentTokenFlags flags) {
+    switch (message.Type) {
+        case MessageType::DEFAULT:
+        case MessageType::INLINE_REPLY:
+            return flags | ContentTokenFlags::RoleMentions;
+        case MessageType::APPLICATION_COMMAND:
+            if (!message.Application.has_value()) return flags;
+            return ContentTokenFlags::None;
+        default:
+            return ContentTokenFlags::None;
+    }
+}
+
+void ChatRenderer::Tokenize(Job &job) {
+    Tracer::Span span("render tokenize");
+    job.Tokens.resize(job.Messages.size());
+    for (size_t i = 0; i < job.Messages.size(); i++) {
+        const auto &message = job.Messages[i];
+        const auto flags = GetFlagsForMessage(message, job.Flags);
+        if (flags == ContentTokenFlags::None) continue;
+
+        job.Tokens[i] = TokenizeContent(message.Content, flags, job.StockEmojis);
+        for (const auto &span : job.Tokens[i]) {
+            switch (span.Type) {
+                case ContentSpanType::UserMention:
+                    job.UserIDs.insert(span.ID);
+                    break;
+                case ContentSpanType::RoleMention:
+                    job.RoleIDs.insert(span.ID);
+                    break;
+                case ContentSpanType::ChannelMention:
+                    job.ChannelIDs.insert(span.ID);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+void ChatRenderer::Resolve(Job &job) {
+    Tracer::Span span("render resolve");
+    const auto &discord = Abaddon::Get().GetDiscordClient();
+
+    for (const auto id : job.RoleIDs) {
+        const auto role = discord.GetRoleSnapshot(id);
+        if (role == nullptr) continue;
+        auto &resolved = job.Roles[id];
+        resolved.Name = role->Name;
+        if (role->HasColor()) resolved.Color = role->Color;
+    }
+
+    for (const auto id : job.ChannelIDs) {
+        const auto channel = discord.GetChannelSnapshot(id);
+        if (channel == nullptr) continue;
+        job.Channels[id] = { channel->Name.value_or(""), channel->Type == ChannelType::GUILD_TEXT };
+    }
+
+    if (job.UserIDs.empty()) return;
+
+    // user colors depend on the channel the message is in, every message in a page shares it
+    const auto channel = discord.GetChannelSnapshot(job.Messages.front().ChannelID);
+    if (channel == nullptr) return;
+    const bool is_dm = channel->Type == ChannelType::DM || channel->Type == ChannelType::GROUP_DM;
+
+    for (const auto id : job.UserIDs) {
+        const auto user = discord.GetUserSnapshot(id);
+        if (user == nullptr) continue;
+        auto &resolved = job.Users[id];
+        resolved.Username = user->Username;
+        resolved.Discriminator = user->Discriminator;
+        if (!is_dm) {
+            const auto role = discord.GetRoleSnapshot(discord.GetMemberHoistedRole(*channel->GuildID, id, true));
+            if (role != nullptr) resolved.Color = role->Color;
+        }
+    }
+}
+
+void ChatRenderer::Build(Job &job) {
+    Tracer::Span span("render build");
+    job.Models.reserve(job.Messages.size());
+    for (size_t i = 0; i < job.Messages.size(); i++) {
+        auto model = std::make_shared<ChatRenderModel>();
+        model->ID = job.Messages[i].ID;
+        model->HasContent = GetFlagsForMessage(job.Messages[i], job.Flags) != ContentTokenFlags::None;
+        model->Spans.reserve(job.Tokens[i].size());
+
+        for (const auto &token : job.Tokens[i]) {
+            auto &span = model->Spans.emplace_back();
+            span.Type = token.Type;
+            span.Text = std::string(token.Text);
+
+            switch (token.Type) {
+                case ContentSpanType::RoleMention: {
+                    const auto it = job.Roles.find(token.ID);
+                    if (it == job.Roles.end()) {
+                        span.Type = ContentSpanType::Text;
+                        break;
+                    }
+                    const auto name = Glib::Markup::escape_text(it->second.Name);
+                    if (it->second.Color.has_value())
+                        span.Markup = "<b><span color=\"#" + IntToCSSColor(*it->second.Color) + "\">@" + name + "</span></b>";
+                    else
+                        span.Markup = "<b>@" + name + "</b>";
+                } break;
+                case ContentSpanType::UserMention: {
+                    const auto it = job.Users.find(token.ID);
+                    if (it == job.Users.end()) {
+                        span.Type = ContentSpanType::Text;
+                        break;
+                    }
+                    const auto bold = "<b>@" + Glib::Markup::escape_text(it->second.Username) + "</b>#" + it->second.Discriminator;
+                    if (it->second.Color.has_value())
+                        span.Markup = "<span color=\"#" + IntToCSSColor(*it->second.Color) + "\">" + bold + "</span>";
+                    else
+                        span.Markup = bold;
+                } break;
+                case ContentSpanType::ChannelMention: {
+                    const auto it = job.Channels.find(token.ID);
+                    if (it == job.Channels.end()) {
+                        span.Type = ContentSpanType::Text;
+                        break;
+                    }
+                    span.Text = "#" + it->second.Name;
+                    span.ID = token.ID;
+                    span.IsClickable = it->second.IsText;
+                } break;
+                case ContentSpanType::Link:
+                    span.URL = span.Text;
+                    break;
+                case ContentSpanType::CustomEmoji:
+                    span.ID = token.ID;
+                    span.IsAnimated = token.IsAnimated && job.ShowAnimations;
+                    span.URL = span.IsAnimated ? EmojiData::URLFromID(token.ID, "gif") : EmojiData::URLFromID(token.ID);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        job.Models.push_back(std::move(model));
+    }
+}
+
+ChatRenderer::Worker::Worker() {
+    m_thread = std::thread([this] { loop(); });
+}
+
+ChatRenderer::Worker::~Worker() {
+    m_queue_mutex.lock();
+    m_stop = true;
+    m_cv.notify_all();
+    m_queue_mutex.unlock();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void ChatRenderer::Worker::Queue(std::function<void()> work) {
+    m_queue_mutex.lock();
+    m_queue.push(std::move(work));
+    m_cv.notify_one();
+    m_queue_mutex.unlock();
+}
+
+void ChatRenderer::Worker::loop() {
+    Tracer::SetThreadName("chat render");
+    while (true) {
+        std::function<void()> work;
+        {
+            std::unique_lock<std::mutex> lock(m_queue_mutex);
+            m_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_stop) return;
+            work = std::move(m_queue.front());
+            m_queue.pop();
+        }
+        work();
+    }
+}
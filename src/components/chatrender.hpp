@@ -0,0 +1,131 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "discord/message.hpp"
+#include "discord/contenttokenizer.hpp"
+#include "discord/dispatcher.hpp"
+
+// message content with mentions, channels and emojis already resolved
+// built ahead of time so the widget only has to fill its text buffer
+struct ChatRenderSpan {
+    ContentSpanType Type = ContentSpanType::Text; // unresolved mentions become Text
+    std::string Text;                             // inserted as is
+    std::string Markup;                           // inserted instead of Text if not empty
+    std::string URL;                              // links and custom emojis
+    Snowflake ID;                                 // mentioned channel or custom emoji
+    bool IsAnimated = false;                      // custom emoji, only if animations are on
+    bool IsClickable = false;                     // channel mention that can be opened
+};
+
+struct ChatRenderModel {
+    Snowflake ID;
+    bool HasContent = false; // false for message types that dont render their content
+    std::vector<ChatRenderSpan> Spans;
+};
+
+// renders pages of messages in three steps:
+// 1. worker: tokenize content, collect mentioned ids
+// 2. main thread: look up every distinct id once (the store isnt thread safe)
+// 3. worker: escape names and build the spans
+// then the callback materializes widgets on the main thread
+class ChatRenderer {
+public:
+    using models_type = std::vector<std::shared_ptr<const ChatRenderModel>>;
+    using callback_type = std::function<void(models_type models)>; // same order as the messages given
+
+    ChatRenderer();
+    ~ChatRenderer();
+
+    // flags are for normal messages, role mentions are added where they apply
+    void Render(std::vector<Message> messages, ContentTokenFlags flags, callback_type callback);
+    // drops the results of everything in flight, their callbacks never run
+    void Cancel();
+    [[nodiscard]] bool IsBusy() const;
+
+    // all three steps at once on the calling thread, for single live messages and edits
+    static std::shared_ptr<const ChatRenderModel> RenderNow(const Message &message, ContentTokenFlags flags);
+
+private:
+    struct ResolvedUser {
+        std::string Username;
+        std::string Discriminator;
+        std::optional<int> Color;
+    };
+
+    struct ResolvedRole {
+        std::string Name;
+        std::optional<int> Color;
+    };
+
+    struct ResolvedChannel {
+        std::string Name;
+        bool IsText;
+    };
+
+    struct Job {
+        uint64_t Generation = 0;
+        ContentTokenFlags Flags = ContentTokenFlags::None;
+        bool ShowAnimations = false;
+        const StockEmojiMatcher *StockEmojis = nullptr;
+        std::vector<Message> Messages;
+        std::vector<std::vector<ContentSpan>> Tokens; // views into Messages
+
+        std::unordered_set<Snowflake> UserIDs;
+        std::unordered_set<Snowflake> RoleIDs;
+        std::unordered_set<Snowflake> ChannelIDs;
+        std::unordered_map<Snowflake, ResolvedUser> Users;
+        std::unordered_map<Snowflake, ResolvedRole> Roles;
+        std::unordered_map<Snowflake, ResolvedChannel> Channels;
+
+        models_type Models;
+        callback_type Callback;
+    };
+
+    static std::shared_ptr<Job> CreateJob(std::vector<Message> messages, ContentTokenFlags flags);
+    static ContentTokenFlags GetFlagsForMessage(const Message &message, ContentTokenFlags flags);
+    static void Tokenize(Job &job);
+    static void Resolve(Job &job);
+    static void Build(Job &job);
+
+    // one thread for every renderer so parked chat views dont each keep one around
+    // it goes away with the last renderer, work still queued for it is dropped
+    class Worker {
+    public:
+        Worker();
+        ~Worker();
+
+        void Queue(std::function<void()> work);
+
+        GlibDispatcher Main;
+
+    private:
+        void loop();
+
+        bool m_stop = false;
+        std::thread m_thread;
+        std::condition_variable m_cv;
+        std::mutex m_queue_mutex;
+        std::queue<std::function<void()>> m_queue;
+    };
+
+    // outlives the renderer if it goes away with work still queued
+    struct State {
+        std::atomic<uint64_t> Generation = 0;
+        int InFlight = 0; // main thread only
+    };
+
+    static std::shared_ptr<Worker> GetWorker(); // main thread only
+
+    std::shared_ptr<Worker> m_worker;
+    std::shared_ptr<State> m_state;
+};
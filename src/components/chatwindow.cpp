@@ -14,7 +14,7 @@ ChatWindow::ChatWindow() {
     discord.signal_message_send_fail().connect(sigc::mem_fun(*this, &ChatWindow::OnMessageSendFail));
 
     m_main = Gtk::manage(new Gtk::Box(Gtk::ORIENTATION_VERTICAL));
-    m_chat = Gtk::manage(new ChatList);
+    m_chat = CreateChatList();
     m_input = Gtk::manage(new ChatInput);
     m_input_indicator = Gtk::manage(new ChatInputIndicator);
     m_rate_limit_indicator = Gtk::manage(new RateLimitIndicator);
@@ -68,29 +68,6 @@ ChatWindow::ChatWindow() {
 
     m_completer.show();
 
-    m_chat->signal_action_channel_click().connect([this](Snowflake id) {
-        m_signal_action_channel_click.emit(id, true);
-    });
-    m_chat->signal_action_chat_load_history().connect([this](Snowflake id) {
-        m_signal_action_chat_load_history.emit(id);
-    });
-    m_chat->signal_action_insert_mention().connect([this](Snowflake id) {
-        // lowkey gross
-        m_signal_action_insert_mention.emit(id);
-    });
-    m_chat->signal_action_message_edit().connect([this](Snowflake channel_id, Snowflake message_id) {
-        m_signal_action_message_edit.emit(channel_id, message_id);
-    });
-    m_chat->signal_action_reaction_add().connect([this](Snowflake id, const Glib::ustring &param) {
-        m_signal_action_reaction_add.emit(id, param);
-    });
-    m_chat->signal_action_reaction_remove().connect([this](Snowflake id, const Glib::ustring &param) {
-        m_signal_action_reaction_remove.emit(id, param);
-    });
-    m_chat->signal_action_reply_to().connect([this](Snowflake id) {
-        StartReplying(id);
-    });
-    m_chat->show();
 
     m_meta->set_hexpand(true);
     m_meta->set_halign(Gtk::ALIGN_FILL);
@@ -104,7 +81,7 @@ ChatWindow::ChatWindow() {
     m_tab_switcher->show();
 #endif
     m_main->add(m_topic);
-    m_main->add(*m_chat);
+    m_main->add(m_chat_stack);
     m_main->add(m_completer);
     m_main->add(*m_input);
     m_main->add(*m_meta);
@@ -112,6 +89,7 @@ ChatWindow::ChatWindow() {
 
     m_progress.show();
 
+    m_chat_stack.show();
     m_main->show();
 }
 
@@ -121,13 +99,17 @@ Gtk::Widget *ChatWindow::GetRoot() const {
 
 void ChatWindow::Clear() {
     m_chat->Clear();
+    m_chat_populated = false;
 }
 
 void ChatWindow::SetMessages(const std::vector<Message> &msgs) {
     m_chat->SetMessages(msgs.begin(), msgs.end());
+    m_chat_populated = true;
 }
 
 void ChatWindow::SetActiveChannel(Snowflake id) {
+    if (id != m_active_channel)
+        SwitchChatList(id);
     m_active_channel = id;
     m_chat->SetActiveChannel(id);
     m_input->SetActiveChannel(id);
@@ -142,19 +124,29 @@ void ChatWindow::SetActiveChannel(Snowflake id) {
 }
 
 void ChatWindow::AddNewMessage(const Message &data) {
-    m_chat->ProcessNewMessage(data, false);
+    auto *list = GetChatList(data.ChannelID);
+    if (list == nullptr) return;
+    list->ProcessNewMessage(data, false);
+    // parked lists grow while nobody is looking so the cap has to hold here too, not just on a switch
+    if (list != m_chat)
+        TrimCachedViews();
 }
 
-void ChatWindow::DeleteMessage(Snowflake id) {
-    m_chat->DeleteMessage(id);
+void ChatWindow::DeleteMessage(Snowflake id, Snowflake channel_id) {
+    if (auto *list = GetChatList(channel_id); list != nullptr)
+        list->DeleteMessage(id);
 }
 
-void ChatWindow::UpdateMessage(Snowflake id) {
-    m_chat->RefetchMessage(id);
+void ChatWindow::UpdateMessage(Snowflake id, Snowflake channel_id) {
+    if (auto *list = GetChatList(channel_id); list != nullptr)
+        list->RefetchMessage(id);
 }
 
 void ChatWindow::AddNewHistory(const std::vector<Message> &msgs) {
-    m_chat->PrependMessages(msgs.crbegin(), msgs.crend());
+    if (msgs.empty()) return;
+    // the fetch can finish after switching away
+    if (auto *list = GetChatList(msgs.front().ChannelID); list != nullptr)
+        list->PrependMessages(msgs.crbegin(), msgs.crend());
 }
 
 void ChatWindow::InsertChatInput(const std::string &text) {
@@ -166,7 +158,10 @@ Snowflake ChatWindow::GetOldestListedMessage() {
 }
 
 void ChatWindow::UpdateReactions(Snowflake id) {
+    // only the message id is known here, lists ignore ids they dont have
     m_chat->UpdateMessageReactions(id);
+    for (const auto &view : m_cached_views)
+        view.List->UpdateMessageReactions(id);
 }
 
 void ChatWindow::SetTopic(const std::string &text) {
@@ -178,6 +173,95 @@ void ChatWindow::AddAttachment(const Glib::RefPtr<Gio::File> &file) {
     m_input->AddAttachment(file);
 }
 
+bool ChatWindow::IsActiveViewPopulated() const {
+    return m_chat_populated;
+}
+
+void ChatWindow::ClearCachedViews() {
+    for (const auto &view : m_cached_views)
+        delete view.List;
+    m_cached_views.clear();
+}
+
+ChatList *ChatWindow::CreateChatList() {
+    auto *list = Gtk::manage(new ChatList);
+    list->signal_action_channel_click().connect([this](Snowflake id) {
+        m_signal_action_channel_click.emit(id, true);
+    });
+    list->signal_action_chat_load_history().connect([this](Snowflake id) {
+        m_signal_action_chat_load_history.emit(id);
+    });
+    list->signal_action_insert_mention().connect([this](Snowflake id) {
+        // lowkey gross
+        m_signal_action_insert_mention.emit(id);
+    });
+    list->signal_action_message_edit().connect([this](Snowflake channel_id, Snowflake message_id) {
+        m_signal_action_message_edit.emit(channel_id, message_id);
+    });
+    list->signal_action_reaction_add().connect([this](Snowflake id, const Glib::ustring &param) {
+        m_signal_action_reaction_add.emit(id, param);
+    });
+    list->signal_action_reaction_remove().connect([this](Snowflake id, const Glib::ustring &param) {
+        m_signal_action_reaction_remove.emit(id, param);
+    });
+    list->signal_action_reply_to().connect([this](Snowflake id) {
+        StartReplying(id);
+    });
+    list->show();
+    m_chat_stack.add(*list);
+    return list;
+}
+
+ChatList *ChatWindow::GetChatList(Snowflake channel_id) {
+    if (channel_id == m_active_channel) return m_chat;
+    for (const auto &view : m_cached_views)
+        if (view.ChannelID == channel_id) return view.List;
+    return nullptr;
+}
+
+void ChatWindow::SwitchChatList(Snowflake id) {
+    const auto cached = std::find_if(m_cached_views.begin(), m_cached_views.end(), [id](const CachedView &view) {
+        return view.ChannelID == id;
+    });
+
+    // only keep lists that were actually filled
+    const bool keep = m_chat_populated && m_active_channel.IsValid() && Abaddon::Get().GetSettings().CachedChannels > 0;
+    if (keep) {
+        m_cached_views.push_front({ m_active_channel, m_chat });
+    } else if (cached != m_cached_views.end()) {
+        delete m_chat;
+    } else {
+        m_chat->Clear();
+    }
+
+    if (cached != m_cached_views.end()) {
+        m_chat = cached->List;
+        m_chat_populated = true;
+        m_cached_views.erase(cached);
+    } else {
+        if (keep) m_chat = CreateChatList();
+        m_chat_populated = false;
+    }
+
+    m_chat_stack.set_visible_child(*m_chat);
+    TrimCachedViews();
+}
+
+void ChatWindow::TrimCachedViews() {
+    const auto max_views = static_cast<size_t>(std::max(0, Abaddon::Get().GetSettings().CachedChannels));
+    size_t num_views = 0;
+    int num_messages = 0;
+    for (auto it = m_cached_views.begin(); it != m_cached_views.end();) {
+        num_messages += it->List->GetNumMessages();
+        if (++num_views > max_views || num_messages > MaxCachedViewMessages) {
+            delete it->List;
+            it = m_cached_views.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
 #ifdef WITH_LIBHANDY
 void ChatWindow::OpenNewTab(Snowflake id) {
     // open if its the first tab (in which case it really isnt a tab but whatever)
@@ -321,6 +405,8 @@ void ChatWindow::OnScrollEdgeOvershot(Gtk::PositionType pos) {
 
 void ChatWindow::OnMessageSendFail(const std::string &nonce, float retry_after) {
     m_chat->SetFailedByNonce(nonce);
+    for (const auto &view : m_cached_views)
+        view.List->SetFailedByNonce(nonce);
 }
 
 ChatWindow::type_signal_action_message_edit ChatWindow::signal_action_message_edit() {
@@ -1,5 +1,6 @@
 #pragma once
 #include <gtkmm.h>
+#include <list>
 #include <string>
 #include <set>
 #include "discord/discord.hpp"
@@ -28,15 +29,17 @@ public:
     void Clear();
     void SetMessages(const std::vector<Message> &msgs); // clear contents and replace with given set
     void SetActiveChannel(Snowflake id);
-    void AddNewMessage(const Message &data);              // append new message to bottom
-    void DeleteMessage(Snowflake id);                     // add [deleted] indicator
-    void UpdateMessage(Snowflake id);                     // add [edited] indicator
-    void AddNewHistory(const std::vector<Message> &msgs); // prepend messages
+    void AddNewMessage(const Message &data);                // append new message to bottom
+    void DeleteMessage(Snowflake id, Snowflake channel_id); // add [deleted] indicator
+    void UpdateMessage(Snowflake id, Snowflake channel_id); // add [edited] indicator
+    void AddNewHistory(const std::vector<Message> &msgs);   // prepend messages
     void InsertChatInput(const std::string &text);
     Snowflake GetOldestListedMessage(); // oldest message that is currently in the ListBox
     void UpdateReactions(Snowflake id);
     void SetTopic(const std::string &text);
     void AddAttachment(const Glib::RefPtr<Gio::File> &file);
+    bool IsActiveViewPopulated() const; // came back from the cache with its messages so it doesnt need them set
+    void ClearCachedViews();
 
 #ifdef WITH_LIBHANDY
     void OpenNewTab(Snowflake id);
@@ -72,7 +75,21 @@ protected:
     Gtk::EventBox m_topic; // todo probably make everything else go on the stack
     Gtk::Label m_topic_text;
 
+    // recently viewed channels keep their list alive and up to date so switching back is instant
+    // the active one is m_chat and isnt in m_cached_views
+    struct CachedView {
+        Snowflake ChannelID;
+        ChatList *List;
+    };
+    ChatList *CreateChatList();
+    ChatList *GetChatList(Snowflake channel_id);
+    void SwitchChatList(Snowflake id);
+    void TrimCachedViews();
+
+    Gtk::Stack m_chat_stack;
     ChatList *m_chat;
+    bool m_chat_populated = false;
+    std::list<CachedView> m_cached_views; // most recently used first
 
     ChatInput *m_input;
 
@@ -1,11 +1,14 @@
-#include <unordered_set>
+#include <algorithm>
 #include <utility>
 #include "completer.hpp"
 #include "abaddon.hpp"
 #include "util.hpp"
+#include "gtkutil.hpp"
 
 constexpr const int CompleterHeight = 150;
-constexpr const int MaxCompleterEntries = 30;
+constexpr const size_t MaxCompleterEntries = 30;
+constexpr const size_t MaxMentionEntries = 16;
+constexpr const size_t MaxStockEmojiEntries = 15;
 
 Completer::Completer() {
     set_reveal_child(false);
@@ -25,6 +28,7 @@ Completer::Completer() {
     set_can_focus(false);
 
     m_list.signal_row_activated().connect(sigc::mem_fun(*this, &Completer::OnRowActivate));
+    Abaddon::Get().GetMemberSearch().signal_results().connect(sigc::mem_fun(*this, &Completer::OnMemberSearchResults));
 
     m_scroll.add(m_list);
     add(m_scroll);
@@ -99,46 +103,96 @@ void Completer::CompleteMentions(const Glib::ustring &term) {
         return;
 
     const auto &discord = Abaddon::Get().GetDiscordClient();
+    auto &index = Abaddon::Get().GetCompletionIndex();
 
     Snowflake channel_id;
     if (m_channel_id_cb)
         channel_id = m_channel_id_cb();
-    auto author_ids = m_recent_authors_cb();
+    std::optional<Snowflake> guild_id;
     if (channel_id.IsValid()) {
         const auto chan = discord.GetChannel(channel_id);
-        if (chan->GuildID.has_value()) {
-            const auto members = discord.GetUsersInGuild(*chan->GuildID);
-            for (const auto x : members)
-                if (std::find(author_ids.begin(), author_ids.end(), x) == author_ids.end())
-                    author_ids.push_back(x);
-        }
+        if (chan.has_value()) guild_id = chan->GuildID;
     }
+
+    // recent authors first then whatever the index ranks highest
     const auto me = discord.GetUserData().ID;
-    int i = 0;
-    for (const auto id : author_ids) {
-        if (id == me) continue;
-        const auto author = discord.GetUser(id);
-        if (!author.has_value()) continue;
-        if (!StringContainsCaseless(author->Username, term)) continue;
-        if (i++ > 15) break;
-
-        auto entry = CreateEntry(author->GetMention());
-
-        entry->SetText(author->Username + "#" + author->Discriminator);
-
-        if (channel_id.IsValid()) {
-            const auto chan = discord.GetChannel(channel_id);
-            if (chan.has_value() && chan->GuildID.has_value()) {
-                const auto role_id = discord.GetMemberHoistedRole(*chan->GuildID, id, true);
-                if (role_id.IsValid()) {
-                    const auto role = discord.GetRole(role_id);
-                    if (role.has_value())
-                        entry->SetTextColor(role->Color);
-                }
-            }
+    std::vector<Snowflake> user_ids;
+    for (const auto id : m_recent_authors_cb())
+        if (id != me && index.UserMatches(id, term) && std::find(user_ids.begin(), user_ids.end(), id) == user_ids.end())
+            user_ids.push_back(id);
+    if (guild_id.has_value() && user_ids.size() < MaxMentionEntries) {
+        for (const auto id : index.FindMembers(*guild_id, term, MaxMentionEntries + 1)) {
+            if (user_ids.size() >= MaxMentionEntries) break;
+            if (id != me && std::find(user_ids.begin(), user_ids.end(), id) == user_ids.end())
+                user_ids.push_back(id);
         }
+    }
+    if (user_ids.size() > MaxMentionEntries)
+        user_ids.resize(MaxMentionEntries);
+
+    for (const auto id : user_ids)
+        AddMentionEntry(id, guild_id);
+
+    // we might not know about everyone so ask the server too. results get merged in when they arrive
+    if (guild_id.has_value() && !term.empty()) {
+        auto &search = Abaddon::Get().GetMemberSearch();
+        if (search.ShouldSearch(*guild_id)) {
+            m_search_guild_id = *guild_id;
+            m_search_term = term;
+            MergeMemberSearchResults();
+            search.Search(*guild_id, term);
+        }
+    }
+}
+
+void Completer::AddMentionEntry(Snowflake id, std::optional<Snowflake> guild_id) {
+    const auto &discord = Abaddon::Get().GetDiscordClient();
+    const auto *author = Abaddon::Get().GetCompletionIndex().GetUser(id);
+    if (author == nullptr) return;
+
+    auto entry = CreateEntry("<@" + std::to_string(id) + ">");
+
+    entry->SetText(author->Username + "#" + author->Discriminator);
+
+    if (guild_id.has_value()) {
+        const auto role_id = discord.GetMemberHoistedRole(*guild_id, id, true);
+        if (role_id.IsValid()) {
+            const auto role = discord.GetRole(role_id);
+            if (role.has_value())
+                entry->SetTextColor(role->Color);
+        }
+    }
+
+    entry->SetImage(author->AvatarURL);
+}
 
-        entry->SetImage(author->GetAvatarURL());
+void Completer::MergeMemberSearchResults() {
+    const auto results = Abaddon::Get().GetMemberSearch().GetResults(m_search_guild_id, m_search_term);
+    if (!results.has_value()) return;
+
+    const auto me = Abaddon::Get().GetDiscordClient().GetUserData().ID;
+    for (const auto id : *results) {
+        if (m_entries.size() >= MaxMentionEntries) break;
+        if (id == me) continue;
+        const auto completion = "<@" + std::to_string(id) + ">";
+        const bool exists = std::any_of(m_entries.begin(), m_entries.end(), [&completion](CompleterEntry *entry) {
+            return entry->GetCompletion() == completion;
+        });
+        if (!exists)
+            AddMentionEntry(id, m_search_guild_id);
+    }
+}
+
+void Completer::OnMemberSearchResults(Snowflake guild_id, const Glib::ustring &query) {
+    if (guild_id != m_search_guild_id) return;
+    // a shorter query can still answer the current one so compare by prefix
+    if (m_search_term.casefold().raw().compare(0, query.raw().size(), query.raw()) != 0) return;
+
+    const bool was_empty = m_entries.empty();
+    MergeMemberSearchResults();
+    if (was_empty && !m_entries.empty()) {
+        m_list.select_row(*m_entries[0]);
+        set_reveal_child(true);
     }
 }
 
@@ -147,6 +201,7 @@ void Completer::CompleteEmojis(const Glib::ustring &term) {
         return;
 
     const auto &discord = Abaddon::Get().GetDiscordClient();
+    auto &index = Abaddon::Get().GetCompletionIndex();
     const auto channel_id = m_channel_id_cb();
     const auto channel = discord.GetChannel(channel_id);
 
@@ -164,62 +219,33 @@ void Completer::CompleteEmojis(const Glib::ustring &term) {
     const auto self_id = discord.GetUserData().ID;
     const bool can_use_external = discord.GetSelfPremiumType() != EPremiumType::None && discord.HasChannelPermission(self_id, channel_id, Permission::USE_EXTERNAL_EMOJIS);
 
-    int i = 0;
-    if (!can_use_external) {
-        if (channel->GuildID.has_value()) {
-            const auto guild = discord.GetGuild(*channel->GuildID);
-
-            if (guild.has_value() && guild->Emojis.has_value())
-                for (const auto &tmp : *guild->Emojis) {
-                    const auto emoji = *discord.GetEmoji(tmp.ID);
-                    if (emoji.IsAnimated.has_value() && *emoji.IsAnimated) continue;
-                    if (emoji.IsAvailable.has_value() && !*emoji.IsAvailable) continue;
-                    if (emoji.Roles.has_value() && !emoji.Roles->empty()) continue;
-                    if (!term.empty())
-                        if (!StringContainsCaseless(emoji.Name, term)) continue;
-
-                    if (i++ > MaxCompleterEntries) break;
-
-                    make_entry(emoji.Name, "<:" + emoji.Name + ":" + std::to_string(emoji.ID) + ">", emoji.GetURL());
-                }
-        }
-    } else {
-        for (const auto guild_id : discord.GetGuilds()) {
-            const auto guild = discord.GetGuild(guild_id);
-            if (!guild.has_value()) continue;
-            for (const auto &tmp : *guild->Emojis) {
-                const auto emoji = *discord.GetEmoji(tmp.ID);
-                const bool is_animated = emoji.IsAnimated.has_value() && *emoji.IsAnimated;
-                if (emoji.IsAvailable.has_value() && !*emoji.IsAvailable) continue;
-                if (emoji.Roles.has_value() && !emoji.Roles->empty()) continue;
-                if (!term.empty())
-                    if (!StringContainsCaseless(emoji.Name, term)) continue;
-
-                if (i++ > MaxCompleterEntries) goto done;
-
-                if (is_animated)
-                    make_entry(emoji.Name, "<a:" + emoji.Name + ":" + std::to_string(emoji.ID) + ">", emoji.GetURL("gif"), true);
-                else
-                    make_entry(emoji.Name, "<:" + emoji.Name + ":" + std::to_string(emoji.ID) + ">", emoji.GetURL());
-            }
-        }
+    std::vector<Snowflake> emoji_ids;
+    if (can_use_external)
+        emoji_ids = index.FindEmojis(std::nullopt, term, MaxCompleterEntries, true);
+    else if (channel.has_value() && channel->GuildID.has_value())
+        emoji_ids = index.FindEmojis(*channel->GuildID, term, MaxCompleterEntries, false);
+
+    for (const auto id : emoji_ids) {
+        const auto *emoji = index.GetEmoji(id);
+        if (emoji == nullptr) continue;
+        if (emoji->IsAnimated)
+            make_entry(emoji->Name, "<a:" + emoji->Name + ":" + std::to_string(id) + ">", EmojiData::URLFromID(id, "gif"), true);
+        else
+            make_entry(emoji->Name, "<:" + emoji->Name + ":" + std::to_string(id) + ">", EmojiData::URLFromID(id));
     }
-done:
 
     // if <15 guild emojis match then load up stock
-    if (i < 15) {
-        std::unordered_set<std::string> added_patterns;
+    if (emoji_ids.size() < MaxStockEmojiEntries) {
         auto &emojis = Abaddon::Get().GetEmojis();
-        const auto &shortcodes = emojis.GetShortCodes();
-        for (const auto &[shortcode, pattern] : shortcodes) {
-            if (added_patterns.find(pattern) != added_patterns.end()) continue;
-            if (!StringContainsCaseless(shortcode, term)) continue;
-            if (i++ > 15) break;
-            const auto &pb = emojis.GetPixBuf(pattern);
-            if (!pb) continue;
-            added_patterns.insert(pattern);
+        for (const auto &[shortcode, pattern] : index.FindShortCodes(term, MaxStockEmojiEntries - emoji_ids.size())) {
+            auto &pb = m_stock_pixbufs[pattern];
+            if (!pb) {
+                pb = emojis.GetPixBuf(pattern);
+                if (!pb) continue;
+                pb = pb->scale_simple(CompleterImageSize, CompleterImageSize, Gdk::INTERP_BILINEAR);
+            }
             const auto entry = make_entry(shortcode, pattern);
-            entry->SetImage(pb->scale_simple(CompleterImageSize, CompleterImageSize, Gdk::INTERP_BILINEAR));
+            entry->SetImage(pb);
         }
     }
 }
@@ -229,18 +255,15 @@ void Completer::CompleteChannels(const Glib::ustring &term) {
         return;
 
     const auto &discord = Abaddon::Get().GetDiscordClient();
+    auto &index = Abaddon::Get().GetCompletionIndex();
     const auto channel_id = m_channel_id_cb();
     const auto channel = discord.GetChannel(channel_id);
-    if (!channel->GuildID.has_value()) return;
-    const auto channels = discord.GetChannelsInGuild(*channel->GuildID);
-    int i = 0;
-    for (const auto chan_id : channels) {
-        const auto chan = discord.GetChannel(chan_id);
-        if (chan->Type == ChannelType::GUILD_VOICE || chan->Type == ChannelType::GUILD_CATEGORY) continue;
-        if (!StringContainsCaseless(*chan->Name, term)) continue;
-        if (i++ > MaxCompleterEntries) break;
+    if (!channel.has_value() || !channel->GuildID.has_value()) return;
+    for (const auto chan_id : index.FindChannels(*channel->GuildID, term, MaxCompleterEntries)) {
+        const auto *name = index.GetChannelName(*channel->GuildID, chan_id);
+        if (name == nullptr) continue;
         const auto entry = CreateEntry("<#" + std::to_string(chan_id) + ">");
-        entry->SetText("#" + *chan->Name);
+        entry->SetText("#" + *name);
     }
 }
 
@@ -262,6 +285,7 @@ void Completer::OnTextBufferChanged() {
         delete *it;
         it = m_entries.erase(it);
     }
+    m_search_guild_id = Snowflake::Invalid;
 
     switch (term[0]) {
         case '@':
@@ -1,6 +1,8 @@
 #pragma once
 #include <gtkmm.h>
 #include <functional>
+#include <optional>
+#include <unordered_map>
 #include "lazyimage.hpp"
 #include "discord/snowflake.hpp"
 
@@ -46,6 +48,9 @@ public:
 private:
     CompleterEntry *CreateEntry(const Glib::ustring &completion);
     void CompleteMentions(const Glib::ustring &term);
+    void AddMentionEntry(Snowflake id, std::optional<Snowflake> guild_id);
+    void MergeMemberSearchResults();
+    void OnMemberSearchResults(Snowflake guild_id, const Glib::ustring &query);
     void CompleteEmojis(const Glib::ustring &term);
     void CompleteChannels(const Glib::ustring &term);
     void DoCompletion(Gtk::ListBoxRow *row);
@@ -63,6 +68,12 @@ private:
     Gtk::ListBox m_list;
     Glib::RefPtr<Gtk::TextBuffer> m_buf;
 
+    std::unordered_map<std::string, Glib::RefPtr<Gdk::Pixbuf>> m_stock_pixbufs; // scaled, by pattern
+
+    // server side search for the mention being typed, invalid if there isnt one
+    Snowflake m_search_guild_id;
+    Glib::ustring m_search_term;
+
     get_recent_authors_cb m_recent_authors_cb;
     get_channel_id_cb m_channel_id_cb;
 };
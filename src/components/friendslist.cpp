@@ -1,5 +1,6 @@
 #include "friendslist.hpp"
 #include "abaddon.hpp"
+#include "gtkutil.hpp"
 #include "lazyimage.hpp"
 
 using namespace std::string_literals;
@@ -257,7 +258,7 @@ FriendsListFriendRow::FriendsListFriendRow(RelationshipType type, const UserData
     auto *lblbox = Gtk::manage(new Gtk::Box(Gtk::ORIENTATION_VERTICAL));
 
     auto &discord = Abaddon::Get().GetDiscordClient();
-    discord.signal_presence_update().connect(sigc::mem_fun(*this, &FriendsListFriendRow::OnPresenceUpdate));
+    discord.signal_presence_update_by_user().connect(ID, sigc::mem_fun(*this, &FriendsListFriendRow::OnPresenceUpdate));
 
     if (data.HasAnimatedAvatar() && Abaddon::Get().GetSettings().ShowAnimations) {
         img->SetAnimated(true);
@@ -331,8 +332,7 @@ void FriendsListFriendRow::UpdatePresenceLabel() {
     }
 }
 
-void FriendsListFriendRow::OnPresenceUpdate(const UserData &user, PresenceStatus status) {
-    if (user.ID != ID) return;
+void FriendsListFriendRow::OnPresenceUpdate(PresenceStatus status) {
     Status = status;
     UpdatePresenceLabel();
     changed();
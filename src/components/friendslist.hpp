@@ -65,7 +65,7 @@ public:
 
 private:
     void UpdatePresenceLabel();
-    void OnPresenceUpdate(const UserData &user, PresenceStatus status);
+    void OnPresenceUpdate(PresenceStatus status);
 
     Gtk::Label *m_status_lbl;
 
@@ -3,6 +3,7 @@
 #include "util.hpp"
 #include "lazyimage.hpp"
 #include "statusindicator.hpp"
+#include "discord/tracer.hpp"
 
 constexpr static const int MaxMemberListRows = 200;
 
@@ -66,16 +67,36 @@ MemberListUserRow::MemberListUserRow(const std::optional<GuildData> &guild, cons
 }
 
 MemberList::MemberList() {
-    m_main = Gtk::manage(new Gtk::ScrolledWindow);
-    m_listbox = Gtk::manage(new Gtk::ListBox);
+    m_main = Gtk::manage(new Gtk::Stack);
 
-    m_listbox->get_style_context()->add_class("members");
+    const auto view = CreateView();
+    m_scroll = view.Scroll;
+    m_listbox = view.ListBox;
 
-    m_listbox->set_selection_mode(Gtk::SELECTION_NONE);
+    m_main->show();
 
-    m_main->set_policy(Gtk::POLICY_NEVER, Gtk::POLICY_AUTOMATIC);
-    m_main->add(*m_listbox);
-    m_main->show_all();
+    // the active list is rebuilt by the main window, parked ones would just go stale
+    // so they get thrown out and rebuilt if they ever come back
+    auto &discord = Abaddon::Get().GetDiscordClient();
+    discord.signal_guild_member_list_update().connect(sigc::mem_fun(*this, &MemberList::DropCachedLists));
+    discord.signal_guild_member_update().connect([this](Snowflake guild_id, Snowflake) {
+        DropCachedLists(guild_id);
+    });
+    discord.signal_role_update().connect([this](Snowflake guild_id, Snowflake) {
+        DropCachedLists(guild_id);
+    });
+    discord.signal_role_create().connect([this](Snowflake guild_id, Snowflake) {
+        DropCachedLists(guild_id);
+    });
+    discord.signal_role_delete().connect([this](Snowflake guild_id, Snowflake) {
+        DropCachedLists(guild_id);
+    });
+    discord.signal_thread_member_list_update().connect([this](const ThreadMemberListUpdateData &data) {
+        DropCachedList(data.ThreadID);
+    });
+    discord.signal_thread_members_update().connect([this](const ThreadMembersUpdateData &data) {
+        DropCachedList(data.ID);
+    });
 }
 
 Gtk::Widget *MemberList::GetRoot() const {
@@ -84,20 +105,121 @@ Gtk::Widget *MemberList::GetRoot() const {
 
 void MemberList::Clear() {
     SetActiveChannel(Snowflake::Invalid);
+    ClearCachedLists();
     UpdateMemberList();
 }
 
 void MemberList::SetActiveChannel(Snowflake id) {
     m_chan_id = id;
     m_guild_id = Snowflake::Invalid;
+    Snowflake key = id;
     if (m_chan_id.IsValid()) {
-        const auto chan = Abaddon::Get().GetDiscordClient().GetChannel(id);
-        if (chan.has_value() && chan->GuildID.has_value()) m_guild_id = *chan->GuildID;
+        const auto chan = Abaddon::Get().GetDiscordClient().GetChannelSnapshot(id);
+        if (chan != nullptr && chan->GuildID.has_value()) {
+            m_guild_id = *chan->GuildID;
+            if (!chan->IsThread()) key = m_guild_id;
+        }
+    }
+
+    if (key == m_view_key) return;
+
+    const int max_views = Abaddon::Get().GetSettings().CachedChannels;
+    if (m_populated && m_view_key.IsValid() && max_views > 0) {
+        m_cached_views.push_front({ m_view_key, m_view_guild_id, m_scroll, m_listbox });
+        const auto it = std::find_if(m_cached_views.begin(), m_cached_views.end(), [key](const View &view) {
+            return view.Key == key;
+        });
+        if (it != m_cached_views.end()) {
+            m_scroll = it->Scroll;
+            m_listbox = it->ListBox;
+            m_populated = true;
+            m_cached_views.erase(it);
+        } else {
+            const auto view = CreateView();
+            m_scroll = view.Scroll;
+            m_listbox = view.ListBox;
+            m_populated = false;
+        }
+        TrimCachedLists();
+    } else {
+        const auto it = std::find_if(m_cached_views.begin(), m_cached_views.end(), [key](const View &view) {
+            return view.Key == key;
+        });
+        if (it != m_cached_views.end()) {
+            // the current one was never filled, nothing worth keeping
+            delete m_scroll;
+            m_scroll = it->Scroll;
+            m_listbox = it->ListBox;
+            m_populated = true;
+            m_cached_views.erase(it);
+        } else {
+            m_populated = false;
+        }
+    }
+
+    m_view_key = key;
+    m_view_guild_id = m_guild_id;
+    m_main->set_visible_child(*m_scroll);
+}
+
+bool MemberList::IsActiveListPopulated() const {
+    return m_populated;
+}
+
+void MemberList::DropCachedLists(Snowflake guild_id) {
+    if (!guild_id.IsValid()) return;
+    for (auto it = m_cached_views.begin(); it != m_cached_views.end();) {
+        if (it->GuildID == guild_id) {
+            delete it->Scroll;
+            it = m_cached_views.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+void MemberList::DropCachedList(Snowflake key) {
+    const auto it = std::find_if(m_cached_views.begin(), m_cached_views.end(), [key](const View &view) {
+        return view.Key == key;
+    });
+    if (it == m_cached_views.end()) return;
+    delete it->Scroll;
+    m_cached_views.erase(it);
+}
+
+void MemberList::ClearCachedLists() {
+    for (const auto &view : m_cached_views)
+        delete view.Scroll;
+    m_cached_views.clear();
+}
+
+MemberList::View MemberList::CreateView() {
+    View view;
+    view.Scroll = Gtk::manage(new Gtk::ScrolledWindow);
+    view.ListBox = Gtk::manage(new Gtk::ListBox);
+
+    view.ListBox->get_style_context()->add_class("members");
+    view.ListBox->set_selection_mode(Gtk::SELECTION_NONE);
+
+    view.Scroll->set_policy(Gtk::POLICY_NEVER, Gtk::POLICY_AUTOMATIC);
+    view.Scroll->add(*view.ListBox);
+    view.Scroll->show_all();
+    m_main->add(*view.Scroll);
+    return view;
+}
+
+void MemberList::TrimCachedLists() {
+    const auto max_views = static_cast<size_t>(std::max(0, Abaddon::Get().GetSettings().CachedChannels));
+    while (m_cached_views.size() > max_views) {
+        delete m_cached_views.back().Scroll;
+        m_cached_views.pop_back();
     }
 }
 
 void MemberList::UpdateMemberList() {
+    Tracer::Span span("build member list");
     m_id_to_row.clear();
+    m_populated = false;
 
     auto children = m_listbox->get_children();
     auto it = children.begin();
@@ -112,6 +234,7 @@ void MemberList::UpdateMemberList() {
     auto &discord = Abaddon::Get().GetDiscordClient();
     const auto chan = discord.GetChannel(m_chan_id);
     if (!chan.has_value()) return;
+    m_populated = true;
     if (chan->Type == ChannelType::DM || chan->Type == ChannelType::GROUP_DM) {
         int num_rows = 0;
         for (const auto &user : chan->GetDMRecipients()) {
@@ -125,43 +248,39 @@ void MemberList::UpdateMemberList() {
         return;
     }
 
-    std::set<Snowflake> ids;
+    SnowflakeSet thread_ids;
+    const SnowflakeSet *ids = &thread_ids;
     if (chan->IsThread()) {
         const auto x = discord.GetUsersInThread(m_chan_id);
-        ids = { x.begin(), x.end() };
+        thread_ids = { x.begin(), x.end() };
     } else
-        ids = discord.GetUsersInGuild(m_guild_id);
+        ids = &discord.GetUsersInGuild(m_guild_id);
 
     // process all the shit first so its in proper order
-    std::map<int, RoleData> pos_to_role;
-    std::map<int, std::vector<UserData>> pos_to_users;
-    std::unordered_map<Snowflake, int> user_to_color;
-    std::vector<Snowflake> roleless_users;
-
-    for (const auto &id : ids) {
-        auto user = discord.GetUser(id);
-        if (!user.has_value() || user->IsDeleted())
+    // snapshots so big guilds dont copy every user and role
+    std::map<int, std::shared_ptr<const RoleData>> pos_to_role;
+    std::map<int, std::vector<std::shared_ptr<const UserData>>> pos_to_users;
+    std::vector<std::shared_ptr<const UserData>> roleless_users;
+
+    for (const auto &id : *ids) {
+        auto user = discord.GetUserSnapshot(id);
+        if (user == nullptr || user->IsDeleted())
             continue;
 
-        auto pos_role_id = discord.GetMemberHoistedRole(m_guild_id, id);       // role for positioning
-        auto col_role_id = discord.GetMemberHoistedRole(m_guild_id, id, true); // role for color
-        auto pos_role = discord.GetRole(pos_role_id);
-        auto col_role = discord.GetRole(col_role_id);
+        auto pos_role = discord.GetRoleSnapshot(discord.GetMemberHoistedRole(m_guild_id, id)); // role for positioning
 
-        if (!pos_role.has_value()) {
-            roleless_users.push_back(id);
+        if (pos_role == nullptr) {
+            roleless_users.push_back(std::move(user));
             continue;
         }
 
-        pos_to_role[pos_role->Position] = *pos_role;
-        pos_to_users[pos_role->Position].push_back(std::move(*user));
-        if (col_role.has_value())
-            user_to_color[id] = col_role->Color;
+        pos_to_users[pos_role->Position].push_back(std::move(user));
+        pos_to_role[pos_role->Position] = std::move(pos_role);
     }
 
     int num_rows = 0;
-    const auto guild = discord.GetGuild(m_guild_id);
-    if (!guild.has_value()) return;
+    const auto guild = discord.GetGuildSnapshot(m_guild_id);
+    if (guild == nullptr) return;
     auto add_user = [this, &num_rows, guild](const UserData &data) -> bool {
         if (num_rows++ > MaxMemberListRows) return false;
         auto *row = Gtk::manage(new MemberListUserRow(*guild, data));
@@ -193,26 +312,23 @@ void MemberList::UpdateMemberList() {
         auto pos = it->first;
         const auto &role = it->second;
 
-        add_role(role.Name);
+        add_role(role->Name);
 
         if (pos_to_users.find(pos) == pos_to_users.end()) continue;
 
         auto &users = pos_to_users.at(pos);
-        AlphabeticalSort(users.begin(), users.end(), [](const auto &e) { return e.Username; });
+        AlphabeticalSort(users.begin(), users.end(), [](const auto &e) { return e->Username; });
 
         for (const auto &data : users)
-            if (!add_user(data)) return;
+            if (!add_user(*data)) return;
     }
 
     if (chan->Type == ChannelType::DM || chan->Type == ChannelType::GROUP_DM)
         add_role("Users");
     else
         add_role("@everyone");
-    for (const auto &id : roleless_users) {
-        const auto user = discord.GetUser(id);
-        if (user.has_value())
-            if (!add_user(*user)) return;
-    }
+    for (const auto &user : roleless_users)
+        if (!add_user(*user)) return;
 }
 
 void MemberList::AttachUserMenuHandler(Gtk::ListBoxRow *row, Snowflake id) {
@@ -1,5 +1,6 @@
 #pragma once
 #include <gtkmm.h>
+#include <list>
 #include <mutex>
 #include <unordered_map>
 #include <optional>
@@ -30,12 +31,32 @@ public:
     void UpdateMemberList();
     void Clear();
     void SetActiveChannel(Snowflake id);
+    bool IsActiveListPopulated() const; // came back from the cache so it doesnt need an update
+    void ClearCachedLists();
 
 private:
     void AttachUserMenuHandler(Gtk::ListBoxRow *row, Snowflake id);
+    void DropCachedLists(Snowflake guild_id); // every parked list in the guild, threads included
+    void DropCachedList(Snowflake key);
 
-    Gtk::ScrolledWindow *m_main;
+    // every channel in a guild shows the same list so guild channels share one keyed by the guild
+    // dms and threads get their own
+    struct View {
+        Snowflake Key;
+        Snowflake GuildID;
+        Gtk::ScrolledWindow *Scroll;
+        Gtk::ListBox *ListBox;
+    };
+    View CreateView();
+    void TrimCachedLists();
+
+    Gtk::Stack *m_main;
+    Gtk::ScrolledWindow *m_scroll;
     Gtk::ListBox *m_listbox;
+    Snowflake m_view_key;
+    Snowflake m_view_guild_id;
+    bool m_populated = false;
+    std::list<View> m_cached_views; // most recently used first
 
     Snowflake m_guild_id;
     Snowflake m_chan_id;
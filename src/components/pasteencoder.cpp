@@ -0,0 +1,91 @@
+#include "pasteencoder.hpp"
+#include <glibmm/fileutils.h>
+#include "discord/log.hpp"
+#include "discord/tracer.hpp"
+
+PasteEncoder::PasteEncoder() {
+    m_thread = std::thread([this] { loop(); });
+}
+
+PasteEncoder::~PasteEncoder() {
+    m_queue_mutex.lock();
+    m_stop = true;
+    m_cv.notify_all();
+    m_queue_mutex.unlock();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void PasteEncoder::Encode(Glib::RefPtr<Gdk::Pixbuf> pb, std::string path_stem, size_t size_target, callback_type callback) {
+    // the pixbuf is only read from here on, the main thread keeps using it for the thumbnail
+    Queue([this, pb = std::move(pb), path_stem = std::move(path_stem), size_target, callback = std::move(callback)] {
+        auto result = EncodeNow(pb, path_stem, size_target);
+        m_main.Post([callback, result = std::move(result)] {
+            callback(result);
+        });
+    });
+}
+
+static std::string SaveToBuffer(const Glib::RefPtr<Gdk::Pixbuf> &pb, const Glib::ustring &type, const std::vector<Glib::ustring> &keys = {}, const std::vector<Glib::ustring> &values = {}) {
+    gchar *buffer = nullptr;
+    gsize size = 0;
+    pb->save_to_buffer(buffer, size, type, keys, values);
+    std::string data(buffer, size);
+    g_free(buffer);
+    return data;
+}
+
+PasteEncoder::Result PasteEncoder::EncodeNow(const Glib::RefPtr<Gdk::Pixbuf> &pb, const std::string &path_stem, size_t size_target) {
+    Tracer::Span span("paste encode");
+    Result result;
+    try {
+        std::string data = SaveToBuffer(pb, "png");
+        result.Extension = "png";
+
+        if (size_target > 0 && data.size() > size_target) {
+            // jpeg has no alpha so flatten onto white first instead of letting transparent parts go black
+            auto flat = Gdk::Pixbuf::create(Gdk::COLORSPACE_RGB, false, 8, pb->get_width(), pb->get_height());
+            flat->fill(0xFFFFFFFF);
+            pb->composite(flat, 0, 0, pb->get_width(), pb->get_height(), 0.0, 0.0, 1.0, 1.0, Gdk::INTERP_NEAREST, 255);
+
+            for (const char *quality : { "90", "80", "70", "60" }) {
+                auto jpeg = SaveToBuffer(flat, "jpeg", { "quality" }, { quality });
+                if (jpeg.size() >= data.size()) continue;
+                data = std::move(jpeg);
+                result.Extension = "jpg";
+                if (data.size() <= size_target) break;
+            }
+        }
+
+        result.Path = path_stem + "." + result.Extension;
+        Glib::file_set_contents(result.Path, data.data(), static_cast<gssize>(data.size()));
+        result.Size = data.size();
+        result.Success = true;
+    } catch (const Glib::Error &e) {
+        LOG_ERROR(Images, "pasted image save error: %s", e.what().c_str());
+    } catch (...) {
+        LOG_ERROR(Images, "pasted image save error");
+    }
+    return result;
+}
+
+void PasteEncoder::Queue(std::function<void()> work) {
+    m_queue_mutex.lock();
+    m_queue.push(std::move(work));
+    m_cv.notify_one();
+    m_queue_mutex.unlock();
+}
+
+void PasteEncoder::loop() {
+    Tracer::SetThreadName("paste encoder");
+    while (true) {
+        std::function<void()> work;
+        {
+            std::unique_lock<std::mutex> lock(m_queue_mutex);
+            m_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_stop) return;
+            work = std::move(m_queue.front());
+            m_queue.pop();
+        }
+        work();
+    }
+}
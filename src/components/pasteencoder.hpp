@@ -0,0 +1,43 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <gdkmm/pixbuf.h>
+#include "discord/dispatcher.hpp"
+
+// writes pasted images to disk on a worker so a big paste doesnt freeze the input box
+// png first, if that comes out bigger than the size target it falls back to jpeg at decreasing quality
+class PasteEncoder {
+public:
+    struct Result {
+        bool Success = false;
+        std::string Path;      // stem + extension
+        std::string Extension; // "png" or "jpg"
+        size_t Size = 0;
+    };
+
+    using callback_type = std::function<void(Result)>; // runs on the main thread
+
+    PasteEncoder();
+    ~PasteEncoder();
+
+    // size_target of 0 means always png
+    void Encode(Glib::RefPtr<Gdk::Pixbuf> pb, std::string path_stem, size_t size_target, callback_type callback);
+
+private:
+    static Result EncodeNow(const Glib::RefPtr<Gdk::Pixbuf> &pb, const std::string &path_stem, size_t size_target);
+
+    void Queue(std::function<void()> work);
+    void loop();
+
+    std::thread m_thread;
+    bool m_stop = false;
+    std::mutex m_queue_mutex;
+    std::condition_variable m_cv;
+    std::queue<std::function<void()>> m_queue;
+
+    GlibDispatcher m_main;
+};
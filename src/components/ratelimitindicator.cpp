@@ -27,6 +27,7 @@ RateLimitIndicator::RateLimitIndicator()
 
     Abaddon::Get().GetDiscordClient().signal_message_create().connect(sigc::mem_fun(*this, &RateLimitIndicator::OnMessageCreate));
     Abaddon::Get().GetDiscordClient().signal_message_send_fail().connect(sigc::mem_fun(*this, &RateLimitIndicator::OnMessageSendFail));
+    Abaddon::Get().GetDiscordClient().signal_message_send_delayed().connect(sigc::mem_fun(*this, &RateLimitIndicator::OnMessageSendFail)); // slowmode, its sent again once it runs out
     Abaddon::Get().GetDiscordClient().signal_channel_update().connect(sigc::mem_fun(*this, &RateLimitIndicator::OnChannelUpdate));
 }
 
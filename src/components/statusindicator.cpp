@@ -13,11 +13,8 @@ StatusIndicator::StatusIndicator(Snowflake user_id)
 
     get_style_context()->add_class("status-indicator");
 
-    Abaddon::Get().GetDiscordClient().signal_guild_member_list_update().connect(sigc::hide(sigc::mem_fun(*this, &StatusIndicator::CheckStatus)));
-    auto cb = [this](const UserData &user, PresenceStatus status) {
-        if (user.ID == m_id) CheckStatus();
-    };
-    Abaddon::Get().GetDiscordClient().signal_presence_update().connect(sigc::track_obj(cb, *this));
+    // member list syncs come through here too
+    Abaddon::Get().GetDiscordClient().signal_presence_update_by_user().connect(m_id, sigc::hide(sigc::mem_fun(*this, &StatusIndicator::CheckStatus)));
 
     CheckStatus();
 }
@@ -10,3 +10,6 @@ constexpr static int NitroAttachmentSizeLimit = 100 * 1024 * 1024;
 constexpr static int BoostLevel2AttachmentSizeLimit = 50 * 1024 * 1024;
 constexpr static int BoostLevel3AttachmentSizeLimit = 100 * 1024 * 1024;
 constexpr static int MaxMessagePayloadSize = 199 * 1024 * 1024;
+constexpr static int PresenceFlushInterval = 16; // ms, roughly one frame
+constexpr static int TypingIndicatorTimeout = 10; // seconds
+constexpr static int MaxCachedViewMessages = 1000; // across all cached chat views, not counting the active one
@@ -1,4 +1,4 @@
-#include "abaddon.hpp"
+#include "discord.hpp"
 #include "channel.hpp"
 
 void from_json(const nlohmann::json &j, ThreadMetadataData &m) {
@@ -77,7 +77,7 @@ bool ChannelData::IsThread() const noexcept {
 }
 
 bool ChannelData::IsJoinedThread() const {
-    return Abaddon::Get().GetDiscordClient().IsThreadJoined(ID);
+    return DiscordClient::Get().IsThreadJoined(ID);
 }
 
 bool ChannelData::IsCategory() const noexcept {
@@ -114,15 +114,15 @@ std::string ChannelData::GetDisplayName() const {
 }
 
 std::vector<Snowflake> ChannelData::GetChildIDs() const {
-    return Abaddon::Get().GetDiscordClient().GetChildChannelIDs(ID);
+    return DiscordClient::Get().GetChildChannelIDs(ID);
 }
 
 std::optional<PermissionOverwrite> ChannelData::GetOverwrite(Snowflake id) const {
-    return Abaddon::Get().GetDiscordClient().GetPermissionOverwrite(ID, id);
+    return DiscordClient::Get().GetPermissionOverwrite(ID, id);
 }
 
 std::vector<UserData> ChannelData::GetDMRecipients() const {
-    const auto &discord = Abaddon::Get().GetDiscordClient();
+    const auto &discord = DiscordClient::Get();
     if (Recipients.has_value())
         return *Recipients;
 
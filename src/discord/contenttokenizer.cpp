@@ -0,0 +1,198 @@
+#include "contenttokenizer.hpp"
+#include <algorithm>
+
+constexpr static size_t MaxIDDigits = 20;
+
+static bool HasFlag(ContentTokenFlags flags, ContentTokenFlags flag) {
+    return (flags & flag) != ContentTokenFlags::None;
+}
+
+// ascii only like the regexes this replaced
+static bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool IsWordChar(char c) {
+    return IsDigit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+StockEmojiMatcher::StockEmojiMatcher() {
+    m_nodes.emplace_back();
+}
+
+void StockEmojiMatcher::Add(std::string_view pattern) {
+    if (pattern.empty()) return;
+    m_starts[static_cast<uint8_t>(pattern[0])] = true;
+
+    uint32_t cur = 0;
+    for (const char c : pattern) {
+        const auto byte = static_cast<uint8_t>(c);
+        auto &children = m_nodes[cur].Children;
+        const auto it = std::lower_bound(children.begin(), children.end(), byte, [](const auto &child, uint8_t b) {
+            return child.first < b;
+        });
+        if (it != children.end() && it->first == byte) {
+            cur = it->second;
+            continue;
+        }
+        // insert before growing m_nodes since that invalidates children
+        const auto next = static_cast<uint32_t>(m_nodes.size());
+        children.insert(it, { byte, next });
+        m_nodes.emplace_back();
+        cur = next;
+    }
+    m_nodes[cur].IsTerminal = true;
+}
+
+size_t StockEmojiMatcher::Match(std::string_view str) const {
+    if (str.empty() || !m_starts[static_cast<uint8_t>(str[0])]) return 0;
+
+    size_t best = 0;
+    uint32_t cur = 0;
+    for (size_t i = 0; i < str.size(); i++) {
+        const auto byte = static_cast<uint8_t>(str[i]);
+        const auto &children = m_nodes[cur].Children;
+        const auto it = std::lower_bound(children.begin(), children.end(), byte, [](const auto &child, uint8_t b) {
+            return child.first < b;
+        });
+        if (it == children.end() || it->first != byte) break;
+        cur = it->second;
+        if (m_nodes[cur].IsTerminal) best = i + 1;
+    }
+    return best;
+}
+
+bool StockEmojiMatcher::Empty() const {
+    return m_nodes.size() == 1;
+}
+
+// digits followed by '>', returns the position after '>' or npos
+static size_t ParseID(std::string_view s, size_t pos, Snowflake &out) {
+    const size_t start = pos;
+    uint64_t n = 0;
+    while (pos < s.size() && IsDigit(s[pos])) {
+        if (pos - start >= MaxIDDigits) return std::string_view::npos;
+        n = n * 10 + static_cast<uint64_t>(s[pos] - '0');
+        pos++;
+    }
+    if (pos == start || pos >= s.size() || s[pos] != '>') return std::string_view::npos;
+    out = n;
+    return pos + 1;
+}
+
+// everything that starts with '<'
+static size_t MatchAngle(std::string_view s, size_t pos, ContentTokenFlags flags, ContentSpan &span) {
+    size_t p = pos + 1;
+    if (p >= s.size()) return 0;
+
+    size_t end = std::string_view::npos;
+    if (s[p] == '@') {
+        p++;
+        if (p < s.size() && s[p] == '&') {
+            if (!HasFlag(flags, ContentTokenFlags::RoleMentions)) return 0;
+            span.Type = ContentSpanType::RoleMention;
+            end = ParseID(s, p + 1, span.ID);
+        } else {
+            if (!HasFlag(flags, ContentTokenFlags::UserMentions)) return 0;
+            if (p < s.size() && s[p] == '!') p++;
+            span.Type = ContentSpanType::UserMention;
+            end = ParseID(s, p, span.ID);
+        }
+    } else if (s[p] == '#') {
+        if (!HasFlag(flags, ContentTokenFlags::ChannelMentions)) return 0;
+        span.Type = ContentSpanType::ChannelMention;
+        end = ParseID(s, p + 1, span.ID);
+    } else if (s[p] == ':' || (s[p] == 'a' && p + 1 < s.size() && s[p + 1] == ':')) {
+        if (!HasFlag(flags, ContentTokenFlags::CustomEmojis)) return 0;
+        span.IsAnimated = s[p] == 'a';
+        p += span.IsAnimated ? 2 : 1;
+        const size_t name_start = p;
+        while (p < s.size() && IsWordChar(s[p])) p++;
+        if (p == name_start || p >= s.size() || s[p] != ':') return 0;
+        span.Type = ContentSpanType::CustomEmoji;
+        span.Name = s.substr(name_start, p - name_start);
+        end = ParseID(s, p + 1, span.ID);
+    }
+
+    if (end == std::string_view::npos) return 0;
+    return end - pos;
+}
+
+// same as \bhttps?:\/\/[^\s]+\.[^\s]+\b, caller checks the leading \b
+static size_t MatchLink(std::string_view s, size_t pos) {
+    size_t p;
+    if (s.compare(pos, 7, "http://") == 0)
+        p = pos + 7;
+    else if (s.compare(pos, 8, "https://") == 0)
+        p = pos + 8;
+    else
+        return 0;
+
+    size_t q = p;
+    while (q < s.size() && !IsSpace(s[q])) q++;
+
+    // needs at least one character on both sides of a dot
+    const size_t dot = s.find('.', p + 1);
+    if (dot == std::string_view::npos || dot >= q) return 0;
+
+    // back off to the last word boundary like the greedy match did
+    for (size_t e = q; e >= dot + 2; e--) {
+        const bool before = IsWordChar(s[e - 1]);
+        const bool after = e < s.size() && IsWordChar(s[e]);
+        if (before != after) return e - pos;
+    }
+    return 0;
+}
+
+static ContentSpan MakeTextSpan(std::string_view text) {
+    ContentSpan span;
+    span.Text = text;
+    return span;
+}
+
+std::vector<ContentSpan> TokenizeContent(std::string_view content, ContentTokenFlags flags, const StockEmojiMatcher *stock_emojis) {
+    std::vector<ContentSpan> spans;
+
+    const bool links = HasFlag(flags, ContentTokenFlags::Links);
+    const bool stock = HasFlag(flags, ContentTokenFlags::StockEmojis) && stock_emojis != nullptr && !stock_emojis->Empty();
+
+    size_t text_start = 0;
+    size_t pos = 0;
+    while (pos < content.size()) {
+        const char c = content[pos];
+        ContentSpan span;
+        size_t len = 0;
+
+        if (c == '<')
+            len = MatchAngle(content, pos, flags, span);
+        if (len == 0 && links && c == 'h' && (pos == 0 || !IsWordChar(content[pos - 1]))) {
+            len = MatchLink(content, pos);
+            span.Type = ContentSpanType::Link;
+        }
+        if (len == 0 && stock) {
+            len = stock_emojis->Match(content.substr(pos));
+            span.Type = ContentSpanType::StockEmoji;
+        }
+
+        if (len == 0) {
+            pos++;
+            continue;
+        }
+
+        if (pos > text_start)
+            spans.push_back(MakeTextSpan(content.substr(text_start, pos - text_start)));
+        span.Text = content.substr(pos, len);
+        spans.push_back(span);
+        pos += len;
+        text_start = pos;
+    }
+
+    if (content.size() > text_start)
+        spans.push_back(MakeTextSpan(content.substr(text_start)));
+
+    return spans;
+}
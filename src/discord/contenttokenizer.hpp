@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "snowflake.hpp"
+#include "util.hpp"
+
+// splits message content into spans in one pass so the chat view can build its text buffer without regexes
+
+enum class ContentSpanType {
+    Text,
+    UserMention,    // <@id> <@!id>
+    RoleMention,    // <@&id>
+    ChannelMention, // <#id>
+    CustomEmoji,    // <:name:id> <a:name:id>
+    Link,           // http(s)://...
+    StockEmoji,
+};
+
+enum class ContentTokenFlags : uint16_t {
+    None = 0,
+    UserMentions = 1 << 0,
+    RoleMentions = 1 << 1,
+    ChannelMentions = 1 << 2,
+    CustomEmojis = 1 << 3,
+    Links = 1 << 4,
+    StockEmojis = 1 << 5,
+};
+
+template<>
+struct Bitwise<ContentTokenFlags> {
+    static const bool enable = true;
+};
+
+struct ContentSpan {
+    ContentSpanType Type = ContentSpanType::Text;
+    std::string_view Text; // raw content covered by the span
+    std::string_view Name; // custom emoji name
+    Snowflake ID;          // mention or custom emoji id
+    bool IsAnimated = false;
+};
+
+// longest match lookup over the stock emoji sequences
+class StockEmojiMatcher {
+public:
+    StockEmojiMatcher();
+
+    void Add(std::string_view pattern);
+    // length in bytes of the longest pattern starting at the beginning of str, 0 if none
+    [[nodiscard]] size_t Match(std::string_view str) const;
+    [[nodiscard]] bool Empty() const;
+
+private:
+    struct Node {
+        std::vector<std::pair<uint8_t, uint32_t>> Children; // sorted by byte
+        bool IsTerminal = false;
+    };
+
+    std::vector<Node> m_nodes;
+    bool m_starts[256] {}; // first bytes of any pattern
+};
+
+// spans reference content so it has to outlive them
+// adjacent text is merged into one span
+std::vector<ContentSpan> TokenizeContent(std::string_view content, ContentTokenFlags flags, const StockEmojiMatcher *stock_emojis = nullptr);
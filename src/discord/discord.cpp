@@ -1,23 +1,24 @@
-#include "abaddon.hpp"
 #include "discord.hpp"
 #include "util.hpp"
+#include "constants.hpp"
+#include "log.hpp"
+#include "loopprofiler.hpp"
+#include "tracer.hpp"
+#include "metrics.hpp"
+#include <algorithm>
 #include <cinttypes>
 #include <utility>
 
 using namespace std::string_literals;
 
-DiscordClient::DiscordClient(bool mem_store)
+static DiscordClient *s_instance = nullptr;
+
+DiscordClient::DiscordClient(bool mem_store, std::shared_ptr<Dispatcher> dispatcher, const std::string &outbox_path)
     : m_decompress_buf(InflateChunkSize)
-    , m_store(mem_store) {
-    m_msg_dispatch.connect(sigc::mem_fun(*this, &DiscordClient::MessageDispatch));
-    auto dispatch_cb = [this]() {
-        m_generic_mutex.lock();
-        auto func = m_generic_queue.front();
-        m_generic_queue.pop();
-        m_generic_mutex.unlock();
-        func();
-    };
-    m_generic_dispatch.connect(dispatch_cb);
+    , m_dispatcher(dispatcher ? std::move(dispatcher) : std::make_shared<GlibDispatcher>())
+    , m_store(mem_store, outbox_path)
+    , m_http(m_dispatcher) {
+    s_instance = this;
 
     m_websocket.signal_message().connect(sigc::mem_fun(*this, &DiscordClient::HandleGatewayMessageRaw));
     m_websocket.signal_open().connect(sigc::mem_fun(*this, &DiscordClient::HandleSocketOpen));
@@ -29,7 +30,7 @@ DiscordClient::DiscordClient(bool mem_store)
 void DiscordClient::Start() {
     if (m_client_started) return;
 
-    m_http.SetBase(GetAPIURL());
+    m_http.SetBase(m_api_url);
     SetHeaders();
 
     std::memset(&m_zstream, 0, sizeof(m_zstream));
@@ -39,11 +40,18 @@ void DiscordClient::Start() {
     m_heartbeat_acked = true;
     m_client_connected = true;
     m_client_started = true;
-    m_websocket.StartConnection(GetGatewayURL());
+    if (!RestoreSession())
+        m_websocket.StartConnection(m_gateway_url);
 }
 
-bool DiscordClient::Stop() {
+bool DiscordClient::Stop(bool keep_session) {
     if (m_client_started) {
+        const bool saved = keep_session && SaveSession();
+        if (!saved)
+            m_session_cache.Discard();
+        m_session_restore_pending = false;
+        m_ready_deferred = false;
+
         inflateEnd(&m_zstream);
         m_compressed_buf.clear();
 
@@ -54,8 +62,18 @@ bool DiscordClient::Stop() {
 
         m_store.ClearAll();
         m_guild_to_users.clear();
+        m_live_channels.clear();
+        m_outbox_ready = false; // kept for when the same account logs back in
+        ClearBackfill();
+        m_backfill_channels.clear();
+        m_recent_channels.clear();
 
-        m_websocket.Stop();
+        m_pending_presences.clear(); // flush can still be queued, itll just find nothing
+
+        if (saved)
+            m_websocket.Stop(1012); // anything but 1000 and 1001 keeps the session resumable
+        else
+            m_websocket.Stop();
 
         m_client_started = false;
 
@@ -67,10 +85,36 @@ bool DiscordClient::Stop() {
     return false;
 }
 
+DiscordClient &DiscordClient::Get() {
+    return *s_instance;
+}
+
+void DiscordClient::SetAPIURL(std::string url) {
+    m_api_url = std::move(url);
+}
+
+void DiscordClient::SetGatewayURL(std::string url) {
+    m_gateway_url = std::move(url);
+}
+
+void DiscordClient::SetSessionCacheDirectory(std::string path) {
+    m_session_cache.SetDirectory(std::move(path));
+}
+
 bool DiscordClient::IsStarted() const {
     return m_client_started;
 }
 
+void DiscordClient::FeedGatewayData(std::string data, bool new_stream) {
+    if (new_stream) {
+        inflateEnd(&m_zstream);
+        m_compressed_buf.clear();
+        std::memset(&m_zstream, 0, sizeof(m_zstream));
+        inflateInit2(&m_zstream, MAX_WBITS + 32);
+    }
+    HandleGatewayMessageRaw(std::move(data));
+}
+
 bool DiscordClient::IsStoreValid() const {
     return m_store.IsValid();
 }
@@ -130,9 +174,9 @@ void DiscordClient::FetchInvite(const std::string &code, const sigc::slot<void(s
     });
 }
 
-void DiscordClient::FetchMessagesInChannel(Snowflake id, const sigc::slot<void(const std::vector<Message> &)> &cb) {
+void DiscordClient::FetchMessagesInChannel(Snowflake id, const sigc::slot<void(const std::vector<Message> &)> &cb, const sigc::slot<void(const http::response_type &)> &err_cb) {
     std::string path = "/channels/" + std::to_string(id) + "/messages?limit=50";
-    m_http.MakeGET(path, [this, id, cb](const http::response_type &r) {
+    m_http.MakeGET(path, [this, id, cb, err_cb](const http::response_type &r) {
         if (!CheckCode(r)) {
             // fake a thread delete event if the requested channel is a thread and we get a 404
 
@@ -148,6 +192,7 @@ void DiscordClient::FetchMessagesInChannel(Snowflake id, const sigc::slot<void(c
                 }
             }
 
+            err_cb(r);
             return;
         }
 
@@ -161,56 +206,157 @@ void DiscordClient::FetchMessagesInChannel(Snowflake id, const sigc::slot<void(c
             if (msg.GuildID.has_value())
                 AddUserToGuild(msg.Author.ID, *msg.GuildID);
         }
+        // newest first. a short page means we have everything back to the start of the channel
+        if (msgs.empty())
+            m_store.AddMessageRange(id, Store::MessageRange::ChannelStart, Store::MessageRange::ChannelStart);
+        else
+            m_store.AddMessageRange(id, msgs.size() < 50 ? Snowflake(Store::MessageRange::ChannelStart) : msgs.back().ID, msgs.front().ID);
         m_store.EndTransaction();
+        m_live_channels.insert(id);
 
         cb(msgs);
     });
 }
 
-void DiscordClient::FetchMessagesInChannelBefore(Snowflake channel_id, Snowflake before_id, const sigc::slot<void(const std::vector<Message> &)> &cb) {
-    std::string path = "/channels/" + std::to_string(channel_id) + "/messages?limit=50&before=" + std::to_string(before_id);
-    m_http.MakeGET(path, [this, cb](http::response_type r) {
+void DiscordClient::FetchMessagesInChannelBefore(Snowflake channel_id, Snowflake before_id, const sigc::slot<void(const std::vector<Message> &)> &cb, size_t limit) {
+    std::string path = "/channels/" + std::to_string(channel_id) + "/messages?limit=" + std::to_string(limit) + "&before=" + std::to_string(before_id);
+    m_http.MakeGET(path, [this, channel_id, before_id, limit, cb](http::response_type r) {
         if (!CheckCode(r)) return;
 
         std::vector<Message> msgs;
 
         nlohmann::json::parse(r.text).get_to(msgs);
 
+        std::sort(msgs.begin(), msgs.end(), [](const Message &a, const Message &b) { return a.ID < b.ID; });
+
         m_store.BeginTransaction();
         for (auto &msg : msgs) {
             StoreMessageData(msg);
             if (msg.GuildID.has_value())
                 AddUserToGuild(msg.Author.ID, *msg.GuildID);
         }
+        // before_id itself isnt necessarily stored but its only ever used as a bound
+        m_store.AddMessageRange(channel_id, msgs.size() < limit ? Snowflake(Store::MessageRange::ChannelStart) : msgs.front().ID, before_id);
         m_store.EndTransaction();
 
+        cb(msgs);
+    });
+}
+
+void DiscordClient::FetchMessagesInChannelAround(Snowflake channel_id, Snowflake around_id, const sigc::slot<void(const std::vector<Message> &)> &cb) {
+    std::string path = "/channels/" + std::to_string(channel_id) + "/messages?limit=50&around=" + std::to_string(around_id);
+    m_http.MakeGET(path, [this, channel_id, cb](http::response_type r) {
+        if (!CheckCode(r)) return;
+
+        std::vector<Message> msgs;
+
+        nlohmann::json::parse(r.text).get_to(msgs);
+
         std::sort(msgs.begin(), msgs.end(), [](const Message &a, const Message &b) { return a.ID < b.ID; });
+
+        m_store.BeginTransaction();
+        for (auto &msg : msgs) {
+            StoreMessageData(msg);
+            if (msg.GuildID.has_value())
+                AddUserToGuild(msg.Author.ID, *msg.GuildID);
+        }
+        // cant tell if a short page hit either end so only whats in it counts
+        if (!msgs.empty())
+            m_store.AddMessageRange(channel_id, msgs.front().ID, msgs.back().ID);
+        m_store.EndTransaction();
+
         cb(msgs);
     });
 }
 
+void DiscordClient::LoadMessagesBefore(Snowflake channel_id, Snowflake before_id, const sigc::slot<void(const std::vector<Message> &)> &cb) {
+    constexpr static size_t PageSize = 50;
+
+    if (!before_id.IsValid()) {
+        cb({});
+        return;
+    }
+
+    const auto range = m_store.GetMessageRange(channel_id, before_id);
+    if (!range.has_value()) {
+        FetchMessagesInChannelBefore(channel_id, before_id, cb);
+        return;
+    }
+
+    // anything older than the start of the range might have a gap before it
+    auto local = m_store.GetMessagesBefore(channel_id, before_id, PageSize);
+    local.erase(local.begin(), std::find_if(local.begin(), local.end(), [&](const Message &msg) { return range->Start <= msg.ID; }));
+
+    if (local.size() >= PageSize || range->ReachesChannelStart()) {
+        cb(local);
+        return;
+    }
+
+    const auto fetch_before = local.empty() ? before_id : local.front().ID;
+    FetchMessagesInChannelBefore(
+        channel_id, fetch_before, [local = std::move(local), cb](const std::vector<Message> &fetched) {
+            std::vector<Message> msgs;
+            msgs.reserve(fetched.size() + local.size());
+            msgs.insert(msgs.end(), fetched.begin(), fetched.end());
+            msgs.insert(msgs.end(), local.begin(), local.end());
+            cb(msgs);
+        },
+        PageSize - local.size());
+}
+
+// the copying getters go through the snapshots too so they at least skip the database
+template<typename T>
+static std::optional<T> CopySnapshot(const std::shared_ptr<const T> &snapshot) {
+    if (snapshot == nullptr) return std::nullopt;
+    return *snapshot;
+}
+
 std::optional<Message> DiscordClient::GetMessage(Snowflake id) const {
-    return m_store.GetMessage(id);
+    return CopySnapshot(GetMessageSnapshot(id));
 }
 
 std::optional<ChannelData> DiscordClient::GetChannel(Snowflake id) const {
-    return m_store.GetChannel(id);
+    return CopySnapshot(GetChannelSnapshot(id));
 }
 
 std::optional<UserData> DiscordClient::GetUser(Snowflake id) const {
-    return m_store.GetUser(id);
+    return CopySnapshot(GetUserSnapshot(id));
 }
 
 std::optional<RoleData> DiscordClient::GetRole(Snowflake id) const {
-    return m_store.GetRole(id);
+    return CopySnapshot(GetRoleSnapshot(id));
 }
 
 std::optional<GuildData> DiscordClient::GetGuild(Snowflake id) const {
-    return m_store.GetGuild(id);
+    return CopySnapshot(GetGuildSnapshot(id));
 }
 
 std::optional<GuildMember> DiscordClient::GetMember(Snowflake user_id, Snowflake guild_id) const {
-    return m_store.GetGuildMember(guild_id, user_id);
+    return CopySnapshot(GetMemberSnapshot(user_id, guild_id));
+}
+
+std::shared_ptr<const Message> DiscordClient::GetMessageSnapshot(Snowflake id) const {
+    return m_store.GetMessageSnapshot(id);
+}
+
+std::shared_ptr<const ChannelData> DiscordClient::GetChannelSnapshot(Snowflake id) const {
+    return m_store.GetChannelSnapshot(id);
+}
+
+std::shared_ptr<const UserData> DiscordClient::GetUserSnapshot(Snowflake id) const {
+    return m_store.GetUserSnapshot(id);
+}
+
+std::shared_ptr<const RoleData> DiscordClient::GetRoleSnapshot(Snowflake id) const {
+    return m_store.GetRoleSnapshot(id);
+}
+
+std::shared_ptr<const GuildData> DiscordClient::GetGuildSnapshot(Snowflake id) const {
+    return m_store.GetGuildSnapshot(id);
+}
+
+std::shared_ptr<const GuildMember> DiscordClient::GetMemberSnapshot(Snowflake user_id, Snowflake guild_id) const {
+    return m_store.GetGuildMemberSnapshot(guild_id, user_id);
 }
 
 std::optional<PermissionOverwrite> DiscordClient::GetPermissionOverwrite(Snowflake channel_id, Snowflake id) const {
@@ -222,51 +368,36 @@ std::optional<EmojiData> DiscordClient::GetEmoji(Snowflake id) const {
 }
 
 Snowflake DiscordClient::GetMemberHoistedRole(Snowflake guild_id, Snowflake user_id, bool with_color) const {
-    const auto data = GetMember(user_id, guild_id);
-    if (!data.has_value()) return Snowflake::Invalid;
-
-    std::optional<RoleData> top_role;
-    for (const auto &id : data->Roles) {
-        const auto role = GetRole(id);
-        if (role.has_value()) {
-            if ((with_color && role->Color != 0x000000) || (!with_color && role->IsHoisted))
-                if (!top_role.has_value() || top_role->Position < role->Position)
-                    top_role = role;
-        }
-    }
-
-    return top_role.has_value() ? top_role->ID : Snowflake::Invalid;
+    const auto roles = m_store.GetMemberRoles(guild_id, user_id);
+    return with_color ? roles.ColorRole : roles.HoistedRole;
 }
 
 std::optional<RoleData> DiscordClient::GetMemberHighestRole(Snowflake guild_id, Snowflake user_id) const {
-    const auto data = GetMember(user_id, guild_id);
-    if (!data.has_value()) return std::nullopt;
-
-    if (data->Roles.empty()) return std::nullopt;
-    if (data->Roles.size() == 1) return GetRole(data->Roles[0]);
-
-    std::vector<RoleData> roles;
-    for (const auto id : data->Roles)
-        roles.push_back(*GetRole(id));
+    const auto id = m_store.GetMemberRoles(guild_id, user_id).HighestRole;
+    if (!id.IsValid()) return std::nullopt;
+    return GetRole(id);
+}
 
-    return *std::max_element(roles.begin(), roles.end(), [](const auto &a, const auto &b) -> bool {
-        return a.Position < b.Position;
-    });
+int DiscordClient::GetMemberHighestRolePosition(Snowflake guild_id, Snowflake user_id) const {
+    return m_store.GetMemberRoles(guild_id, user_id).HighestPosition;
 }
 
-std::set<Snowflake> DiscordClient::GetUsersInGuild(Snowflake id) const {
+static const SnowflakeSet EmptyIDSet;
+static const SortedSnowflakeSet EmptySortedIDSet;
+
+const SnowflakeSet &DiscordClient::GetUsersInGuild(Snowflake id) const {
     auto it = m_guild_to_users.find(id);
     if (it != m_guild_to_users.end())
         return it->second;
 
-    return {};
+    return EmptyIDSet;
 }
 
-std::set<Snowflake> DiscordClient::GetChannelsInGuild(Snowflake id) const {
+const SortedSnowflakeSet &DiscordClient::GetChannelsInGuild(Snowflake id) const {
     auto it = m_guild_to_channels.find(id);
     if (it != m_guild_to_channels.end())
         return it->second;
-    return {};
+    return EmptySortedIDSet;
 }
 
 std::vector<Snowflake> DiscordClient::GetUsersInThread(Snowflake id) const {
@@ -311,7 +442,7 @@ std::vector<Snowflake> DiscordClient::GetChildChannelIDs(Snowflake parent_id) co
 }
 
 bool DiscordClient::IsThreadJoined(Snowflake thread_id) const {
-    return std::find(m_joined_threads.begin(), m_joined_threads.end(), thread_id) != m_joined_threads.end();
+    return m_joined_threads.contains(thread_id);
 }
 
 bool DiscordClient::HasGuildPermission(Snowflake user_id, Snowflake guild_id, Permission perm) const {
@@ -324,16 +455,16 @@ bool DiscordClient::HasSelfChannelPermission(Snowflake channel_id, Permission pe
 }
 
 bool DiscordClient::HasAnyChannelPermission(Snowflake user_id, Snowflake channel_id, Permission perm) const {
-    const auto channel = m_store.GetChannel(channel_id);
-    if (!channel.has_value() || !channel->GuildID.has_value()) return false;
+    const auto channel = GetChannelSnapshot(channel_id);
+    if (channel == nullptr || !channel->GuildID.has_value()) return false;
     const auto base = ComputePermissions(user_id, *channel->GuildID);
     const auto overwrites = ComputeOverwrites(base, user_id, channel_id);
     return (overwrites & perm) != Permission::NONE;
 }
 
 bool DiscordClient::HasChannelPermission(Snowflake user_id, Snowflake channel_id, Permission perm) const {
-    const auto channel = m_store.GetChannel(channel_id);
-    if (!channel.has_value()) return false;
+    const auto channel = GetChannelSnapshot(channel_id);
+    if (channel == nullptr) return false;
     if (channel->IsDM()) return true;
     const auto base = ComputePermissions(user_id, *channel->GuildID);
     const auto overwrites = ComputeOverwrites(base, user_id, channel_id);
@@ -341,22 +472,22 @@ bool DiscordClient::HasChannelPermission(Snowflake user_id, Snowflake channel_id
 }
 
 Permission DiscordClient::ComputePermissions(Snowflake member_id, Snowflake guild_id) const {
-    const auto member = GetMember(member_id, guild_id);
-    const auto guild = GetGuild(guild_id);
-    if (!member.has_value() || !guild.has_value())
+    const auto member = GetMemberSnapshot(member_id, guild_id);
+    const auto guild = GetGuildSnapshot(guild_id);
+    if (member == nullptr || guild == nullptr)
         return Permission::NONE;
 
     if (guild->OwnerID == member_id)
         return Permission::ALL;
 
-    const auto everyone = GetRole(guild_id);
-    if (!everyone.has_value())
+    const auto everyone = GetRoleSnapshot(guild_id);
+    if (everyone == nullptr)
         return Permission::NONE;
 
     Permission perms = everyone->Permissions;
     for (const auto role_id : member->Roles) {
-        const auto role = GetRole(role_id);
-        if (role.has_value())
+        const auto role = GetRoleSnapshot(role_id);
+        if (role != nullptr)
             perms |= role->Permissions;
     }
 
@@ -370,9 +501,11 @@ Permission DiscordClient::ComputeOverwrites(Permission base, Snowflake member_id
     if ((base & Permission::ADMINISTRATOR) == Permission::ADMINISTRATOR)
         return Permission::ALL;
 
-    const auto channel = GetChannel(channel_id);
-    const auto member = GetMember(member_id, *channel->GuildID);
-    if (!member.has_value() || !channel.has_value())
+    const auto channel = GetChannelSnapshot(channel_id);
+    if (channel == nullptr || !channel->GuildID.has_value())
+        return Permission::NONE;
+    const auto member = GetMemberSnapshot(member_id, *channel->GuildID);
+    if (member == nullptr)
         return Permission::NONE;
 
     Permission perms = base;
@@ -407,127 +540,383 @@ Permission DiscordClient::ComputeOverwrites(Permission base, Snowflake member_id
 bool DiscordClient::CanManageMember(Snowflake guild_id, Snowflake actor, Snowflake target) const {
     const auto guild = GetGuild(guild_id);
     if (guild.has_value() && guild->OwnerID == target) return false;
-    const auto actor_highest = GetMemberHighestRole(guild_id, actor);
-    const auto target_highest = GetMemberHighestRole(guild_id, target);
-    if (!actor_highest.has_value()) return false;
-    if (!target_highest.has_value()) return true;
-    return actor_highest->Position > target_highest->Position;
-}
-
-void DiscordClient::ChatMessageCallback(const std::string &nonce, const http::response_type &response, const sigc::slot<void(DiscordError)> &callback) {
-    if (!CheckCode(response)) {
-        if (response.status_code == http::TooManyRequests) {
-            try { // not sure if this body is guaranteed
-                RateLimitedResponse r = nlohmann::json::parse(response.text);
-                m_signal_message_send_fail.emit(nonce, r.RetryAfter);
-            } catch (...) {
-                m_signal_message_send_fail.emit(nonce, 0);
-            }
-        } else {
-            m_signal_message_send_fail.emit(nonce, 0);
-        }
-
-        // todo actually callback with correct error code (not necessary rn)
-        callback(DiscordError::GENERIC);
-    } else {
-        callback(DiscordError::NONE);
-    }
+    const auto actor_highest = GetMemberHighestRolePosition(guild_id, actor);
+    const auto target_highest = GetMemberHighestRolePosition(guild_id, target);
+    if (actor_highest < 0) return false;
+    if (target_highest < 0) return true;
+    return actor_highest > target_highest;
 }
 
-void DiscordClient::SendChatMessageNoAttachments(const ChatSubmitParams &params, const sigc::slot<void(DiscordError)> &callback) {
-    const auto nonce = std::to_string(Snowflake::FromNow());
+void DiscordClient::SendChatMessage(const ChatSubmitParams &params, const sigc::slot<void(DiscordError)> &callback) {
+    OutboxItem item;
+    item.Entry.Nonce = Snowflake::FromNow();
+    item.Entry.UserID = GetUserData().ID;
+    item.Entry.ChannelID = params.ChannelID;
+    item.Entry.InReplyToID = params.InReplyToID;
+    item.Entry.Content = params.Message;
+    bool keep = true;
+    for (const auto &attachment : params.Attachments) {
+        auto path = attachment.File->get_path();
+        // uri backed files (gvfs and such) have no local path so there would be nothing to send after a restart
+        if (path.empty()) keep = false;
+        item.Entry.Attachments.push_back({ std::move(path), attachment.Filename, attachment.Type == ChatSubmitParams::PastedImage });
+    }
+    item.Attachments = params.Attachments;
+    item.Callback = callback;
 
-    CreateMessageObject obj;
-    obj.Content = params.Message;
-    obj.Nonce = nonce;
-    if (params.InReplyToID.IsValid())
-        obj.MessageReference.emplace().MessageID = params.InReplyToID;
+    // still sent this session either way, it just isnt kept across restarts
+    if (keep)
+        m_store.SetOutboxEntry(item.Entry);
+    m_signal_message_create.emit(StorePendingMessage(item.Entry));
 
-    m_http.MakePOST("/channels/" + std::to_string(params.ChannelID) + "/messages",
-                    nlohmann::json(obj).dump(),
-                    [this, nonce, callback](const http::response_type &r) {
-                        ChatMessageCallback(nonce, r, callback);
-                    });
+    const auto nonce = std::to_string(item.Entry.Nonce);
+    const auto channel_id = item.Entry.ChannelID;
+    m_outbox_queues[channel_id].push_back(nonce);
+    m_outbox.emplace(nonce, std::move(item));
+    PumpOutbox(channel_id);
+}
 
+Message DiscordClient::StorePendingMessage(const Store::OutboxEntry &entry) {
     // dummy preview data
     Message tmp;
-    tmp.Content = params.Message;
-    tmp.ID = nonce;
-    tmp.ChannelID = params.ChannelID;
+    tmp.Content = entry.Content;
+    tmp.ID = entry.Nonce;
+    tmp.ChannelID = entry.ChannelID;
     tmp.Author = GetUserData();
     tmp.IsTTS = false;
     tmp.DoesMentionEveryone = false;
     tmp.Type = MessageType::DEFAULT;
     tmp.IsPinned = false;
     tmp.Timestamp = "2000-01-01T00:00:00.000000+00:00";
-    tmp.Nonce = nonce;
+    tmp.Nonce = std::to_string(entry.Nonce);
     tmp.IsPending = true;
 
     m_store.SetMessage(tmp.ID, tmp);
-    m_signal_message_create.emit(tmp);
+    return tmp;
+}
+
+void DiscordClient::LoadOutbox() {
+    // whatever another account left behind stays in the store until it logs in again
+    for (auto it = m_outbox.begin(); it != m_outbox.end();) {
+        if (it->second.Entry.UserID == GetUserData().ID) {
+            it++;
+            continue;
+        }
+        auto &queue = m_outbox_queues[it->second.Entry.ChannelID];
+        queue.erase(std::remove(queue.begin(), queue.end(), it->first), queue.end());
+        it = m_outbox.erase(it);
+    }
+
+    for (auto &entry : m_store.GetOutbox(GetUserData().ID)) {
+        auto nonce = std::to_string(entry.Nonce);
+        if (m_outbox.find(nonce) != m_outbox.end()) continue;
+
+        OutboxItem item;
+        for (const auto &attachment : entry.Attachments) {
+            if (attachment.Path.empty()) continue;
+            auto file = Gio::File::create_for_path(attachment.Path);
+            if (!file->query_exists()) continue;
+            item.Attachments.push_back({ file, attachment.IsTemp ? ChatSubmitParams::PastedImage : ChatSubmitParams::ExtantFile, attachment.Filename });
+        }
+        if (entry.Content.empty() && item.Attachments.empty()) {
+            m_store.ClearOutboxEntry(entry.Nonce);
+            continue;
+        }
+        item.Entry = std::move(entry);
+        m_outbox_queues[item.Entry.ChannelID].push_back(nonce);
+        m_outbox.emplace(std::move(nonce), std::move(item));
+    }
+
+    for (auto &[channel_id, queue] : m_outbox_queues) {
+        std::sort(queue.begin(), queue.end(), [this](const std::string &a, const std::string &b) {
+            return m_outbox.at(a).Entry.Nonce < m_outbox.at(b).Entry.Nonce;
+        });
+    }
+
+    // the previews were cleared along with everything else
+    m_store.BeginTransaction();
+    for (const auto &[nonce, item] : m_outbox)
+        StorePendingMessage(item.Entry);
+    m_store.EndTransaction();
+
+    if (!m_outbox.empty())
+        LOG_INFO(General, "%zu messages waiting in the outbox", m_outbox.size());
+
+    m_outbox_ready = true;
+    PumpOutbox();
 }
 
-void DiscordClient::SendChatMessageAttachments(const ChatSubmitParams &params, const sigc::slot<void(DiscordError)> &callback) {
-    const auto nonce = std::to_string(Snowflake::FromNow());
+void DiscordClient::PumpOutbox() {
+    std::vector<Snowflake> channel_ids;
+    for (const auto &[channel_id, queue] : m_outbox_queues)
+        channel_ids.push_back(channel_id);
+    for (const auto channel_id : channel_ids)
+        PumpOutbox(channel_id);
+}
+
+void DiscordClient::PumpOutbox(Snowflake channel_id) {
+    if (!m_client_started || !m_outbox_ready) return;
+
+    // one message at a time per channel so they show up in the order they were sent
+    const auto it = m_outbox_queues.find(channel_id);
+    if (it == m_outbox_queues.end() || it->second.empty()) return;
+    const auto nonce = it->second.front();
+    auto &item = m_outbox.at(nonce);
+    if (item.InFlight || item.RetryQueued) return;
+
+    item.InFlight = true;
 
     CreateMessageObject obj;
-    obj.Content = params.Message;
+    obj.Content = item.Entry.Content;
     obj.Nonce = nonce;
-    if (params.InReplyToID.IsValid())
-        obj.MessageReference.emplace().MessageID = params.InReplyToID;
-
-    auto req = m_http.CreateRequest(http::REQUEST_POST, "/channels/" + std::to_string(params.ChannelID) + "/messages");
-    m_progress_cb_timer.start();
-    req.set_progress_callback([this, nonce](curl_off_t ultotal, curl_off_t ulnow) {
-        if (m_progress_cb_timer.elapsed() < 0.0417) return; // try to prevent it from blocking ui
-        m_progress_cb_timer.start();
-        m_generic_mutex.lock();
-        m_generic_queue.push([this, nonce, ultotal, ulnow] {
+    obj.EnforceNonce = true; // retries of something that actually went through get deduplicated
+    if (item.Entry.InReplyToID.IsValid())
+        obj.MessageReference.emplace().MessageID = item.Entry.InReplyToID;
+
+    const auto path = "/channels/" + std::to_string(channel_id) + "/messages";
+    const auto cb = [this, nonce](const http::response_type &r) {
+        OnOutboxResponse(nonce, r);
+    };
+
+    if (item.Attachments.empty()) {
+        m_http.MakePOST(path, nlohmann::json(obj).dump(), cb);
+        return;
+    }
+
+    auto req = m_http.CreateRequest(http::REQUEST_POST, path);
+    auto progress = std::make_shared<UploadProgress>();
+    req.set_progress_callback([this, nonce, progress](curl_off_t ultotal, curl_off_t ulnow) {
+        progress->Total = ultotal;
+        progress->Now = ulnow;
+        // curl calls this way more often than its worth redrawing for
+        const auto now = std::chrono::steady_clock::now();
+        if (now - progress->LastQueued < std::chrono::milliseconds(UploadProgressIntervalMilliseconds)) return;
+        if (progress->Queued.exchange(true)) return;
+        progress->LastQueued = now;
+        m_dispatcher->Post([this, nonce, progress] {
+            progress->Queued = false;
             m_signal_message_progress.emit(
                 nonce,
-                static_cast<float>(ulnow) / static_cast<float>(ultotal));
+                static_cast<float>(progress->Now) / static_cast<float>(progress->Total));
         });
-        m_generic_mutex.unlock();
-        m_generic_dispatch.emit();
     });
     req.make_form();
     req.add_field("payload_json", nlohmann::json(obj).dump().c_str(), CURL_ZERO_TERMINATED);
-    for (size_t i = 0; i < params.Attachments.size(); i++) {
+    for (size_t i = 0; i < item.Attachments.size(); i++) {
         const auto field_name = "files[" + std::to_string(i) + "]";
-        req.add_file(field_name, params.Attachments.at(i).File, params.Attachments.at(i).Filename);
+        req.add_file(field_name, item.Attachments.at(i).File, item.Attachments.at(i).Filename);
+    }
+    m_http.Execute(std::move(req), cb);
+}
+
+void DiscordClient::OnOutboxResponse(const std::string &nonce, const http::response_type &response) {
+    const auto it = m_outbox.find(nonce);
+    if (it == m_outbox.end()) return; // the gateway got it to us first
+    auto &item = it->second;
+    item.InFlight = false;
+
+    if (CheckCode(response)) {
+        FinishOutboxItem(nonce, DiscordError::NONE);
+        return;
+    }
+
+    float retry_after = 0.0f;
+    if (response.status_code == http::TooManyRequests) {
+        try { // not sure if this body is guaranteed
+            const RateLimitedResponse r = nlohmann::json::parse(response.text);
+            retry_after = r.RetryAfter;
+        } catch (...) {}
     }
-    m_http.Execute(std::move(req), [this, params, nonce, callback](const http::response_type &res) {
-        for (const auto &attachment : params.Attachments) {
-            if (attachment.Type == ChatSubmitParams::AttachmentType::PastedImage) {
+
+    const bool network_error = response.status_code == http::ClientErrorCURLPerform;
+    const bool retryable = network_error || response.status_code == http::TooManyRequests || response.status_code >= http::InternalServerError;
+
+    // nothing is going to get through until the connection is back, the gateway reconnecting picks it up again
+    if (network_error && !m_client_connected) return;
+
+    if (retryable && ++item.Attempts < MaxOutboxAttempts) {
+        unsigned delay = std::min(MaxOutboxBackoffMilliseconds, OutboxBackoffMilliseconds << (item.Attempts - 1));
+        if (retry_after > 0.0f) {
+            delay = static_cast<unsigned>(retry_after * 1000.0f) + 1;
+            m_signal_message_send_delayed.emit(nonce, retry_after);
+        }
+        LOG_WARN(HTTP, "message %s failed with %d, retrying in %ums", nonce.c_str(), response.status_code, delay);
+        item.RetryQueued = true;
+        const auto retry = [this, nonce] {
+            const auto it = m_outbox.find(nonce);
+            if (it == m_outbox.end()) return;
+            it->second.RetryQueued = false;
+            PumpOutbox(it->second.Entry.ChannelID);
+        };
+        m_dispatcher->PostDelayed(retry, delay);
+        return;
+    }
+
+    m_signal_message_send_fail.emit(nonce, retry_after);
+    FinishOutboxItem(nonce, GetCodeFromResponse(response));
+}
+
+void DiscordClient::FinishOutboxItem(const std::string &nonce, DiscordError code) {
+    const auto it = m_outbox.find(nonce);
+    if (it == m_outbox.end()) return;
+    const auto item = std::move(it->second);
+    m_outbox.erase(it);
+
+    const auto channel_id = item.Entry.ChannelID;
+    auto &queue = m_outbox_queues[channel_id];
+    queue.erase(std::remove(queue.begin(), queue.end(), nonce), queue.end());
+    if (queue.empty())
+        m_outbox_queues.erase(channel_id);
+
+    m_store.ClearOutboxEntry(item.Entry.Nonce);
+    if (code == DiscordError::NONE)
+        m_store.ClearMessage(item.Entry.Nonce); // the real one is (or will be) stored under its own id
+
+    for (const auto &attachment : item.Attachments) {
+        if (attachment.Type == ChatSubmitParams::AttachmentType::PastedImage) {
+            try {
                 attachment.File->remove();
-            }
+            } catch (...) {}
         }
-        ChatMessageCallback(nonce, res, callback);
+    }
+
+    if (!item.Callback.empty())
+        item.Callback(code);
+
+    PumpOutbox(channel_id);
+}
+
+void DiscordClient::MarkChannelViewed(Snowflake id) {
+    m_recent_channels.erase(std::remove(m_recent_channels.begin(), m_recent_channels.end(), id), m_recent_channels.end());
+    m_recent_channels.push_front(id);
+    if (m_recent_channels.size() > MaxBackfillChannels)
+        m_recent_channels.pop_back();
+}
+
+void DiscordClient::RememberBackfillChannels() {
+    const auto remember = [this](Snowflake channel_id) {
+        if (std::find(m_backfill_channels.begin(), m_backfill_channels.end(), channel_id) == m_backfill_channels.end())
+            m_backfill_channels.push_back(channel_id);
+    };
+    // whatever was still being caught up from last time has to start over
+    if (m_backfill_in_flight.IsValid())
+        remember(m_backfill_in_flight);
+    for (const auto &job : m_backfill_queue)
+        remember(job.ChannelID);
+    ClearBackfill();
+
+    for (const auto channel_id : m_recent_channels)
+        if (m_live_channels.contains(channel_id))
+            remember(channel_id);
+}
+
+void DiscordClient::StartBackfill() {
+    const auto channels = std::move(m_backfill_channels);
+    m_backfill_channels.clear();
+    for (const auto channel_id : channels) {
+        const auto ranges = m_store.GetMessageRanges(channel_id);
+        if (ranges.empty()) continue;
+        const auto newest = ranges.back().End;
+        const auto last = m_last_message_id.find(channel_id);
+        if (last == m_last_message_id.end() || last->second <= newest) {
+            m_live_channels.insert(channel_id); // nothing was missed
+            continue;
+        }
+        m_backfill_queue.push_back({ channel_id, newest });
+    }
+    PumpBackfill();
+}
+
+void DiscordClient::PumpBackfill() {
+    if (m_backfill_in_flight.IsValid() || m_backfill_pump_queued || m_backfill_queue.empty() || !m_client_started) return;
+
+    const auto job = m_backfill_queue.front();
+    m_backfill_queue.pop_front();
+    m_backfill_in_flight = job.ChannelID;
+
+    std::string path = "/channels/" + std::to_string(job.ChannelID) + "/messages?limit=" + std::to_string(BackfillPageSize);
+    if (!job.AfterFetched)
+        path += "&after=" + std::to_string(job.After);
+    const auto generation = m_backfill_generation;
+    m_http.MakeGET(path, [this, job, generation](const http::response_type &r) {
+        if (generation != m_backfill_generation) return;
+        m_backfill_in_flight = Snowflake::Invalid;
+        OnBackfillResponse(job, r);
     });
+}
 
-    // dummy preview data
-    Message tmp;
-    tmp.Content = params.Message;
-    tmp.ID = nonce;
-    tmp.ChannelID = params.ChannelID;
-    tmp.Author = GetUserData();
-    tmp.IsTTS = false;
-    tmp.DoesMentionEveryone = false;
-    tmp.Type = MessageType::DEFAULT;
-    tmp.IsPinned = false;
-    tmp.Timestamp = "2000-01-01T00:00:00.000000+00:00";
-    tmp.Nonce = nonce;
-    tmp.IsPending = true;
+void DiscordClient::ScheduleBackfillPump(unsigned delay) {
+    if (m_backfill_queue.empty()) return;
+    m_backfill_pump_queued = true;
+    const auto generation = m_backfill_generation;
+    m_dispatcher->PostDelayed([this, generation] {
+        if (generation != m_backfill_generation) return;
+        m_backfill_pump_queued = false;
+        PumpBackfill();
+    }, delay);
+}
+
+void DiscordClient::OnBackfillResponse(BackfillJob job, const http::response_type &r) {
+    if (!CheckCode(r)) {
+        unsigned delay = BackfillIntervalMilliseconds;
+        if (r.status_code == http::TooManyRequests) {
+            delay = BackfillBackoffMilliseconds;
+            try {
+                const RateLimitedResponse data = nlohmann::json::parse(r.text);
+                delay = static_cast<unsigned>(data.RetryAfter * 1000.0f) + 1;
+            } catch (...) {}
+        }
+        // if it gives up the channel just isnt live, opening it again fetches it like before
+        const bool retryable = r.status_code == http::TooManyRequests || r.status_code >= http::InternalServerError || r.status_code == http::ClientErrorCURLPerform;
+        if (retryable && ++job.Attempts < MaxBackfillAttempts)
+            m_backfill_queue.push_front(job);
+        ScheduleBackfillPump(delay);
+        return;
+    }
 
-    m_store.SetMessage(tmp.ID, tmp);
-    m_signal_message_create.emit(tmp);
+    std::vector<Message> msgs;
+    nlohmann::json::parse(r.text).get_to(msgs);
+    std::sort(msgs.begin(), msgs.end(), [](const Message &a, const Message &b) { return a.ID < b.ID; });
+
+    // anything the gateway delivered since ready is already stored, so a page that reaches the present covers up to it
+    const auto last = m_last_message_id.find(job.ChannelID);
+    const auto present = last == m_last_message_id.end() ? Snowflake(0ULL) : last->second;
+    const bool full = msgs.size() >= BackfillPageSize;
+
+    m_store.BeginTransaction();
+    for (auto &msg : msgs) {
+        StoreMessageData(msg);
+        if (msg.GuildID.has_value())
+            AddUserToGuild(msg.Author.ID, *msg.GuildID);
+    }
+    if (!job.AfterFetched) {
+        // picks up right where the stored messages left off
+        const auto end = msgs.empty() ? job.After : msgs.back().ID;
+        m_store.AddMessageRange(job.ChannelID, job.After, full ? end : std::max(end, present));
+    } else if (!msgs.empty()) {
+        // the rest of the hole is left for scrolling back
+        m_store.AddMessageRange(job.ChannelID, msgs.front().ID, std::max(msgs.back().ID, present));
+    }
+    m_store.EndTransaction();
+
+    if (full && !job.AfterFetched) {
+        job.AfterFetched = true;
+        job.Attempts = 0;
+        m_backfill_queue.push_front(job);
+    } else {
+        LOG_DEBUG(Gateway, "caught up %" PRIu64 " after reconnecting", static_cast<uint64_t>(job.ChannelID));
+        m_live_channels.insert(job.ChannelID);
+        m_signal_channel_backfilled.emit(job.ChannelID);
+    }
+
+    ScheduleBackfillPump(BackfillIntervalMilliseconds);
 }
 
-void DiscordClient::SendChatMessage(const ChatSubmitParams &params, const sigc::slot<void(DiscordError)> &callback) {
-    if (params.Attachments.empty())
-        SendChatMessageNoAttachments(params, callback);
-    else
-        SendChatMessageAttachments(params, callback);
+void DiscordClient::ClearBackfill() {
+    m_backfill_generation++;
+    m_backfill_queue.clear();
+    m_backfill_in_flight = Snowflake::Invalid;
+    m_backfill_pump_queued = false;
 }
 
 void DiscordClient::DeleteMessage(Snowflake channel_id, Snowflake id) {
@@ -593,7 +982,7 @@ void DiscordClient::UpdateStatus(PresenceStatus status, bool is_afk) {
     m_websocket.Send(nlohmann::json(msg));
     // fake message cuz we dont receive messages for ourself
     m_user_to_status[m_user_data.ID] = status;
-    m_signal_presence_update.emit(GetUserData(), status);
+    m_keyed_signal_presence_update.emit(m_user_data.ID, status);
 }
 
 void DiscordClient::UpdateStatus(PresenceStatus status, bool is_afk, const ActivityData &obj) {
@@ -604,7 +993,7 @@ void DiscordClient::UpdateStatus(PresenceStatus status, bool is_afk, const Activ
 
     m_websocket.Send(nlohmann::json(msg));
     m_user_to_status[m_user_data.ID] = status;
-    m_signal_presence_update.emit(GetUserData(), status);
+    m_keyed_signal_presence_update.emit(m_user_data.ID, status);
 }
 
 void DiscordClient::CloseDM(Snowflake channel_id) {
@@ -738,14 +1127,6 @@ void DiscordClient::ModifyRoleColor(Snowflake guild_id, Snowflake role_id, uint3
     });
 }
 
-void DiscordClient::ModifyRoleColor(Snowflake guild_id, Snowflake role_id, const Gdk::RGBA &color, const sigc::slot<void(DiscordError code)> &callback) {
-    uint32_t int_color = 0;
-    int_color |= static_cast<uint32_t>(color.get_blue() * 255.0) << 0;
-    int_color |= static_cast<uint32_t>(color.get_green() * 255.0) << 8;
-    int_color |= static_cast<uint32_t>(color.get_red() * 255.0) << 16;
-    ModifyRoleColor(guild_id, role_id, int_color, callback);
-}
-
 void DiscordClient::ModifyRolePosition(Snowflake guild_id, Snowflake role_id, int position, const sigc::slot<void(DiscordError code)> &callback) {
     const auto guild = GetGuild(guild_id);
     if (!guild.has_value() || !guild->Roles.has_value()) return;
@@ -909,7 +1290,7 @@ void DiscordClient::MarkChannelAsRead(Snowflake channel_id, const sigc::slot<voi
 
 void DiscordClient::MarkGuildAsRead(Snowflake guild_id, const sigc::slot<void(DiscordError code)> &callback) {
     AckBulkData data;
-    const auto channels = GetChannelsInGuild(guild_id);
+    const auto &channels = GetChannelsInGuild(guild_id);
     for (const auto &[unread, mention_count] : m_unread) {
         if (channels.find(unread) == channels.end()) continue;
 
@@ -1022,8 +1403,18 @@ bool DiscordClient::CanModifyRole(Snowflake guild_id, Snowflake role_id, Snowfla
     if (guild.OwnerID == user_id) return true;
     const auto role = *GetRole(role_id);
     const auto has_modify = HasGuildPermission(user_id, guild_id, Permission::MANAGE_CHANNELS);
-    const auto highest = GetMemberHighestRole(guild_id, user_id);
-    return has_modify && highest.has_value() && highest->Position > role.Position;
+    const auto highest = GetMemberHighestRolePosition(guild_id, user_id);
+    return has_modify && highest >= 0 && highest > role.Position;
+}
+
+void DiscordClient::RequestMembers(Snowflake guild_id, const std::string &query, int limit, const std::string &nonce) {
+    RequestGuildMembersMessage obj;
+    obj.GuildID = guild_id;
+    obj.Presences = false;
+    obj.Query = query;
+    obj.Limit = limit;
+    obj.Nonce = nonce;
+    m_websocket.Send(obj);
 }
 
 bool DiscordClient::CanModifyRole(Snowflake guild_id, Snowflake role_id) const {
@@ -1218,31 +1609,28 @@ int DiscordClient::GetUnreadStateForChannel(Snowflake id) const noexcept {
     return iter->second;
 }
 
-bool DiscordClient::GetUnreadStateForGuild(Snowflake id, int &total_mentions) const noexcept {
-    total_mentions = 0;
-    bool has_any_unread = false;
-    const auto channels = GetChannelsInGuild(id);
-    for (const auto channel_id : channels) {
-        const auto channel_unread = GetUnreadStateForChannel(channel_id);
-        if (channel_unread > -1)
-            total_mentions += channel_unread;
-
-        // channels under muted categories wont contribute to unread state
-        if (const auto iter = m_channel_muted_parent.find(channel_id); iter != m_channel_muted_parent.end())
-            continue;
+std::vector<Snowflake> DiscordClient::GetChannelsWithMentions() const {
+    std::vector<Snowflake> ret;
+    for (const auto &[channel_id, mentions] : m_unread)
+        if (mentions > 0)
+            ret.push_back(channel_id);
+    return ret;
+}
 
-        if (!has_any_unread && channel_unread > -1 && !IsChannelMuted(channel_id))
-            has_any_unread = true;
+bool DiscordClient::GetUnreadStateForGuild(Snowflake id, int &total_mentions) const noexcept {
+    const auto it = m_unread_aggregates.find(id);
+    if (it == m_unread_aggregates.end()) {
+        total_mentions = 0;
+        return false;
     }
-    return has_any_unread;
+    total_mentions = it->second.Mentions;
+    return it->second.UnreadChannels > 0;
 }
 
 int DiscordClient::GetUnreadDMsCount() const {
-    const auto channels = GetPrivateChannels();
-    int count = 0;
-    for (const auto channel_id : channels)
-        if (!IsChannelMuted(channel_id) && GetUnreadStateForChannel(channel_id) > -1) count++;
-    return count;
+    const auto it = m_unread_aggregates.find(Snowflake::Invalid);
+    if (it == m_unread_aggregates.end()) return 0;
+    return it->second.UnreadChannels;
 }
 
 PresenceStatus DiscordClient::GetUserStatus(Snowflake id) const {
@@ -1273,6 +1661,10 @@ std::optional<RelationshipType> DiscordClient::GetRelationship(Snowflake id) con
 
 void DiscordClient::HandleGatewayMessageRaw(std::string str) {
     // handles multiple zlib compressed messages, calling HandleGatewayMessage when a full message is received
+    Tracer::Span span("gateway inflate");
+    static auto &received_bytes = Metrics::Get().GetCounter("abaddon_gateway_received_bytes_total", "compressed bytes received from the gateway");
+    static auto &inflated_bytes = Metrics::Get().GetCounter("abaddon_gateway_inflated_bytes_total", "bytes of json inflated from gateway messages");
+    received_bytes.Inc(str.size());
     std::vector<uint8_t> buf(str.begin(), str.end());
     int len = static_cast<int>(buf.size());
     bool has_suffix = buf[len - 4] == 0x00 && buf[len - 3] == 0x00 && buf[len - 2] == 0xFF && buf[len - 1] == 0xFF;
@@ -1295,12 +1687,12 @@ void DiscordClient::HandleGatewayMessageRaw(std::string str) {
             m_decompress_buf.resize(m_decompress_buf.size() + InflateChunkSize);
         } else {
             if (err != Z_OK) {
-                fprintf(stderr, "Error decompressing input buffer %d (%d/%d)\n", err, m_zstream.avail_in, m_zstream.avail_out);
+                LOG_ERROR(Gateway, "Error decompressing input buffer %d (%d/%d)", err, m_zstream.avail_in, m_zstream.avail_out);
             } else {
-                m_msg_mutex.lock();
-                m_msg_queue.push(std::string(m_decompress_buf.begin(), m_decompress_buf.begin() + m_zstream.total_out));
-                m_msg_dispatch.emit();
-                m_msg_mutex.unlock();
+                inflated_bytes.Inc(m_zstream.total_out);
+                m_dispatcher->Post([this, msg = std::string(m_decompress_buf.begin(), m_decompress_buf.begin() + m_zstream.total_out)] {
+                    HandleGatewayMessage(msg);
+                });
                 if (m_decompress_buf.size() > InflateChunkSize)
                     m_decompress_buf.resize(InflateChunkSize);
             }
@@ -1311,26 +1703,31 @@ void DiscordClient::HandleGatewayMessageRaw(std::string str) {
     m_compressed_buf.clear();
 }
 
-void DiscordClient::MessageDispatch() {
-    m_msg_mutex.lock();
-    auto msg = m_msg_queue.front();
-    m_msg_queue.pop();
-    m_msg_mutex.unlock();
-    HandleGatewayMessage(msg);
-}
-
 void DiscordClient::HandleGatewayMessage(std::string str) {
+    LoopProfiler::Scope parse_scope("gateway message");
     GatewayMessage m;
     try {
+        Tracer::Span span("json decode");
         m = nlohmann::json::parse(str);
     } catch (std::exception &e) {
-        printf("Error decoding JSON. Discarding message: %s\n", e.what());
+        LOG_ERROR(Gateway, "Error decoding JSON. Discarding message: %s", e.what());
         return;
     }
 
     if (m.Sequence != -1)
         m_last_sequence = m.Sequence;
 
+    if (m.Opcode == GatewayOp::Dispatch && !m_replaying_session) {
+        if (m.Type == "READY")
+            m_session_cache.BeginJournal(str);
+        else
+            m_session_cache.Append(str);
+    }
+
+    const auto event_label = m.Opcode == GatewayOp::Dispatch ? m.Type : "op " + std::to_string(static_cast<int>(m.Opcode));
+    Metrics::Get().GetCounter("abaddon_gateway_events_total", "gateway messages handled, by dispatch event or opcode", { { "event", event_label } }).Inc();
+    LoopProfiler::Scope scope("gateway", event_label);
+    Tracer::Span span("gateway event", m.Type);
     try {
         switch (m.Opcode) {
             case GatewayOp::Hello: {
@@ -1348,13 +1745,16 @@ void DiscordClient::HandleGatewayMessage(std::string str) {
             case GatewayOp::Dispatch: {
                 auto iter = m_event_map.find(m.Type);
                 if (iter == m_event_map.end()) {
-                    printf("Unknown event %s\n", m.Type.c_str());
+                    LOG_DEBUG(Gateway, "Unknown event %s", m.Type.c_str());
                     break;
                 }
                 switch (iter->second) {
                     case GatewayEvent::READY: {
                         HandleGatewayReady(m);
                     } break;
+                    case GatewayEvent::RESUMED: {
+                        HandleGatewayResumed(m);
+                    } break;
                     case GatewayEvent::MESSAGE_CREATE: {
                         HandleGatewayMessageCreate(m);
                     } break;
@@ -1487,11 +1887,11 @@ void DiscordClient::HandleGatewayMessage(std::string str) {
                 }
             } break;
             default:
-                printf("Unknown opcode %d\n", static_cast<int>(m.Opcode));
+                LOG_DEBUG(Gateway, "Unknown opcode %d", static_cast<int>(m.Opcode));
                 break;
         }
     } catch (std::exception &e) {
-        fprintf(stderr, "error handling message (opcode %d): %s\n", static_cast<int>(m.Opcode), e.what());
+        LOG_ERROR(Gateway, "error handling message (opcode %d): %s", static_cast<int>(m.Opcode), e.what());
     }
 }
 
@@ -1506,19 +1906,12 @@ void DiscordClient::HandleGatewayHello(const GatewayMessage &msg) {
     if (m_wants_resume) {
         m_wants_resume = false;
         SendResume();
+        PumpOutbox(); // otherwise it waits for ready
     } else
         SendIdentify();
 }
 
 // perhaps this should be set by the main class
-std::string DiscordClient::GetAPIURL() {
-    return Abaddon::Get().GetSettings().APIBaseURL;
-}
-
-std::string DiscordClient::GetGatewayURL() {
-    return Abaddon::Get().GetSettings().GatewayURL;
-}
-
 DiscordError DiscordClient::GetCodeFromResponse(const http::response_type &response) {
     try {
         const auto data = nlohmann::json::parse(response.text);
@@ -1529,7 +1922,7 @@ DiscordError DiscordClient::GetCodeFromResponse(const http::response_type &respo
 
 void DiscordClient::ProcessNewGuild(GuildData &guild) {
     if (guild.IsUnavailable) {
-        printf("guild (%" PRIu64 ") unavailable\n", static_cast<uint64_t>(guild.ID));
+        LOG_INFO(Gateway, "guild (%" PRIu64 ") unavailable", static_cast<uint64_t>(guild.ID));
         return;
     }
 
@@ -1541,6 +1934,7 @@ void DiscordClient::ProcessNewGuild(GuildData &guild) {
             c.GuildID = guild.ID;
             m_store.SetChannel(c.ID, c);
             m_guild_to_channels[guild.ID].insert(c.ID);
+            m_channel_to_guild[c.ID] = guild.ID;
             for (auto &p : *c.PermissionOverwrites) {
                 m_store.SetPermissionOverwrite(c.ID, p.ID, p);
             }
@@ -1566,6 +1960,9 @@ void DiscordClient::ProcessNewGuild(GuildData &guild) {
 
 void DiscordClient::HandleGatewayReady(const GatewayMessage &msg) {
     m_ready_received = true;
+    if (!m_replaying_session)
+        RememberBackfillChannels();
+    m_live_channels.clear();
     ReadyEventData data = msg.Data;
     for (auto &g : data.Guilds)
         ProcessNewGuild(g);
@@ -1574,6 +1971,7 @@ void DiscordClient::HandleGatewayReady(const GatewayMessage &msg) {
 
     for (const auto &dm : data.PrivateChannels) {
         m_guild_to_channels[Snowflake::Invalid].insert(dm.ID);
+        m_channel_to_guild[dm.ID] = Snowflake::Invalid;
         m_store.SetChannel(dm.ID, dm);
         if (dm.Recipients.has_value())
             for (const auto &recipient : *dm.Recipients)
@@ -1604,11 +2002,35 @@ void DiscordClient::HandleGatewayReady(const GatewayMessage &msg) {
     m_store.EndTransaction();
 
     m_session_id = data.SessionID;
+    m_resume_gateway_url = data.ResumeGatewayURL.value_or("");
     m_user_data = data.SelfUser;
     m_user_settings = data.Settings;
 
     HandleReadyReadState(data);
     HandleReadyGuildSettings(data);
+    RebuildUnreadAggregates();
+
+    if (m_replaying_session) {
+        m_ready_deferred = true;
+        return;
+    }
+    m_ready_deferred = false;
+
+    LoadOutbox();
+    StartBackfill();
+
+    m_signal_gateway_ready.emit();
+}
+
+void DiscordClient::HandleGatewayResumed(const GatewayMessage &msg) {
+    if (m_replaying_session) return;
+    // missed events were replayed but channels stop being live on any disconnect
+    StartBackfill();
+    if (!m_ready_deferred) return;
+    LOG_INFO(Session, "resumed saved session");
+    m_ready_deferred = false;
+
+    LoadOutbox();
 
     m_signal_gateway_ready.emit();
 }
@@ -1619,11 +2041,16 @@ void DiscordClient::HandleGatewayMessageCreate(const GatewayMessage &msg) {
     if (data.GuildID.has_value())
         AddUserToGuild(data.Author.ID, *data.GuildID);
     m_last_message_id[data.ChannelID] = data.ID;
+    if (m_live_channels.contains(data.ChannelID))
+        m_store.ExtendNewestMessageRange(data.ChannelID, data.ID);
+    if (data.Nonce.has_value() && data.Author.ID == GetUserData().ID)
+        FinishOutboxItem(*data.Nonce, DiscordError::NONE);
     if (data.Author.ID != GetUserData().ID)
         m_unread[data.ChannelID];
     if (data.DoesMention(GetUserData().ID)) {
         m_unread[data.ChannelID]++;
     }
+    UpdateUnreadAggregate(data.ChannelID);
     m_signal_message_create.emit(data);
 }
 
@@ -1661,19 +2088,13 @@ void DiscordClient::HandleGatewayGuildMemberUpdate(const GatewayMessage &msg) {
         m_store.SetGuildMember(data.GuildID, data.User.ID, *cur);
     }
     m_signal_guild_member_update.emit(data.GuildID, data.User.ID);
+    m_keyed_signal_guild_member_update.emit(data.User.ID, data.GuildID);
 }
 
 void DiscordClient::HandleGatewayPresenceUpdate(const GatewayMessage &msg) {
     PresenceUpdateMessage data = msg.Data;
     const auto user_id = data.User.at("id").get<Snowflake>();
 
-    auto cur = m_store.GetUser(user_id);
-    if (cur.has_value()) {
-        cur->update_from_json(data.User);
-        m_store.SetUser(cur->ID, *cur);
-    } else
-        return;
-
     PresenceStatus e;
     if (data.StatusMessage == "online")
         e = PresenceStatus::Online;
@@ -1686,7 +2107,36 @@ void DiscordClient::HandleGatewayPresenceUpdate(const GatewayMessage &msg) {
 
     m_user_to_status[user_id] = e;
 
-    m_signal_presence_update.emit(*cur, e);
+    QueuePresenceUpdate(user_id, data.User);
+}
+
+void DiscordClient::QueuePresenceUpdate(Snowflake user_id, const nlohmann::json &user) {
+    // partial user objects so merge instead of replace
+    m_pending_presences[user_id].update(user);
+    if (!m_presence_flush_queued) {
+        m_presence_flush_queued = true;
+        m_dispatcher->PostDelayed([this] { FlushPresenceUpdates(); }, PresenceFlushInterval);
+    }
+}
+
+void DiscordClient::FlushPresenceUpdates() {
+    m_presence_flush_queued = false;
+
+    decltype(m_pending_presences) pending;
+    std::swap(pending, m_pending_presences);
+
+    m_store.BeginTransaction();
+    for (const auto &[id, user] : pending) {
+        if (user.empty()) continue;
+        auto cur = m_store.GetUser(id);
+        if (!cur.has_value()) continue;
+        cur->update_from_json(user);
+        m_store.SetUser(id, *cur);
+    }
+    m_store.EndTransaction();
+
+    for (const auto &[id, user] : pending)
+        m_keyed_signal_presence_update.emit(id, GetUserStatus(id));
 }
 
 void DiscordClient::HandleGatewayChannelDelete(const GatewayMessage &msg) {
@@ -1695,6 +2145,8 @@ void DiscordClient::HandleGatewayChannelDelete(const GatewayMessage &msg) {
     auto it = m_guild_to_channels.find(*channel->GuildID);
     if (it != m_guild_to_channels.end())
         it->second.erase(id);
+    m_channel_to_guild.erase(id);
+    UpdateUnreadAggregate(id);
     m_store.ClearChannel(id);
     m_signal_channel_delete.emit(id);
     m_signal_channel_accessibility_changed.emit(id, false);
@@ -1726,6 +2178,7 @@ void DiscordClient::HandleGatewayChannelCreate(const GatewayMessage &msg) {
     m_store.BeginTransaction();
     m_store.SetChannel(data.ID, data);
     m_guild_to_channels[*data.GuildID].insert(data.ID);
+    m_channel_to_guild[data.ID] = *data.GuildID;
     if (data.PermissionOverwrites.has_value())
         for (const auto &p : *data.PermissionOverwrites)
             m_store.SetPermissionOverwrite(data.ID, p.ID, p);
@@ -1740,12 +2193,13 @@ void DiscordClient::HandleGatewayGuildUpdate(const GatewayMessage &msg) {
     current->update_from_json(msg.Data);
     m_store.SetGuild(id, *current);
     m_signal_guild_update.emit(id);
+    m_keyed_signal_guild_update.emit(id);
 }
 
 void DiscordClient::HandleGatewayGuildRoleUpdate(const GatewayMessage &msg) {
     GuildRoleUpdateObject data = msg.Data;
 
-    const auto channels = GetChannelsInGuild(data.GuildID);
+    const auto &channels = GetChannelsInGuild(data.GuildID);
     std::unordered_set<Snowflake> accessible;
     for (auto channel : channels) {
         if (HasChannelPermission(m_user_data.ID, channel, Permission::VIEW_CHANNEL))
@@ -2018,6 +2472,7 @@ void DiscordClient::HandleGatewayThreadMemberListUpdate(const GatewayMessage &ms
 void DiscordClient::HandleGatewayMessageAck(const GatewayMessage &msg) {
     MessageAckData data = msg.Data;
     m_unread.erase(data.ChannelID);
+    UpdateUnreadAggregate(data.ChannelID);
     m_signal_message_ack.emit(data);
 }
 
@@ -2025,7 +2480,7 @@ void DiscordClient::HandleGatewayUserGuildSettingsUpdate(const GatewayMessage &m
     UserGuildSettingsUpdateData data = msg.Data;
     const bool for_dms = !data.Settings.GuildID.IsValid();
 
-    const auto channels = for_dms ? GetPrivateChannels() : GetChannelsInGuild(data.Settings.GuildID);
+    const auto &channels = for_dms ? GetPrivateChannels() : GetChannelsInGuild(data.Settings.GuildID);
     std::set<Snowflake> now_muted_channels;
     const auto now = Snowflake::FromNow();
 
@@ -2084,14 +2539,27 @@ void DiscordClient::HandleGatewayUserGuildSettingsUpdate(const GatewayMessage &m
             }
         }
     }
+
+    // also picks up children of categories whose mute changed since theyre in the same guild
+    for (const auto &channel_id : channels)
+        UpdateUnreadAggregate(channel_id);
 }
 
 void DiscordClient::HandleGatewayGuildMembersChunk(const GatewayMessage &msg) {
     GuildMembersChunkData data = msg.Data;
     m_store.BeginTransaction();
-    for (const auto &member : data.Members)
+    for (const auto &member : data.Members) {
+        if (!member.User.has_value()) continue;
+        m_store.SetUser(member.User->ID, *member.User);
         m_store.SetGuildMember(data.GuildID, member.User->ID, member);
+    }
     m_store.EndTransaction();
+
+    for (const auto &member : data.Members)
+        if (member.User.has_value())
+            AddUserToGuild(member.User->ID, data.GuildID);
+
+    m_signal_guild_members_chunk.emit(data);
 }
 
 void DiscordClient::HandleGatewayReadySupplemental(const GatewayMessage &msg) {
@@ -2108,12 +2576,12 @@ void DiscordClient::HandleGatewayReadySupplemental(const GatewayMessage &msg) {
             m_user_to_status[p.UserID] = PresenceStatus::Idle;
         else if (s == "dnd")
             m_user_to_status[p.UserID] = PresenceStatus::DND;
-        m_signal_presence_update.emit(*user, m_user_to_status.at(p.UserID));
+        QueuePresenceUpdate(p.UserID, nlohmann::json::object());
     }
 }
 
 void DiscordClient::HandleGatewayReconnect(const GatewayMessage &msg) {
-    printf("received reconnect\n");
+    LOG_INFO(Gateway, "received reconnect");
     inflateEnd(&m_zstream);
     m_compressed_buf.clear();
 
@@ -2129,11 +2597,11 @@ void DiscordClient::HandleGatewayReconnect(const GatewayMessage &msg) {
     std::memset(&m_zstream, 0, sizeof(m_zstream));
     inflateInit2(&m_zstream, MAX_WBITS + 32);
 
-    m_websocket.StartConnection(GetGatewayURL());
+    m_websocket.StartConnection(m_gateway_url);
 }
 
 void DiscordClient::HandleGatewayInvalidSession(const GatewayMessage &msg) {
-    printf("invalid session! re-identifying\n");
+    LOG_WARN(Gateway, "invalid session! re-identifying");
 
     inflateEnd(&m_zstream);
     m_compressed_buf.clear();
@@ -2145,13 +2613,17 @@ void DiscordClient::HandleGatewayInvalidSession(const GatewayMessage &msg) {
     m_wants_resume = false;
     m_reconnecting = true;
 
+    // the saved session wasnt accepted so whatever the journal rebuilt is stale, the new ready starts over
+    if (m_ready_deferred)
+        DropRestoredSession();
+
     m_heartbeat_waiter.kill();
     if (m_heartbeat_thread.joinable()) m_heartbeat_thread.join();
 
     m_websocket.Stop(1000);
 
     if (m_client_started)
-        Glib::signal_timeout().connect_once([this] { if (m_client_started) m_websocket.StartConnection(GetGatewayURL()); }, 1000);
+        m_dispatcher->PostDelayed([this] { if (m_client_started) m_websocket.StartConnection(m_gateway_url); }, 1000);
 }
 
 bool IsCompleteMessageObject(const nlohmann::json &j) {
@@ -2197,6 +2669,7 @@ void DiscordClient::HandleGatewayGuildMemberListUpdate(const GatewayMessage &msg
     m_store.BeginTransaction();
 
     bool has_sync = false;
+    std::vector<Snowflake> synced_presences;
     for (const auto &op : data.Ops) {
         if (op.Op == "SYNC") {
             has_sync = true;
@@ -2216,6 +2689,7 @@ void DiscordClient::HandleGatewayGuildMemberListUpdate(const GatewayMessage &msg
                             m_user_to_status[member->User.ID] = PresenceStatus::Idle;
                         else if (s == "dnd")
                             m_user_to_status[member->User.ID] = PresenceStatus::DND;
+                        synced_presences.push_back(member->User.ID);
                     }
                 }
             }
@@ -2224,12 +2698,16 @@ void DiscordClient::HandleGatewayGuildMemberListUpdate(const GatewayMessage &msg
                 const auto &m = dynamic_cast<const GuildMemberListUpdateMessage::MemberItem *>(op.OpItem.value().get())->GetAsMemberData();
                 m_store.SetGuildMember(data.GuildID, m.User->ID, m);
                 m_signal_guild_member_update.emit(data.GuildID, m.User->ID); // cheeky
+                m_keyed_signal_guild_member_update.emit(m.User->ID, data.GuildID);
             }
         }
     }
 
     m_store.EndTransaction();
 
+    for (const auto user_id : synced_presences)
+        m_keyed_signal_presence_update.emit(user_id, GetUserStatus(user_id));
+
     // todo: manage this event a little better
     if (has_sync)
         m_signal_guild_member_list_update.emit(data.GuildID);
@@ -2247,7 +2725,7 @@ void DiscordClient::HandleGatewayGuildDelete(const GatewayMessage &msg) {
     bool unavailable = msg.Data.contains("unavailable") && msg.Data.at("unavailable").get<bool>();
 
     if (unavailable)
-        printf("guild %" PRIu64 " became unavailable\n", static_cast<uint64_t>(id));
+        LOG_INFO(Gateway, "guild %" PRIu64 " became unavailable", static_cast<uint64_t>(id));
 
     const auto guild = m_store.GetGuild(id);
     if (!guild.has_value()) {
@@ -2268,13 +2746,12 @@ void DiscordClient::HandleGatewayGuildDelete(const GatewayMessage &msg) {
 }
 
 void DiscordClient::AddUserToGuild(Snowflake user_id, Snowflake guild_id) {
-    m_guild_to_users[guild_id].insert(user_id);
+    if (m_guild_to_users[guild_id].insert(user_id).second)
+        m_signal_guild_user_added.emit(guild_id, user_id);
 }
 
-std::set<Snowflake> DiscordClient::GetPrivateChannels() const {
-    if (const auto iter = m_guild_to_channels.find(Snowflake::Invalid); iter != m_guild_to_channels.end())
-        return iter->second;
-    return {};
+const SortedSnowflakeSet &DiscordClient::GetPrivateChannels() const {
+    return GetChannelsInGuild(Snowflake::Invalid);
 }
 
 EPremiumType DiscordClient::GetSelfPremiumType() const {
@@ -2287,7 +2764,7 @@ EPremiumType DiscordClient::GetSelfPremiumType() const {
 void DiscordClient::HeartbeatThread() {
     while (m_client_connected) {
         if (!m_heartbeat_acked) {
-            printf("wow! a heartbeat wasn't acked! how could this happen?");
+            LOG_WARN(Gateway, "wow! a heartbeat wasn't acked! how could this happen?");
         }
 
         m_heartbeat_acked = false;
@@ -2334,6 +2811,153 @@ void DiscordClient::SendIdentify() {
     m_websocket.SetPrintMessages(b);
 }
 
+bool DiscordClient::SaveSession() {
+    if (!m_client_connected || m_ready_deferred || m_session_id.empty() || m_resume_gateway_url.empty()) return false;
+
+    SessionCache::Session session;
+    session.SessionID = m_session_id;
+    session.Sequence = m_last_sequence;
+    session.ResumeURL = m_resume_gateway_url;
+    session.UserID = m_user_data.ID;
+    session.TokenHash = SessionCache::HashToken(m_token);
+    session.SavedAt = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if (!m_session_cache.Save(session)) return false;
+
+    LOG_INFO(Session, "saved session at sequence %d", session.Sequence);
+    return true;
+}
+
+bool DiscordClient::RestoreSession() {
+    auto session = m_session_cache.Take(m_token);
+    if (!session.has_value()) {
+        m_session_cache.Discard();
+        return false;
+    }
+
+    // the journal is read on its own thread and handled here a batch at a time so the window keeps drawing
+    // a stop or another start in the meantime makes anything still queued from this one go nowhere
+    m_session_restore_pending = true;
+    const auto generation = ++m_session_restore_generation;
+    const auto is_current = [this, generation] {
+        return m_session_restore_pending && m_session_restore_generation == generation;
+    };
+    m_session_cache.Replay(
+        [this, is_current](std::vector<std::string> messages) {
+            m_dispatcher->Post([this, is_current, messages = std::move(messages)]() mutable {
+                if (!is_current()) return;
+                m_replaying_session = true;
+                BlockSignals(true);
+                for (auto &message : messages)
+                    HandleGatewayMessage(std::move(message));
+                BlockSignals(false);
+                m_replaying_session = false;
+            });
+        },
+        [this, is_current, session = std::move(*session)](bool replayed) {
+            m_dispatcher->Post([this, is_current, session, replayed] {
+                if (!is_current()) return;
+                m_session_restore_pending = false;
+                ResumeSavedSession(session, replayed);
+            });
+        });
+    return true;
+}
+
+void DiscordClient::BlockSignals(bool blocked) {
+    // replayed events only need to land in the store, listeners start over from it when the deferred ready goes out
+    // without this they would act on old events (notifications, prefetching, requesting members, ...)
+    m_signal_gateway_ready.block(blocked);
+    m_signal_message_create.block(blocked);
+    m_signal_message_delete.block(blocked);
+    m_signal_message_update.block(blocked);
+    m_signal_guild_member_list_update.block(blocked);
+    m_signal_guild_create.block(blocked);
+    m_signal_guild_delete.block(blocked);
+    m_signal_channel_delete.block(blocked);
+    m_signal_channel_update.block(blocked);
+    m_signal_channel_create.block(blocked);
+    m_signal_guild_update.block(blocked);
+    m_signal_role_update.block(blocked);
+    m_signal_role_create.block(blocked);
+    m_signal_role_delete.block(blocked);
+    m_signal_reaction_add.block(blocked);
+    m_signal_reaction_remove.block(blocked);
+    m_signal_typing_start.block(blocked);
+    m_signal_guild_member_update.block(blocked);
+    m_signal_guild_ban_remove.block(blocked);
+    m_signal_guild_ban_add.block(blocked);
+    m_signal_invite_create.block(blocked);
+    m_signal_invite_delete.block(blocked);
+    m_signal_note_update.block(blocked);
+    m_signal_guild_emojis_update.block(blocked);
+    m_signal_guild_join_request_create.block(blocked);
+    m_signal_guild_join_request_update.block(blocked);
+    m_signal_guild_join_request_delete.block(blocked);
+    m_signal_relationship_remove.block(blocked);
+    m_signal_relationship_add.block(blocked);
+    m_signal_message_unpinned.block(blocked);
+    m_signal_message_pinned.block(blocked);
+    m_signal_thread_create.block(blocked);
+    m_signal_thread_delete.block(blocked);
+    m_signal_thread_list_sync.block(blocked);
+    m_signal_thread_members_update.block(blocked);
+    m_signal_thread_update.block(blocked);
+    m_signal_thread_member_list_update.block(blocked);
+    m_signal_message_ack.block(blocked);
+    m_signal_guild_members_chunk.block(blocked);
+    m_signal_removed_from_thread.block(blocked);
+    m_signal_added_to_thread.block(blocked);
+    m_signal_message_sent.block(blocked);
+    m_signal_channel_muted.block(blocked);
+    m_signal_channel_unmuted.block(blocked);
+    m_signal_guild_muted.block(blocked);
+    m_signal_guild_unmuted.block(blocked);
+    m_signal_channel_accessibility_changed.block(blocked);
+    m_signal_guild_user_added.block(blocked);
+    m_signal_channel_backfilled.block(blocked);
+    m_signal_message_send_fail.block(blocked);
+    m_signal_message_send_delayed.block(blocked);
+    m_signal_disconnected.block(blocked);
+    m_signal_connected.block(blocked);
+    m_signal_message_progress.block(blocked);
+    m_keyed_signal_presence_update.block(blocked);
+    m_keyed_signal_guild_member_update.block(blocked);
+    m_keyed_signal_guild_update.block(blocked);
+}
+
+void DiscordClient::ResumeSavedSession(const SessionCache::Session &session, bool replayed) {
+    if (!m_client_started) return;
+
+    if (!replayed || !m_ready_deferred || m_user_data.ID != session.UserID) {
+        LOG_INFO(Session, "couldnt restore saved session, identifying");
+        DropRestoredSession();
+        m_session_cache.Discard();
+        m_websocket.StartConnection(m_gateway_url);
+        return;
+    }
+
+    LOG_INFO(Session, "restored session, resuming at sequence %d", session.Sequence);
+    m_session_id = session.SessionID;
+    m_last_sequence = session.Sequence;
+    m_session_cache.ReopenJournal();
+
+    // resume_gateway_url is just the host, the query (version, encoding, compression) has to match what we asked for before
+    auto url = session.ResumeURL;
+    if (const auto query = m_gateway_url.find('?'); query != std::string::npos) {
+        if (url.back() != '/') url += '/';
+        url += m_gateway_url.substr(query);
+    }
+    m_wants_resume = true;
+    m_websocket.StartConnection(url);
+}
+
+void DiscordClient::DropRestoredSession() {
+    m_ready_deferred = false;
+    m_store.ClearAll();
+    m_guild_to_users.clear();
+    m_live_channels.clear();
+}
+
 void DiscordClient::SendResume() {
     ResumeMessage msg;
     msg.Sequence = m_last_sequence;
@@ -2376,15 +3000,17 @@ void DiscordClient::HandleSocketOpen() {
 }
 
 void DiscordClient::HandleSocketClose(uint16_t code) {
-    printf("got socket close code: %d\n", code);
+    LOG_INFO(Websocket, "got socket close code: %d", code);
     auto close_code = static_cast<GatewayCloseCode>(code);
     auto cb = [this, close_code]() {
         m_heartbeat_waiter.kill();
         if (m_heartbeat_thread.joinable()) m_heartbeat_thread.join();
         m_client_connected = false;
+        RememberBackfillChannels();
+        m_live_channels.clear(); // anything sent while disconnected would be a hole
 
         if (m_client_started && !m_reconnecting && close_code == GatewayCloseCode::Abnormal) {
-            Glib::signal_timeout().connect_once([this] { if (m_client_started) HandleGatewayReconnect(GatewayMessage()); }, 1000);
+            m_dispatcher->PostDelayed([this] { if (m_client_started) HandleGatewayReconnect(GatewayMessage()); }, 1000);
             m_reconnecting = true;
         }
 
@@ -2398,7 +3024,7 @@ void DiscordClient::HandleSocketClose(uint16_t code) {
 
 bool DiscordClient::CheckCode(const http::response_type &r) {
     if (r.status_code >= 300 || r.error) {
-        fprintf(stderr, "api request to %s failed with status code %d: %s\n", r.url.c_str(), r.status_code, r.error_string.c_str());
+        LOG_ERROR(HTTP, "api request to %s failed with status code %d: %s", r.url.c_str(), r.status_code, r.error_string.c_str());
         return false;
     }
 
@@ -2408,7 +3034,7 @@ bool DiscordClient::CheckCode(const http::response_type &r) {
 bool DiscordClient::CheckCode(const http::response_type &r, int expected) {
     if (!CheckCode(r)) return false;
     if (r.status_code != expected) {
-        fprintf(stderr, "api request to %s returned %d, expected %d\n", r.url.c_str(), r.status_code, expected);
+        LOG_ERROR(HTTP, "api request to %s returned %d, expected %d", r.url.c_str(), r.status_code, expected);
         return false;
     }
     return true;
@@ -2451,6 +3077,40 @@ void DiscordClient::StoreMessageData(Message &msg) {
             StoreMessageData(**msg.ReferencedMessage);
 }
 
+void DiscordClient::UpdateUnreadAggregate(Snowflake channel_id) {
+    // take back whatever this channel added before
+    if (const auto it = m_unread_contributions.find(channel_id); it != m_unread_contributions.end()) {
+        auto &aggregate = m_unread_aggregates[it->second.GuildID];
+        aggregate.Mentions -= it->second.Mentions;
+        if (it->second.Counted) aggregate.UnreadChannels--;
+        m_unread_contributions.erase(it);
+    }
+
+    // threads arent in m_guild_to_channels so they never counted
+    const auto guild_it = m_channel_to_guild.find(channel_id);
+    if (guild_it == m_channel_to_guild.end()) return;
+    const auto unread_it = m_unread.find(channel_id);
+    if (unread_it == m_unread.end()) return;
+
+    UnreadContribution contribution;
+    contribution.GuildID = guild_it->second;
+    contribution.Mentions = unread_it->second;
+    // channels under muted categories wont contribute to unread state
+    contribution.Counted = !IsChannelMuted(channel_id) && m_channel_muted_parent.find(channel_id) == m_channel_muted_parent.end();
+
+    auto &aggregate = m_unread_aggregates[contribution.GuildID];
+    aggregate.Mentions += contribution.Mentions;
+    if (contribution.Counted) aggregate.UnreadChannels++;
+    m_unread_contributions[channel_id] = contribution;
+}
+
+void DiscordClient::RebuildUnreadAggregates() {
+    m_unread_aggregates.clear();
+    m_unread_contributions.clear();
+    for (const auto &[channel_id, mentions] : m_unread)
+        UpdateUnreadAggregate(channel_id);
+}
+
 // some notes for myself
 // a read channel is determined by checking if the channel object's last message id is equal to the read state's last message id
 // channels without entries are also unread
@@ -2544,6 +3204,7 @@ void DiscordClient::HandleReadyGuildSettings(const ReadyEventData &data) {
 
 void DiscordClient::LoadEventMap() {
     m_event_map["READY"] = GatewayEvent::READY;
+    m_event_map["RESUMED"] = GatewayEvent::RESUMED;
     m_event_map["MESSAGE_CREATE"] = GatewayEvent::MESSAGE_CREATE;
     m_event_map["MESSAGE_DELETE"] = GatewayEvent::MESSAGE_DELETE;
     m_event_map["MESSAGE_UPDATE"] = GatewayEvent::MESSAGE_UPDATE;
@@ -2645,6 +3306,18 @@ DiscordClient::type_signal_message_progress DiscordClient::signal_message_progre
     return m_signal_message_progress;
 }
 
+DiscordClient::type_keyed_signal_presence_update &DiscordClient::signal_presence_update_by_user() {
+    return m_keyed_signal_presence_update;
+}
+
+DiscordClient::type_keyed_signal_guild_member_update &DiscordClient::signal_guild_member_update_by_user() {
+    return m_keyed_signal_guild_member_update;
+}
+
+DiscordClient::type_keyed_signal_guild_update &DiscordClient::signal_guild_update_by_guild() {
+    return m_keyed_signal_guild_update;
+}
+
 DiscordClient::type_signal_role_update DiscordClient::signal_role_update() {
     return m_signal_role_update;
 }
@@ -2689,10 +3362,6 @@ DiscordClient::type_signal_invite_delete DiscordClient::signal_invite_delete() {
     return m_signal_invite_delete;
 }
 
-DiscordClient::type_signal_presence_update DiscordClient::signal_presence_update() {
-    return m_signal_presence_update;
-}
-
 DiscordClient::type_signal_note_update DiscordClient::signal_note_update() {
     return m_signal_note_update;
 }
@@ -2793,6 +3462,18 @@ DiscordClient::type_signal_channel_accessibility_changed DiscordClient::signal_c
     return m_signal_channel_accessibility_changed;
 }
 
+DiscordClient::type_signal_guild_user_added DiscordClient::signal_guild_user_added() {
+    return m_signal_guild_user_added;
+}
+
+DiscordClient::type_signal_channel_backfilled DiscordClient::signal_channel_backfilled() {
+    return m_signal_channel_backfilled;
+}
+
 DiscordClient::type_signal_message_send_fail DiscordClient::signal_message_send_fail() {
     return m_signal_message_send_fail;
 }
+
+DiscordClient::type_signal_message_send_delayed DiscordClient::signal_message_send_delayed() {
+    return m_signal_message_send_delayed;
+}
@@ -1,18 +1,23 @@
 #pragma once
 #include "websocket.hpp"
 #include "httpclient.hpp"
+#include "dispatcher.hpp"
 #include "objects.hpp"
 #include "store.hpp"
+#include "flatmap.hpp"
+#include "keyedsignal.hpp"
 #include "chatsubmitparams.hpp"
+#include "sessioncache.hpp"
 #include <sigc++/sigc++.h>
 #include <nlohmann/json.hpp>
+#include <chrono>
 #include <thread>
+#include <deque>
 #include <map>
 #include <set>
 #include <mutex>
 #include <zlib.h>
 #include <glibmm.h>
-#include <queue>
 
 #ifdef GetMessage
     #undef GetMessage
@@ -48,23 +53,42 @@ class DiscordClient {
     friend class Abaddon;
 
 public:
-    DiscordClient(bool mem_store = false);
+    // dispatcher defaults to a GlibDispatcher when null
+    // outbox_path is where unsent messages are kept across restarts, empty keeps them with everything else
+    DiscordClient(bool mem_store = false, std::shared_ptr<Dispatcher> dispatcher = nullptr, const std::string &outbox_path = "");
+
+    // the instance data objects look things up through (channel recipients, member roles, etc)
+    static DiscordClient &Get();
+
+    void SetAPIURL(std::string url);
+    void SetGatewayURL(std::string url);
+    // where the session is kept to be resumed after a restart, empty to always identify
+    void SetSessionCacheDirectory(std::string path);
+
     void Start();
-    bool Stop();
+    // keep_session leaves the session open on discords end and saves it so the next Start can resume it
+    bool Stop(bool keep_session = false);
     bool IsStarted() const;
     bool IsStoreValid() const;
 
+    // runs data through the same path as the gateway socket without connecting, for benchmarks and recorded traffic
+    // messages are handled on the dispatcher. new_stream starts over with a fresh zlib stream like a new connection does
+    void FeedGatewayData(std::string data, bool new_stream = false);
+
     std::unordered_set<Snowflake> GetGuilds() const;
     const UserData &GetUserData() const;
     std::vector<Snowflake> GetUserSortedGuilds() const;
     std::vector<Message> GetMessagesForChannel(Snowflake id, size_t limit = 50) const;
     std::vector<Message> GetMessagesBefore(Snowflake channel_id, Snowflake message_id, size_t limit = 50) const;
-    std::set<Snowflake> GetPrivateChannels() const;
+    const SortedSnowflakeSet &GetPrivateChannels() const;
 
     EPremiumType GetSelfPremiumType() const;
 
-    void FetchMessagesInChannel(Snowflake id, const sigc::slot<void(const std::vector<Message> &)> &cb);
-    void FetchMessagesInChannelBefore(Snowflake channel_id, Snowflake before_id, const sigc::slot<void(const std::vector<Message> &)> &cb);
+    void FetchMessagesInChannel(Snowflake id, const sigc::slot<void(const std::vector<Message> &)> &cb, const sigc::slot<void(const http::response_type &)> &err_cb = {});
+    void FetchMessagesInChannelBefore(Snowflake channel_id, Snowflake before_id, const sigc::slot<void(const std::vector<Message> &)> &cb, size_t limit = 50);
+    void FetchMessagesInChannelAround(Snowflake channel_id, Snowflake around_id, const sigc::slot<void(const std::vector<Message> &)> &cb); // for jumping to a message
+    // up to 50 messages before before_id, ascending. only goes to the api for what the store doesnt have
+    void LoadMessagesBefore(Snowflake channel_id, Snowflake before_id, const sigc::slot<void(const std::vector<Message> &)> &cb);
     std::optional<Message> GetMessage(Snowflake id) const;
     std::optional<ChannelData> GetChannel(Snowflake id) const;
     std::optional<EmojiData> GetEmoji(Snowflake id) const;
@@ -73,10 +97,21 @@ public:
     std::optional<RoleData> GetRole(Snowflake id) const;
     std::optional<GuildData> GetGuild(Snowflake id) const;
     std::optional<GuildMember> GetMember(Snowflake user_id, Snowflake guild_id) const;
+
+    // shared and immutable, nothing is copied. null if not found
+    // use these for anything that runs often like renderers, dont hold on to them for long since they go stale
+    std::shared_ptr<const Message> GetMessageSnapshot(Snowflake id) const;
+    std::shared_ptr<const ChannelData> GetChannelSnapshot(Snowflake id) const;
+    std::shared_ptr<const UserData> GetUserSnapshot(Snowflake id) const;
+    std::shared_ptr<const RoleData> GetRoleSnapshot(Snowflake id) const;
+    std::shared_ptr<const GuildData> GetGuildSnapshot(Snowflake id) const;
+    std::shared_ptr<const GuildMember> GetMemberSnapshot(Snowflake user_id, Snowflake guild_id) const;
+
     Snowflake GetMemberHoistedRole(Snowflake guild_id, Snowflake user_id, bool with_color = false) const;
     std::optional<RoleData> GetMemberHighestRole(Snowflake guild_id, Snowflake user_id) const;
-    std::set<Snowflake> GetUsersInGuild(Snowflake id) const;
-    std::set<Snowflake> GetChannelsInGuild(Snowflake id) const;
+    int GetMemberHighestRolePosition(Snowflake guild_id, Snowflake user_id) const; // -1 if no roles
+    const SnowflakeSet &GetUsersInGuild(Snowflake id) const;
+    const SortedSnowflakeSet &GetChannelsInGuild(Snowflake id) const;
     std::vector<Snowflake> GetUsersInThread(Snowflake id) const;
     std::vector<ChannelData> GetActiveThreads(Snowflake channel_id) const;
     void GetArchivedPublicThreads(Snowflake channel_id, const sigc::slot<void(DiscordError, const ArchivedThreadsResponseData &)> &callback);
@@ -104,10 +139,7 @@ public:
     Permission ComputeOverwrites(Permission base, Snowflake member_id, Snowflake channel_id) const;
     bool CanManageMember(Snowflake guild_id, Snowflake actor, Snowflake target) const; // kick, ban, edit nickname (cant think of a better name)
 
-    void ChatMessageCallback(const std::string &nonce, const http::response_type &response, const sigc::slot<void(DiscordError code)> &callback);
-    void SendChatMessageNoAttachments(const ChatSubmitParams &params, const sigc::slot<void(DiscordError code)> &callback);
-    void SendChatMessageAttachments(const ChatSubmitParams &params, const sigc::slot<void(DiscordError code)> &callback);
-
+    // queued in the outbox, callback runs once its been delivered or given up on
     void SendChatMessage(const ChatSubmitParams &params, const sigc::slot<void(DiscordError code)> &callback);
     void DeleteMessage(Snowflake channel_id, Snowflake id);
     void EditMessage(Snowflake channel_id, Snowflake id, std::string content);
@@ -131,7 +163,6 @@ public:
     void ModifyRolePermissions(Snowflake guild_id, Snowflake role_id, Permission permissions, const sigc::slot<void(DiscordError code)> &callback);
     void ModifyRoleName(Snowflake guild_id, Snowflake role_id, const Glib::ustring &name, const sigc::slot<void(DiscordError code)> &callback);
     void ModifyRoleColor(Snowflake guild_id, Snowflake role_id, uint32_t color, const sigc::slot<void(DiscordError code)> &callback);
-    void ModifyRoleColor(Snowflake guild_id, Snowflake role_id, const Gdk::RGBA &color, const sigc::slot<void(DiscordError code)> &callback);
     void ModifyRolePosition(Snowflake guild_id, Snowflake role_id, int position, const sigc::slot<void(DiscordError code)> &callback);
     void ModifyEmojiName(Snowflake guild_id, Snowflake emoji_id, const Glib::ustring &name, const sigc::slot<void(DiscordError code)> &callback);
     void DeleteEmoji(Snowflake guild_id, Snowflake emoji_id, const sigc::slot<void(DiscordError code)> &callback);
@@ -167,6 +198,9 @@ public:
         m_websocket.Send(obj);
     }
 
+    // search members by username/nickname prefix, results come back through signal_guild_members_chunk with the nonce
+    void RequestMembers(Snowflake guild_id, const std::string &query, int limit, const std::string &nonce);
+
     // real client doesn't seem to use the single role endpoints so neither do we
     template<typename Iter>
     auto SetMemberRoles(Snowflake guild_id, Snowflake user_id, Iter begin, Iter end, const sigc::slot<void(DiscordError code)> &callback) {
@@ -204,6 +238,8 @@ public:
     void AcceptVerificationGate(Snowflake guild_id, VerificationGateInfoObject info, const sigc::slot<void(DiscordError code)> &callback);
 
     void SetReferringChannel(Snowflake id);
+    // the most recently viewed channels get what they missed fetched after a reconnect
+    void MarkChannelViewed(Snowflake id);
 
     void SetBuildNumber(uint32_t build_number);
     void SetCookie(std::string_view cookie);
@@ -214,6 +250,7 @@ public:
     bool IsChannelMuted(Snowflake id) const noexcept;
     bool IsGuildMuted(Snowflake id) const noexcept;
     int GetUnreadStateForChannel(Snowflake id) const noexcept;
+    std::vector<Snowflake> GetChannelsWithMentions() const;
     bool GetUnreadStateForGuild(Snowflake id, int &total_mentions) const noexcept;
     int GetUnreadDMsCount() const;
 
@@ -227,10 +264,10 @@ private:
     static const constexpr int InflateChunkSize = 0x10000;
     std::vector<uint8_t> m_compressed_buf;
     std::vector<uint8_t> m_decompress_buf;
-    z_stream m_zstream;
+    z_stream m_zstream {};
 
-    static std::string GetAPIURL();
-    static std::string GetGatewayURL();
+    std::string m_api_url = "https://discord.com/api/v9";
+    std::string m_gateway_url = "wss://gateway.discord.gg/?v=9&encoding=json&compress=zlib-stream";
 
     static DiscordError GetCodeFromResponse(const http::response_type &response);
 
@@ -283,6 +320,7 @@ private:
     void HandleGatewayUserGuildSettingsUpdate(const GatewayMessage &msg);
     void HandleGatewayGuildMembersChunk(const GatewayMessage &msg);
     void HandleGatewayReadySupplemental(const GatewayMessage &msg);
+    void HandleGatewayResumed(const GatewayMessage &msg);
     void HandleGatewayReconnect(const GatewayMessage &msg);
     void HandleGatewayInvalidSession(const GatewayMessage &msg);
     void HeartbeatThread();
@@ -308,22 +346,47 @@ private:
     uint32_t m_build_number = 142000;
 
     void AddUserToGuild(Snowflake user_id, Snowflake guild_id);
-    std::map<Snowflake, std::set<Snowflake>> m_guild_to_users;
-    std::map<Snowflake, std::set<Snowflake>> m_guild_to_channels;
+    SnowflakeMap<SnowflakeSet> m_guild_to_users;
+    SnowflakeMap<SortedSnowflakeSet> m_guild_to_channels;
     std::map<Snowflake, GuildApplicationData> m_guild_join_requests;
-    std::map<Snowflake, PresenceStatus> m_user_to_status;
+    SnowflakeMap<PresenceStatus> m_user_to_status;
     std::map<Snowflake, RelationshipType> m_user_relationships;
-    std::set<Snowflake> m_joined_threads;
-    std::map<Snowflake, std::vector<Snowflake>> m_thread_members;
+    SnowflakeSet m_joined_threads;
+    SnowflakeMap<std::vector<Snowflake>> m_thread_members;
     std::map<Snowflake, Snowflake> m_last_message_id;
-    std::unordered_set<Snowflake> m_muted_guilds;
-    std::unordered_set<Snowflake> m_muted_channels;
-    std::unordered_map<Snowflake, int> m_unread;
-    std::unordered_set<Snowflake> m_channel_muted_parent;
+    SnowflakeSet m_muted_guilds;
+    SnowflakeSet m_muted_channels;
+    SnowflakeMap<int> m_unread;
+    SnowflakeSet m_channel_muted_parent;
+    SnowflakeSet m_live_channels; // newest message range reaches the present so gateway messages extend it
+
+    // unread state summed per guild (dms under invalid) so rendering doesnt have to walk every channel
+    // kept up to date by recomputing a single channel's contribution whenever anything it depends on changes
+    struct UnreadAggregate {
+        int UnreadChannels = 0; // not muted and not under a muted category
+        int Mentions = 0;
+    };
+    struct UnreadContribution {
+        Snowflake GuildID;
+        int Mentions;
+        bool Counted;
+    };
+    void UpdateUnreadAggregate(Snowflake channel_id);
+    void RebuildUnreadAggregates();
+    std::unordered_map<Snowflake, Snowflake> m_channel_to_guild; // mirror of m_guild_to_channels
+    std::unordered_map<Snowflake, UnreadAggregate> m_unread_aggregates;
+    std::unordered_map<Snowflake, UnreadContribution> m_unread_contributions;
+
+    // latest user object per user since the last flush, merged
+    void QueuePresenceUpdate(Snowflake user_id, const nlohmann::json &user);
+    void FlushPresenceUpdates();
+    std::unordered_map<Snowflake, nlohmann::json> m_pending_presences;
+    bool m_presence_flush_queued = false;
 
     UserData m_user_data;
     UserSettings m_user_settings;
 
+    std::shared_ptr<Dispatcher> m_dispatcher;
     Store m_store;
     HTTPClient m_http;
     Websocket m_websocket;
@@ -343,17 +406,80 @@ private:
     bool m_reconnecting = false; // reconnecting either to resume or reidentify
     bool m_wants_resume = false; // reconnecting specifically to resume
     std::string m_session_id;
-
-    mutable std::mutex m_msg_mutex;
-    Glib::Dispatcher m_msg_dispatch;
-    std::queue<std::string> m_msg_queue;
-    void MessageDispatch();
-
-    mutable std::mutex m_generic_mutex;
-    Glib::Dispatcher m_generic_dispatch;
-    std::queue<std::function<void()>> m_generic_queue;
-
-    Glib::Timer m_progress_cb_timer;
+    std::string m_resume_gateway_url;
+
+    // the state is rebuilt by replaying the journal through the normal handlers, then the saved session is resumed
+    // ready isnt emitted until discord says the session was resumed, if it doesnt the rebuilt state is thrown away
+    bool SaveSession();
+    bool RestoreSession();
+    void ResumeSavedSession(const SessionCache::Session &session, bool replayed); // once the journal has been handled
+    void DropRestoredSession();
+    void BlockSignals(bool blocked); // while the journal is replayed
+    SessionCache m_session_cache;
+    bool m_session_restore_pending = false; // journal still being replayed
+    uint64_t m_session_restore_generation = 0;
+    bool m_replaying_session = false;
+    bool m_ready_deferred = false;
+
+    // latest progress of one upload, written by the transfer thread
+    // only one main loop update is queued at a time and it reads whatever is newest when it runs
+    struct UploadProgress {
+        std::atomic<curl_off_t> Total = 0;
+        std::atomic<curl_off_t> Now = 0;
+        std::atomic<bool> Queued = false;
+        std::chrono::steady_clock::time_point LastQueued; // transfer thread only
+    };
+    constexpr static int UploadProgressIntervalMilliseconds = 42;
+
+    // messages we sent that discord hasnt confirmed, mirrored in the store so they survive disconnects
+    // each channel sends one at a time in order, rate limits, server errors, and dropped connections are retried
+    struct OutboxItem {
+        Store::OutboxEntry Entry;
+        std::vector<ChatSubmitParams::Attachment> Attachments;
+        sigc::slot<void(DiscordError code)> Callback;
+        int Attempts = 0;
+        bool InFlight = false;
+        bool RetryQueued = false;
+    };
+    constexpr static int MaxOutboxAttempts = 5;
+    constexpr static unsigned OutboxBackoffMilliseconds = 1000;     // doubled every attempt
+    constexpr static unsigned MaxOutboxBackoffMilliseconds = 16000; // rate limits wait as long as theyre told instead
+    Message StorePendingMessage(const Store::OutboxEntry &entry);
+    void LoadOutbox();
+    void PumpOutbox();
+    void PumpOutbox(Snowflake channel_id);
+    void OnOutboxResponse(const std::string &nonce, const http::response_type &response);
+    void FinishOutboxItem(const std::string &nonce, DiscordError code);
+    std::unordered_map<std::string, OutboxItem> m_outbox; // by nonce, which is what the gateway echoes back
+    SnowflakeMap<std::deque<std::string>> m_outbox_queues; // nonces per channel, oldest first
+    bool m_outbox_ready = false;                           // ready received for the account the outbox belongs to
+
+    // recently viewed channels that were live when the connection dropped are caught up once its back
+    // only the hole after the newest stored message is asked for, and if that doesnt reach the present the newest page is
+    // so the rest of the hole is left for scrolling back. one request at a time, spaced out, and paused on 429s
+    struct BackfillJob {
+        Snowflake ChannelID;
+        Snowflake After;           // newest stored message before the gap
+        bool AfterFetched = false; // first page came back full, the newest page is next
+        int Attempts = 0;
+    };
+    constexpr static size_t MaxBackfillChannels = 5;
+    constexpr static size_t BackfillPageSize = 100;
+    constexpr static unsigned BackfillIntervalMilliseconds = 250;
+    constexpr static unsigned BackfillBackoffMilliseconds = 5000; // if a 429 doesnt say how long to wait
+    constexpr static int MaxBackfillAttempts = 3;
+    void RememberBackfillChannels();
+    void StartBackfill();
+    void PumpBackfill();
+    void ScheduleBackfillPump(unsigned delay);
+    void OnBackfillResponse(BackfillJob job, const http::response_type &r);
+    void ClearBackfill();
+    std::deque<Snowflake> m_recent_channels; // most recent first
+    std::vector<Snowflake> m_backfill_channels; // were live when the connection dropped, most recent first
+    std::deque<BackfillJob> m_backfill_queue;
+    Snowflake m_backfill_in_flight; // channel with a request out
+    bool m_backfill_pump_queued = false;
+    uint64_t m_backfill_generation = 0; // bumped on clear so late responses are dropped
 
     std::set<Snowflake> m_channels_pinned_requested;
     std::set<Snowflake> m_channels_lazy_loaded;
@@ -382,7 +508,6 @@ public:
     typedef sigc::signal<void, Snowflake, Snowflake> type_signal_guild_ban_add;       // guild id, user id
     typedef sigc::signal<void, InviteData> type_signal_invite_create;
     typedef sigc::signal<void, InviteDeleteObject> type_signal_invite_delete;
-    typedef sigc::signal<void, UserData, PresenceStatus> type_signal_presence_update;
     typedef sigc::signal<void, Snowflake, std::string> type_signal_note_update;
     typedef sigc::signal<void, Snowflake, std::vector<EmojiData>> type_signal_guild_emojis_update; // guild id
     typedef sigc::signal<void, GuildJoinRequestCreateData> type_signal_guild_join_request_create;
@@ -410,8 +535,11 @@ public:
     typedef sigc::signal<void, Snowflake> type_signal_guild_muted;
     typedef sigc::signal<void, Snowflake> type_signal_guild_unmuted;
     typedef sigc::signal<void, Snowflake, bool> type_signal_channel_accessibility_changed;
+    typedef sigc::signal<void, Snowflake, Snowflake> type_signal_guild_user_added; // guild id, user id. first time a user is seen in a guild
+    typedef sigc::signal<void, Snowflake> type_signal_channel_backfilled;            // caught up after a reconnect, the newest messages are in the store
 
     typedef sigc::signal<void, std::string /* nonce */, float /* retry_after */> type_signal_message_send_fail; // retry after param will be 0 if it failed for a reason that isnt slowmode
+    typedef sigc::signal<void, std::string /* nonce */, float /* retry_after */> type_signal_message_send_delayed; // rate limited, itll be sent again after retry_after
     typedef sigc::signal<void, bool, GatewayCloseCode> type_signal_disconnected;                                // bool true if reconnecting
     typedef sigc::signal<void> type_signal_connected;
     typedef sigc::signal<void, std::string, float> type_signal_message_progress;
@@ -438,7 +566,6 @@ public:
     type_signal_guild_ban_add signal_guild_ban_add();
     type_signal_invite_create signal_invite_create();
     type_signal_invite_delete signal_invite_delete(); // safe to assume guild id is set
-    type_signal_presence_update signal_presence_update();
     type_signal_note_update signal_note_update();
     type_signal_guild_emojis_update signal_guild_emojis_update();
     type_signal_guild_join_request_create signal_guild_join_request_create();
@@ -465,11 +592,24 @@ public:
     type_signal_guild_muted signal_guild_muted();
     type_signal_guild_unmuted signal_guild_unmuted();
     type_signal_channel_accessibility_changed signal_channel_accessibility_changed();
+    type_signal_guild_user_added signal_guild_user_added();
+    type_signal_channel_backfilled signal_channel_backfilled();
     type_signal_message_send_fail signal_message_send_fail();
+    type_signal_message_send_delayed signal_message_send_delayed();
     type_signal_disconnected signal_disconnected();
     type_signal_connected signal_connected();
     type_signal_message_progress signal_message_progress();
 
+    // the same events keyed by what they are about, only subscribers to that id get called
+    // use these from widgets that show one user/guild and can exist many times over
+    typedef KeyedSignal<PresenceStatus> type_keyed_signal_presence_update;  // user id
+    typedef KeyedSignal<Snowflake> type_keyed_signal_guild_member_update;   // user id -> guild id
+    typedef KeyedSignal<> type_keyed_signal_guild_update;                   // guild id
+
+    type_keyed_signal_presence_update &signal_presence_update_by_user();
+    type_keyed_signal_guild_member_update &signal_guild_member_update_by_user();
+    type_keyed_signal_guild_update &signal_guild_update_by_guild();
+
 protected:
     type_signal_gateway_ready m_signal_gateway_ready;
     type_signal_message_create m_signal_message_create;
@@ -493,7 +633,6 @@ protected:
     type_signal_guild_ban_add m_signal_guild_ban_add;
     type_signal_invite_create m_signal_invite_create;
     type_signal_invite_delete m_signal_invite_delete;
-    type_signal_presence_update m_signal_presence_update;
     type_signal_note_update m_signal_note_update;
     type_signal_guild_emojis_update m_signal_guild_emojis_update;
     type_signal_guild_join_request_create m_signal_guild_join_request_create;
@@ -520,8 +659,15 @@ protected:
     type_signal_guild_muted m_signal_guild_muted;
     type_signal_guild_unmuted m_signal_guild_unmuted;
     type_signal_channel_accessibility_changed m_signal_channel_accessibility_changed;
+    type_signal_guild_user_added m_signal_guild_user_added;
+    type_signal_channel_backfilled m_signal_channel_backfilled;
     type_signal_message_send_fail m_signal_message_send_fail;
+    type_signal_message_send_delayed m_signal_message_send_delayed;
     type_signal_disconnected m_signal_disconnected;
     type_signal_connected m_signal_connected;
     type_signal_message_progress m_signal_message_progress;
+
+    type_keyed_signal_presence_update m_keyed_signal_presence_update;
+    type_keyed_signal_guild_member_update m_keyed_signal_guild_member_update;
+    type_keyed_signal_guild_update m_keyed_signal_guild_update;
 };
@@ -0,0 +1,60 @@
+#include "dispatcher.hpp"
+#include "loopprofiler.hpp"
+
+GlibDispatcher::GlibDispatcher() {
+    m_dispatcher.connect(sigc::mem_fun(*this, &GlibDispatcher::OnDispatch));
+}
+
+void GlibDispatcher::Post(std::function<void()> func) {
+    m_mutex.lock();
+    m_queue.push(std::move(func));
+    m_dispatcher.emit();
+    m_mutex.unlock();
+}
+
+void GlibDispatcher::PostDelayed(std::function<void()> func, unsigned int msec) {
+    Glib::signal_timeout().connect_once(std::move(func), msec);
+}
+
+void GlibDispatcher::OnDispatch() {
+    // one emit per post
+    m_mutex.lock();
+    auto func = std::move(m_queue.front());
+    m_queue.pop();
+    m_mutex.unlock();
+    LoopProfiler::Scope scope("dispatch");
+    func();
+}
+
+void ManualDispatcher::Post(std::function<void()> func) {
+    std::lock_guard<std::mutex> l(m_mutex);
+    m_queue.push_back(std::move(func));
+}
+
+void ManualDispatcher::PostDelayed(std::function<void()> func, unsigned int msec) {
+    std::lock_guard<std::mutex> l(m_mutex);
+    m_delayed.emplace_back(clock::now() + std::chrono::milliseconds(msec), std::move(func));
+}
+
+size_t ManualDispatcher::RunPending() {
+    std::vector<std::function<void()>> run;
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+        std::swap(run, m_queue);
+        const auto now = clock::now();
+        for (auto it = m_delayed.begin(); it != m_delayed.end();) {
+            if (it->first <= now) {
+                run.push_back(std::move(it->second));
+                it = m_delayed.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+
+    // callbacks can post more, those wait for the next call
+    for (auto &func : run)
+        func();
+
+    return run.size();
+}
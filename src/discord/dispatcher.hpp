@@ -0,0 +1,51 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <vector>
+#include <glibmm.h>
+
+// how the networking and storage stack gets back onto the thread that owns it
+// Post can be called from any thread, PostDelayed only from the owning thread
+class Dispatcher {
+public:
+    virtual ~Dispatcher() = default;
+
+    virtual void Post(std::function<void()> func) = 0;
+    virtual void PostDelayed(std::function<void()> func, unsigned int msec) = 0;
+};
+
+// runs callbacks on the default glib main context (gui and cli)
+// must be constructed on the main thread
+class GlibDispatcher : public Dispatcher {
+public:
+    GlibDispatcher();
+
+    void Post(std::function<void()> func) override;
+    void PostDelayed(std::function<void()> func, unsigned int msec) override;
+
+private:
+    void OnDispatch();
+
+    std::mutex m_mutex;
+    Glib::Dispatcher m_dispatcher;
+    std::queue<std::function<void()>> m_queue;
+};
+
+// nothing runs until RunPending is called so a benchmark or soak test can drive the client from its own loop
+class ManualDispatcher : public Dispatcher {
+public:
+    void Post(std::function<void()> func) override;
+    void PostDelayed(std::function<void()> func, unsigned int msec) override;
+
+    // runs everything posted so far and any delayed callbacks that are due, returns how many ran
+    size_t RunPending();
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    std::mutex m_mutex;
+    std::vector<std::function<void()>> m_queue;
+    std::vector<std::pair<clock::time_point, std::function<void()>>> m_delayed;
+};
@@ -0,0 +1,385 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "snowflake.hpp"
+
+// containers for the id -> thing tables the client keeps in memory
+// std::map/std::set cost a heap node per entry plus pointer chasing on every lookup
+// these keep everything in one array so big guilds stay cheap to hold and to query
+
+namespace flat_detail {
+// cant be ~0 since thats Snowflake::Invalid which dms are filed under, this one would be a message sent a few million years from now
+constexpr static uint64_t EmptyKey = ~1ULL;
+
+// snowflakes have the timestamp in the high bits and mostly zeroes in the low ones so they need mixing (splitmix64)
+inline uint64_t Mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+inline Snowflake &KeyOf(Snowflake &slot) {
+    return slot;
+}
+
+inline const Snowflake &KeyOf(const Snowflake &slot) {
+    return slot;
+}
+
+template<typename V>
+Snowflake &KeyOf(std::pair<Snowflake, V> &slot) {
+    return slot.first;
+}
+
+template<typename V>
+const Snowflake &KeyOf(const std::pair<Snowflake, V> &slot) {
+    return slot.first;
+}
+
+// open addressing with linear probing, erase shifts the following entries back instead of leaving tombstones
+// like std::unordered_map inserting can invalidate iterators, unlike it erasing invalidates all of them too
+template<typename Slot>
+class FlatTable {
+    template<typename T>
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::remove_const_t<T>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = T *;
+        using reference = T &;
+
+        Iterator() = default;
+        Iterator(T *cur, T *end)
+            : m_cur(cur)
+            , m_end(end) {
+            Skip();
+        }
+
+        // iterator -> const_iterator
+        template<typename U, typename = std::enable_if_t<std::is_same_v<const U, T>>>
+        Iterator(const Iterator<U> &other)
+            : m_cur(other.m_cur)
+            , m_end(other.m_end) {}
+
+        reference operator*() const {
+            return *m_cur;
+        }
+
+        pointer operator->() const {
+            return m_cur;
+        }
+
+        Iterator &operator++() {
+            m_cur++;
+            Skip();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            auto tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return m_cur == other.m_cur;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return m_cur != other.m_cur;
+        }
+
+    private:
+        template<typename>
+        friend class Iterator;
+
+        void Skip() {
+            while (m_cur != m_end && static_cast<uint64_t>(KeyOf(*m_cur)) == EmptyKey)
+                m_cur++;
+        }
+
+        T *m_cur = nullptr;
+        T *m_end = nullptr;
+    };
+
+public:
+    using iterator = Iterator<Slot>;
+    using const_iterator = Iterator<const Slot>;
+
+    iterator begin() {
+        return { m_slots.data(), m_slots.data() + m_slots.size() };
+    }
+
+    iterator end() {
+        return { m_slots.data() + m_slots.size(), m_slots.data() + m_slots.size() };
+    }
+
+    const_iterator begin() const {
+        return { m_slots.data(), m_slots.data() + m_slots.size() };
+    }
+
+    const_iterator end() const {
+        return { m_slots.data() + m_slots.size(), m_slots.data() + m_slots.size() };
+    }
+
+    iterator find(Snowflake key) {
+        const auto idx = FindSlot(key);
+        if (idx == npos) return end();
+        return { m_slots.data() + idx, m_slots.data() + m_slots.size() };
+    }
+
+    const_iterator find(Snowflake key) const {
+        const auto idx = FindSlot(key);
+        if (idx == npos) return end();
+        return { m_slots.data() + idx, m_slots.data() + m_slots.size() };
+    }
+
+    [[nodiscard]] size_t count(Snowflake key) const {
+        return FindSlot(key) == npos ? 0 : 1;
+    }
+
+    [[nodiscard]] bool contains(Snowflake key) const {
+        return FindSlot(key) != npos;
+    }
+
+    size_t erase(Snowflake key) {
+        auto idx = FindSlot(key);
+        if (idx == npos) return 0;
+
+        // pull back every entry in the run that would still be reachable from the hole
+        const size_t mask = m_slots.size() - 1;
+        size_t next = (idx + 1) & mask;
+        while (static_cast<uint64_t>(KeyOf(m_slots[next])) != EmptyKey) {
+            const size_t home = Mix(KeyOf(m_slots[next])) & mask;
+            if (((next - home) & mask) >= ((next - idx) & mask)) {
+                m_slots[idx] = std::move(m_slots[next]);
+                idx = next;
+            }
+            next = (next + 1) & mask;
+        }
+        m_slots[idx] = MakeEmpty();
+        m_size--;
+        return 1;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return m_size;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return m_size == 0;
+    }
+
+    void clear() {
+        m_slots.clear();
+        m_slots.shrink_to_fit();
+        m_size = 0;
+    }
+
+    // slots allocated, for comparing footprints
+    [[nodiscard]] size_t bucket_count() const {
+        return m_slots.size();
+    }
+
+    void reserve(size_t count) {
+        size_t capacity = MinCapacity;
+        while (capacity * MaxLoadNum < count * MaxLoadDen)
+            capacity *= 2;
+        if (capacity > m_slots.size())
+            Rehash(capacity);
+    }
+
+protected:
+    constexpr static size_t npos = static_cast<size_t>(-1);
+    constexpr static size_t MinCapacity = 16;
+    constexpr static size_t MaxLoadNum = 3; // 75%
+    constexpr static size_t MaxLoadDen = 4;
+
+    static Slot MakeEmpty() {
+        Slot slot {};
+        KeyOf(slot) = EmptyKey;
+        return slot;
+    }
+
+    size_t FindSlot(Snowflake key) const {
+        if (m_slots.empty()) return npos;
+        const size_t mask = m_slots.size() - 1;
+        for (size_t idx = Mix(key) & mask;; idx = (idx + 1) & mask) {
+            const uint64_t k = KeyOf(m_slots[idx]);
+            if (k == static_cast<uint64_t>(key)) return idx;
+            if (k == EmptyKey) return npos;
+        }
+    }
+
+    // index of the slot for key and whether it was just created
+    std::pair<size_t, bool> InsertSlot(Snowflake key) {
+        assert(static_cast<uint64_t>(key) != EmptyKey);
+        if ((m_size + 1) * MaxLoadDen > m_slots.size() * MaxLoadNum)
+            Rehash(std::max(MinCapacity, m_slots.size() * 2));
+
+        const size_t mask = m_slots.size() - 1;
+        for (size_t idx = Mix(key) & mask;; idx = (idx + 1) & mask) {
+            const uint64_t k = KeyOf(m_slots[idx]);
+            if (k == static_cast<uint64_t>(key)) return { idx, false };
+            if (k == EmptyKey) {
+                KeyOf(m_slots[idx]) = key;
+                m_size++;
+                return { idx, true };
+            }
+        }
+    }
+
+    iterator IteratorAt(size_t idx) {
+        return { m_slots.data() + idx, m_slots.data() + m_slots.size() };
+    }
+
+private:
+    void Rehash(size_t capacity) {
+        std::vector<Slot> old(capacity);
+        std::swap(old, m_slots);
+        for (auto &slot : m_slots)
+            KeyOf(slot) = EmptyKey;
+
+        const size_t mask = capacity - 1;
+        for (auto &slot : old) {
+            const uint64_t key = KeyOf(slot);
+            if (key == EmptyKey) continue;
+            size_t idx = Mix(key) & mask;
+            while (static_cast<uint64_t>(KeyOf(m_slots[idx])) != EmptyKey)
+                idx = (idx + 1) & mask;
+            m_slots[idx] = std::move(slot);
+        }
+    }
+
+    std::vector<Slot> m_slots; // size is zero or a power of two
+    size_t m_size = 0;
+};
+} // namespace flat_detail
+
+// hash map from snowflake to V, V has to be default constructible
+template<typename V>
+class SnowflakeMap : public flat_detail::FlatTable<std::pair<Snowflake, V>> {
+    using base = flat_detail::FlatTable<std::pair<Snowflake, V>>;
+
+public:
+    using iterator = typename base::iterator;
+    using const_iterator = typename base::const_iterator;
+
+    V &operator[](Snowflake key) {
+        const auto idx = this->InsertSlot(key).first;
+        return this->IteratorAt(idx)->second;
+    }
+
+    [[nodiscard]] V &at(Snowflake key) {
+        return this->find(key)->second;
+    }
+
+    [[nodiscard]] const V &at(Snowflake key) const {
+        return this->find(key)->second;
+    }
+
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Snowflake key, Args &&...args) {
+        const auto [idx, inserted] = this->InsertSlot(key);
+        auto it = this->IteratorAt(idx);
+        if (inserted) it->second = V(std::forward<Args>(args)...);
+        return { it, inserted };
+    }
+
+    std::pair<iterator, bool> insert(const std::pair<Snowflake, V> &entry) {
+        return emplace(entry.first, entry.second);
+    }
+};
+
+// hash set of snowflakes, iteration order is meaningless
+class SnowflakeSet : public flat_detail::FlatTable<Snowflake> {
+public:
+    SnowflakeSet() = default;
+
+    template<typename It>
+    SnowflakeSet(It first, It last) {
+        for (; first != last; first++)
+            insert(*first);
+    }
+
+    std::pair<iterator, bool> insert(Snowflake key) {
+        const auto [idx, inserted] = InsertSlot(key);
+        return { IteratorAt(idx), inserted };
+    }
+};
+
+// sorted vector of snowflakes for small sets that are iterated more than changed
+// iterates in the same order std::set<Snowflake> did
+class SortedSnowflakeSet {
+public:
+    using const_iterator = std::vector<Snowflake>::const_iterator;
+    using iterator = const_iterator;
+
+    SortedSnowflakeSet() = default;
+
+    template<typename It>
+    SortedSnowflakeSet(It first, It last)
+        : m_ids(first, last) {
+        std::sort(m_ids.begin(), m_ids.end());
+        m_ids.erase(std::unique(m_ids.begin(), m_ids.end()), m_ids.end());
+    }
+
+    std::pair<const_iterator, bool> insert(Snowflake id) {
+        const auto it = std::lower_bound(m_ids.begin(), m_ids.end(), id);
+        if (it != m_ids.end() && *it == id) return { it, false };
+        return { m_ids.insert(it, id), true };
+    }
+
+    size_t erase(Snowflake id) {
+        const auto it = std::lower_bound(m_ids.begin(), m_ids.end(), id);
+        if (it == m_ids.end() || !(*it == id)) return 0;
+        m_ids.erase(it);
+        return 1;
+    }
+
+    [[nodiscard]] const_iterator find(Snowflake id) const {
+        const auto it = std::lower_bound(m_ids.begin(), m_ids.end(), id);
+        if (it != m_ids.end() && *it == id) return it;
+        return m_ids.end();
+    }
+
+    [[nodiscard]] size_t count(Snowflake id) const {
+        return std::binary_search(m_ids.begin(), m_ids.end(), id) ? 1 : 0;
+    }
+
+    [[nodiscard]] bool contains(Snowflake id) const {
+        return std::binary_search(m_ids.begin(), m_ids.end(), id);
+    }
+
+    [[nodiscard]] const_iterator begin() const {
+        return m_ids.begin();
+    }
+
+    [[nodiscard]] const_iterator end() const {
+        return m_ids.end();
+    }
+
+    [[nodiscard]] size_t size() const {
+        return m_ids.size();
+    }
+
+    [[nodiscard]] bool empty() const {
+        return m_ids.empty();
+    }
+
+    void clear() {
+        m_ids.clear();
+    }
+
+private:
+    std::vector<Snowflake> m_ids;
+};
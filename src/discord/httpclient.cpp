@@ -1,10 +1,13 @@
 #include "httpclient.hpp"
+#include "log.hpp"
+#include "loopprofiler.hpp"
+#include "tracer.hpp"
+#include "metrics.hpp"
 
 #include <utility>
 
-HTTPClient::HTTPClient() {
-    m_dispatcher.connect(sigc::mem_fun(*this, &HTTPClient::RunCallbacks));
-}
+HTTPClient::HTTPClient(std::shared_ptr<Dispatcher> dispatcher)
+    : m_dispatcher(std::move(dispatcher)) {}
 
 void HTTPClient::SetBase(const std::string &url) {
     m_api_base = url;
@@ -27,7 +30,7 @@ void HTTPClient::SetCookie(std::string_view cookie) {
 }
 
 void HTTPClient::MakeDELETE(const std::string &path, const std::function<void(http::response_type r)> &cb) {
-    printf("DELETE %s\n", path.c_str());
+    LOG_DEBUG(HTTP, "DELETE %s", path.c_str());
     m_futures.push_back(std::async(std::launch::async, [this, path, cb] {
         http::request req(http::REQUEST_DELETE, m_api_base + path);
         AddHeaders(req);
@@ -42,7 +45,7 @@ void HTTPClient::MakeDELETE(const std::string &path, const std::function<void(ht
 }
 
 void HTTPClient::MakePATCH(const std::string &path, const std::string &payload, const std::function<void(http::response_type r)> &cb) {
-    printf("PATCH %s\n", path.c_str());
+    LOG_DEBUG(HTTP, "PATCH %s", path.c_str());
     m_futures.push_back(std::async(std::launch::async, [this, path, cb, payload] {
         http::request req(http::REQUEST_PATCH, m_api_base + path);
         AddHeaders(req);
@@ -59,7 +62,7 @@ void HTTPClient::MakePATCH(const std::string &path, const std::string &payload,
 }
 
 void HTTPClient::MakePOST(const std::string &path, const std::string &payload, const std::function<void(http::response_type r)> &cb) {
-    printf("POST %s\n", path.c_str());
+    LOG_DEBUG(HTTP, "POST %s", path.c_str());
     m_futures.push_back(std::async(std::launch::async, [this, path, cb, payload] {
         http::request req(http::REQUEST_POST, m_api_base + path);
         AddHeaders(req);
@@ -76,7 +79,7 @@ void HTTPClient::MakePOST(const std::string &path, const std::string &payload, c
 }
 
 void HTTPClient::MakePUT(const std::string &path, const std::string &payload, const std::function<void(http::response_type r)> &cb) {
-    printf("PUT %s\n", path.c_str());
+    LOG_DEBUG(HTTP, "PUT %s", path.c_str());
     m_futures.push_back(std::async(std::launch::async, [this, path, cb, payload] {
         http::request req(http::REQUEST_PUT, m_api_base + path);
         AddHeaders(req);
@@ -94,7 +97,7 @@ void HTTPClient::MakePUT(const std::string &path, const std::string &payload, co
 }
 
 void HTTPClient::MakeGET(const std::string &path, const std::function<void(http::response_type r)> &cb) {
-    printf("GET %s\n", path.c_str());
+    LOG_DEBUG(HTTP, "GET %s", path.c_str());
     m_futures.push_back(std::async(std::launch::async, [this, path, cb] {
         http::request req(http::REQUEST_GET, m_api_base + path);
         AddHeaders(req);
@@ -115,7 +118,7 @@ http::request HTTPClient::CreateRequest(http::EMethod method, std::string path)
 }
 
 void HTTPClient::Execute(http::request &&req, const std::function<void(http::response_type r)> &cb) {
-    printf("%s %s\n", req.get_method(), req.get_url().c_str());
+    LOG_DEBUG(HTTP, "%s %s", req.get_method(), req.get_url().c_str());
     m_futures.push_back(std::async(std::launch::async, [this, cb, req = std::move(req)]() mutable {
         auto res = req.execute();
         OnResponse(res, cb);
@@ -131,13 +134,6 @@ void HTTPClient::CleanupFutures() {
     }
 }
 
-void HTTPClient::RunCallbacks() {
-    m_mutex.lock();
-    m_queue.front()();
-    m_queue.pop();
-    m_mutex.unlock();
-}
-
 void HTTPClient::AddHeaders(http::request &r) {
     for (const auto &[name, val] : m_headers) {
         r.set_header(name, val);
@@ -149,11 +145,22 @@ void HTTPClient::AddHeaders(http::request &r) {
 void HTTPClient::OnResponse(const http::response_type &r, const std::function<void(http::response_type r)> &cb) {
     CleanupFutures();
     try {
-        m_mutex.lock();
-        m_queue.push([r, cb] { cb(r); });
-        m_dispatcher.emit();
-        m_mutex.unlock();
+        const auto endpoint = LoopProfiler::LabelFromURL(r.url);
+        auto &metrics = Metrics::Get();
+        if (!r.error)
+            metrics.GetHistogram("abaddon_http_request_seconds", "api request latency, by endpoint", { { "endpoint", endpoint } }).Observe(r.elapsed);
+        if (r.status_code == http::TooManyRequests)
+            metrics.GetCounter("abaddon_http_rate_limited_total", "api requests that got a 429, by endpoint", { { "endpoint", endpoint } }).Inc();
+        else if (r.error)
+            metrics.GetCounter("abaddon_http_errors_total", "api requests that never got a response, by endpoint", { { "endpoint", endpoint } }).Inc();
+
+        auto label = LoopProfiler::Get().IsRunning() ? endpoint : std::string();
+        m_dispatcher->Post([r, cb, label = std::move(label)] {
+            LoopProfiler::Scope scope("http", label);
+            Tracer::Span span("http callback", r.url);
+            cb(r);
+        });
     } catch (const std::exception &e) {
-        fprintf(stderr, "error handling response (%s, code %d): %s\n", r.url.c_str(), r.status_code, e.what());
+        LOG_ERROR(HTTP, "error handling response (%s, code %d): %s", r.url.c_str(), r.status_code, e.what());
     }
 }
@@ -5,13 +5,12 @@
 #include <unordered_map>
 #include <memory>
 #include <mutex>
-#include <queue>
-#include <glibmm.h>
 #include "http.hpp"
+#include "dispatcher.hpp"
 
 class HTTPClient {
 public:
-    HTTPClient();
+    HTTPClient(std::shared_ptr<Dispatcher> dispatcher);
 
     void SetBase(const std::string &url);
 
@@ -35,10 +34,7 @@ private:
     void OnResponse(const http::response_type &r, const std::function<void(http::response_type r)> &cb);
     void CleanupFutures();
 
-    mutable std::mutex m_mutex;
-    Glib::Dispatcher m_dispatcher;
-    std::queue<std::function<void()>> m_queue;
-    void RunCallbacks();
+    std::shared_ptr<Dispatcher> m_dispatcher;
 
     std::vector<std::future<void>> m_futures;
     std::string m_api_base;
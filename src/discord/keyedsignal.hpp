@@ -0,0 +1,59 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include <sigc++/sigc++.h>
+#include "flatmap.hpp"
+
+// a signal per id so emitting only calls whoever subscribed to that id
+// meant for widgets that exist many times over (rows, indicators) which would otherwise all be called for every event
+template<typename... T_arg>
+class KeyedSignal {
+public:
+    using signal_type = sigc::signal<void, T_arg...>;
+    using slot_type = typename signal_type::slot_type;
+
+    sigc::connection connect(Snowflake key, const slot_type &slot) {
+        Prune();
+        return m_signals[key].connect(slot);
+    }
+
+    void emit(Snowflake key, T_arg... args) {
+        if (m_blocked) return;
+        const auto it = m_signals.find(key);
+        if (it == m_signals.end()) return;
+        // copy the handle, a subscriber connecting something else could move the entry
+        auto signal = it->second;
+        signal.emit(args...);
+        if (signal.empty())
+            m_signals.erase(key);
+    }
+
+    // nothing is called while blocked, same as sigc::signal_base::block
+    void block(bool should_block = true) {
+        m_blocked = should_block;
+    }
+
+    [[nodiscard]] bool has_subscribers(Snowflake key) const {
+        const auto it = m_signals.find(key);
+        return it != m_signals.end() && !it->second.empty();
+    }
+
+private:
+    constexpr static size_t MinPruneSize = 64;
+
+    // subscribers going away only empty their signal, the leftovers are swept out whenever the table doubles
+    void Prune() {
+        if (m_signals.size() < m_prune_at) return;
+        std::vector<Snowflake> empty;
+        for (const auto &[key, signal] : m_signals)
+            if (signal.empty())
+                empty.push_back(key);
+        for (const auto key : empty)
+            m_signals.erase(key);
+        m_prune_at = std::max(MinPruneSize, m_signals.size() * 2);
+    }
+
+    SnowflakeMap<signal_type> m_signals;
+    size_t m_prune_at = MinPruneSize;
+    bool m_blocked = false;
+};
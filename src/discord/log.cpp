@@ -0,0 +1,269 @@
+#include "log.hpp"
+#include "tracer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+constexpr static std::array<const char *, static_cast<size_t>(LogCategory::Count)> CategoryNames {
+    "general",
+    "gateway",
+    "websocket",
+    "http",
+    "store",
+    "session",
+    "images",
+    "prefetch",
+    "profiler",
+    "metrics",
+    "tracing",
+};
+
+constexpr static std::array<const char *, static_cast<size_t>(LogLevel::Off) + 1> LevelNames {
+    "trace",
+    "debug",
+    "info",
+    "warn",
+    "error",
+    "off",
+};
+
+Log::Log()
+    : m_records(new Record[Capacity]) {
+    for (size_t i = 0; i < Capacity; i++)
+        m_records[i].Sequence.store(i, std::memory_order_relaxed);
+    m_running = true;
+    m_flusher = std::thread([this] { FlushThread(); });
+}
+
+Log::~Log() {
+    Stop();
+}
+
+Log &Log::Get() {
+    static Log log;
+    return log;
+}
+
+void Log::SetLevel(LogCategory category, LogLevel level) {
+    m_thresholds[static_cast<size_t>(category)].store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+}
+
+void Log::SetLevel(LogLevel level) {
+    for (auto &threshold : m_thresholds)
+        threshold.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+}
+
+static std::string_view Trim(std::string_view str) {
+    while (!str.empty() && str.front() == ' ') str.remove_prefix(1);
+    while (!str.empty() && str.back() == ' ') str.remove_suffix(1);
+    return str;
+}
+
+bool Log::Configure(std::string_view spec) {
+    const auto parse_level = [](std::string_view name) -> int {
+        for (size_t i = 0; i < LevelNames.size(); i++)
+            if (name == LevelNames[i]) return static_cast<int>(i);
+        return -1;
+    };
+
+    bool ok = true;
+    while (!spec.empty()) {
+        const auto comma = spec.find(',');
+        const auto item = Trim(spec.substr(0, comma));
+        spec = comma == std::string_view::npos ? std::string_view() : spec.substr(comma + 1);
+        if (item.empty()) continue;
+
+        const auto eq = item.find('=');
+        if (eq == std::string_view::npos) {
+            if (const int level = parse_level(item); level >= 0) {
+                SetLevel(static_cast<LogLevel>(level));
+                continue;
+            }
+        } else {
+            const auto name = Trim(item.substr(0, eq));
+            const int level = parse_level(Trim(item.substr(eq + 1)));
+            bool found = false;
+            for (size_t i = 0; i < CategoryNames.size() && level >= 0; i++) {
+                if (name == CategoryNames[i]) {
+                    SetLevel(static_cast<LogCategory>(i), static_cast<LogLevel>(level));
+                    found = true;
+                    break;
+                }
+            }
+            if (found) continue;
+        }
+        fprintf(stderr, "ignoring log level %.*s\n", static_cast<int>(item.size()), item.data());
+        ok = false;
+    }
+    return ok;
+}
+
+const char *Log::GetName(LogCategory category) {
+    return CategoryNames[static_cast<size_t>(category)];
+}
+
+const char *Log::GetName(LogLevel level) {
+    return LevelNames[static_cast<size_t>(level)];
+}
+
+void Log::Write(LogCategory category, LogLevel level, const char *fmt, ...) {
+    const auto now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    char text[MaxMessage];
+    va_list args;
+    va_start(args, fmt);
+    va_list retry;
+    va_copy(retry, args);
+    const int n = std::vsnprintf(text, MaxMessage, fmt, args);
+    va_end(args);
+    if (n < 0) {
+        va_end(retry);
+        return;
+    }
+    if (n < static_cast<int>(MaxMessage)) {
+        va_end(retry);
+        Enqueue(category, level, now, text, n);
+        return;
+    }
+
+    // too long for one record (gateway payloads and such), split it up instead of losing the rest
+    std::string full(n, '\0');
+    std::vsnprintf(full.data(), full.size() + 1, fmt, retry);
+    va_end(retry);
+    for (size_t pos = 0; pos < full.size(); pos += MaxMessage - 1)
+        Enqueue(category, level, now, full.data() + pos, std::min(MaxMessage - 1, full.size() - pos));
+}
+
+void Log::Enqueue(LogCategory category, LogLevel level, int64_t time, const char *text, size_t length) {
+    if (!m_running) {
+        // stopped, nothing is draining the ring anymore
+        Record record;
+        record.Time = time;
+        record.Category = category;
+        record.Level = level;
+        std::memcpy(record.Text, text, length);
+        record.Length = static_cast<uint16_t>(length);
+        std::fputs(Format(record).c_str(), level >= LogLevel::Warn ? stderr : stdout);
+        return;
+    }
+
+    // bounded mpmc queue (vyukov), only the claiming cas is contended
+    Record *record;
+    size_t pos = m_enqueue.load(std::memory_order_relaxed);
+    while (true) {
+        record = &m_records[pos & (Capacity - 1)];
+        const size_t seq = record->Sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (m_enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            // full, dropping is better than making a hot path wait on stdout
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = m_enqueue.load(std::memory_order_relaxed);
+        }
+    }
+
+    record->Time = time;
+    record->Category = category;
+    record->Level = level;
+    std::memcpy(record->Text, text, length);
+    record->Length = static_cast<uint16_t>(length);
+    record->Sequence.store(pos + 1, std::memory_order_release);
+}
+
+void Log::Flush() {
+    std::lock_guard<std::mutex> l(m_drain_mutex);
+    Drain();
+}
+
+void Log::Stop() {
+    {
+        std::lock_guard<std::mutex> l(m_wake_mutex);
+        if (!m_running) return;
+        m_running = false;
+    }
+    m_wake.notify_one();
+    if (m_flusher.joinable()) m_flusher.join();
+    // anything that was halfway through being written when m_running went false
+    Flush();
+}
+
+std::string Log::Format(const Record &record) {
+    const auto secs = static_cast<std::time_t>(record.Time / 1000000);
+    std::tm tm {};
+#ifdef _WIN32
+    localtime_s(&tm, &secs);
+#else
+    localtime_r(&secs, &tm);
+#endif
+    char prefix[64];
+    std::snprintf(prefix, sizeof(prefix), "[%02d:%02d:%02d.%03d] [%s] [%s] ",
+                  tm.tm_hour, tm.tm_min, tm.tm_sec, static_cast<int>((record.Time / 1000) % 1000), GetName(record.Level), GetName(record.Category));
+    std::string line = prefix;
+    line.append(record.Text, record.Length);
+    line += '\n';
+    return line;
+}
+
+void Log::FlushThread() {
+    Tracer::SetThreadName("log");
+    while (m_running) {
+        size_t count;
+        {
+            std::lock_guard<std::mutex> l(m_drain_mutex);
+            count = Drain();
+        }
+        if (count == 0) {
+            std::unique_lock<std::mutex> l(m_wake_mutex);
+            m_wake.wait_for(l, std::chrono::milliseconds(FlushIntervalMilliseconds), [this] { return !m_running; });
+        }
+    }
+}
+
+size_t Log::Drain() {
+    // batched so a burst is a couple of writes instead of one per line
+    std::string out;
+    std::string err;
+    size_t count = 0;
+    while (true) {
+        auto &record = m_records[m_dequeue & (Capacity - 1)];
+        if (record.Sequence.load(std::memory_order_acquire) != m_dequeue + 1) break;
+        const auto line = Format(record);
+        // errors and warnings still go to stderr like they always did
+        if (record.Level >= LogLevel::Warn) {
+            // keep the order between the two streams
+            if (!out.empty()) {
+                std::fputs(out.c_str(), stdout);
+                std::fflush(stdout);
+                out.clear();
+            }
+            err += line;
+        } else {
+            if (!err.empty()) {
+                std::fputs(err.c_str(), stderr);
+                err.clear();
+            }
+            out += line;
+        }
+        record.Sequence.store(m_dequeue + Capacity, std::memory_order_release);
+        m_dequeue++;
+        count++;
+    }
+
+    if (const auto dropped = m_dropped.exchange(0, std::memory_order_relaxed); dropped > 0)
+        err += "[log] dropped " + std::to_string(dropped) + " messages, the queue was full\n";
+
+    if (!out.empty()) {
+        std::fputs(out.c_str(), stdout);
+        std::fflush(stdout);
+    }
+    if (!err.empty())
+        std::fputs(err.c_str(), stderr);
+    return count;
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// leveled logging per subsystem that never blocks the caller
+// messages are formatted into a lock-free ring and written out by a background thread
+// use the LOG_ macros, a disabled category costs one relaxed load and a branch and nothing gets formatted
+
+// anything below this level is compiled out entirely (0 trace ... 4 error)
+#ifndef ABADDON_LOG_MIN_LEVEL
+    #define ABADDON_LOG_MIN_LEVEL 0
+#endif
+
+enum class LogLevel : uint8_t {
+    Trace,
+    Debug,
+    Info,
+    Warn,
+    Error,
+    Off,
+};
+
+enum class LogCategory : uint8_t {
+    General,
+    Gateway,
+    Websocket,
+    HTTP,
+    Store,
+    Session,
+    Images,
+    Prefetch,
+    Profiler,
+    Metrics,
+    Tracing,
+    Count,
+};
+
+class Log {
+public:
+    static Log &Get();
+
+    [[nodiscard]] static bool IsEnabled(LogCategory category, LogLevel level) noexcept {
+        return static_cast<uint8_t>(level) >= m_thresholds[static_cast<size_t>(category)].load(std::memory_order_relaxed);
+    }
+
+    static void SetLevel(LogCategory category, LogLevel level);
+    static void SetLevel(LogLevel level); // every category
+    // comma separated, a bare level applies to every category: "warn,gateway=debug,http=trace"
+    // returns false if anything in it wasnt understood, whatever was understood is still applied
+    static bool Configure(std::string_view spec);
+
+    static const char *GetName(LogCategory category);
+    static const char *GetName(LogLevel level);
+
+#ifdef __GNUC__
+    __attribute__((format(printf, 4, 5)))
+#endif
+    void Write(LogCategory category, LogLevel level, const char *fmt, ...);
+
+    // writes out everything queued so far before returning
+    void Flush();
+    // flushes and stops the background thread, anything logged after this is written synchronously
+    void Stop();
+
+private:
+    Log();
+    ~Log();
+
+    constexpr static size_t Capacity = 2048;   // power of two
+    constexpr static size_t MaxMessage = 480;  // longer messages are split over several records
+    constexpr static int FlushIntervalMilliseconds = 25;
+    static_assert((Capacity & (Capacity - 1)) == 0);
+
+    struct Record {
+        std::atomic<size_t> Sequence;
+        int64_t Time; // unix microseconds
+        LogCategory Category;
+        LogLevel Level;
+        uint16_t Length;
+        char Text[MaxMessage];
+    };
+
+    static std::string Format(const Record &record);
+    void Enqueue(LogCategory category, LogLevel level, int64_t time, const char *text, size_t length);
+    void FlushThread();
+    size_t Drain(); // with m_drain_mutex held
+
+    inline static std::array<std::atomic<uint8_t>, static_cast<size_t>(LogCategory::Count)> m_thresholds {
+        static_cast<uint8_t>(LogLevel::Info), // general
+        static_cast<uint8_t>(LogLevel::Info), // gateway
+        static_cast<uint8_t>(LogLevel::Info), // websocket
+        static_cast<uint8_t>(LogLevel::Info), // http
+        static_cast<uint8_t>(LogLevel::Info), // store
+        static_cast<uint8_t>(LogLevel::Info), // session
+        static_cast<uint8_t>(LogLevel::Info), // images
+        static_cast<uint8_t>(LogLevel::Info), // prefetch
+        static_cast<uint8_t>(LogLevel::Info), // profiler
+        static_cast<uint8_t>(LogLevel::Info), // metrics
+        static_cast<uint8_t>(LogLevel::Info), // tracing
+    };
+
+    std::unique_ptr<Record[]> m_records;
+    alignas(64) std::atomic<size_t> m_enqueue = 0;
+    alignas(64) size_t m_dequeue = 0;
+    std::atomic<uint64_t> m_dropped = 0;
+
+    std::mutex m_drain_mutex;
+    std::mutex m_wake_mutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_running = false;
+    std::thread m_flusher;
+};
+
+#define ABADDON_LOG(category, level, ...)                                                                                         \
+    do {                                                                                                                          \
+        if (static_cast<int>(LogLevel::level) >= ABADDON_LOG_MIN_LEVEL && Log::IsEnabled(LogCategory::category, LogLevel::level)) \
+            Log::Get().Write(LogCategory::category, LogLevel::level, __VA_ARGS__);                                                \
+    } while (false)
+
+#define LOG_TRACE(category, ...) ABADDON_LOG(category, Trace, __VA_ARGS__)
+#define LOG_DEBUG(category, ...) ABADDON_LOG(category, Debug, __VA_ARGS__)
+#define LOG_INFO(category, ...) ABADDON_LOG(category, Info, __VA_ARGS__)
+#define LOG_WARN(category, ...) ABADDON_LOG(category, Warn, __VA_ARGS__)
+#define LOG_ERROR(category, ...) ABADDON_LOG(category, Error, __VA_ARGS__)
@@ -0,0 +1,222 @@
+#include "loopprofiler.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cinttypes>
+#include <cstdio>
+
+LoopProfiler::Scope::Scope(const char *label) {
+    auto &profiler = Get();
+    if (!profiler.m_running || std::this_thread::get_id() != profiler.m_main_thread) return;
+    m_active = true;
+    profiler.Push(label);
+}
+
+LoopProfiler::Scope::Scope(const char *prefix, const std::string &name) {
+    auto &profiler = Get();
+    if (!profiler.m_running || std::this_thread::get_id() != profiler.m_main_thread) return;
+    m_active = true;
+    profiler.Push(std::string(prefix) + " " + name);
+}
+
+LoopProfiler::Scope::~Scope() {
+    if (m_active)
+        Get().Pop();
+}
+
+LoopProfiler &LoopProfiler::Get() {
+    static LoopProfiler profiler;
+    return profiler;
+}
+
+LoopProfiler::~LoopProfiler() {
+    Stop();
+}
+
+void LoopProfiler::Start(unsigned stall_threshold_ms) {
+    if (m_running) return;
+
+    m_main_thread = std::this_thread::get_id();
+    m_threshold_ms = stall_threshold_ms;
+    m_last_heartbeat = clock::now().time_since_epoch().count();
+
+    if (m_threshold_ms > 0) {
+        const auto heartbeat = [this]() -> bool {
+            m_last_heartbeat = clock::now().time_since_epoch().count();
+            return true;
+        };
+        m_heartbeat_conn = Glib::signal_timeout().connect(heartbeat, HeartbeatMilliseconds);
+        m_watchdog_stop = false;
+        m_watchdog = std::thread([this] { WatchdogThread(); });
+    }
+
+    m_running = true;
+}
+
+void LoopProfiler::Stop() {
+    if (!m_running) return;
+    m_running = false;
+
+    m_heartbeat_conn.disconnect();
+    {
+        std::lock_guard<std::mutex> l(m_watchdog_mutex);
+        m_watchdog_stop = true;
+    }
+    m_watchdog_cv.notify_all();
+    if (m_watchdog.joinable()) m_watchdog.join();
+}
+
+bool LoopProfiler::IsRunning() const {
+    return m_running;
+}
+
+std::string LoopProfiler::Dump() const {
+    std::lock_guard<std::mutex> l(m_mutex);
+
+    std::vector<std::pair<const std::string *, const Histogram *>> sorted;
+    sorted.reserve(m_histograms.size());
+    for (const auto &[label, histogram] : m_histograms)
+        sorted.emplace_back(&label, &histogram);
+    std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
+        return a.second->TotalMicroseconds > b.second->TotalMicroseconds;
+    });
+
+    std::string out;
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-48s %10s %10s %10s %10s %10s %10s\n", "label", "count", "total ms", "mean ms", "p50 ms", "p99 ms", "max ms");
+    out += line;
+    for (const auto &[label, h] : sorted) {
+        std::snprintf(line, sizeof(line), "%-48.48s %10" PRIu64 " %10.1f %10.2f %10.2f %10.2f %10.2f\n",
+                      label->c_str(),
+                      h->Count,
+                      h->TotalMicroseconds / 1000.0,
+                      h->Count == 0 ? 0.0 : h->TotalMicroseconds / 1000.0 / h->Count,
+                      h->Percentile(0.50) / 1000.0,
+                      h->Percentile(0.99) / 1000.0,
+                      h->MaxMicroseconds / 1000.0);
+        out += line;
+    }
+    return out;
+}
+
+void LoopProfiler::Reset() {
+    std::lock_guard<std::mutex> l(m_mutex);
+    m_histograms.clear();
+}
+
+std::string LoopProfiler::LabelFromURL(const std::string &url) {
+    auto path = url.substr(0, url.find('?'));
+    if (const auto scheme = path.find("://"); scheme != std::string::npos) {
+        const auto host_end = path.find('/', scheme + 3);
+        path = host_end == std::string::npos ? "/" : path.substr(host_end);
+    }
+    if (path.rfind("/api/v", 0) == 0) {
+        const auto version_end = path.find('/', 6);
+        path = version_end == std::string::npos ? "/" : path.substr(version_end);
+    }
+
+    // anything long enough to be an id
+    std::string label;
+    label.reserve(path.size());
+    for (size_t i = 0; i < path.size();) {
+        size_t j = i;
+        while (j < path.size() && std::isdigit(static_cast<unsigned char>(path[j]))) j++;
+        if (j - i >= 5) {
+            label += '#';
+            i = j;
+        } else if (j > i) {
+            label.append(path, i, j - i);
+            i = j;
+        } else {
+            label += path[i++];
+        }
+    }
+    return label;
+}
+
+void LoopProfiler::Histogram::Add(uint64_t us) {
+    size_t i = 0;
+    while (i < BucketCount - 1 && (uint64_t(1) << i) <= us) i++;
+    Buckets[i]++;
+    Count++;
+    TotalMicroseconds += us;
+    MaxMicroseconds = std::max(MaxMicroseconds, us);
+}
+
+uint64_t LoopProfiler::Histogram::Percentile(double p) const {
+    if (Count == 0) return 0;
+    const auto target = static_cast<uint64_t>(p * static_cast<double>(Count - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BucketCount; i++) {
+        seen += Buckets[i];
+        if (seen >= target)
+            return std::min(MaxMicroseconds, uint64_t(1) << i);
+    }
+    return MaxMicroseconds;
+}
+
+void LoopProfiler::Push(std::string label) {
+    const auto now = clock::now();
+    std::lock_guard<std::mutex> l(m_mutex);
+    if (m_stack.empty())
+        m_unit++;
+    m_stack.push_back({ std::move(label), now });
+}
+
+void LoopProfiler::Pop() {
+    const auto now = clock::now();
+    std::lock_guard<std::mutex> l(m_mutex);
+    if (m_stack.empty()) return;
+
+    const auto frame = std::move(m_stack.back());
+    m_stack.pop_back();
+    const auto us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - frame.Start).count());
+    m_histograms[frame.Label].Add(us);
+
+    if (m_stack.empty()) {
+        // the heartbeat couldnt tick while this ran, dont blame it on whatever comes next
+        m_last_heartbeat = now.time_since_epoch().count();
+        if (m_threshold_ms > 0 && us >= m_threshold_ms * uint64_t(1000))
+            LOG_WARN(Profiler, "main loop: %s took %" PRIu64 "ms", frame.Label.c_str(), us / 1000);
+    }
+}
+
+std::string LoopProfiler::GetStackLabel() const {
+    std::string label;
+    for (const auto &frame : m_stack) {
+        if (!label.empty()) label += " > ";
+        label += frame.Label;
+    }
+    return label;
+}
+
+void LoopProfiler::WatchdogThread() {
+    const auto threshold = std::chrono::milliseconds(m_threshold_ms);
+    const auto interval = std::max(std::chrono::milliseconds(10), threshold / 4);
+
+    std::unique_lock<std::mutex> lock(m_watchdog_mutex);
+    while (!m_watchdog_cv.wait_for(lock, interval, [this] { return m_watchdog_stop; })) {
+        const auto now = clock::now();
+
+        bool busy;
+        {
+            std::lock_guard<std::mutex> l(m_mutex);
+            busy = !m_stack.empty();
+            if (busy && m_reported_unit != m_unit && now - m_stack.front().Start >= threshold) {
+                m_reported_unit = m_unit;
+                const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_stack.front().Start).count();
+                LOG_WARN(Profiler, "main loop stalled for %" PRId64 "ms in %s", static_cast<int64_t>(ms), GetStackLabel().c_str());
+            }
+        }
+
+        const auto heartbeat = clock::time_point(clock::duration(m_last_heartbeat.load()));
+        const auto since_heartbeat = now - heartbeat;
+        if (since_heartbeat < threshold + std::chrono::milliseconds(HeartbeatMilliseconds)) {
+            m_heartbeat_reported = false;
+        } else if (!busy && !m_heartbeat_reported) {
+            m_heartbeat_reported = true;
+            const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(since_heartbeat).count();
+            LOG_WARN(Profiler, "main loop stalled for %" PRId64 "ms outside of any timed work", static_cast<int64_t>(ms));
+        }
+    }
+}
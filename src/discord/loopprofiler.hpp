@@ -0,0 +1,96 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glibmm/main.h>
+
+// times units of work on the main loop so a freeze can be pinned on whatever caused it
+// a watchdog thread prints the labels of anything still running past the threshold, every unit goes into a latency
+// histogram for its label that can be dumped whenever
+class LoopProfiler {
+public:
+    // times everything until its destroyed. nested scopes show up as a path in stall reports
+    // does nothing off the main thread or when the profiler isnt running
+    class Scope {
+    public:
+        explicit Scope(const char *label);
+        Scope(const char *prefix, const std::string &name); // "prefix name", for labels that arent known ahead of time
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        bool m_active = false;
+    };
+
+    static LoopProfiler &Get();
+
+    // must be called on the main thread, a threshold of 0 keeps the histograms but never reports stalls
+    void Start(unsigned stall_threshold_ms);
+    void Stop();
+    [[nodiscard]] bool IsRunning() const;
+
+    // one line per label, slowest first
+    [[nodiscard]] std::string Dump() const;
+    void Reset();
+
+    // strips ids and queries so requests to the same endpoint share a label
+    static std::string LabelFromURL(const std::string &url);
+
+private:
+    LoopProfiler() = default;
+    ~LoopProfiler();
+
+    using clock = std::chrono::steady_clock;
+
+    constexpr static size_t BucketCount = 24; // bucket i holds anything under 2^i microseconds, the last one holds the rest
+    constexpr static unsigned HeartbeatMilliseconds = 50;
+
+    struct Histogram {
+        std::array<uint64_t, BucketCount> Buckets {};
+        uint64_t Count = 0;
+        uint64_t TotalMicroseconds = 0;
+        uint64_t MaxMicroseconds = 0;
+
+        void Add(uint64_t us);
+        [[nodiscard]] uint64_t Percentile(double p) const; // upper bound of the bucket it lands in
+    };
+
+    struct Frame {
+        std::string Label;
+        clock::time_point Start;
+    };
+
+    void Push(std::string label);
+    void Pop();
+    void WatchdogThread();
+    [[nodiscard]] std::string GetStackLabel() const; // with m_mutex held
+
+    std::atomic<bool> m_running = false;
+    std::thread::id m_main_thread;
+    unsigned m_threshold_ms = 0;
+
+    mutable std::mutex m_mutex;
+    std::vector<Frame> m_stack;
+    uint64_t m_unit = 0;          // bumped for every outermost scope so each stall is reported once
+    uint64_t m_reported_unit = 0; // last unit the watchdog reported
+    std::map<std::string, Histogram> m_histograms;
+
+    // stalls outside of any scope (layout, drawing, uninstrumented handlers) only show up as the loop not ticking
+    std::atomic<int64_t> m_last_heartbeat = 0; // clock ticks
+    bool m_heartbeat_reported = false;         // watchdog thread only
+    sigc::connection m_heartbeat_conn;
+
+    std::thread m_watchdog;
+    std::condition_variable m_watchdog_cv;
+    std::mutex m_watchdog_mutex;
+    bool m_watchdog_stop = false;
+};
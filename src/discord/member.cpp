@@ -1,5 +1,5 @@
 #include "member.hpp"
-#include "abaddon.hpp"
+#include "discord.hpp"
 
 void from_json(const nlohmann::json &j, GuildMember &m) {
     JS_O("user", m.User);
@@ -17,7 +17,7 @@ void from_json(const nlohmann::json &j, GuildMember &m) {
 std::vector<RoleData> GuildMember::GetSortedRoles() const {
     std::vector<RoleData> roles;
     for (const auto role_id : Roles) {
-        const auto role = Abaddon::Get().GetDiscordClient().GetRole(role_id);
+        const auto role = DiscordClient::Get().GetRole(role_id);
         if (!role.has_value()) continue;
         roles.push_back(*role);
     }
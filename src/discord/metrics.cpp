@@ -0,0 +1,316 @@
+#include "metrics.hpp"
+#include "log.hpp"
+#include "tracer.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/stat.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+void Metrics::Gauge::Set(double value) {
+    m_value.store(value, std::memory_order_relaxed);
+}
+
+void Metrics::Gauge::Add(double delta) {
+    double current = m_value.load(std::memory_order_relaxed);
+    while (!m_value.compare_exchange_weak(current, current + delta, std::memory_order_relaxed)) {}
+}
+
+double Metrics::Gauge::Value() const {
+    return m_value.load(std::memory_order_relaxed);
+}
+
+void Metrics::Histogram::Observe(double seconds) {
+    const auto bucket = std::lower_bound(Bounds.begin(), Bounds.end(), seconds) - Bounds.begin();
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    double current = m_sum.load(std::memory_order_relaxed);
+    while (!m_sum.compare_exchange_weak(current, current + seconds, std::memory_order_relaxed)) {}
+}
+
+Metrics::Histogram::bucket_counts Metrics::Histogram::GetCumulative() const {
+    bucket_counts counts {};
+    uint64_t total = 0;
+    for (size_t i = 0; i < m_buckets.size(); i++) {
+        total += m_buckets[i].load(std::memory_order_relaxed);
+        counts[i] = total;
+    }
+    return counts;
+}
+
+double Metrics::Histogram::Sum() const {
+    return m_sum.load(std::memory_order_relaxed);
+}
+
+Metrics::Timer::Timer(Histogram &histogram)
+    : m_histogram(histogram)
+    , m_start(std::chrono::steady_clock::now()) {}
+
+Metrics::Timer::~Timer() {
+    m_histogram.Observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count());
+}
+
+Metrics &Metrics::Get() {
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::~Metrics() {
+    StopServing();
+}
+
+Metrics::Counter &Metrics::GetCounter(const std::string &name, const std::string &help, const Labels &labels) {
+    std::lock_guard<std::mutex> l(m_mutex);
+    auto &counter = GetFamily(name, help, Type::Counter).Counters[RenderLabels(labels)];
+    if (!counter) counter = std::make_unique<Counter>();
+    return *counter;
+}
+
+Metrics::Gauge &Metrics::GetGauge(const std::string &name, const std::string &help, const Labels &labels) {
+    std::lock_guard<std::mutex> l(m_mutex);
+    auto &gauge = GetFamily(name, help, Type::Gauge).Gauges[RenderLabels(labels)];
+    if (!gauge) gauge = std::make_unique<Gauge>();
+    return *gauge;
+}
+
+Metrics::Histogram &Metrics::GetHistogram(const std::string &name, const std::string &help, const Labels &labels) {
+    std::lock_guard<std::mutex> l(m_mutex);
+    auto &histogram = GetFamily(name, help, Type::Histogram).Histograms[RenderLabels(labels)];
+    if (!histogram) histogram = std::make_unique<Histogram>();
+    return *histogram;
+}
+
+void Metrics::AddCollector(std::function<void()> collector) {
+    std::lock_guard<std::mutex> l(m_collectors_mutex);
+    m_collectors.push_back(std::move(collector));
+}
+
+static std::string FormatValue(double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.10g", value);
+    return buf;
+}
+
+// le has to go in with the rest of the labels
+static std::string WithBound(const std::string &labels, const std::string &bound) {
+    if (labels.empty()) return "{le=\"" + bound + "\"}";
+    return labels.substr(0, labels.size() - 1) + ",le=\"" + bound + "\"}";
+}
+
+std::string Metrics::Render() {
+    RunCollectors();
+
+    std::string out;
+    std::lock_guard<std::mutex> l(m_mutex);
+    for (const auto &[name, family] : m_families) {
+        std::string help;
+        for (const char c : family.Help) {
+            if (c == '\\')
+                help += "\\\\";
+            else if (c == '\n')
+                help += "\\n";
+            else
+                help += c;
+        }
+        out += "# HELP " + name + " " + help + "\n";
+
+        switch (family.Kind) {
+            case Type::Counter:
+                out += "# TYPE " + name + " counter\n";
+                for (const auto &[labels, counter] : family.Counters)
+                    out += name + labels + " " + std::to_string(counter->Value()) + "\n";
+                break;
+            case Type::Gauge:
+                out += "# TYPE " + name + " gauge\n";
+                for (const auto &[labels, gauge] : family.Gauges)
+                    out += name + labels + " " + FormatValue(gauge->Value()) + "\n";
+                break;
+            case Type::Histogram:
+                out += "# TYPE " + name + " histogram\n";
+                for (const auto &[labels, histogram] : family.Histograms) {
+                    const auto counts = histogram->GetCumulative();
+                    for (size_t i = 0; i < Histogram::Bounds.size(); i++)
+                        out += name + "_bucket" + WithBound(labels, FormatValue(Histogram::Bounds[i])) + " " + std::to_string(counts[i]) + "\n";
+                    out += name + "_bucket" + WithBound(labels, "+Inf") + " " + std::to_string(counts.back()) + "\n";
+                    out += name + "_sum" + labels + " " + FormatValue(histogram->Sum()) + "\n";
+                    out += name + "_count" + labels + " " + std::to_string(counts.back()) + "\n";
+                }
+                break;
+        }
+    }
+    return out;
+}
+
+std::vector<Metrics::Sample> Metrics::GetSamples() {
+    RunCollectors();
+
+    std::vector<Sample> samples;
+    std::lock_guard<std::mutex> l(m_mutex);
+    for (const auto &[name, family] : m_families) {
+        switch (family.Kind) {
+            case Type::Counter:
+                for (const auto &[labels, counter] : family.Counters)
+                    samples.push_back({ name, labels, Type::Counter, static_cast<double>(counter->Value()), 0, 0.0 });
+                break;
+            case Type::Gauge:
+                for (const auto &[labels, gauge] : family.Gauges)
+                    samples.push_back({ name, labels, Type::Gauge, gauge->Value(), 0, 0.0 });
+                break;
+            case Type::Histogram:
+                for (const auto &[labels, histogram] : family.Histograms)
+                    samples.push_back({ name, labels, Type::Histogram, 0.0, histogram->GetCumulative().back(), histogram->Sum() });
+                break;
+        }
+    }
+    return samples;
+}
+
+Metrics::Family &Metrics::GetFamily(const std::string &name, const std::string &help, Type kind) {
+    auto [it, inserted] = m_families.try_emplace(name);
+    if (inserted) {
+        it->second.Kind = kind;
+        it->second.Help = help;
+    } else if (it->second.Kind != kind) {
+        // still hands something back so the caller works, it just never shows up
+        LOG_WARN(Metrics, "metric %s was registered with a different type", name.c_str());
+    }
+    return it->second;
+}
+
+std::string Metrics::RenderLabels(const Labels &labels) {
+    if (labels.empty()) return "";
+    std::string out = "{";
+    for (const auto &[name, value] : labels) {
+        if (out.size() > 1) out += ',';
+        out += name + "=\"";
+        for (const char c : value) {
+            if (c == '\\' || c == '"')
+                out += '\\';
+            if (c == '\n')
+                out += "\\n";
+            else
+                out += c;
+        }
+        out += '"';
+    }
+    out += '}';
+    return out;
+}
+
+void Metrics::RunCollectors() {
+    std::lock_guard<std::mutex> l(m_collectors_mutex);
+    for (const auto &collector : m_collectors)
+        collector();
+}
+
+#ifdef _WIN32
+bool Metrics::Serve(const std::string &path) {
+    LOG_WARN(Metrics, "the metrics socket isnt supported on windows");
+    return false;
+}
+
+void Metrics::StopServing() {}
+
+void Metrics::ServeThread() {}
+
+void Metrics::Respond(int fd) {}
+#else
+bool Metrics::Serve(const std::string &path) {
+    StopServing();
+
+    sockaddr_un addr {};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        LOG_WARN(Metrics, "metrics socket path is too long: %s", path.c_str());
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    // one left behind by a crash would fail the bind, but dont delete anything that isnt a socket
+    struct stat st {};
+    if (stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path.c_str());
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        LOG_WARN(Metrics, "couldnt create metrics socket: %s", std::strerror(errno));
+        return false;
+    }
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+        LOG_WARN(Metrics, "couldnt listen on %s: %s", path.c_str(), std::strerror(errno));
+        close(fd);
+        return false;
+    }
+    chmod(path.c_str(), S_IRUSR | S_IWUSR);
+
+    m_listen_fd = fd;
+    m_socket_path = path;
+    m_serving = true;
+    m_server = std::thread([this] { ServeThread(); });
+    LOG_INFO(Metrics, "serving metrics on %s", path.c_str());
+    return true;
+}
+
+void Metrics::StopServing() {
+    if (!m_serving) return;
+    m_serving = false;
+    if (m_server.joinable()) m_server.join();
+    close(m_listen_fd);
+    m_listen_fd = -1;
+    unlink(m_socket_path.c_str());
+    m_socket_path.clear();
+}
+
+void Metrics::ServeThread() {
+    Tracer::SetThreadName("metrics");
+    while (m_serving) {
+        pollfd pfd { m_listen_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, PollMilliseconds) <= 0) continue;
+        const int client = accept(m_listen_fd, nullptr, nullptr);
+        if (client < 0) continue;
+        Respond(client);
+        close(client);
+    }
+}
+
+static void WriteAll(int fd, const std::string &data) {
+    #ifdef MSG_NOSIGNAL
+    constexpr int flags = MSG_NOSIGNAL;
+    #else
+    constexpr int flags = 0;
+    #endif
+    size_t written = 0;
+    while (written < data.size()) {
+        const auto n = send(fd, data.data() + written, data.size() - written, flags);
+        if (n <= 0) return;
+        written += static_cast<size_t>(n);
+    }
+}
+
+void Metrics::Respond(int fd) {
+    #ifdef SO_NOSIGPIPE
+    const int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+    #endif
+
+    bool http = false;
+    pollfd pfd { fd, POLLIN, 0 };
+    if (poll(&pfd, 1, RequestWaitMilliseconds) > 0) {
+        char buf[1024];
+        const auto n = recv(fd, buf, sizeof(buf), 0);
+        http = n >= 4 && (std::memcmp(buf, "GET ", 4) == 0 || std::memcmp(buf, "HEAD", 4) == 0);
+    }
+
+    const auto body = Render();
+    if (http)
+        WriteAll(fd, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n");
+    WriteAll(fd, body);
+}
+#endif
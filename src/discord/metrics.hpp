@@ -0,0 +1,140 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// counters, gauges and histograms for watching how much work the client is doing over a long session
+// everything is rendered in the prometheus text format, either for the debug window or for whatever scrapes the socket
+class Metrics {
+public:
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+
+    enum class Type {
+        Counter,
+        Gauge,
+        Histogram,
+    };
+
+    class Counter {
+    public:
+        void Inc(uint64_t n = 1) {
+            m_value.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] uint64_t Value() const {
+            return m_value.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<uint64_t> m_value = 0;
+    };
+
+    class Gauge {
+    public:
+        void Set(double value);
+        void Add(double delta);
+        [[nodiscard]] double Value() const;
+
+    private:
+        std::atomic<double> m_value = 0.0;
+    };
+
+    // latencies in seconds
+    class Histogram {
+    public:
+        constexpr static std::array<double, 14> Bounds { 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 5.0 };
+        using bucket_counts = std::array<uint64_t, Bounds.size() + 1>; // the last one is +Inf
+
+        void Observe(double seconds);
+        [[nodiscard]] bucket_counts GetCumulative() const;
+        [[nodiscard]] double Sum() const;
+
+    private:
+        std::array<std::atomic<uint64_t>, Bounds.size() + 1> m_buckets {};
+        std::atomic<double> m_sum = 0.0;
+    };
+
+    // observes how long it was alive
+    class Timer {
+    public:
+        explicit Timer(Histogram &histogram);
+        ~Timer();
+
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
+
+    private:
+        Histogram &m_histogram;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    struct Sample {
+        std::string Name;
+        std::string Labels; // rendered, like {a="b"}
+        Type Kind;
+        double Value;   // counters and gauges
+        uint64_t Count; // histograms
+        double Sum;     // histograms
+    };
+
+    static Metrics &Get();
+
+    // the same name and labels always give back the same metric
+    // look it up once and hold on to it on hot paths, every lookup takes a lock
+    Counter &GetCounter(const std::string &name, const std::string &help, const Labels &labels = {});
+    Gauge &GetGauge(const std::string &name, const std::string &help, const Labels &labels = {});
+    Histogram &GetHistogram(const std::string &name, const std::string &help, const Labels &labels = {});
+
+    // for values that are easier to sample than to track, run before every render on whatever thread is rendering
+    void AddCollector(std::function<void()> collector);
+
+    [[nodiscard]] std::string Render();
+    [[nodiscard]] std::vector<Sample> GetSamples();
+
+    // answers every connection to a unix socket at path with Render
+    // as an http response if it sends a request (curl --unix-socket, prometheus through a proxy) or as plain text if it doesnt (socat)
+    bool Serve(const std::string &path);
+    void StopServing();
+
+private:
+    Metrics() = default;
+    ~Metrics();
+
+    constexpr static int PollMilliseconds = 250;        // how long stopping can take
+    constexpr static int RequestWaitMilliseconds = 100; // for a client to say something before it gets plain text
+
+    struct Family {
+        Type Kind;
+        std::string Help;
+        // keyed by rendered labels
+        std::map<std::string, std::unique_ptr<Counter>> Counters;
+        std::map<std::string, std::unique_ptr<Gauge>> Gauges;
+        std::map<std::string, std::unique_ptr<Histogram>> Histograms;
+    };
+
+    Family &GetFamily(const std::string &name, const std::string &help, Type kind); // with m_mutex held
+    static std::string RenderLabels(const Labels &labels);
+    void RunCollectors();
+    void ServeThread();
+    void Respond(int fd);
+
+    std::mutex m_mutex;
+    std::map<std::string, Family> m_families;
+
+    std::mutex m_collectors_mutex;
+    std::vector<std::function<void()>> m_collectors;
+
+    std::thread m_server;
+    std::atomic<bool> m_serving = false;
+    int m_listen_fd = -1;
+    std::string m_socket_path;
+};
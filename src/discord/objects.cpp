@@ -124,7 +124,14 @@ void to_json(nlohmann::json &j, const RequestGuildMembersMessage &m) {
     j["d"] = nlohmann::json::object();
     j["d"]["guild_id"] = m.GuildID;
     j["d"]["presences"] = m.Presences;
-    j["d"]["user_ids"] = m.UserIDs;
+    if (m.Query.has_value()) {
+        j["d"]["query"] = *m.Query;
+        j["d"]["limit"] = m.Limit.value_or(0);
+    } else {
+        j["d"]["user_ids"] = m.UserIDs;
+    }
+    if (m.Nonce.has_value())
+        j["d"]["nonce"] = *m.Nonce;
 }
 
 void from_json(const nlohmann::json &j, ReadStateEntry &m) {
@@ -210,6 +217,7 @@ void from_json(const nlohmann::json &j, ReadyEventData &m) {
     JS_D("user", m.SelfUser);
     JS_D("guilds", m.Guilds);
     JS_D("session_id", m.SessionID);
+    JS_O("resume_gateway_url", m.ResumeGatewayURL);
     JS_O("analytics_token", m.AnalyticsToken);
     JS_O("friend_suggestion_count", m.FriendSuggestionCount);
     JS_D("user_settings", m.Settings);
@@ -288,6 +296,8 @@ void to_json(nlohmann::json &j, const CreateMessageObject &m) {
     j["content"] = m.Content;
     JS_IF("message_reference", m.MessageReference);
     JS_IF("nonce", m.Nonce);
+    if (m.EnforceNonce)
+        j["enforce_nonce"] = true;
 }
 
 void to_json(nlohmann::json &j, const MessageEditObject &m) {
@@ -639,4 +649,5 @@ void from_json(const nlohmann::json &j, UserGuildSettingsUpdateData &m) {
 void from_json(const nlohmann::json &j, GuildMembersChunkData &m) {
     JS_D("members", m.Members);
     JS_D("guild_id", m.GuildID);
+    JS_ON("nonce", m.Nonce);
 }
@@ -100,6 +100,7 @@ enum class GatewayEvent : int {
     MESSAGE_ACK,
     USER_GUILD_SETTINGS_UPDATE,
     GUILD_MEMBERS_CHUNK,
+    RESUMED,
 };
 
 enum class GatewayCloseCode : uint16_t {
@@ -250,6 +251,10 @@ struct RequestGuildMembersMessage {
     Snowflake GuildID;
     bool Presences;
     std::vector<Snowflake> UserIDs;
+    // either user ids or a username prefix to search for
+    std::optional<std::string> Query;
+    std::optional<int> Limit;
+    std::optional<std::string> Nonce; // sent back in GUILD_MEMBERS_CHUNK
 
     friend void to_json(nlohmann::json &j, const RequestGuildMembersMessage &m);
 };
@@ -312,6 +317,7 @@ struct ReadyEventData {
     UserData SelfUser;
     std::vector<GuildData> Guilds;
     std::string SessionID;
+    std::optional<std::string> ResumeGatewayURL;
     std::vector<ChannelData> PrivateChannels;
 
     // undocumented
@@ -408,6 +414,7 @@ struct CreateMessageObject {
     std::string Content;
     std::optional<MessageReferenceData> MessageReference;
     std::optional<std::string> Nonce;
+    bool EnforceNonce = false; // discord drops a second message with the same nonce instead of posting it twice
 
     friend void to_json(nlohmann::json &j, const CreateMessageObject &m);
 };
@@ -861,6 +868,7 @@ struct GuildMembersChunkData {
     */
     Snowflake GuildID;
     std::vector<GuildMember> Members;
+    std::optional<std::string> Nonce;
 
     friend void from_json(const nlohmann::json &j, GuildMembersChunkData &m);
 };
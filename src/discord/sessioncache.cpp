@@ -0,0 +1,307 @@
+#include "sessioncache.hpp"
+#include "log.hpp"
+#include "tracer.hpp"
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+#include <nlohmann/json.hpp>
+#include "util.hpp"
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <sys/stat.h>
+#else
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+SessionCache::SessionCache() {
+    m_thread = std::thread([this] { loop(); });
+}
+
+SessionCache::~SessionCache() {
+    CloseJournal();
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void SessionCache::SetDirectory(std::string path) {
+    if (path == m_dir) return;
+    if (path.empty())
+        Discard(); // turned off, dont leave the last one lying around
+    CloseJournal();
+    Wait();
+    m_dir = std::move(path);
+}
+
+bool SessionCache::IsEnabled() const {
+    return !m_dir.empty();
+}
+
+void SessionCache::BeginJournal(const std::string &ready) {
+    if (!IsEnabled()) return;
+    Queue([this, ready] {
+        CloseJournalNow();
+        std::error_code ec;
+        std::filesystem::create_directories(m_dir, ec);
+        // level 1, most of it is ready which is compressed once and every other message is tiny
+        OpenJournal("wb1");
+        if (m_journal == nullptr) return;
+        m_journal_size = 0;
+        Write(ready);
+    });
+}
+
+void SessionCache::ReopenJournal() {
+    if (!IsEnabled()) return;
+    Queue([this] {
+        CloseJournalNow();
+        // zlib reads concatenated gzip members as one stream so appending a new member is fine
+        OpenJournal("ab1");
+    });
+}
+
+void SessionCache::Append(const std::string &message) {
+    if (!IsEnabled()) return;
+    Queue([this, message] {
+        if (m_journal != nullptr)
+            Write(message);
+    });
+}
+
+void SessionCache::CloseJournal() {
+    Queue([this] { CloseJournalNow(); });
+}
+
+bool SessionCache::Save(const Session &session) {
+    // the session is only good if every message before it made it into the journal
+    bool closed = false;
+    Queue([this, &closed] {
+        if (m_journal == nullptr) return;
+        closed = gzclose(m_journal) == Z_OK;
+        m_journal = nullptr;
+    });
+    Wait();
+    if (!closed) return false;
+
+    nlohmann::json j;
+    j["session_id"] = session.SessionID;
+    j["seq"] = session.Sequence;
+    j["resume_url"] = session.ResumeURL;
+    j["user_id"] = session.UserID;
+    j["token_hash"] = session.TokenHash;
+    j["saved_at"] = session.SavedAt;
+    const auto s = j.dump();
+
+    const int fd = OpenPrivate(GetSessionPath(), false);
+    if (fd < 0) return false;
+    auto *fp = fdopen(fd, "wb");
+    if (fp == nullptr) {
+        close(fd);
+        return false;
+    }
+    const bool ok = std::fwrite(s.c_str(), 1, s.size(), fp) == s.size();
+    std::fclose(fp);
+    return ok;
+}
+
+std::optional<SessionCache::Session> SessionCache::Take(const std::string &token) {
+    if (!IsEnabled()) return std::nullopt;
+
+    const auto data = ReadWholeFile(GetSessionPath());
+    std::error_code ec;
+    std::filesystem::remove(GetSessionPath(), ec);
+    if (data.empty()) return std::nullopt;
+
+    Session session;
+    try {
+        const auto j = nlohmann::json::parse(data.begin(), data.end());
+        j.at("session_id").get_to(session.SessionID);
+        j.at("seq").get_to(session.Sequence);
+        j.at("resume_url").get_to(session.ResumeURL);
+        j.at("user_id").get_to(session.UserID);
+        j.at("token_hash").get_to(session.TokenHash);
+        j.at("saved_at").get_to(session.SavedAt);
+    } catch (const std::exception &e) {
+        LOG_ERROR(Session, "failed to read saved session: %s", e.what());
+        return std::nullopt;
+    }
+
+    const auto now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if (session.TokenHash != HashToken(token)) return std::nullopt;
+    if (now - session.SavedAt > MaxSessionAgeSeconds || now < session.SavedAt) {
+        LOG_INFO(Session, "saved session is %" PRId64 "s old, not resuming", static_cast<int64_t>(now - session.SavedAt));
+        return std::nullopt;
+    }
+    if (session.SessionID.empty() || session.Sequence < 0 || session.ResumeURL.empty()) return std::nullopt;
+
+    return session;
+}
+
+void SessionCache::Replay(std::function<void(std::vector<std::string>)> batch, std::function<void(bool)> done) {
+    if (!IsEnabled()) {
+        Queue([done = std::move(done)] { done(false); });
+        return;
+    }
+
+    Queue([this, batch = std::move(batch), done = std::move(done)] {
+        CloseJournalNow();
+        gzFile file = gzopen(GetJournalPath().c_str(), "rb");
+        if (file == nullptr) {
+            done(false);
+            return;
+        }
+        gzbuffer(file, JournalBufferSize);
+
+        bool ok = true;
+        size_t total = 0;
+        size_t batch_size = 0;
+        std::vector<std::string> messages;
+        while (true) {
+            uint32_t size;
+            const int n = gzread(file, &size, sizeof(size));
+            if (n == 0) break;
+            if (n != sizeof(size) || size > MaxJournalSize) {
+                ok = false;
+                break;
+            }
+            std::string message(size, '\0');
+            if (gzread(file, message.data(), size) != static_cast<int>(size)) {
+                ok = false;
+                break;
+            }
+            total += size;
+            batch_size += size;
+            messages.push_back(std::move(message));
+            if (batch_size >= ReplayBatchBytes) {
+                batch(std::move(messages));
+                messages = {};
+                batch_size = 0;
+            }
+        }
+        gzclose(file);
+        if (!messages.empty())
+            batch(std::move(messages));
+
+        m_journal_size = total;
+        done(ok && total > 0);
+    });
+}
+
+void SessionCache::Discard() {
+    if (!IsEnabled()) return;
+    Queue([this] { DiscardNow(); });
+}
+
+uint64_t SessionCache::HashToken(const std::string &token) {
+    // fnv-1a, only has to tell tokens apart without keeping one on disk
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (const unsigned char c : token) {
+        hash ^= c;
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+std::string SessionCache::GetJournalPath() const {
+    return m_dir + "/session.journal.gz";
+}
+
+std::string SessionCache::GetSessionPath() const {
+    return m_dir + "/session.json";
+}
+
+int SessionCache::OpenPrivate(const std::string &path, bool append) {
+    // these have the session and everything the account received, nobody else gets to read them even for a moment
+#ifdef _WIN32
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_BINARY | (append ? _O_APPEND : _O_TRUNC), _S_IREAD | _S_IWRITE);
+#else
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC), S_IRUSR | S_IWUSR);
+    // left over from before this was created private
+    if (fd >= 0) fchmod(fd, S_IRUSR | S_IWUSR);
+    return fd;
+#endif
+}
+
+void SessionCache::OpenJournal(const char *mode) {
+    const int fd = OpenPrivate(GetJournalPath(), mode[0] == 'a');
+    if (fd >= 0) m_journal = gzdopen(fd, mode);
+    if (m_journal == nullptr) {
+        if (fd >= 0) close(fd);
+        LOG_ERROR(Session, "failed to open session journal");
+        return;
+    }
+    gzbuffer(m_journal, JournalBufferSize);
+}
+
+void SessionCache::CloseJournalNow() {
+    if (m_journal == nullptr) return;
+    gzclose(m_journal);
+    m_journal = nullptr;
+}
+
+void SessionCache::DiscardNow() {
+    CloseJournalNow();
+    std::error_code ec;
+    std::filesystem::remove(GetSessionPath(), ec);
+    std::filesystem::remove(GetJournalPath(), ec);
+}
+
+bool SessionCache::Write(const std::string &message) {
+    m_journal_size += message.size();
+    if (m_journal_size > MaxJournalSize) {
+        LOG_WARN(Session, "session journal is too big, session wont be resumable");
+        DiscardNow();
+        return false;
+    }
+
+    const auto size = static_cast<uint32_t>(message.size());
+    if (gzwrite(m_journal, &size, sizeof(size)) != sizeof(size) ||
+        gzwrite(m_journal, message.data(), size) != static_cast<int>(size)) {
+        LOG_ERROR(Session, "failed to write session journal");
+        DiscardNow();
+        return false;
+    }
+    return true;
+}
+
+void SessionCache::Queue(std::function<void()> work) {
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+        m_queue.push_back(std::move(work));
+    }
+    m_cv.notify_one();
+}
+
+void SessionCache::Wait() {
+    std::unique_lock<std::mutex> l(m_mutex);
+    m_idle_cv.wait(l, [this] { return m_queue.empty() && !m_busy; });
+}
+
+void SessionCache::loop() {
+    Tracer::SetThreadName("session journal");
+    while (true) {
+        std::function<void()> work;
+        {
+            std::unique_lock<std::mutex> l(m_mutex);
+            m_cv.wait(l, [this] { return m_stop || !m_queue.empty(); });
+            // whatever was queued still runs, closing the journal at exit is queued too
+            if (m_queue.empty()) return;
+            work = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_busy = true;
+        }
+        work();
+        {
+            std::lock_guard<std::mutex> l(m_mutex);
+            m_busy = false;
+        }
+        m_idle_cv.notify_all();
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+#include "snowflake.hpp"
+
+// keeps what is needed to resume a gateway session after the process restarts
+// resuming only replays what was missed so ready and every dispatch after it are journaled to rebuild the state locally first
+// that means message contents, dms included, sit on disk until the session is resumed or thrown away
+// the journal is written and read on its own thread, nothing here blocks on compression except Save
+class SessionCache {
+public:
+    struct Session {
+        std::string SessionID;
+        int Sequence = -1;
+        std::string ResumeURL;
+        Snowflake UserID;
+        uint64_t TokenHash = 0; // dont resume someone elses session if the token changed
+        int64_t SavedAt = 0;    // unix seconds
+    };
+
+    SessionCache();
+    ~SessionCache();
+
+    SessionCache(const SessionCache &) = delete;
+    SessionCache &operator=(const SessionCache &) = delete;
+
+    // empty disables everything
+    void SetDirectory(std::string path);
+    [[nodiscard]] bool IsEnabled() const;
+
+    // truncates and starts over from this ready
+    void BeginJournal(const std::string &ready);
+    // continue after a replay
+    void ReopenJournal();
+    void Append(const std::string &message);
+    void CloseJournal();
+
+    // closes the journal and writes the session next to it, waits for everything queued before it
+    bool Save(const Session &session);
+    // the saved session is removed on read, a session is only ever tried once
+    std::optional<Session> Take(const std::string &token);
+    // decompresses the journal on its thread, batch gets the messages in the order they were received a few at a time
+    // done gets false if the journal was incomplete, both are called on the journal thread
+    void Replay(std::function<void(std::vector<std::string>)> batch, std::function<void(bool)> done);
+    void Discard();
+
+    static uint64_t HashToken(const std::string &token);
+
+private:
+    constexpr static size_t MaxJournalSize = 256 * 1024 * 1024; // uncompressed, starting over with identify is cheaper after this
+    constexpr static int64_t MaxSessionAgeSeconds = 5 * 60;     // discord wont have kept it around longer than this anyways
+    constexpr static unsigned JournalBufferSize = 256 * 1024;
+    constexpr static size_t ReplayBatchBytes = 1024 * 1024; // roughly, ready usually goes in a batch of its own
+
+    [[nodiscard]] std::string GetJournalPath() const;
+    [[nodiscard]] std::string GetSessionPath() const;
+    // write only, owner only, returns a file descriptor or -1
+    static int OpenPrivate(const std::string &path, bool append);
+
+    // journal thread only
+    void OpenJournal(const char *mode);
+    void CloseJournalNow();
+    void DiscardNow();
+    bool Write(const std::string &message);
+
+    void Queue(std::function<void()> work);
+    void Wait(); // until everything queued so far is done
+    void loop();
+
+    std::string m_dir; // only changed while the journal thread is idle
+    gzFile m_journal = nullptr;
+    size_t m_journal_size = 0;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::condition_variable m_idle_cv;
+    std::deque<std::function<void()>> m_queue;
+    bool m_busy = false;
+    bool m_stop = false;
+};
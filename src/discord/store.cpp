@@ -1,28 +1,35 @@
 #include "store.hpp"
+#include "log.hpp"
+#include "tracer.hpp"
+#include <algorithm>
 #include <cinttypes>
 
 using namespace std::literals::string_literals;
 
 // hopefully the casting between signed and unsigned int64 doesnt cause issues
 
-Store::Store(bool mem_store)
+Store::Store(bool mem_store, const std::string &outbox_path)
     : m_db_path(mem_store ? ":memory:" : std::filesystem::temp_directory_path() / "abaddon-store.db")
     , m_db(m_db_path.string().c_str()) {
     if (!m_db.OK()) {
-        fprintf(stderr, "error opening database: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "error opening database: %s", m_db.ErrStr());
         return;
     }
 
     if (m_db.Execute("PRAGMA journal_mode = WAL") != SQLITE_OK) {
-        fprintf(stderr, "enabling write-ahead-log failed: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "enabling write-ahead-log failed: %s", m_db.ErrStr());
         return;
     }
 
     if (m_db.Execute("PRAGMA synchronous = NORMAL") != SQLITE_OK) {
-        fprintf(stderr, "setting synchronous failed: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "setting synchronous failed: %s", m_db.ErrStr());
         return;
     }
 
+    // a failure here only means unsent messages dont survive a restart
+    if (!outbox_path.empty())
+        AttachOutbox(outbox_path);
+
     m_ok &= CreateTables();
     m_ok &= CreateStatements();
 }
@@ -30,7 +37,7 @@ Store::Store(bool mem_store)
 Store::~Store() {
     m_db.Close();
     if (!m_db.OK()) {
-        fprintf(stderr, "error closing database: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "error closing database: %s", m_db.ErrStr());
         return;
     }
 
@@ -52,12 +59,16 @@ void Store::SetBan(Snowflake guild_id, Snowflake user_id, const BanData &ban) {
     s->Bind(3, ban.Reason);
 
     if (!s->Insert())
-        fprintf(stderr, "ban insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(guild_id), static_cast<uint64_t>(user_id), m_db.ErrStr());
+        LOG_ERROR(Store, "ban insert failed for %" PRIu64 "/%" PRIu64 ": %s", static_cast<uint64_t>(guild_id), static_cast<uint64_t>(user_id), m_db.ErrStr());
 
     s->Reset();
 }
 
 void Store::SetChannel(Snowflake id, const ChannelData &chan) {
+    m_channel_snapshots.erase(id);
+    if (chan.GuildID.has_value())
+        m_guild_snapshots.erase(*chan.GuildID);
+
     auto &s = m_stmt_set_chan;
 
     s->Bind(1, id);
@@ -87,7 +98,7 @@ void Store::SetChannel(Snowflake id, const ChannelData &chan) {
     }
 
     if (!s->Insert())
-        fprintf(stderr, "channel insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+        LOG_ERROR(Store, "channel insert failed for %" PRIu64 ": %s", static_cast<uint64_t>(id), m_db.ErrStr());
 
     if (chan.Recipients.has_value()) {
         BeginTransaction();
@@ -96,7 +107,7 @@ void Store::SetChannel(Snowflake id, const ChannelData &chan) {
             s->Bind(1, chan.ID);
             s->Bind(2, r.ID);
             if (!s->Insert())
-                fprintf(stderr, "recipient insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(chan.ID), static_cast<uint64_t>(r.ID), m_db.ErrStr());
+                LOG_ERROR(Store, "recipient insert failed for %" PRIu64 "/%" PRIu64 ": %s", static_cast<uint64_t>(chan.ID), static_cast<uint64_t>(r.ID), m_db.ErrStr());
             s->Reset();
         }
         EndTransaction();
@@ -107,7 +118,7 @@ void Store::SetChannel(Snowflake id, const ChannelData &chan) {
             s->Bind(1, chan.ID);
             s->Bind(2, id);
             if (!s->Insert())
-                fprintf(stderr, "recipient insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(chan.ID), static_cast<uint64_t>(id), m_db.ErrStr());
+                LOG_ERROR(Store, "recipient insert failed for %" PRIu64 "/%" PRIu64 ": %s", static_cast<uint64_t>(chan.ID), static_cast<uint64_t>(id), m_db.ErrStr());
             s->Reset();
         }
         EndTransaction();
@@ -117,6 +128,8 @@ void Store::SetChannel(Snowflake id, const ChannelData &chan) {
 }
 
 void Store::SetEmoji(Snowflake id, const EmojiData &emoji) {
+    m_guild_snapshots.clear();
+
     auto &s = m_stmt_set_emoji;
 
     s->Bind(1, id);
@@ -139,7 +152,7 @@ void Store::SetEmoji(Snowflake id, const EmojiData &emoji) {
             s->Bind(1, id);
             s->Bind(2, r);
             if (!s->Insert())
-                fprintf(stderr, "emoji role insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(id), static_cast<uint64_t>(r), m_db.ErrStr());
+                LOG_ERROR(Store, "emoji role insert failed for %" PRIu64 "/%" PRIu64 ": %s", static_cast<uint64_t>(id), static_cast<uint64_t>(r), m_db.ErrStr());
             s->Reset();
         }
 
@@ -147,12 +160,15 @@ void Store::SetEmoji(Snowflake id, const EmojiData &emoji) {
     }
 
     if (!s->Insert())
-        fprintf(stderr, "emoji insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+        LOG_ERROR(Store, "emoji insert failed for %" PRIu64 ": %s", static_cast<uint64_t>(id), m_db.ErrStr());
 
     s->Reset();
 }
 
 void Store::SetGuild(Snowflake id, const GuildData &guild) {
+    m_guild_snapshots.erase(id);
+    InvalidateGuildRoles(id);
+
     BeginTransaction();
     auto &s = m_stmt_set_guild;
 
@@ -193,7 +209,7 @@ void Store::SetGuild(Snowflake id, const GuildData &guild) {
     s->Bind(35, guild.IsLazy);
 
     if (!s->Insert())
-        fprintf(stderr, "guild insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(guild.ID), m_db.ErrStr());
+        LOG_ERROR(Store, "guild insert failed for %" PRIu64 ": %s", static_cast<uint64_t>(guild.ID), m_db.ErrStr());
 
     s->Reset();
 
@@ -203,7 +219,7 @@ void Store::SetGuild(Snowflake id, const GuildData &guild) {
             s->Bind(1, guild.ID);
             s->Bind(2, emoji.ID);
             if (!s->Insert())
-                fprintf(stderr, "guild emoji insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(guild.ID), static_cast<uint64_t>(emoji.ID), m_db.ErrStr());
+                LOG_ERROR(Store, "guild emoji insert failed for %" PRIu64 "/%" PRIu64 ": %s", static_cast<uint64_t>(guild.ID), static_cast<uint64_t>(emoji.ID), m_db.ErrStr());
             s->Reset();
         }
     }
@@ -215,7 +231,7 @@ void Store::SetGuild(Snowflake id, const GuildData &guild) {
             s->Bind(1, guild.ID);
             s->Bind(2, feature);
             if (!s->Insert())
-                fprintf(stderr, "guild feature insert failed for %" PRIu64 "/%s: %s\n", static_cast<uint64_t>(guild.ID), feature.c_str(), m_db.ErrStr());
+                LOG_ERROR(Store, "guild feature insert failed for %" PRIu64 "/%s: %s", static_cast<uint64_t>(guild.ID), feature.c_str(), m_db.ErrStr());
             s->Reset();
         }
     }
@@ -227,7 +243,7 @@ void Store::SetGuild(Snowflake id, const GuildData &guild) {
             s->Bind(1, guild.ID);
             s->Bind(2, thread.ID);
             if (!s->Insert())
-                fprintf(stderr, "guild thread insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(guild.ID), static_cast<uint64_t>(thread.ID), m_db.ErrStr());
+                LOG_ERROR(Store, "guild thread insert failed for %" PRIu64 "/%" PRIu64 ": %s", static_cast<uint64_t>(guild.ID), static_cast<uint64_t>(thread.ID), m_db.ErrStr());
             s->Reset();
         }
     }
@@ -236,6 +252,11 @@ void Store::SetGuild(Snowflake id, const GuildData &guild) {
 }
 
 void Store::SetGuildMember(Snowflake guild_id, Snowflake user_id, const GuildMember &data) {
+    if (const auto it = m_member_snapshots.find(guild_id); it != m_member_snapshots.end())
+        it->second.erase(user_id);
+    if (const auto it = m_member_roles.find(guild_id); it != m_member_roles.end())
+        it->second.erase(user_id);
+
     auto &s = m_stmt_set_member;
 
     s->Bind(1, user_id);
@@ -249,7 +270,7 @@ void Store::SetGuildMember(Snowflake guild_id, Snowflake user_id, const GuildMem
     s->Bind(9, data.IsPending);
 
     if (!s->Insert())
-        fprintf(stderr, "member insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(user_id), static_cast<uint64_t>(guild_id), m_db.ErrStr());
+        LOG_ERROR(Store, "member insert failed for %" PRIu64 "/%" PRIu64 ": %s", static_cast<uint64_t>(user_id), static_cast<uint64_t>(guild_id), m_db.ErrStr());
 
     s->Reset();
 
@@ -269,8 +290,8 @@ void Store::SetGuildMember(Snowflake guild_id, Snowflake user_id, const GuildMem
             s->Bind(1, user_id);
             s->Bind(2, role);
             if (!s->Insert())
-                fprintf(stderr, "member role insert failed for %" PRIu64 "/%" PRIu64 "/%" PRIu64 ": %s\n",
-                        static_cast<uint64_t>(user_id), static_cast<uint64_t>(guild_id), static_cast<uint64_t>(role), m_db.ErrStr());
+                LOG_ERROR(Store, "member role insert failed for %" PRIu64 "/%" PRIu64 "/%" PRIu64 ": %s",
+                          static_cast<uint64_t>(user_id), static_cast<uint64_t>(guild_id), static_cast<uint64_t>(role), m_db.ErrStr());
             s->Reset();
         }
         EndTransaction();
@@ -278,6 +299,8 @@ void Store::SetGuildMember(Snowflake guild_id, Snowflake user_id, const GuildMem
 }
 
 void Store::SetMessageInteractionPair(Snowflake message_id, const MessageInteractionData &interaction) {
+    InvalidateMessageSnapshot(message_id);
+
     auto &s = m_stmt_set_interaction;
 
     s->Bind(1, message_id);
@@ -287,12 +310,14 @@ void Store::SetMessageInteractionPair(Snowflake message_id, const MessageInterac
     s->Bind(5, interaction.User.ID);
 
     if (!s->Insert())
-        fprintf(stderr, "message interaction failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(message_id), m_db.ErrStr());
+        LOG_ERROR(Store, "message interaction failed for %" PRIu64 ": %s", static_cast<uint64_t>(message_id), m_db.ErrStr());
 
     s->Reset();
 }
 
 void Store::SetMessage(Snowflake id, const Message &message) {
+    InvalidateMessageSnapshot(id);
+
     auto &s = m_stmt_set_msg;
 
     BeginTransaction();
@@ -320,7 +345,7 @@ void Store::SetMessage(Snowflake id, const Message &message) {
     s->BindAsJSON(21, message.StickerItems);
 
     if (!s->Insert())
-        fprintf(stderr, "message insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+        LOG_ERROR(Store, "message insert failed for %" PRIu64 ": %s", static_cast<uint64_t>(id), m_db.ErrStr());
 
     s->Reset();
 
@@ -332,7 +357,7 @@ void Store::SetMessage(Snowflake id, const Message &message) {
         s->Bind(4, message.MessageReference->GuildID);
 
         if (!s->Insert())
-            fprintf(stderr, "message ref insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+            LOG_ERROR(Store, "message ref insert failed for %" PRIu64 ": %s", static_cast<uint64_t>(id), m_db.ErrStr());
 
         s->Reset();
     }
@@ -342,7 +367,7 @@ void Store::SetMessage(Snowflake id, const Message &message) {
         s->Bind(1, id);
         s->Bind(2, u.ID);
         if (!s->Insert())
-            fprintf(stderr, "message mention insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(id), static_cast<uint64_t>(u.ID), m_db.ErrStr());
+            LOG_ERROR(Store, "message mention insert failed for %" PRIu64 "/%" PRIu64 ": %s", static_cast<uint64_t>(id), static_cast<uint64_t>(u.ID), m_db.ErrStr());
         s->Reset();
     }
 
@@ -357,7 +382,7 @@ void Store::SetMessage(Snowflake id, const Message &message) {
         s->Bind(7, a.Height);
         s->Bind(8, a.Width);
         if (!s->Insert())
-            fprintf(stderr, "message attachment insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(id), static_cast<uint64_t>(a.ID), m_db.ErrStr());
+            LOG_ERROR(Store, "message attachment insert failed for %" PRIu64 "/%" PRIu64 ": %s", static_cast<uint64_t>(id), static_cast<uint64_t>(a.ID), m_db.ErrStr());
         s->Reset();
     }
 
@@ -372,7 +397,7 @@ void Store::SetMessage(Snowflake id, const Message &message) {
             s->Bind(5, reaction.HasReactedWith);
             s->Bind(6, i);
             if (!s->Insert())
-                fprintf(stderr, "message reaction insert failed for %" PRIu64 "/%" PRIu64 "/%s: %s\n", static_cast<uint64_t>(id), static_cast<uint64_t>(reaction.Emoji.ID), reaction.Emoji.Name.c_str(), m_db.ErrStr());
+                LOG_ERROR(Store, "message reaction insert failed for %" PRIu64 "/%" PRIu64 "/%s: %s", static_cast<uint64_t>(id), static_cast<uint64_t>(reaction.Emoji.ID), reaction.Emoji.Name.c_str(), m_db.ErrStr());
             s->Reset();
         }
     }
@@ -393,12 +418,16 @@ void Store::SetPermissionOverwrite(Snowflake channel_id, Snowflake id, const Per
     s->Bind(5, perm.Deny);
 
     if (!s->Insert())
-        fprintf(stderr, "permission insert failed for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(channel_id), static_cast<uint64_t>(id), m_db.ErrStr());
+        LOG_ERROR(Store, "permission insert failed for %" PRIu64 "/%" PRIu64 ": %s", static_cast<uint64_t>(channel_id), static_cast<uint64_t>(id), m_db.ErrStr());
 
     s->Reset();
 }
 
 void Store::SetRole(Snowflake guild_id, const RoleData &role) {
+    m_role_snapshots.erase(role.ID);
+    m_guild_snapshots.erase(guild_id);
+    InvalidateGuildRoles(guild_id);
+
     auto &s = m_stmt_set_role;
 
     s->Bind(1, role.ID);
@@ -412,12 +441,19 @@ void Store::SetRole(Snowflake guild_id, const RoleData &role) {
     s->Bind(9, role.IsMentionable);
 
     if (!s->Insert())
-        fprintf(stderr, "role insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(role.ID), m_db.ErrStr());
+        LOG_ERROR(Store, "role insert failed for %" PRIu64 ": %s", static_cast<uint64_t>(role.ID), m_db.ErrStr());
 
     s->Reset();
 }
 
 void Store::SetUser(Snowflake id, const UserData &user) {
+    m_user_snapshots.erase(id);
+    if (const auto it = m_snapshot_mentions.find(id); it != m_snapshot_mentions.end()) {
+        for (const auto message_id : it->second)
+            m_message_snapshots.erase(message_id);
+        m_snapshot_mentions.erase(it);
+    }
+
     auto &s = m_stmt_set_user;
 
     s->Bind(1, id);
@@ -431,11 +467,165 @@ void Store::SetUser(Snowflake id, const UserData &user) {
     s->Bind(9, user.PublicFlags);
 
     if (!s->Insert())
-        fprintf(stderr, "user insert failed for %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+        LOG_ERROR(Store, "user insert failed for %" PRIu64 ": %s", static_cast<uint64_t>(id), m_db.ErrStr());
 
     s->Reset();
 }
 
+// plenty for everything on screen, past this the map is just dropped since callers keep their own references
+constexpr static size_t MaxSnapshots = 8192;
+
+Store::SnapshotCounters Store::MakeSnapshotCounters(const char *kind) {
+    auto &metrics = Metrics::Get();
+    return {
+        metrics.GetCounter("abaddon_store_snapshot_lookups_total", "snapshot cache lookups, by object kind and whether it was cached", { { "kind", kind }, { "result", "hit" } }),
+        metrics.GetCounter("abaddon_store_snapshot_lookups_total", "snapshot cache lookups, by object kind and whether it was cached", { { "kind", kind }, { "result", "miss" } }),
+    };
+}
+
+template<typename T, typename F>
+std::shared_ptr<const T> Store::GetSnapshot(snapshot_map<T> &map, Snowflake id, const SnapshotCounters &counters, const F &load) {
+    if (const auto it = map.find(id); it != map.end()) {
+        counters.Hits.Inc();
+        return it->second;
+    }
+
+    counters.Misses.Inc();
+    auto data = load();
+    if (!data.has_value()) return nullptr;
+    if (map.size() >= MaxSnapshots) map.clear();
+    auto snapshot = std::make_shared<const T>(std::move(*data));
+    map[id] = snapshot;
+    return snapshot;
+}
+
+std::shared_ptr<const ChannelData> Store::GetChannelSnapshot(Snowflake id) const {
+    static const auto counters = MakeSnapshotCounters("channel");
+    return GetSnapshot(m_channel_snapshots, id, counters, [this, id] { return GetChannel(id); });
+}
+
+std::shared_ptr<const GuildData> Store::GetGuildSnapshot(Snowflake id) const {
+    static const auto counters = MakeSnapshotCounters("guild");
+    return GetSnapshot(m_guild_snapshots, id, counters, [this, id] { return GetGuild(id); });
+}
+
+std::shared_ptr<const GuildMember> Store::GetGuildMemberSnapshot(Snowflake guild_id, Snowflake user_id) const {
+    static const auto counters = MakeSnapshotCounters("member");
+    return GetSnapshot(m_member_snapshots[guild_id], user_id, counters, [this, guild_id, user_id] { return GetGuildMember(guild_id, user_id); });
+}
+
+std::shared_ptr<const Message> Store::GetMessageSnapshot(Snowflake id) const {
+    static const auto counters = MakeSnapshotCounters("message");
+    if (const auto it = m_message_snapshots.find(id); it != m_message_snapshots.end()) {
+        counters.Hits.Inc();
+        return it->second;
+    }
+
+    // GetSnapshot would drop the map when its full, the indexes have to go with it
+    if (m_message_snapshots.size() >= MaxSnapshots) {
+        m_message_snapshots.clear();
+        m_snapshot_mentions.clear();
+        m_snapshot_replies.clear();
+    }
+    auto snapshot = GetSnapshot(m_message_snapshots, id, counters, [this, id] { return GetMessage(id); });
+    if (snapshot == nullptr) return nullptr;
+    for (const auto &user : snapshot->Mentions)
+        m_snapshot_mentions[user.ID].insert(id);
+    if (snapshot->MessageReference.has_value() && snapshot->MessageReference->MessageID.has_value())
+        m_snapshot_replies[*snapshot->MessageReference->MessageID].insert(id);
+    return snapshot;
+}
+
+std::shared_ptr<const RoleData> Store::GetRoleSnapshot(Snowflake id) const {
+    static const auto counters = MakeSnapshotCounters("role");
+    return GetSnapshot(m_role_snapshots, id, counters, [this, id] { return GetRole(id); });
+}
+
+std::shared_ptr<const UserData> Store::GetUserSnapshot(Snowflake id) const {
+    static const auto counters = MakeSnapshotCounters("user");
+    return GetSnapshot(m_user_snapshots, id, counters, [this, id] { return GetUser(id); });
+}
+
+void Store::InvalidateMessageSnapshot(Snowflake id) {
+    m_message_snapshots.erase(id);
+    if (const auto it = m_snapshot_replies.find(id); it != m_snapshot_replies.end()) {
+        for (const auto reply_id : it->second)
+            m_message_snapshots.erase(reply_id);
+        m_snapshot_replies.erase(it);
+    }
+}
+
+Store::MemberRoles Store::GetMemberRoles(Snowflake guild_id, Snowflake user_id) const {
+    if (!guild_id.IsValid()) return {}; // dms and such
+    if (const auto guild = m_member_roles.find(guild_id); guild != m_member_roles.end())
+        if (const auto it = guild->second.find(user_id); it != guild->second.end())
+            return it->second;
+
+    // only members we know about are cached, otherwise every stranger would leave an entry behind
+    const auto member = GetGuildMemberSnapshot(guild_id, user_id);
+    if (member == nullptr) return {};
+    auto &ret = m_member_roles[guild_id][user_id];
+
+    // lower rank is higher up
+    const auto &table = GetRoleTable(guild_id);
+    uint32_t hoisted = UINT32_MAX, color = UINT32_MAX, highest = UINT32_MAX;
+    for (const auto id : member->Roles) {
+        const auto it = table.Ranks.find(id);
+        if (it == table.Ranks.end()) continue;
+        const auto rank = it->second;
+        const auto &role = table.Roles[rank];
+        if (role.IsHoisted) hoisted = std::min(hoisted, rank);
+        if (role.HasColor) color = std::min(color, rank);
+        highest = std::min(highest, rank);
+    }
+
+    if (hoisted != UINT32_MAX) ret.HoistedRole = table.Roles[hoisted].ID;
+    if (color != UINT32_MAX) ret.ColorRole = table.Roles[color].ID;
+    if (highest != UINT32_MAX) {
+        ret.HighestRole = table.Roles[highest].ID;
+        ret.HighestPosition = table.Roles[highest].Position;
+    }
+    return ret;
+}
+
+const Store::RoleTable &Store::GetRoleTable(Snowflake guild_id) const {
+    if (const auto it = m_role_tables.find(guild_id); it != m_role_tables.end())
+        return it->second;
+
+    auto &table = m_role_tables[guild_id];
+    const auto guild = GetGuildSnapshot(guild_id);
+    if (guild == nullptr || !guild->Roles.has_value()) return table;
+
+    table.Roles.reserve(guild->Roles->size());
+    for (const auto &role : *guild->Roles)
+        table.Roles.push_back({ role.ID, role.Position, role.IsHoisted, role.HasColor() });
+    // equal positions go to the older role like the client does
+    std::sort(table.Roles.begin(), table.Roles.end(), [](const auto &a, const auto &b) {
+        if (a.Position != b.Position) return a.Position > b.Position;
+        return a.ID < b.ID;
+    });
+    table.Ranks.reserve(table.Roles.size());
+    for (size_t i = 0; i < table.Roles.size(); i++)
+        table.Ranks[table.Roles[i].ID] = static_cast<uint32_t>(i);
+    return table;
+}
+
+void Store::InvalidateGuildRoles(Snowflake guild_id) {
+    m_role_tables.erase(guild_id);
+    m_member_roles.erase(guild_id);
+}
+
+void Store::ClearSnapshots() {
+    m_channel_snapshots.clear();
+    m_guild_snapshots.clear();
+    m_member_snapshots.clear();
+    m_message_snapshots.clear();
+    m_snapshot_mentions.clear();
+    m_snapshot_replies.clear();
+    m_role_snapshots.clear();
+    m_user_snapshots.clear();
+}
+
 std::optional<BanData> Store::GetBan(Snowflake guild_id, Snowflake user_id) const {
     auto &s = m_stmt_get_ban;
 
@@ -443,7 +633,7 @@ std::optional<BanData> Store::GetBan(Snowflake guild_id, Snowflake user_id) cons
     s->Bind(2, user_id);
     if (!s->FetchOne()) {
         if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching ban for %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(guild_id), static_cast<uint64_t>(user_id), m_db.ErrStr());
+            LOG_ERROR(Store, "error while fetching ban for %" PRIu64 "/%" PRIu64 ": %s", static_cast<uint64_t>(guild_id), static_cast<uint64_t>(user_id), m_db.ErrStr());
         s->Reset();
         return {};
     }
@@ -584,6 +774,134 @@ std::vector<Snowflake> Store::GetChannelIDsWithParentID(Snowflake channel_id) co
     return ret;
 }
 
+std::vector<Store::MessageRange> Store::GetMessageRanges(Snowflake channel_id) const {
+    auto &s = m_stmt_get_msg_ranges;
+
+    s->Bind(1, channel_id);
+
+    std::vector<MessageRange> ret;
+    while (s->FetchOne()) {
+        auto &range = ret.emplace_back();
+        s->Get(0, range.Start);
+        s->Get(1, range.End);
+    }
+
+    s->Reset();
+
+    return ret;
+}
+
+std::optional<Store::MessageRange> Store::GetMessageRange(Snowflake channel_id, Snowflake message_id) const {
+    for (const auto &range : GetMessageRanges(channel_id))
+        if (range.Start <= message_id && message_id <= range.End)
+            return range;
+    return std::nullopt;
+}
+
+void Store::AddMessageRange(Snowflake channel_id, Snowflake start, Snowflake end) {
+    // pages are fetched relative to a message that is already in a range so contiguous ones always overlap
+    // existing ranges never overlap each other so one pass is enough
+    MessageRange merged { start, end };
+    std::vector<MessageRange> absorbed;
+    for (const auto &range : GetMessageRanges(channel_id)) {
+        if (range.Start <= merged.End && merged.Start <= range.End) {
+            merged.Start = std::min(merged.Start, range.Start);
+            merged.End = std::max(merged.End, range.End);
+            absorbed.push_back(range);
+        }
+    }
+
+    // only whatever got merged in is replaced, the rest of the channel is left alone
+    for (const auto &range : absorbed) {
+        auto &s = m_stmt_clr_msg_range;
+        s->Bind(1, channel_id);
+        s->Bind(2, range.Start);
+        s->Step();
+        s->Reset();
+    }
+
+    auto &s = m_stmt_set_msg_range;
+    s->Bind(1, channel_id);
+    s->Bind(2, merged.Start);
+    s->Bind(3, merged.End);
+    if (!s->Insert())
+        LOG_ERROR(Store, "message range insert failed for %" PRIu64 ": %s", static_cast<uint64_t>(channel_id), m_db.ErrStr());
+    s->Reset();
+}
+
+bool Store::ExtendNewestMessageRange(Snowflake channel_id, Snowflake end) {
+    // nothing is newer than the newest range so moving its end up cant make it overlap anything
+    auto &s = m_stmt_ext_msg_range;
+    s->Bind(1, end);
+    s->Bind(2, channel_id);
+    s->Bind(3, end);
+    s->Bind(4, channel_id);
+    const bool ok = s->Insert();
+    if (!ok)
+        LOG_ERROR(Store, "message range update failed for %" PRIu64 ": %s", static_cast<uint64_t>(channel_id), m_db.ErrStr());
+    const bool changed = ok && sqlite3_changes(m_db.obj()) > 0;
+    s->Reset();
+    return changed;
+}
+
+void Store::SetOutboxEntry(const OutboxEntry &entry) {
+    auto attachments = nlohmann::json::array();
+    for (const auto &attachment : entry.Attachments)
+        attachments.push_back({ { "path", attachment.Path }, { "filename", attachment.Filename }, { "temp", attachment.IsTemp } });
+
+    auto &s = m_stmt_set_outbox;
+
+    s->Bind(1, entry.Nonce);
+    s->Bind(2, entry.UserID);
+    s->Bind(3, entry.ChannelID);
+    if (entry.InReplyToID.IsValid())
+        s->Bind(4, entry.InReplyToID);
+    else
+        s->Bind(4);
+    s->Bind(5, entry.Content);
+    s->Bind(6, attachments.dump());
+
+    if (!s->Insert())
+        LOG_ERROR(Store, "outbox insert failed for %" PRIu64 ": %s", static_cast<uint64_t>(entry.Nonce), m_db.ErrStr());
+
+    s->Reset();
+}
+
+std::vector<Store::OutboxEntry> Store::GetOutbox(Snowflake user_id) const {
+    auto &s = m_stmt_get_outbox;
+
+    s->Bind(1, user_id);
+
+    std::vector<OutboxEntry> ret;
+    while (s->FetchOne()) {
+        auto &entry = ret.emplace_back();
+        entry.UserID = user_id;
+        s->Get(0, entry.Nonce);
+        s->Get(1, entry.ChannelID);
+        if (!s->IsNull(2))
+            s->Get(2, entry.InReplyToID);
+        s->Get(3, entry.Content);
+        std::string attachments;
+        s->Get(4, attachments);
+        try {
+            for (const auto &attachment : nlohmann::json::parse(attachments))
+                entry.Attachments.push_back({ attachment.at("path").get<std::string>(), attachment.at("filename").get<std::string>(), attachment.at("temp").get<bool>() });
+        } catch (...) {}
+    }
+
+    s->Reset();
+
+    return ret;
+}
+
+void Store::ClearOutboxEntry(Snowflake nonce) {
+    auto &s = m_stmt_clr_outbox;
+
+    s->Bind(1, nonce);
+    s->Step();
+    s->Reset();
+}
+
 std::unordered_set<Snowflake> Store::GetMembersInGuild(Snowflake guild_id) const {
     auto &s = m_stmt_get_guild_member_ids;
 
@@ -602,6 +920,8 @@ std::unordered_set<Snowflake> Store::GetMembersInGuild(Snowflake guild_id) const
 }
 
 void Store::AddReaction(const MessageReactionAddObject &data, bool byself) {
+    InvalidateMessageSnapshot(data.MessageID);
+
     auto &s = m_stmt_add_reaction;
 
     s->Bind(1, data.MessageID);
@@ -615,12 +935,14 @@ void Store::AddReaction(const MessageReactionAddObject &data, bool byself) {
     s->Bind(6);
 
     if (!s->Insert())
-        fprintf(stderr, "failed to add reaction for %" PRIu64 ": %s\n", static_cast<uint64_t>(data.MessageID), m_db.ErrStr());
+        LOG_ERROR(Store, "failed to add reaction for %" PRIu64 ": %s", static_cast<uint64_t>(data.MessageID), m_db.ErrStr());
 
     s->Reset();
 }
 
 void Store::RemoveReaction(const MessageReactionRemoveObject &data, bool byself) {
+    InvalidateMessageSnapshot(data.MessageID);
+
     auto &s = m_stmt_sub_reaction;
 
     s->Bind(1, data.MessageID);
@@ -632,7 +954,7 @@ void Store::RemoveReaction(const MessageReactionRemoveObject &data, bool byself)
         s->Bind(4);
 
     if (!s->Insert())
-        fprintf(stderr, "failed to remove reaction for %" PRIu64 ": %s\n", static_cast<uint64_t>(data.MessageID), m_db.ErrStr());
+        LOG_ERROR(Store, "failed to remove reaction for %" PRIu64 ": %s", static_cast<uint64_t>(data.MessageID), m_db.ErrStr());
 
     s->Reset();
 }
@@ -642,7 +964,7 @@ std::optional<ChannelData> Store::GetChannel(Snowflake id) const {
     s->Bind(1, id);
     if (!s->FetchOne()) {
         if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching channel %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+            LOG_ERROR(Store, "error while fetching channel %" PRIu64 ": %s", static_cast<uint64_t>(id), m_db.ErrStr());
         s->Reset();
         return {};
     }
@@ -693,7 +1015,7 @@ std::optional<EmojiData> Store::GetEmoji(Snowflake id) const {
     s->Bind(1, id);
     if (!s->FetchOne()) {
         if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching emoji %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+            LOG_ERROR(Store, "error while fetching emoji %" PRIu64 ": %s", static_cast<uint64_t>(id), m_db.ErrStr());
         s->Reset();
         return {};
     }
@@ -734,7 +1056,7 @@ std::optional<GuildData> Store::GetGuild(Snowflake id) const {
     s->Bind(1, id);
     if (!s->FetchOne()) {
         if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching guild %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+            LOG_ERROR(Store, "error while fetching guild %" PRIu64 ": %s", static_cast<uint64_t>(id), m_db.ErrStr());
         s->Reset();
         return {};
     }
@@ -817,7 +1139,7 @@ std::optional<GuildMember> Store::GetGuildMember(Snowflake guild_id, Snowflake u
     s->Bind(2, guild_id);
     if (!s->FetchOne()) {
         if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching member %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(user_id), static_cast<uint64_t>(guild_id), m_db.ErrStr());
+            LOG_ERROR(Store, "error while fetching member %" PRIu64 "/%" PRIu64 ": %s", static_cast<uint64_t>(user_id), static_cast<uint64_t>(guild_id), m_db.ErrStr());
         s->Reset();
         return {};
     }
@@ -857,7 +1179,7 @@ std::optional<Message> Store::GetMessage(Snowflake id) const {
     s->Bind(1, id);
     if (!s->FetchOne()) {
         if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching message %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+            LOG_ERROR(Store, "error while fetching message %" PRIu64 ": %s", static_cast<uint64_t>(id), m_db.ErrStr());
         s->Reset();
         return {};
     }
@@ -865,7 +1187,7 @@ std::optional<Message> Store::GetMessage(Snowflake id) const {
     auto top = GetMessageBound(s);
     if (!s->FetchOne()) {
         if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching message %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+            LOG_ERROR(Store, "error while fetching message %" PRIu64 ": %s", static_cast<uint64_t>(id), m_db.ErrStr());
         s->Reset();
         return top;
     }
@@ -983,7 +1305,7 @@ std::optional<PermissionOverwrite> Store::GetPermissionOverwrite(Snowflake chann
     s->Bind(2, channel_id);
     if (!s->FetchOne()) {
         if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "failed while fetching permission %" PRIu64 "/%" PRIu64 ": %s\n", static_cast<uint64_t>(channel_id), static_cast<uint64_t>(id), m_db.ErrStr());
+            LOG_ERROR(Store, "failed while fetching permission %" PRIu64 "/%" PRIu64 ": %s", static_cast<uint64_t>(channel_id), static_cast<uint64_t>(id), m_db.ErrStr());
         s->Reset();
         return {};
     }
@@ -1005,7 +1327,7 @@ std::optional<RoleData> Store::GetRole(Snowflake id) const {
     s->Bind(1, id);
     if (!s->FetchOne()) {
         if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching role %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+            LOG_ERROR(Store, "error while fetching role %" PRIu64 ": %s", static_cast<uint64_t>(id), m_db.ErrStr());
         s->Reset();
         return {};
     }
@@ -1038,7 +1360,7 @@ std::optional<UserData> Store::GetUser(Snowflake id) const {
     s->Bind(1, id);
     if (!s->FetchOne()) {
         if (m_db.Error() != SQLITE_DONE)
-            fprintf(stderr, "error while fetching user %" PRIu64 ": %s\n", static_cast<uint64_t>(id), m_db.ErrStr());
+            LOG_ERROR(Store, "error while fetching user %" PRIu64 ": %s", static_cast<uint64_t>(id), m_db.ErrStr());
         s->Reset();
         return {};
     }
@@ -1061,6 +1383,10 @@ std::optional<UserData> Store::GetUser(Snowflake id) const {
 }
 
 void Store::ClearGuild(Snowflake id) {
+    m_guild_snapshots.erase(id);
+    m_member_snapshots.erase(id);
+    InvalidateGuildRoles(id);
+
     auto &s = m_stmt_clr_guild;
 
     s->Bind(1, id);
@@ -1069,6 +1395,16 @@ void Store::ClearGuild(Snowflake id) {
 }
 
 void Store::ClearChannel(Snowflake id) {
+    m_channel_snapshots.erase(id);
+    m_guild_snapshots.clear();
+
+    {
+        auto &s = m_stmt_clr_msg_ranges;
+        s->Bind(1, id);
+        s->Step();
+        s->Reset();
+    }
+
     auto &s = m_stmt_clr_chan;
 
     s->Bind(1, id);
@@ -1076,6 +1412,16 @@ void Store::ClearChannel(Snowflake id) {
     s->Reset();
 }
 
+void Store::ClearMessage(Snowflake id) {
+    InvalidateMessageSnapshot(id);
+
+    auto &s = m_stmt_clr_msg;
+
+    s->Bind(1, id);
+    s->Step();
+    s->Reset();
+}
+
 void Store::ClearBan(Snowflake guild_id, Snowflake user_id) {
     auto &s = m_stmt_clr_ban;
 
@@ -1086,6 +1432,8 @@ void Store::ClearBan(Snowflake guild_id, Snowflake user_id) {
 }
 
 void Store::ClearRecipient(Snowflake channel_id, Snowflake user_id) {
+    m_channel_snapshots.erase(channel_id);
+
     auto &s = m_stmt_clr_recipient;
 
     s->Bind(1, channel_id);
@@ -1095,6 +1443,11 @@ void Store::ClearRecipient(Snowflake channel_id, Snowflake user_id) {
 }
 
 void Store::ClearRole(Snowflake id) {
+    m_role_snapshots.erase(id);
+    m_guild_snapshots.clear();
+    m_role_tables.clear();
+    m_member_roles.clear();
+
     auto &s = m_stmt_clr_role;
 
     s->Bind(1, id);
@@ -1133,6 +1486,10 @@ std::unordered_set<Snowflake> Store::GetGuilds() const {
 }
 
 void Store::ClearAll() {
+    ClearSnapshots();
+    m_role_tables.clear();
+    m_member_roles.clear();
+
     if (m_db.Execute(R"(
         DELETE FROM attachments;
         DELETE FROM bans;
@@ -1146,6 +1503,7 @@ void Store::ClearAll() {
         DELETE FROM member_roles;
         DELETE FROM mentions;
         DELETE FROM message_interactions;
+        DELETE FROM message_ranges;
         DELETE FROM message_references;
         DELETE FROM messages;
         DELETE FROM permissions;
@@ -1155,7 +1513,7 @@ void Store::ClearAll() {
         DELETE FROM threads;
         DELETE FROM users;
     )") != SQLITE_OK) {
-        fprintf(stderr, "failed to clear: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to clear: %s", m_db.ErrStr());
     }
 }
 
@@ -1167,6 +1525,24 @@ void Store::EndTransaction() {
     m_db.EndTransaction();
 }
 
+bool Store::AttachOutbox(const std::string &path) {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+    // unlike the main database this one is never deleted
+    // nothing else has an outbox table so the statements find it here without naming the schema
+    char *command = sqlite3_mprintf("ATTACH DATABASE %Q AS kept", path.c_str());
+    const int err = m_db.Execute(command);
+    sqlite3_free(command);
+    if (err != SQLITE_OK) {
+        LOG_ERROR(Store, "failed to open outbox database %s: %s", path.c_str(), m_db.ErrStr());
+        return false;
+    }
+
+    m_outbox_schema = "kept";
+    return true;
+}
+
 bool Store::CreateTables() {
     const char *create_users = R"(
         CREATE TABLE IF NOT EXISTS users (
@@ -1424,6 +1800,25 @@ bool Store::CreateTables() {
         )
     )";
 
+    const char *create_message_ranges = R"(
+        CREATE TABLE IF NOT EXISTS message_ranges (
+            channel INTEGER NOT NULL,
+            start_id INTEGER NOT NULL,
+            end_id INTEGER NOT NULL,
+            PRIMARY KEY(channel, start_id)
+        )
+    )";
+
+    const auto create_outbox = "CREATE TABLE IF NOT EXISTS " + m_outbox_schema + R"(.outbox (
+            nonce INTEGER PRIMARY KEY,
+            user INTEGER NOT NULL,
+            channel INTEGER NOT NULL,
+            reply_to INTEGER,
+            content TEXT NOT NULL,
+            attachments TEXT NOT NULL /* json */
+        )
+    )";
+
     const char *create_reactions = R"(
         CREATE TABLE IF NOT EXISTS reactions (
             message INTEGER NOT NULL,
@@ -1437,102 +1832,112 @@ bool Store::CreateTables() {
     )";
 
     if (m_db.Execute(create_users) != SQLITE_OK) {
-        fprintf(stderr, "failed to create user table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create user table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_permissions) != SQLITE_OK) {
-        fprintf(stderr, "failed to create permissions table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create permissions table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_messages) != SQLITE_OK) {
-        fprintf(stderr, "failed to create messages table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create messages table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_roles) != SQLITE_OK) {
-        fprintf(stderr, "failed to create roles table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create roles table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_emojis) != SQLITE_OK) {
-        fprintf(stderr, "failed to create emojis table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create emojis table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_members) != SQLITE_OK) {
-        fprintf(stderr, "failed to create members table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create members table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_guilds) != SQLITE_OK) {
-        fprintf(stderr, "failed to create guilds table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create guilds table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_channels) != SQLITE_OK) {
-        fprintf(stderr, "failed to create channels table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create channels table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_bans) != SQLITE_OK) {
-        fprintf(stderr, "failed to create bans table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create bans table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_interactions) != SQLITE_OK) {
-        fprintf(stderr, "failed to create interactions table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create interactions table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_references) != SQLITE_OK) {
-        fprintf(stderr, "failed to create references table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create references table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_member_roles) != SQLITE_OK) {
-        fprintf(stderr, "failed to create member roles table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create member roles table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_guild_emojis) != SQLITE_OK) {
-        fprintf(stderr, "failed to create guild emojis table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create guild emojis table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_guild_features) != SQLITE_OK) {
-        fprintf(stderr, "failed to create guild features table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create guild features table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_threads) != SQLITE_OK) {
-        fprintf(stderr, "failed to create threads table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create threads table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_emoji_roles) != SQLITE_OK) {
-        fprintf(stderr, "failed to create emoji roles table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create emoji roles table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_mentions) != SQLITE_OK) {
-        fprintf(stderr, "failed to create mentions table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create mentions table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_attachments) != SQLITE_OK) {
-        fprintf(stderr, "failed to create attachments table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create attachments table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_recipients) != SQLITE_OK) {
-        fprintf(stderr, "failed to create recipients table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create recipients table: %s", m_db.ErrStr());
         return false;
     }
 
     if (m_db.Execute(create_reactions) != SQLITE_OK) {
-        fprintf(stderr, "failed to create reactions table: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create reactions table: %s", m_db.ErrStr());
+        return false;
+    }
+
+    if (m_db.Execute(create_message_ranges) != SQLITE_OK) {
+        LOG_ERROR(Store, "failed to create message ranges table: %s", m_db.ErrStr());
+        return false;
+    }
+
+    if (m_db.Execute(create_outbox.c_str()) != SQLITE_OK) {
+        LOG_ERROR(Store, "failed to create outbox table: %s", m_db.ErrStr());
         return false;
     }
 
@@ -1542,7 +1947,7 @@ bool Store::CreateTables() {
             DELETE FROM reactions WHERE message = new.message AND emoji_id = new.emoji_id AND name = new.name;
         END
     )") != SQLITE_OK) {
-        fprintf(stderr, "failed to create reactions trigger: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create reactions trigger: %s", m_db.ErrStr());
         return false;
     }
 
@@ -1552,7 +1957,7 @@ bool Store::CreateTables() {
             DELETE FROM member_roles WHERE role = old.id;
         END
     )") != SQLITE_OK) {
-        fprintf(stderr, "failed to create roles trigger: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to create roles trigger: %s", m_db.ErrStr());
         return false;
     }
 
@@ -1560,86 +1965,86 @@ bool Store::CreateTables() {
 }
 
 bool Store::CreateStatements() {
-    m_stmt_set_guild = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_guild = std::make_unique<Statement>(m_db, "set_guild", R"(
         REPLACE INTO guilds VALUES (
             ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?
         )
     )");
     if (!m_stmt_set_guild->OK()) {
-        fprintf(stderr, "failed to prepare set guild statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare set guild statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_guild = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_guild = std::make_unique<Statement>(m_db, "get_guild", R"(
         SELECT * FROM guilds WHERE id = ?
     )");
     if (!m_stmt_get_guild->OK()) {
-        fprintf(stderr, "failed to prepare get guild statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get guild statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_guild_ids = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_guild_ids = std::make_unique<Statement>(m_db, "get_guild_ids", R"(
         SELECT id FROM guilds
     )");
     if (!m_stmt_get_guild_ids->OK()) {
-        fprintf(stderr, "failed to prepare get guild ids statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get guild ids statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_clr_guild = std::make_unique<Statement>(m_db, R"(
+    m_stmt_clr_guild = std::make_unique<Statement>(m_db, "clr_guild", R"(
         DELETE FROM guilds WHERE id = ?
     )");
     if (!m_stmt_clr_guild->OK()) {
-        fprintf(stderr, "failed to prepare clear guild statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare clear guild statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_set_chan = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_chan = std::make_unique<Statement>(m_db, "set_chan", R"(
         REPLACE INTO channels VALUES (
             ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?
         )
     )");
     if (!m_stmt_set_chan->OK()) {
-        fprintf(stderr, "failed to prepare set channel statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare set channel statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_chan = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_chan = std::make_unique<Statement>(m_db, "get_chan", R"(
         SELECT * FROM channels WHERE id = ?
     )");
     if (!m_stmt_get_chan->OK()) {
-        fprintf(stderr, "failed to prepare get channel statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get channel statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_chan_ids = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_chan_ids = std::make_unique<Statement>(m_db, "get_chan_ids", R"(
         SELECT id FROM channels
     )");
     if (!m_stmt_get_chan_ids->OK()) {
-        fprintf(stderr, "failed to prepare get channel ids statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get channel ids statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_clr_chan = std::make_unique<Statement>(m_db, R"(
+    m_stmt_clr_chan = std::make_unique<Statement>(m_db, "clr_chan", R"(
         DELETE FROM channels WHERE id = ?
     )");
     if (!m_stmt_clr_chan->OK()) {
-        fprintf(stderr, "failed to prepare clear channel statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare clear channel statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_set_msg = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_msg = std::make_unique<Statement>(m_db, "set_msg", R"(
         REPLACE INTO messages VALUES (
             ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?
         )
     )");
     if (!m_stmt_set_msg->OK()) {
-        fprintf(stderr, "failed to prepare set message statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare set message statement: %s", m_db.ErrStr());
         return false;
     }
 
     // wew
-    m_stmt_get_msg = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_msg = std::make_unique<Statement>(m_db, "get_msg", R"(
         SELECT messages.*,
                message_interactions.interaction_id,
                message_interactions.name,
@@ -1684,21 +2089,21 @@ bool Store::CreateStatements() {
         GROUP BY messages.id ORDER BY messages.id DESC
     )");
     if (!m_stmt_get_msg->OK()) {
-        fprintf(stderr, "failed to prepare get message statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get message statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_set_msg_ref = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_msg_ref = std::make_unique<Statement>(m_db, "set_msg_ref", R"(
         REPLACE INTO message_references VALUES (
             ?, ?, ?, ?
         );
     )");
     if (!m_stmt_set_msg_ref->OK()) {
-        fprintf(stderr, "failed to prepare set message reference statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare set message reference statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_last_msgs = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_last_msgs = std::make_unique<Statement>(m_db, "get_last_msgs", R"(
         SELECT * FROM (
             SELECT messages.*,
                    message_interactions.interaction_id,
@@ -1723,174 +2128,174 @@ bool Store::CreateStatements() {
         ) ORDER BY id ASC
     )");
     if (!m_stmt_get_last_msgs->OK()) {
-        fprintf(stderr, "failed to prepare get last messages statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get last messages statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_set_user = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_user = std::make_unique<Statement>(m_db, "set_user", R"(
         REPLACE INTO users VALUES (
             ?, ?, ?, ?, ?, ?, ?, ?, ?
         )
     )");
     if (!m_stmt_set_user->OK()) {
-        fprintf(stderr, "failed to prepare set user statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare set user statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_user = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_user = std::make_unique<Statement>(m_db, "get_user", R"(
         SELECT * FROM users WHERE id = ?
     )");
     if (!m_stmt_get_user->OK()) {
-        fprintf(stderr, "failed to prepare get user statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get user statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_set_member = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_member = std::make_unique<Statement>(m_db, "set_member", R"(
         REPLACE INTO members VALUES (
             ?, ?, ?, ?, ?, ?, ?, ?, ?
         )
     )");
     if (!m_stmt_set_member->OK()) {
-        fprintf(stderr, "failed to prepare set member statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare set member statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_member = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_member = std::make_unique<Statement>(m_db, "get_member", R"(
         SELECT * FROM members WHERE user_id = ? AND guild_id = ?
     )");
     if (!m_stmt_get_member->OK()) {
-        fprintf(stderr, "failed to prepare get member statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get member statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_set_role = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_role = std::make_unique<Statement>(m_db, "set_role", R"(
         REPLACE INTO roles VALUES (
             ?, ?, ?, ?, ?, ?, ?, ?, ?
         )
     )");
     if (!m_stmt_set_role->OK()) {
-        fprintf(stderr, "failed to prepare set role statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare set role statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_role = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_role = std::make_unique<Statement>(m_db, "get_role", R"(
         SELECT * FROM roles WHERE id = ?
     )");
     if (!m_stmt_get_role->OK()) {
-        fprintf(stderr, "failed to prepare get role statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get role statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_guild_roles = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_guild_roles = std::make_unique<Statement>(m_db, "get_guild_roles", R"(
         SELECT * FROM roles WHERE guild = ?
     )");
     if (!m_stmt_get_guild_roles->OK()) {
-        fprintf(stderr, "failed to prepare get guild roles statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get guild roles statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_set_emoji = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_emoji = std::make_unique<Statement>(m_db, "set_emoji", R"(
         REPLACE INTO emojis VALUES (
             ?, ?, ?, ?, ?, ?, ?
         )
     )");
     if (!m_stmt_set_emoji->OK()) {
-        fprintf(stderr, "failed to prepare set emoji statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare set emoji statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_emoji = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_emoji = std::make_unique<Statement>(m_db, "get_emoji", R"(
         SELECT * FROM emojis WHERE id = ?
     )");
     if (!m_stmt_get_emoji->OK()) {
-        fprintf(stderr, "failed to prepare get emoji statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get emoji statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_set_perm = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_perm = std::make_unique<Statement>(m_db, "set_perm", R"(
         REPLACE INTO permissions VALUES (
             ?, ?, ?, ?, ?
         )
     )");
     if (!m_stmt_set_perm->OK()) {
-        fprintf(stderr, "failed to prepare set permission statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare set permission statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_perm = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_perm = std::make_unique<Statement>(m_db, "get_perm", R"(
         SELECT * FROM permissions WHERE id = ? AND channel_id = ?
     )");
     if (!m_stmt_get_perm->OK()) {
-        fprintf(stderr, "failed to prepare get permission statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get permission statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_set_ban = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_ban = std::make_unique<Statement>(m_db, "set_ban", R"(
         REPLACE INTO bans VALUES (
             ?, ?, ?
         )
     )");
     if (!m_stmt_set_ban->OK()) {
-        fprintf(stderr, "failed to prepare set ban statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare set ban statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_ban = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_ban = std::make_unique<Statement>(m_db, "get_ban", R"(
         SELECT * FROM bans WHERE guild_id = ? AND user_id = ?
     )");
     if (!m_stmt_get_ban->OK()) {
-        fprintf(stderr, "failed to prepare get ban statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get ban statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_bans = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_bans = std::make_unique<Statement>(m_db, "get_bans", R"(
         SELECT * FROM bans WHERE guild_id = ?
     )");
     if (!m_stmt_get_bans->OK()) {
-        fprintf(stderr, "failed to prepare get bans statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get bans statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_clr_ban = std::make_unique<Statement>(m_db, R"(
+    m_stmt_clr_ban = std::make_unique<Statement>(m_db, "clr_ban", R"(
         DELETE FROM bans WHERE guild_id = ? AND user_id = ?
     )");
     if (!m_stmt_clr_ban->OK()) {
-        fprintf(stderr, "failed to prepare clear ban statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare clear ban statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_set_interaction = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_interaction = std::make_unique<Statement>(m_db, "set_interaction", R"(
         REPLACE INTO message_interactions VALUES (
             ?, ?, ?, ?, ?
         )
     )");
     if (!m_stmt_set_interaction->OK()) {
-        fprintf(stderr, "failed to prepare set interaction statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare set interaction statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_set_member_roles = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_member_roles = std::make_unique<Statement>(m_db, "set_member_roles", R"(
         REPLACE INTO member_roles VALUES (
             ?, ?
         )
     )");
     if (!m_stmt_set_member_roles->OK()) {
-        fprintf(stderr, "faile to prepare set member roles statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "faile to prepare set member roles statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_member_roles = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_member_roles = std::make_unique<Statement>(m_db, "get_member_roles", R"(
         SELECT id FROM roles, member_roles
         WHERE roles.id = member_roles.role
         AND member_roles.user = ?
         AND roles.guild = ?
     )");
     if (!m_stmt_get_member_roles->OK()) {
-        fprintf(stderr, "failed to prepare get member role statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get member role statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_clr_member_roles = std::make_unique<Statement>(m_db, R"(
+    m_stmt_clr_member_roles = std::make_unique<Statement>(m_db, "clr_member_roles", R"(
         DELETE FROM member_roles
         WHERE user = ? AND
         EXISTS (
@@ -1900,89 +2305,89 @@ bool Store::CreateStatements() {
         )
     )");
     if (!m_stmt_clr_member_roles->OK()) {
-        fprintf(stderr, "failed to prepare clear member roles statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare clear member roles statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_set_guild_emoji = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_guild_emoji = std::make_unique<Statement>(m_db, "set_guild_emoji", R"(
         REPLACE INTO guild_emojis VALUES (
             ?, ?
         )
     )");
     if (!m_stmt_set_guild_emoji->OK()) {
-        fprintf(stderr, "failed to prepare set guild emoji statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare set guild emoji statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_guild_emojis = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_guild_emojis = std::make_unique<Statement>(m_db, "get_guild_emojis", R"(
         SELECT emoji FROM guild_emojis WHERE guild = ?
     )");
     if (!m_stmt_get_guild_emojis->OK()) {
-        fprintf(stderr, "failed to prepare get guild emojis statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get guild emojis statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_clr_guild_emoji = std::make_unique<Statement>(m_db, R"(
+    m_stmt_clr_guild_emoji = std::make_unique<Statement>(m_db, "clr_guild_emoji", R"(
         DELETE FROM guild_emojis WHERE guild = ? AND emoji = ?
     )");
     if (!m_stmt_clr_guild_emoji->OK()) {
-        fprintf(stderr, "failed to prepare clear guild emoji statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare clear guild emoji statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_set_guild_feature = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_guild_feature = std::make_unique<Statement>(m_db, "set_guild_feature", R"(
         REPLACE INTO guild_features VALUES (
             ?, ?
         )
     )");
     if (!m_stmt_set_guild_feature->OK()) {
-        fprintf(stderr, "failed to prepare set guild feature statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare set guild feature statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_guild_features = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_guild_features = std::make_unique<Statement>(m_db, "get_guild_features", R"(
         SELECT feature FROM guild_features WHERE guild = ?  
     )");
     if (!m_stmt_get_guild_features->OK()) {
-        fprintf(stderr, "failed to prepare get guild features statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get guild features statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_guild_chans = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_guild_chans = std::make_unique<Statement>(m_db, "get_guild_chans", R"(
         SELECT id FROM channels WHERE guild_id = ?
     )");
     if (!m_stmt_get_guild_chans->OK()) {
-        fprintf(stderr, "failed to prepare get guild channels statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get guild channels statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_set_thread = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_thread = std::make_unique<Statement>(m_db, "set_thread", R"(
         REPLACE INTO threads VALUES (
             ?, ?
         )
     )");
     if (!m_stmt_set_thread->OK()) {
-        fprintf(stderr, "failed to prepare set thread statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare set thread statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_threads = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_threads = std::make_unique<Statement>(m_db, "get_threads", R"(
         SELECT id FROM threads WHERE guild = ?
     )");
     if (!m_stmt_get_threads->OK()) {
-        fprintf(stderr, "failed to prepare get threads statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get threads statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_active_threads = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_active_threads = std::make_unique<Statement>(m_db, "get_active_threads", R"(
         SELECT id FROM channels WHERE parent_id = ? AND (type = 10 OR type = 11 OR type = 12) AND archived = FALSE
     )");
     if (!m_stmt_get_active_threads->OK()) {
-        fprintf(stderr, "faile to prepare get active threads statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "faile to prepare get active threads statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_messages_before = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_messages_before = std::make_unique<Statement>(m_db, "get_messages_before", R"(
         SELECT * FROM (
             SELECT messages.*,
                    message_interactions.interaction_id,
@@ -2011,11 +2416,11 @@ bool Store::CreateStatements() {
         ) ORDER BY id ASC
     )");
     if (!m_stmt_get_messages_before->OK()) {
-        fprintf(stderr, "failed to prepare get messages before statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get messages before statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_pins = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_pins = std::make_unique<Statement>(m_db, "get_pins", R"(
         SELECT messages.*,
                message_interactions.interaction_id,
                message_interactions.name,
@@ -2044,92 +2449,92 @@ bool Store::CreateStatements() {
         WHERE channel_id = ? AND pinned = 1 ORDER BY id ASC
     )");
     if (!m_stmt_get_pins->OK()) {
-        fprintf(stderr, "failed to prepare get pins statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get pins statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_set_emoji_role = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_emoji_role = std::make_unique<Statement>(m_db, "set_emoji_role", R"(
         REPLACE INTO emoji_roles VALUES (
             ?, ?
         )
     )");
     if (!m_stmt_set_emoji_role->OK()) {
-        fprintf(stderr, "failed to prepare set emoji role statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare set emoji role statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_emoji_roles = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_emoji_roles = std::make_unique<Statement>(m_db, "get_emoji_roles", R"(
         SELECT role FROM emoji_roles WHERE emoji = ?
     )");
     if (!m_stmt_get_emoji_roles->OK()) {
-        fprintf(stderr, "failed to prepare get emoji role statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get emoji role statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_set_mention = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_mention = std::make_unique<Statement>(m_db, "set_mention", R"(
         REPLACE INTO mentions VALUES (
             ?, ?
         )
     )");
     if (!m_stmt_set_mention->OK()) {
-        fprintf(stderr, "failed to prepare set mention statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare set mention statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_mentions = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_mentions = std::make_unique<Statement>(m_db, "get_mentions", R"(
         SELECT user FROM mentions WHERE message = ?
     )");
     if (!m_stmt_get_mentions->OK()) {
-        fprintf(stderr, "failed to prepare get mentions statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get mentions statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_set_attachment = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_attachment = std::make_unique<Statement>(m_db, "set_attachment", R"(
         REPLACE INTO attachments VALUES (
             ?, ?, ?, ?, ?, ?, ?, ?
         )
     )");
     if (!m_stmt_set_attachment->OK()) {
-        fprintf(stderr, "failed to prepare set attachment statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare set attachment statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_attachments = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_attachments = std::make_unique<Statement>(m_db, "get_attachments", R"(
         SELECT * FROM attachments WHERE message = ?
     )");
     if (!m_stmt_get_attachments->OK()) {
-        fprintf(stderr, "failed to prepare get attachments statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get attachments statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_set_recipient = std::make_unique<Statement>(m_db, R"(
+    m_stmt_set_recipient = std::make_unique<Statement>(m_db, "set_recipient", R"(
         REPLACE INTO recipients VALUES (
             ?, ?
         )
     )");
     if (!m_stmt_set_recipient->OK()) {
-        fprintf(stderr, "failed to prepare set recipient statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare set recipient statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_recipients = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_recipients = std::make_unique<Statement>(m_db, "get_recipients", R"(
         SELECT user FROM recipients WHERE channel = ?
     )");
     if (!m_stmt_get_recipients->OK()) {
-        fprintf(stderr, "failed to prepare get recipients statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get recipients statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_clr_recipient = std::make_unique<Statement>(m_db, R"(
+    m_stmt_clr_recipient = std::make_unique<Statement>(m_db, "clr_recipient", R"(
         DELETE FROM recipients WHERE channel = ? AND user = ?
     )");
     if (!m_stmt_clr_recipient->OK()) {
-        fprintf(stderr, "failed to prepare clear recipient statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare clear recipient statement: %s", m_db.ErrStr());
         return false;
     }
 
     // probably not the best way to do this lol but i just want one statement i guess
-    m_stmt_add_reaction = std::make_unique<Statement>(m_db, R"(
+    m_stmt_add_reaction = std::make_unique<Statement>(m_db, "add_reaction", R"(
         INSERT OR REPLACE INTO reactions VALUES (
             ?1, ?2, ?3,
             COALESCE(
@@ -2150,51 +2555,128 @@ bool Store::CreateStatements() {
         )
     )");
     if (!m_stmt_add_reaction->OK()) {
-        fprintf(stderr, "failed to prepare add reaction statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare add reaction statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_sub_reaction = std::make_unique<Statement>(m_db, R"(
+    m_stmt_sub_reaction = std::make_unique<Statement>(m_db, "sub_reaction", R"(
         UPDATE reactions
         SET count = count - 1,
             me = COALESCE(?4, me)
         WHERE message = ?1 AND emoji_id = ?2 AND name = ?3
     )");
     if (!m_stmt_sub_reaction->OK()) {
-        fprintf(stderr, "failed to prepare sub reaction statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare sub reaction statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_reactions = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_reactions = std::make_unique<Statement>(m_db, "get_reactions", R"(
         SELECT emoji_id, name, count, me, idx FROM reactions WHERE message = ?
     )");
     if (!m_stmt_get_reactions->OK()) {
-        fprintf(stderr, "failed to prepare get reactions statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get reactions statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_chan_ids_parent = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_chan_ids_parent = std::make_unique<Statement>(m_db, "get_chan_ids_parent", R"(
         SELECT id FROM channels WHERE parent_id = ?
     )");
     if (!m_stmt_get_chan_ids_parent->OK()) {
-        fprintf(stderr, "failed to prepare get channel ids for parent statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get channel ids for parent statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_get_guild_member_ids = std::make_unique<Statement>(m_db, R"(
+    m_stmt_get_guild_member_ids = std::make_unique<Statement>(m_db, "get_guild_member_ids", R"(
         SELECT user_id FROM members WHERE guild_id = ?
     )");
     if (!m_stmt_get_guild_member_ids->OK()) {
-        fprintf(stderr, "failed to prepare get guild member ids statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare get guild member ids statement: %s", m_db.ErrStr());
         return false;
     }
 
-    m_stmt_clr_role = std::make_unique<Statement>(m_db, R"(
+    m_stmt_clr_role = std::make_unique<Statement>(m_db, "clr_role", R"(
         DELETE FROM roles
         WHERE id = ?1;
     )");
     if (!m_stmt_clr_role->OK()) {
-        fprintf(stderr, "failed to prepare clear role statement: %s\n", m_db.ErrStr());
+        LOG_ERROR(Store, "failed to prepare clear role statement: %s", m_db.ErrStr());
+        return false;
+    }
+
+    m_stmt_get_msg_ranges = std::make_unique<Statement>(m_db, "get_msg_ranges", R"(
+        SELECT start_id, end_id FROM message_ranges WHERE channel = ? ORDER BY start_id ASC
+    )");
+    if (!m_stmt_get_msg_ranges->OK()) {
+        LOG_ERROR(Store, "failed to prepare get message ranges statement: %s", m_db.ErrStr());
+        return false;
+    }
+
+    m_stmt_set_msg_range = std::make_unique<Statement>(m_db, "set_msg_range", R"(
+        REPLACE INTO message_ranges VALUES (
+            ?, ?, ?
+        )
+    )");
+    if (!m_stmt_set_msg_range->OK()) {
+        LOG_ERROR(Store, "failed to prepare set message range statement: %s", m_db.ErrStr());
+        return false;
+    }
+
+    m_stmt_clr_msg_ranges = std::make_unique<Statement>(m_db, "clr_msg_ranges", R"(
+        DELETE FROM message_ranges WHERE channel = ?
+    )");
+    if (!m_stmt_clr_msg_ranges->OK()) {
+        LOG_ERROR(Store, "failed to prepare clear message ranges statement: %s", m_db.ErrStr());
+        return false;
+    }
+
+    m_stmt_clr_msg_range = std::make_unique<Statement>(m_db, "clr_msg_range", R"(
+        DELETE FROM message_ranges WHERE channel = ? AND start_id = ?
+    )");
+    if (!m_stmt_clr_msg_range->OK()) {
+        LOG_ERROR(Store, "failed to prepare clear message range statement: %s", m_db.ErrStr());
+        return false;
+    }
+
+    m_stmt_ext_msg_range = std::make_unique<Statement>(m_db, "ext_msg_range", R"(
+        UPDATE message_ranges SET end_id = ?
+            WHERE channel = ? AND end_id < ? AND start_id = (SELECT MAX(start_id) FROM message_ranges WHERE channel = ?)
+    )");
+    if (!m_stmt_ext_msg_range->OK()) {
+        LOG_ERROR(Store, "failed to prepare extend message range statement: %s", m_db.ErrStr());
+        return false;
+    }
+
+    m_stmt_clr_msg = std::make_unique<Statement>(m_db, "clr_msg", R"(
+        DELETE FROM messages WHERE id = ?
+    )");
+    if (!m_stmt_clr_msg->OK()) {
+        LOG_ERROR(Store, "failed to prepare clear message statement: %s", m_db.ErrStr());
+        return false;
+    }
+
+    m_stmt_set_outbox = std::make_unique<Statement>(m_db, "set_outbox", R"(
+        REPLACE INTO outbox VALUES (
+            ?, ?, ?, ?, ?, ?
+        )
+    )");
+    if (!m_stmt_set_outbox->OK()) {
+        LOG_ERROR(Store, "failed to prepare set outbox statement: %s", m_db.ErrStr());
+        return false;
+    }
+
+    m_stmt_get_outbox = std::make_unique<Statement>(m_db, "get_outbox", R"(
+        SELECT nonce, channel, reply_to, content, attachments FROM outbox WHERE user = ? ORDER BY nonce ASC
+    )");
+    if (!m_stmt_get_outbox->OK()) {
+        LOG_ERROR(Store, "failed to prepare get outbox statement: %s", m_db.ErrStr());
+        return false;
+    }
+
+    m_stmt_clr_outbox = std::make_unique<Statement>(m_db, "clr_outbox", R"(
+        DELETE FROM outbox WHERE nonce = ?
+    )");
+    if (!m_stmt_clr_outbox->OK()) {
+        LOG_ERROR(Store, "failed to prepare clear outbox statement: %s", m_db.ErrStr());
         return false;
     }
 
@@ -2205,7 +2687,7 @@ Store::Database::Database(const char *path) {
     if (path != ":memory:"s) {
         std::error_code ec;
         if (std::filesystem::exists(path, ec) && !std::filesystem::remove(path, ec)) {
-            fprintf(stderr, "the database could not be removed. the database may be corrupted as a result\n");
+            LOG_ERROR(Store, "the database could not be removed. the database may be corrupted as a result");
         }
     }
 
@@ -2265,8 +2747,9 @@ Store::Database::type_signal_close Store::Database::signal_close() {
     return m_signal_close;
 }
 
-Store::Statement::Statement(Database &db, const char *command)
-    : m_db(&db) {
+Store::Statement::Statement(Database &db, const char *name, const char *command)
+    : m_db(&db)
+    , m_latency(Metrics::Get().GetHistogram("abaddon_store_query_seconds", "time spent in sqlite per store query, by statement", { { "statement", name } })) {
     if (m_db->SetError(sqlite3_prepare_v2(m_db->obj(), command, -1, &m_stmt, nullptr)) != SQLITE_OK) return;
     m_db->signal_close().connect([this] {
         sqlite3_finalize(m_stmt);
@@ -2315,19 +2798,41 @@ bool Store::Statement::IsNull(int index) const {
     return sqlite3_column_type(m_stmt, index) == SQLITE_NULL;
 }
 
+// only looked up while tracing
+static std::string_view GetTraceSQL(sqlite3_stmt *stmt) {
+    if (!Tracer::Get().IsEnabled() || stmt == nullptr) return {};
+    const char *sql = sqlite3_sql(stmt);
+    if (sql == nullptr) return {};
+    return std::string_view(sql).substr(0, 80);
+}
+
+int Store::Statement::StepTimed() {
+    Tracer::Span span("store", GetTraceSQL(m_stmt));
+    const auto start = std::chrono::steady_clock::now();
+    const int err = m_db->SetError(sqlite3_step(m_stmt));
+    m_elapsed += std::chrono::steady_clock::now() - start;
+    m_stepped = true;
+    return err;
+}
+
 int Store::Statement::Step() {
-    return m_db->SetError(sqlite3_step(m_stmt));
+    return StepTimed();
 }
 
 bool Store::Statement::Insert() {
-    return m_db->SetError(sqlite3_step(m_stmt)) == SQLITE_DONE;
+    return StepTimed() == SQLITE_DONE;
 }
 
 bool Store::Statement::FetchOne() {
-    return m_db->SetError(sqlite3_step(m_stmt)) == SQLITE_ROW;
+    return StepTimed() == SQLITE_ROW;
 }
 
 int Store::Statement::Reset() {
+    if (m_stepped) {
+        m_latency.Observe(std::chrono::duration<double>(m_elapsed).count());
+        m_elapsed = {};
+        m_stepped = false;
+    }
     if (m_db->SetError(sqlite3_reset(m_stmt)) != SQLITE_OK)
         return m_db->Error();
     if (m_db->SetError(sqlite3_clear_bindings(m_stmt)) != SQLITE_OK)
@@ -1,6 +1,9 @@
 #pragma once
 #include "util.hpp"
 #include "objects.hpp"
+#include "flatmap.hpp"
+#include "metrics.hpp"
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 #include <mutex>
@@ -13,7 +16,8 @@
 
 class Store {
 public:
-    Store(bool mem_store = false);
+    // the outbox goes in its own database at outbox_path if given, the rest is deleted on exit
+    Store(bool mem_store = false, const std::string &outbox_path = "");
     ~Store();
 
     bool IsValid() const;
@@ -39,6 +43,25 @@ public:
     std::optional<BanData> GetBan(Snowflake guild_id, Snowflake user_id) const;
     std::vector<BanData> GetBans(Snowflake guild_id) const;
 
+    // same as above but shared and immutable so repeated lookups dont rebuild or copy anything
+    // built on first access and dropped when anything they were built from is written
+    std::shared_ptr<const ChannelData> GetChannelSnapshot(Snowflake id) const;
+    std::shared_ptr<const GuildData> GetGuildSnapshot(Snowflake id) const;
+    std::shared_ptr<const GuildMember> GetGuildMemberSnapshot(Snowflake guild_id, Snowflake user_id) const;
+    std::shared_ptr<const Message> GetMessageSnapshot(Snowflake id) const;
+    std::shared_ptr<const RoleData> GetRoleSnapshot(Snowflake id) const;
+    std::shared_ptr<const UserData> GetUserSnapshot(Snowflake id) const;
+
+    // the roles of a member that matter for display and hierarchy checks, invalid if the member has none
+    // cached per member until the member or any role in the guild changes
+    struct MemberRoles {
+        Snowflake HoistedRole; // highest hoisted role
+        Snowflake ColorRole;   // highest role with a color
+        Snowflake HighestRole;
+        int HighestPosition = -1;
+    };
+    MemberRoles GetMemberRoles(Snowflake guild_id, Snowflake user_id) const;
+
     std::vector<Message> GetLastMessages(Snowflake id, size_t num) const;
     std::vector<Message> GetMessagesBefore(Snowflake channel_id, Snowflake message_id, size_t limit) const;
     std::vector<Message> GetPinnedMessages(Snowflake channel_id) const;
@@ -47,11 +70,50 @@ public:
     std::unordered_set<Snowflake> GetMembersInGuild(Snowflake guild_id) const;
     // ^ not the same as GetUsersInGuild since users in a guild may include users who do not have retrieved member data
 
+    // inclusive span of message ids in a channel that the store has every message for
+    struct MessageRange {
+        constexpr static uint64_t ChannelStart = 0; // start of a range that goes back to the first message in the channel
+
+        Snowflake Start;
+        Snowflake End;
+
+        [[nodiscard]] bool ReachesChannelStart() const {
+            return static_cast<uint64_t>(Start) == ChannelStart;
+        }
+    };
+    std::vector<MessageRange> GetMessageRanges(Snowflake channel_id) const; // ascending, never overlapping
+    std::optional<MessageRange> GetMessageRange(Snowflake channel_id, Snowflake message_id) const;
+    // merged with anything it touches, for fetched pages which should already be inside a transaction
+    void AddMessageRange(Snowflake channel_id, Snowflake start, Snowflake end);
+    // a live message, one update instead of a merge. false if the channel has no ranges or end isnt newer
+    bool ExtendNewestMessageRange(Snowflake channel_id, Snowflake end);
+
+    // a message we sent that discord hasnt confirmed yet
+    // kept apart from everything else so it isnt lost when the rest is cleared on disconnect or the app is closed
+    struct OutboxEntry {
+        struct Attachment {
+            std::string Path;
+            std::string Filename;
+            bool IsTemp = false; // pasted image, deleted once the message is done
+        };
+
+        Snowflake Nonce;
+        Snowflake UserID; // who sent it, only sent again while logged in as them
+        Snowflake ChannelID;
+        Snowflake InReplyToID;
+        std::string Content;
+        std::vector<Attachment> Attachments;
+    };
+    void SetOutboxEntry(const OutboxEntry &entry);
+    std::vector<OutboxEntry> GetOutbox(Snowflake user_id) const; // oldest first
+    void ClearOutboxEntry(Snowflake nonce);
+
     void AddReaction(const MessageReactionAddObject &data, bool byself);
     void RemoveReaction(const MessageReactionRemoveObject &data, bool byself);
 
     void ClearGuild(Snowflake id);
     void ClearChannel(Snowflake id);
+    void ClearMessage(Snowflake id);
     void ClearBan(Snowflake guild_id, Snowflake user_id);
     void ClearRecipient(Snowflake channel_id, Snowflake user_id);
     void ClearRole(Snowflake id);
@@ -98,7 +160,7 @@ private:
     public:
         Statement() = delete;
         Statement(const Statement &other) = delete;
-        Statement(Database &db, const char *command);
+        Statement(Database &db, const char *name, const char *command); // name labels its latency metric
         ~Statement();
         Statement &operator=(Statement &other) = delete;
 
@@ -234,8 +296,15 @@ private:
         sqlite3_stmt *obj();
 
     private:
+        int StepTimed();
+
         Database *m_db;
         sqlite3_stmt *m_stmt;
+
+        // every step until the next reset counts as one query
+        Metrics::Histogram &m_latency;
+        std::chrono::steady_clock::duration m_elapsed {};
+        bool m_stepped = false;
     };
 
     Message GetMessageBound(std::unique_ptr<Statement> &stmt) const;
@@ -243,10 +312,54 @@ private:
 
     void SetMessageInteractionPair(Snowflake message_id, const MessageInteractionData &interaction);
 
+    template<typename T>
+    using snapshot_map = std::unordered_map<Snowflake, std::shared_ptr<const T>>;
+
+    struct SnapshotCounters {
+        Metrics::Counter &Hits;
+        Metrics::Counter &Misses;
+    };
+
+    static SnapshotCounters MakeSnapshotCounters(const char *kind);
+    template<typename T, typename F>
+    static std::shared_ptr<const T> GetSnapshot(snapshot_map<T> &map, Snowflake id, const SnapshotCounters &counters, const F &load);
+    void InvalidateMessageSnapshot(Snowflake id);
+    void ClearSnapshots();
+
+    mutable snapshot_map<ChannelData> m_channel_snapshots;
+    mutable snapshot_map<GuildData> m_guild_snapshots;
+    mutable std::unordered_map<Snowflake, snapshot_map<GuildMember>> m_member_snapshots; // guild -> user
+    mutable snapshot_map<Message> m_message_snapshots;
+    // message snapshots carry copies of the users they mention and of the message they reply to
+    // these point back at them so a write only drops what it affects instead of scanning every snapshot
+    mutable std::unordered_map<Snowflake, std::unordered_set<Snowflake>> m_snapshot_mentions; // user -> messages
+    mutable std::unordered_map<Snowflake, std::unordered_set<Snowflake>> m_snapshot_replies;  // message -> replies
+    mutable snapshot_map<RoleData> m_role_snapshots;
+    mutable snapshot_map<UserData> m_user_snapshots;
+
+    // roles of a guild highest first with what GetMemberRoles needs to know about them
+    struct RoleTable {
+        struct Entry {
+            Snowflake ID;
+            int Position;
+            bool IsHoisted;
+            bool HasColor;
+        };
+        std::vector<Entry> Roles;
+        SnowflakeMap<uint32_t> Ranks; // role id -> index into Roles
+    };
+    const RoleTable &GetRoleTable(Snowflake guild_id) const;
+    void InvalidateGuildRoles(Snowflake guild_id);
+
+    mutable SnowflakeMap<RoleTable> m_role_tables;
+    mutable SnowflakeMap<SnowflakeMap<MemberRoles>> m_member_roles; // guild -> user
+
+    bool AttachOutbox(const std::string &path);
     bool CreateTables();
     bool CreateStatements();
 
     bool m_ok = true;
+    std::string m_outbox_schema = "main";
 
     std::filesystem::path m_db_path;
     Database m_db;
@@ -308,5 +421,14 @@ private:
     STMT(get_chan_ids_parent);
     STMT(get_guild_member_ids);
     STMT(clr_role);
+    STMT(get_msg_ranges);
+    STMT(set_msg_range);
+    STMT(clr_msg_ranges);
+    STMT(clr_msg_range);
+    STMT(ext_msg_range);
+    STMT(clr_msg);
+    STMT(set_outbox);
+    STMT(get_outbox);
+    STMT(clr_outbox);
 #undef STMT
 };
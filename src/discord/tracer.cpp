@@ -0,0 +1,134 @@
+#include "tracer.hpp"
+#include "log.hpp"
+#include <cinttypes>
+#include <cstdio>
+#include <nlohmann/json.hpp>
+
+Tracer::Span::Span(const char *name) {
+    auto &tracer = Get();
+    if (!tracer.IsEnabled()) return;
+    m_name = name;
+    m_session = tracer.m_session.load();
+    m_start = tracer.Now();
+}
+
+Tracer::Span::Span(const char *name, std::string_view detail) {
+    auto &tracer = Get();
+    if (!tracer.IsEnabled()) return;
+    m_name = name;
+    m_detail = detail;
+    m_session = tracer.m_session.load();
+    m_start = tracer.Now();
+}
+
+Tracer::Span::~Span() {
+    if (m_name == nullptr) return;
+    auto &tracer = Get();
+    const auto end = tracer.Now();
+    tracer.Record({ 'X', m_name, std::move(m_detail), GetThreadID(), m_start, end - m_start, 0 }, m_session);
+}
+
+Tracer::Tracer() = default;
+
+Tracer &Tracer::Get() {
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::SetThreadName(std::string name) {
+    auto &tracer = Get();
+    std::lock_guard<std::mutex> l(tracer.m_mutex);
+    tracer.m_thread_names[GetThreadID()] = std::move(name);
+}
+
+void Tracer::Start() {
+    std::lock_guard<std::mutex> l(m_mutex);
+    m_events.clear();
+    m_dropped = false;
+    m_epoch = clock::now().time_since_epoch().count();
+    m_session++;
+    m_enabled = true;
+}
+
+static std::string Quote(std::string_view str) {
+    return nlohmann::json(std::string(str)).dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+}
+
+bool Tracer::Stop(const std::string &path) {
+    if (!m_enabled) return false;
+    m_enabled = false;
+    m_session++;
+
+    std::vector<Event> events;
+    std::map<uint32_t, std::string> names;
+    bool dropped;
+    {
+        std::lock_guard<std::mutex> l(m_mutex);
+        events.swap(m_events);
+        names = m_thread_names;
+        dropped = m_dropped;
+    }
+
+    auto *fp = std::fopen(path.c_str(), "wb");
+    if (fp == nullptr) {
+        LOG_WARN(Tracing, "couldnt open %s to write the trace", path.c_str());
+        return false;
+    }
+
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", fp);
+    const char *separator = "";
+    for (const auto &[tid, name] : names) {
+        std::fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%" PRIu32 ",\"args\":{\"name\":%s}}", separator, tid, Quote(name).c_str());
+        separator = ",\n";
+    }
+    for (const auto &event : events) {
+        std::fprintf(fp, "%s{\"name\":%s,\"cat\":\"abaddon\",\"ph\":\"%c\",\"ts\":%" PRId64 ",\"pid\":1,\"tid\":%" PRIu32,
+                     separator, Quote(event.Name).c_str(), event.Phase, event.Timestamp, event.ThreadID);
+        if (event.Phase == 'X')
+            std::fprintf(fp, ",\"dur\":%" PRId64, event.Duration);
+        else
+            std::fprintf(fp, ",\"id\":\"0x%" PRIx64 "\"", event.ID);
+        if (!event.Detail.empty())
+            std::fprintf(fp, ",\"args\":{\"detail\":%s}", Quote(event.Detail).c_str());
+        std::fputs("}", fp);
+        separator = ",\n";
+    }
+    std::fputs("\n]}\n", fp);
+    std::fclose(fp);
+
+    LOG_INFO(Tracing, "wrote %zu trace events to %s", events.size(), path.c_str());
+    if (dropped)
+        LOG_WARN(Tracing, "trace hit %zu events, anything after that was dropped", MaxEvents);
+    return true;
+}
+
+void Tracer::AsyncBegin(const char *name, uint64_t id, std::string_view detail) {
+    if (!IsEnabled()) return;
+    Record({ 'b', name, std::string(detail), GetThreadID(), Now(), 0, id }, m_session);
+}
+
+void Tracer::AsyncEnd(const char *name, uint64_t id) {
+    if (!IsEnabled()) return;
+    Record({ 'e', name, {}, GetThreadID(), Now(), 0, id }, m_session);
+}
+
+uint32_t Tracer::GetThreadID() {
+    static std::atomic<uint32_t> next = 1;
+    thread_local const uint32_t id = next++;
+    return id;
+}
+
+int64_t Tracer::Now() const {
+    const auto since_start = clock::now().time_since_epoch() - clock::duration(m_epoch.load());
+    return std::chrono::duration_cast<std::chrono::microseconds>(since_start).count();
+}
+
+void Tracer::Record(Event event, uint64_t session) {
+    if (!IsEnabled() || session != m_session) return;
+    std::lock_guard<std::mutex> l(m_mutex);
+    if (m_events.size() >= MaxEvents) {
+        m_dropped = true;
+        return;
+    }
+    m_events.push_back(std::move(event));
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// records what the client is doing on every thread and writes it in chromes trace event format
+// load the file in perfetto (ui.perfetto.dev) or chrome://tracing to see where time goes across threads
+// while its off a span costs one atomic load
+class Tracer {
+public:
+    // one slice from construction to destruction on the calling thread, spans on the same thread have to nest
+    class Span {
+    public:
+        explicit Span(const char *name);
+        Span(const char *name, std::string_view detail); // detail is shown in the slices args
+
+        ~Span();
+
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+    private:
+        const char *m_name = nullptr; // null if tracing was off when it started
+        std::string m_detail;
+        int64_t m_start = 0;
+        uint64_t m_session = 0;
+    };
+
+    static Tracer &Get();
+
+    // names the calling thread in the trace, can be called before tracing starts
+    static void SetThreadName(std::string name);
+
+    // drops anything recorded before
+    void Start();
+    // writes everything recorded since Start to path
+    bool Stop(const std::string &path);
+    [[nodiscard]] bool IsEnabled() const {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    // for work that overlaps on one thread (concurrent downloads), id has to be unique among whats in flight under name
+    void AsyncBegin(const char *name, uint64_t id, std::string_view detail = {});
+    void AsyncEnd(const char *name, uint64_t id);
+
+private:
+    Tracer();
+
+    using clock = std::chrono::steady_clock;
+
+    constexpr static size_t MaxEvents = 2000000; // about 100 MB, later events are dropped
+
+    struct Event {
+        char Phase; // X complete, b/e async begin/end
+        const char *Name;
+        std::string Detail;
+        uint32_t ThreadID;
+        int64_t Timestamp; // microseconds since Start
+        int64_t Duration;
+        uint64_t ID;
+    };
+
+    static uint32_t GetThreadID();
+    [[nodiscard]] int64_t Now() const;
+    void Record(Event event, uint64_t session);
+
+    std::atomic<bool> m_enabled = false;
+    std::atomic<uint64_t> m_session = 0; // spans that started before the last Start or Stop are dropped
+    std::atomic<int64_t> m_epoch = 0;    // clock ticks at Start
+
+    std::mutex m_mutex;
+    std::vector<Event> m_events;
+    bool m_dropped = false;
+    std::map<uint32_t, std::string> m_thread_names;
+};
@@ -1,5 +1,5 @@
 #include "user.hpp"
-#include "abaddon.hpp"
+#include "discord.hpp"
 
 bool UserData::IsABot() const noexcept {
     return IsBot.has_value() && *IsBot;
@@ -18,7 +18,7 @@ bool UserData::HasAnimatedAvatar() const noexcept {
 }
 
 bool UserData::HasAnimatedAvatar(Snowflake guild_id) const {
-    const auto member = Abaddon::Get().GetDiscordClient().GetMember(ID, guild_id);
+    const auto member = DiscordClient::Get().GetMember(ID, guild_id);
     if (member.has_value() && member->Avatar.has_value() && member->Avatar.value()[0] == 'a' && member->Avatar.value()[1] == '_')
         return true;
     else if (member.has_value() && !member->Avatar.has_value())
@@ -34,7 +34,7 @@ bool UserData::HasAnimatedAvatar(const std::optional<Snowflake> &guild_id) const
 }
 
 std::string UserData::GetAvatarURL(Snowflake guild_id, const std::string &ext, std::string size) const {
-    const auto member = Abaddon::Get().GetDiscordClient().GetMember(ID, guild_id);
+    const auto member = DiscordClient::Get().GetMember(ID, guild_id);
     if (member.has_value() && member->Avatar.has_value()) {
         if (ext == "gif" && !(member->Avatar.value()[0] == 'a' && member->Avatar.value()[1] == '_'))
             return GetAvatarURL(ext, size);
@@ -66,7 +66,7 @@ std::string UserData::GetDefaultAvatarURL() const {
 }
 
 Snowflake UserData::GetHoistedRole(Snowflake guild_id, bool with_color) const {
-    return Abaddon::Get().GetDiscordClient().GetMemberHoistedRole(guild_id, ID, with_color);
+    return DiscordClient::Get().GetMemberHoistedRole(guild_id, ID, with_color);
 }
 
 std::string UserData::GetMention() const {
@@ -1,4 +1,5 @@
 #include "websocket.hpp"
+#include "log.hpp"
 #include <utility>
 
 Websocket::Websocket() = default;
@@ -33,7 +34,7 @@ void Websocket::Stop(uint16_t code) {
 
 void Websocket::Send(const std::string &str) {
     if (m_print_messages)
-        printf("sending %s\n", str.c_str());
+        LOG_TRACE(Websocket, "sending %s", str.c_str());
     m_websocket.sendText(str);
 }
 
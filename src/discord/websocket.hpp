@@ -13,6 +13,7 @@ public:
 
     void SetUserAgent(std::string agent);
 
+    // sent payloads are logged at trace level, turned off around anything with the token in it
     bool GetPrintMessages() const noexcept;
     void SetPrintMessages(bool show) noexcept;
 
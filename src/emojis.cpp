@@ -53,7 +53,7 @@ bool EmojiResource::Load() {
         surrogates_count = emojis_int32_correct_endian(surrogates_count);
         std::string surrogates(surrogates_count, '\0');
         std::fread(surrogates.data(), surrogates_count, 1, m_fp);
-        m_patterns.emplace_back(surrogates);
+        m_matcher.Add(surrogates);
 
         int data_size, data_offset;
         std::fread(&data_size, 4, 1, m_fp);
@@ -67,10 +67,6 @@ bool EmojiResource::Load() {
 
         m_pattern_shortcode_index[surrogates] = std::move(shortcodes);
     }
-
-    std::sort(m_patterns.begin(), m_patterns.end(), [](const Glib::ustring &a, const Glib::ustring &b) {
-        return a.size() > b.size();
-    });
     return true;
 }
 
@@ -88,42 +84,8 @@ Glib::RefPtr<Gdk::Pixbuf> EmojiResource::GetPixBuf(const Glib::ustring &pattern)
     return loader->get_pixbuf();
 }
 
-void EmojiResource::ReplaceEmojis(Glib::RefPtr<Gtk::TextBuffer> buf, int size) {
-    auto get_text = [&]() -> auto {
-        Gtk::TextBuffer::iterator a, b;
-        buf->get_bounds(a, b);
-        return buf->get_slice(a, b, true);
-    };
-    auto text = get_text();
-
-    int searchpos;
-    for (const auto &pattern : m_patterns) {
-        searchpos = 0;
-        Glib::RefPtr<Gdk::Pixbuf> pixbuf;
-        while (true) {
-            size_t r = text.find(pattern, searchpos);
-            if (r == Glib::ustring::npos) break;
-            if (!pixbuf) {
-                pixbuf = GetPixBuf(pattern);
-                if (pixbuf)
-                    pixbuf = pixbuf->scale_simple(size, size, Gdk::INTERP_BILINEAR);
-                else
-                    break;
-            }
-            searchpos = static_cast<int>(r + pattern.size());
-
-            const auto start_it = buf->get_iter_at_offset(static_cast<int>(r));
-            const auto end_it = buf->get_iter_at_offset(static_cast<int>(r + pattern.size()));
-
-            auto it = buf->erase(start_it, end_it);
-            buf->insert_pixbuf(it, pixbuf);
-
-            int alen = static_cast<int>(text.size());
-            text = get_text();
-            int blen = static_cast<int>(text.size());
-            searchpos -= (alen - blen);
-        }
-    }
+const StockEmojiMatcher &EmojiResource::GetMatcher() const {
+    return m_matcher;
 }
 
 std::string EmojiResource::GetShortCodeForPattern(const Glib::ustring &pattern) {
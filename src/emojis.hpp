@@ -4,6 +4,7 @@
 #include <unordered_map>
 #include <vector>
 #include <gtkmm.h>
+#include "discord/contenttokenizer.hpp"
 
 // shoutout to gtk for only supporting .svg's sometimes
 
@@ -13,7 +14,7 @@ public:
     bool Load();
     Glib::RefPtr<Gdk::Pixbuf> GetPixBuf(const Glib::ustring &pattern);
     const std::map<std::string, std::string> &GetShortCodes() const;
-    void ReplaceEmojis(Glib::RefPtr<Gtk::TextBuffer> buf, int size = 24);
+    const StockEmojiMatcher &GetMatcher() const;
     std::string GetShortCodeForPattern(const Glib::ustring &pattern);
 
 private:
@@ -22,5 +23,5 @@ private:
     std::unordered_map<std::string, std::pair<int, int>> m_index; // pattern -> [pos, len]
     FILE *m_fp = nullptr;
     std::string m_filepath;
-    std::vector<Glib::ustring> m_patterns;
+    StockEmojiMatcher m_matcher;
 };
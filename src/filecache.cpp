@@ -3,6 +3,8 @@
 
 #include <utility>
 #include "MurmurHash3.h"
+#include "discord/log.hpp"
+#include "discord/tracer.hpp"
 
 std::string GetCachedName(const std::string &str) {
     uint32_t out;
@@ -10,7 +12,14 @@ std::string GetCachedName(const std::string &str) {
     return std::to_string(out);
 }
 
-Cache::Cache() {
+static Metrics::Counter &GetLookupCounter(const char *result) {
+    return Metrics::Get().GetCounter("abaddon_image_cache_lookups_total", "file cache lookups, by whether it was on disk, already downloading, or had to be downloaded", { { "result", result } });
+}
+
+Cache::Cache()
+    : m_disk_hits(GetLookupCounter("disk"))
+    , m_joined(GetLookupCounter("pending"))
+    , m_downloads(GetLookupCounter("download")) {
     m_tmp_path = std::filesystem::temp_directory_path() / "abaddon-cache";
     std::filesystem::create_directories(m_tmp_path);
     m_worker.set_file_path(m_tmp_path);
@@ -29,7 +38,7 @@ Cache::~Cache() {
 
     std::error_code err;
     if (!std::filesystem::remove_all(m_tmp_path, err))
-        fprintf(stderr, "error removing tmp dir\n");
+        LOG_ERROR(Images, "error removing tmp dir");
 }
 
 void Cache::ClearCache() {
@@ -44,6 +53,7 @@ void Cache::RespondFromPath(const std::filesystem::path &path, const callback_ty
 void Cache::GetFileFromURL(const std::string &url, const callback_type &cb) {
     auto cache_path = m_tmp_path / GetCachedName(url);
     if (std::filesystem::exists(cache_path)) {
+        m_disk_hits.Inc();
         m_mutex.lock();
         m_futures.push_back(std::async(std::launch::async, [cache_path, cb]() { RespondFromPath(cache_path, cb); }));
         m_mutex.unlock();
@@ -51,8 +61,10 @@ void Cache::GetFileFromURL(const std::string &url, const callback_type &cb) {
     }
 
     if (m_callbacks.find(url) != m_callbacks.end()) {
+        m_joined.Inc();
         m_callbacks[url].push_back(cb);
     } else {
+        m_downloads.Inc();
         m_callbacks[url].push_back(cb);
         m_worker.add_image(url, [this, url](const std::string &path) {
             OnFetchComplete(url);
@@ -100,7 +112,9 @@ void Cache::OnFetchComplete(const std::string &url) {
     m_mutex.unlock();
 }
 
-FileCacheWorkerThread::FileCacheWorkerThread() {
+FileCacheWorkerThread::FileCacheWorkerThread()
+    : m_queue_depth(Metrics::Get().GetGauge("abaddon_image_queue_depth", "images waiting for a download slot"))
+    , m_active_downloads(Metrics::Get().GetGauge("abaddon_image_downloads_active", "images being downloaded")) {
     m_multi_handle = curl_multi_init();
     m_thread = std::thread([this] { loop(); });
 }
@@ -119,6 +133,7 @@ void FileCacheWorkerThread::set_file_path(const std::filesystem::path &path) {
 void FileCacheWorkerThread::add_image(const std::string &string, callback_type callback) {
     m_queue_mutex.lock();
     m_queue.push({ string, std::move(callback) });
+    m_queue_depth.Add(1);
     m_cv.notify_one();
     m_queue_mutex.unlock();
 }
@@ -132,6 +147,7 @@ void FileCacheWorkerThread::stop() {
 }
 
 void FileCacheWorkerThread::loop() {
+    Tracer::SetThreadName("file cache");
     timeval timeout {};
     timeout.tv_sec = 1;
     timeout.tv_usec = 0;
@@ -150,12 +166,13 @@ void FileCacheWorkerThread::loop() {
             if (!m_queue.empty()) {
                 entry = std::move(m_queue.front());
                 m_queue.pop();
+                m_queue_depth.Add(-1);
             }
             m_queue_mutex.unlock();
 
             if (entry.has_value()) {
                 if (m_callbacks.find(entry->URL) != m_callbacks.end()) {
-                    printf("url is being requested twice :(\n");
+                    LOG_DEBUG(Images, "url is being requested twice :(");
                     continue;
                 }
 
@@ -163,7 +180,7 @@ void FileCacheWorkerThread::loop() {
                 auto path = m_data_path / (GetCachedName(entry->URL) + "!");
                 FILE *fp = std::fopen(path.string().c_str(), "wb");
                 if (fp == nullptr) {
-                    printf("couldn't open fp\n");
+                    LOG_ERROR(Images, "couldn't open fp");
                     continue;
                 }
 
@@ -179,6 +196,8 @@ void FileCacheWorkerThread::loop() {
                 m_paths[entry->URL] = std::move(path);
 
                 curl_multi_add_handle(m_multi_handle, handle);
+                m_active_downloads.Set(static_cast<double>(m_handles.size()));
+                Tracer::Get().AsyncBegin("image download", reinterpret_cast<uintptr_t>(handle), entry->URL);
             }
         }
 
@@ -201,11 +220,13 @@ void FileCacheWorkerThread::loop() {
         int num_msgs;
         while (auto msg = curl_multi_info_read(m_multi_handle, &num_msgs)) {
             if (msg->msg == CURLMSG_DONE) {
+                Tracer::Get().AsyncEnd("image download", reinterpret_cast<uintptr_t>(msg->easy_handle));
                 auto url = m_handle_urls.at(msg->easy_handle);
                 auto fp = m_curl_file_handles.find(msg->easy_handle);
                 std::fclose(fp->second);
 
                 m_handles.erase(msg->easy_handle);
+                m_active_downloads.Set(static_cast<double>(m_handles.size()));
                 m_handle_urls.erase(msg->easy_handle);
 
                 curl_multi_remove_handle(m_multi_handle, msg->easy_handle);
@@ -10,6 +10,7 @@
 #include <mutex>
 #include "util.hpp"
 #include "http.hpp"
+#include "discord/metrics.hpp"
 
 class FileCacheWorkerThread {
 public:
@@ -51,6 +52,9 @@ private:
     CURLM *m_multi_handle;
 
     std::filesystem::path m_data_path;
+
+    Metrics::Gauge &m_queue_depth;
+    Metrics::Gauge &m_active_downloads;
 };
 
 class Cache {
@@ -76,4 +80,8 @@ private:
     mutable std::mutex m_mutex;
 
     FileCacheWorkerThread m_worker;
+
+    Metrics::Counter &m_disk_hits;
+    Metrics::Counter &m_joined;
+    Metrics::Counter &m_downloads;
 };
@@ -0,0 +1,68 @@
+#include "gtkutil.hpp"
+
+void LaunchBrowser(const Glib::ustring &url) {
+    GError *err = nullptr;
+    if (!gtk_show_uri_on_window(nullptr, url.c_str(), GDK_CURRENT_TIME, &err))
+        printf("failed to open uri: %s\n", err->message);
+}
+
+void ScrollListBoxToSelected(Gtk::ListBox &list) {
+    auto cb = [&list]() -> bool {
+        const auto selected = list.get_selected_row();
+        if (selected == nullptr) return false;
+        int x, y;
+        selected->translate_coordinates(list, 0, 0, x, y);
+        if (y < 0) return false;
+        const auto adj = list.get_adjustment();
+        if (!adj) return false;
+        int min, nat;
+        selected->get_preferred_height(min, nat);
+        adj->set_value(y - (adj->get_page_size() - nat) / 2.0);
+
+        return false;
+    };
+    Glib::signal_idle().connect(sigc::track_obj(cb, list));
+}
+
+Gdk::RGBA IntToRGBA(int color) {
+    Gdk::RGBA ret;
+    ret.set_red(((color & 0xFF0000) >> 16) / 255.0);
+    ret.set_green(((color & 0x00FF00) >> 8) / 255.0);
+    ret.set_blue(((color & 0x0000FF) >> 0) / 255.0);
+    ret.set_alpha(255.0);
+    return ret;
+}
+
+uint32_t RGBAToInt(const Gdk::RGBA &color) {
+    uint32_t ret = 0;
+    ret |= static_cast<uint32_t>(color.get_blue() * 255.0) << 0;
+    ret |= static_cast<uint32_t>(color.get_green() * 255.0) << 8;
+    ret |= static_cast<uint32_t>(color.get_red() * 255.0) << 16;
+    return ret;
+}
+
+// so widgets can modify the menu before it is displayed
+// maybe theres a better way to do this idk
+void AddWidgetMenuHandler(Gtk::Widget *widget, Gtk::Menu &menu, const sigc::slot<void()> &pre_callback) {
+    sigc::signal<void()> signal;
+    signal.connect(pre_callback);
+    widget->signal_button_press_event().connect([&menu, signal](GdkEventButton *ev) -> bool {
+        if (ev->type == GDK_BUTTON_PRESS && ev->button == GDK_BUTTON_SECONDARY) {
+            signal.emit();
+            menu.popup_at_pointer(reinterpret_cast<const GdkEvent *>(ev));
+            return true;
+        }
+        return false;
+        // clang-format off
+    }, false);
+    // clang-format on
+}
+
+void AddPointerCursor(Gtk::Widget &widget) {
+    widget.signal_realize().connect([&widget]() {
+        auto window = widget.get_window();
+        auto display = window->get_display();
+        auto cursor = Gdk::Cursor::create(display, "pointer");
+        window->set_cursor(cursor);
+    });
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <cstdint>
+#include <gtkmm.h>
+
+// helpers that need gtk, kept out of util.hpp so abaddon-core doesnt depend on it
+
+void LaunchBrowser(const Glib::ustring &url);
+Gdk::RGBA IntToRGBA(int color);
+uint32_t RGBAToInt(const Gdk::RGBA &color);
+void AddWidgetMenuHandler(Gtk::Widget *widget, Gtk::Menu &menu, const sigc::slot<void()> &pre_callback);
+void AddPointerCursor(Gtk::Widget &widget);
+void ScrollListBoxToSelected(Gtk::ListBox &list);
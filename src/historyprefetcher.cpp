@@ -0,0 +1,237 @@
+#include "historyprefetcher.hpp"
+#include <algorithm>
+#include <cinttypes>
+#include "abaddon.hpp"
+#include "discord/log.hpp"
+#include "discord/metrics.hpp"
+
+static void CountOpened(const char *result) {
+    Metrics::Get().GetCounter("abaddon_prefetch_opened_total", "channels opened, by whether the prefetcher had warmed them", { { "result", result } }).Inc();
+}
+
+HistoryPrefetcher::HistoryPrefetcher(DiscordClient &discord, ImageManager &img_mgr)
+    : m_discord(discord)
+    , m_img_mgr(img_mgr) {
+    m_discord.signal_message_create().connect([this](const Message &message) {
+        if (message.DoesMention(m_discord.GetUserData().ID))
+            Hint(message.ChannelID, Reason::Mention);
+    });
+}
+
+void HistoryPrefetcher::Clear() {
+    // the response is about to be dropped but the user is still waiting on it
+    const auto adopted = m_in_flight && m_in_flight_adopted ? m_in_flight_channel : Snowflake::Invalid;
+    m_generation++;
+    m_queue.clear();
+    m_done.clear();
+    m_warm.clear();
+    m_in_flight = false;
+    m_in_flight_channel = Snowflake::Invalid;
+    m_in_flight_adopted = false;
+    m_hover_conn.disconnect();
+    m_pump_conn.disconnect();
+    if (adopted.IsValid())
+        m_signal_adopted_failed.emit(adopted);
+}
+
+void HistoryPrefetcher::Hint(Snowflake channel_id, Reason reason) {
+    if (!IsEnabled() || m_done.find(channel_id) != m_done.end()) return;
+
+    // already queued for something at least as likely
+    const auto existing = std::find_if(m_queue.begin(), m_queue.end(), [&](const Candidate &c) { return c.ChannelID == channel_id; });
+    if (existing != m_queue.end()) {
+        if (existing->Why <= reason) return;
+        m_queue.erase(existing);
+    }
+
+    // newest hint goes first among its own kind
+    const auto pos = std::find_if(m_queue.begin(), m_queue.end(), [&](const Candidate &c) { return c.Why >= reason; });
+    m_queue.insert(pos, { channel_id, reason });
+    if (m_queue.size() > MaxQueued)
+        m_queue.pop_back();
+
+    Pump();
+}
+
+void HistoryPrefetcher::HintHovered(Snowflake channel_id) {
+    m_hover_conn.disconnect();
+    if (!channel_id.IsValid() || !IsEnabled()) return;
+    const auto cb = [this, channel_id]() -> bool {
+        Hint(channel_id, Reason::Hover);
+        return false;
+    };
+    m_hover_conn = Glib::signal_timeout().connect(cb, HoverDelayMilliseconds);
+}
+
+bool HistoryPrefetcher::OnChannelOpened(Snowflake channel_id, bool needs_fetch) {
+    m_done.insert(channel_id);
+    Dequeue(channel_id);
+    // too late to be warm but theres no point asking for the same page twice
+    const bool adopted = m_in_flight && m_in_flight_channel == channel_id;
+    if (adopted)
+        m_in_flight_adopted = true;
+    const bool was_warm = m_warm.erase(channel_id) > 0;
+    if (!IsEnabled()) return adopted;
+
+    if (needs_fetch && adopted) {
+        m_stats.Adopted++;
+        CountOpened("adopted");
+    } else if (needs_fetch) {
+        m_stats.Misses++;
+        CountOpened("miss");
+    } else if (was_warm) {
+        m_stats.Hits++;
+        CountOpened("hit");
+    } else
+        return adopted; // opened before, doesnt say anything about the prefetcher
+    PrintStats();
+    return adopted;
+}
+
+const HistoryPrefetcher::Stats &HistoryPrefetcher::GetStats() const {
+    return m_stats;
+}
+
+bool HistoryPrefetcher::IsEnabled() const {
+    return Abaddon::Get().GetSettings().PrefetchHistory;
+}
+
+bool HistoryPrefetcher::CanFetch(Snowflake channel_id) const {
+    if (m_done.find(channel_id) != m_done.end()) return false;
+    const auto channel = m_discord.GetChannelSnapshot(channel_id);
+    if (channel == nullptr) return false;
+    if (channel->IsDM()) return true;
+    if (!channel->IsText() && !channel->IsThread()) return false;
+    return m_discord.HasChannelPermission(m_discord.GetUserData().ID, channel_id, Permission::VIEW_CHANNEL);
+}
+
+void HistoryPrefetcher::Dequeue(Snowflake channel_id) {
+    m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(), [&](const Candidate &c) { return c.ChannelID == channel_id; }), m_queue.end());
+}
+
+void HistoryPrefetcher::Pump() {
+    if (m_in_flight || m_queue.empty() || m_pump_conn.connected() || !IsEnabled()) return;
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now < m_paused_until) {
+        SchedulePump(m_paused_until - now);
+        return;
+    }
+
+    const auto refill = std::chrono::milliseconds(BudgetRefillMilliseconds);
+    if (m_budget >= BudgetBurst) {
+        m_last_refill = now;
+    } else {
+        const auto refilled = static_cast<int>((now - m_last_refill) / refill);
+        m_budget = std::min(BudgetBurst, m_budget + refilled);
+        m_last_refill += refilled * refill;
+    }
+    if (m_budget == 0) {
+        SchedulePump(m_last_refill + refill - now);
+        return;
+    }
+
+    while (!m_queue.empty()) {
+        const auto channel_id = m_queue.front().ChannelID;
+        const auto reason = m_queue.front().Why;
+        m_queue.pop_front();
+        if (!CanFetch(channel_id)) continue;
+
+        m_budget--;
+        m_in_flight = true;
+        m_in_flight_channel = channel_id;
+        m_in_flight_reason = reason;
+        m_in_flight_adopted = false;
+        m_done.insert(channel_id);
+        const auto generation = m_generation;
+        m_discord.FetchMessagesInChannel(
+            channel_id,
+            [this, channel_id, generation](const std::vector<Message> &msgs) {
+                if (generation == m_generation) OnFetched(channel_id, msgs);
+            },
+            [this, channel_id, generation](const http::response_type &r) {
+                if (generation == m_generation) OnFailed(channel_id, r);
+            });
+        return;
+    }
+}
+
+void HistoryPrefetcher::SchedulePump(std::chrono::steady_clock::duration delay) {
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(delay).count() + 1;
+    const auto cb = [this]() -> bool {
+        m_pump_conn.disconnect();
+        Pump();
+        return false;
+    };
+    m_pump_conn = Glib::signal_timeout().connect(cb, static_cast<unsigned>(ms));
+}
+
+void HistoryPrefetcher::OnFetched(Snowflake channel_id, const std::vector<Message> &msgs) {
+    m_in_flight = false;
+    m_stats.Fetched++;
+    Metrics::Get().GetCounter("abaddon_prefetch_fetched_total", "channel pages warmed by the prefetcher").Inc();
+    if (!m_in_flight_adopted)
+        m_warm.insert(channel_id);
+    m_in_flight_channel = Snowflake::Invalid;
+    m_in_flight_adopted = false;
+    PrefetchImages(msgs);
+    m_signal_prefetched.emit(channel_id, msgs);
+    Pump();
+}
+
+void HistoryPrefetcher::OnFailed(Snowflake channel_id, const http::response_type &r) {
+    const bool opened = m_in_flight_adopted;
+    const auto reason = m_in_flight_reason;
+    m_in_flight = false;
+    m_in_flight_channel = Snowflake::Invalid;
+    m_in_flight_adopted = false;
+    if (r.status_code == http::TooManyRequests) {
+        // back off and try it again later, this shouldnt get in the way of anything the user actually does
+        m_stats.RateLimited++;
+        Metrics::Get().GetCounter("abaddon_prefetch_rate_limited_total", "prefetches that got a 429").Inc();
+        auto backoff = std::chrono::milliseconds(DefaultBackoffMilliseconds);
+        try {
+            const RateLimitedResponse data = nlohmann::json::parse(r.text);
+            backoff = std::chrono::milliseconds(static_cast<int64_t>(data.RetryAfter * 1000.0f) + 1);
+        } catch (...) {}
+        m_paused_until = std::chrono::steady_clock::now() + backoff;
+        LOG_INFO(Prefetch, "history prefetch rate limited, pausing for %" PRId64 "ms", static_cast<int64_t>(backoff.count()));
+        if (!opened) {
+            m_done.erase(channel_id);
+            Hint(channel_id, reason);
+        }
+    }
+    // whoever opened it is still waiting on this
+    if (opened)
+        m_signal_adopted_failed.emit(channel_id);
+    Pump();
+}
+
+void HistoryPrefetcher::PrefetchImages(const std::vector<Message> &msgs) {
+    const bool animations = Abaddon::Get().GetSettings().ShowAnimations;
+    std::unordered_set<std::string> urls;
+    for (const auto &msg : msgs) {
+        if (msg.Author.HasAvatar())
+            urls.insert(msg.Author.GetAvatarURL(msg.GuildID));
+        for (const auto &span : TokenizeContent(msg.Content, ContentTokenFlags::CustomEmojis)) {
+            if (span.Type != ContentSpanType::CustomEmoji) continue;
+            urls.insert(span.IsAnimated && animations ? EmojiData::URLFromID(span.ID, "gif") : EmojiData::URLFromID(span.ID));
+        }
+    }
+    for (const auto &url : urls)
+        m_img_mgr.Prefetch(url);
+}
+
+void HistoryPrefetcher::PrintStats() const {
+    const auto opened = m_stats.Hits + m_stats.Misses + m_stats.Adopted;
+    LOG_INFO(Prefetch, "history prefetch: %" PRIu64 "/%" PRIu64 " opened channels were warm (%" PRIu64 "%%), %" PRIu64 " still loading, %" PRIu64 " pages fetched, %" PRIu64 " rate limited",
+             m_stats.Hits, opened, opened == 0 ? 0 : m_stats.Hits * 100 / opened, m_stats.Adopted, m_stats.Fetched, m_stats.RateLimited);
+}
+
+HistoryPrefetcher::type_signal_prefetched HistoryPrefetcher::signal_prefetched() {
+    return m_signal_prefetched;
+}
+
+HistoryPrefetcher::type_signal_adopted_failed HistoryPrefetcher::signal_adopted_failed() {
+    return m_signal_adopted_failed;
+}
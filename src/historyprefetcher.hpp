@@ -0,0 +1,98 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <unordered_set>
+#include <vector>
+#include <glibmm.h>
+#include "discord/message.hpp"
+#include "http.hpp"
+
+class DiscordClient;
+class ImageManager;
+
+// fetches the latest page of channels that are likely to be opened next so opening them doesnt wait on the api
+// only a few requests are allowed in a short window, one at a time, and everything stops for a bit if we get rate limited
+class HistoryPrefetcher {
+public:
+    // most likely to be opened soon first
+    enum class Reason {
+        Hover,   // pointer resting on it in the channel list
+        Mention, // has unread mentions
+        Tab,     // open in a tab
+    };
+
+    struct Stats {
+        uint64_t Fetched = 0;     // pages warmed
+        uint64_t Hits = 0;        // opened after being warmed
+        uint64_t Misses = 0;      // opened and had to wait on the api
+        uint64_t Adopted = 0;     // opened while its page was already on the way
+        uint64_t RateLimited = 0; // 429s we ran into
+    };
+
+    HistoryPrefetcher(DiscordClient &discord, ImageManager &img_mgr);
+
+    void Clear();
+
+    void Hint(Snowflake channel_id, Reason reason);
+    // only hinted once the pointer stays on the same channel for a moment
+    void HintHovered(Snowflake channel_id);
+    // needs_fetch is whether opening it had to wait on the api
+    // returns true if its page is already being fetched, signal_prefetched or signal_adopted_failed will follow
+    bool OnChannelOpened(Snowflake channel_id, bool needs_fetch);
+
+    [[nodiscard]] const Stats &GetStats() const;
+
+private:
+    struct Candidate {
+        Snowflake ChannelID;
+        Reason Why;
+    };
+
+    constexpr static unsigned HoverDelayMilliseconds = 250;
+    constexpr static int BudgetBurst = 3;                         // requests that can go out back to back
+    constexpr static unsigned BudgetRefillMilliseconds = 2000;    // one more request is allowed this often
+    constexpr static unsigned DefaultBackoffMilliseconds = 10000; // if a 429 doesnt say how long to wait
+    constexpr static size_t MaxQueued = 32;
+
+    [[nodiscard]] bool IsEnabled() const;
+    [[nodiscard]] bool CanFetch(Snowflake channel_id) const;
+    void Dequeue(Snowflake channel_id);
+    void Pump();
+    void SchedulePump(std::chrono::steady_clock::duration delay);
+    void OnFetched(Snowflake channel_id, const std::vector<Message> &msgs);
+    void OnFailed(Snowflake channel_id, const http::response_type &r);
+    void PrefetchImages(const std::vector<Message> &msgs);
+    void PrintStats() const;
+
+    DiscordClient &m_discord;
+    ImageManager &m_img_mgr;
+
+    std::deque<Candidate> m_queue; // ordered by reason
+    std::unordered_set<Snowflake> m_done; // warmed, tried, or opened by the user
+    std::unordered_set<Snowflake> m_warm; // warmed and not opened yet
+    bool m_in_flight = false;
+    Snowflake m_in_flight_channel;
+    Reason m_in_flight_reason = Reason::Tab;
+    bool m_in_flight_adopted = false; // the user opened it while it was in flight
+    uint64_t m_generation = 0; // bumped on clear so late responses are dropped
+
+    int m_budget = BudgetBurst;
+    std::chrono::steady_clock::time_point m_last_refill;
+    std::chrono::steady_clock::time_point m_paused_until;
+
+    sigc::connection m_hover_conn;
+    sigc::connection m_pump_conn;
+
+    Stats m_stats;
+
+public:
+    using type_signal_prefetched = sigc::signal<void, Snowflake, const std::vector<Message> &>; // channel id, messages (newest first)
+    using type_signal_adopted_failed = sigc::signal<void, Snowflake>; // channel id
+    type_signal_prefetched signal_prefetched();
+    type_signal_adopted_failed signal_adopted_failed();
+
+private:
+    type_signal_prefetched m_signal_prefetched;
+    type_signal_adopted_failed m_signal_adopted_failed;
+};
@@ -1,6 +1,8 @@
 #include "http.hpp"
 
 #include <utility>
+#include <glib/gstdio.h>
+#include "discord/tracer.hpp"
 
 // #define USE_LOCAL_PROXY
 
@@ -38,6 +40,7 @@ request::request(request &&other) noexcept
     , m_header_list(std::exchange(other.m_header_list, nullptr))
     , m_form(std::exchange(other.m_form, nullptr))
     , m_read_streams(std::move(other.m_read_streams))
+    , m_file_parts(std::move(other.m_file_parts))
     , m_progress_callback(std::move(other.m_progress_callback)) {
     if (m_progress_callback) {
         curl_easy_setopt(m_curl, CURLOPT_XFERINFODATA, this);
@@ -117,21 +120,73 @@ static size_t http_readfunc(char *buffer, size_t size, size_t nitems, void *arg)
     return r;
 }
 
+// local files are read straight through stdio with a big buffer instead of a gio stream per chunk
+constexpr static size_t FileReadBufferSize = 1024 * 1024;
+constexpr static long UploadBufferSize = 512 * 1024; // how much curl asks for at once
+
+static size_t http_file_readfunc(char *buffer, size_t size, size_t nitems, void *arg) {
+    auto *fp = static_cast<FILE *>(arg);
+    const size_t n = fread(buffer, 1, size * nitems, fp);
+    if (n == 0 && ferror(fp)) return CURL_READFUNC_ABORT;
+    return n;
+}
+
+// curl rewinds when it has to send the body again (redirects, auth)
+static int http_file_seekfunc(void *arg, curl_off_t offset, int origin) {
+    auto *fp = static_cast<FILE *>(arg);
+#ifdef _WIN32
+    const int r = _fseeki64(fp, offset, origin);
+#else
+    const int r = fseeko(fp, static_cast<off_t>(offset), origin);
+#endif
+    return r == 0 ? CURL_SEEKFUNC_OK : CURL_SEEKFUNC_CANTSEEK;
+}
+
+static void http_file_freefunc(void *arg) {
+    fclose(static_cast<FILE *>(arg));
+}
+
 // file must exist until request completes
 void request::add_file(std::string_view name, const Glib::RefPtr<Gio::File> &file, std::string_view filename) {
-    if (!file->query_exists()) return;
+    // local files are opened in execute so nothing here touches the disk
+    auto path = file->get_path();
+    if (path.empty() && !file->query_exists()) return;
 
     auto *field = curl_mime_addpart(m_form);
     curl_mime_name(field, name.data());
+    curl_mime_filename(field, filename.data());
+
+    if (!path.empty()) {
+        m_file_parts.push_back({ field, std::move(path) });
+        return;
+    }
+
     auto info = file->query_info();
     auto stream = file->read();
     curl_mime_data_cb(field, info->get_size(), http_readfunc, nullptr, nullptr, stream->gobj());
-    curl_mime_filename(field, filename.data());
 
     // hold ref
     m_read_streams.insert(stream);
 }
 
+bool request::open_files(std::string &error) {
+    for (const auto &[part, path] : m_file_parts) {
+        GStatBuf st;
+        FILE *fp = nullptr;
+        if (g_stat(path.c_str(), &st) != 0 || (fp = g_fopen(path.c_str(), "rb")) == nullptr) {
+            error = "couldnt open " + path;
+            return false;
+        }
+        setvbuf(fp, nullptr, _IOFBF, FileReadBufferSize);
+        // curl owns it from here and closes it when the form is freed
+        curl_mime_data_cb(part, static_cast<curl_off_t>(st.st_size), http_file_readfunc, http_file_seekfunc, http_file_freefunc, fp);
+    }
+    if (!m_file_parts.empty())
+        curl_easy_setopt(m_curl, CURLOPT_UPLOAD_BUFFERSIZE, UploadBufferSize);
+    m_file_parts.clear();
+    return true;
+}
+
 // copied
 void request::add_field(std::string_view name, const char *data, size_t size) {
     auto *field = curl_mime_addpart(m_form);
@@ -140,6 +195,7 @@ void request::add_field(std::string_view name, const char *data, size_t size) {
 }
 
 response request::execute() {
+    Tracer::Span span("http request", m_url);
     if (m_curl == nullptr) {
         auto response = detail::make_response(m_url, EStatusCode::ClientErrorCURLInit);
         response.error_string = "curl pointer is null";
@@ -160,8 +216,15 @@ response request::execute() {
     curl_easy_setopt(m_curl, CURLOPT_WRITEDATA, &str);
     if (m_header_list != nullptr)
         curl_easy_setopt(m_curl, CURLOPT_HTTPHEADER, m_header_list);
-    if (m_form != nullptr)
+    if (m_form != nullptr) {
+        std::string error;
+        if (!open_files(error)) {
+            auto response = detail::make_response(m_url, EStatusCode::ClientErrorFileRead);
+            response.error_string = error;
+            return response;
+        }
         curl_easy_setopt(m_curl, CURLOPT_MIMEPOST, m_form);
+    }
 
     CURLcode result = curl_easy_perform(m_curl);
     if (result != CURLE_OK) {
@@ -175,6 +238,7 @@ response request::execute() {
 
     auto response = detail::make_response(m_url, response_code);
     response.text = str;
+    curl_easy_getinfo(m_curl, CURLINFO_TOTAL_TIME, &response.elapsed);
 
     return response;
 }
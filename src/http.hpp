@@ -3,6 +3,7 @@
 #include <functional>
 #include <set>
 #include <string>
+#include <vector>
 #include <curl/curl.h>
 #include <giomm/file.h>
 
@@ -79,6 +80,7 @@ enum EStatusCode : int {
     ClientError = 1,
     ClientErrorCURLInit,
     ClientErrorCURLPerform,
+    ClientErrorFileRead,
     ClientErrorMax = 99,
 };
 
@@ -94,6 +96,7 @@ struct response {
     EStatusCode status_code;
     std::string text;
     std::string url;
+    double elapsed = 0.0; // seconds
     bool error = false;
     std::string error_string;
 };
@@ -125,7 +128,14 @@ struct request {
     CURL *get_curl();
 
 private:
+    // a file part that is opened when the request runs instead of when its added
+    struct file_part {
+        curl_mimepart *part;
+        std::string path;
+    };
+
     void prepare();
+    bool open_files(std::string &error);
 
     CURL *m_curl;
     std::string m_url;
@@ -135,6 +145,7 @@ private:
     std::function<void(curl_off_t, curl_off_t)> m_progress_callback;
 
     std::set<Glib::RefPtr<Gio::FileInputStream>> m_read_streams;
+    std::vector<file_part> m_file_parts;
 
     friend size_t http_req_xferinfofunc(void *, curl_off_t, curl_off_t, curl_off_t, curl_off_t);
 };
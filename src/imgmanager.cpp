@@ -3,6 +3,9 @@
 #include <utility>
 #include "util.hpp"
 #include "abaddon.hpp"
+#include "discord/log.hpp"
+#include "discord/loopprofiler.hpp"
+#include "discord/tracer.hpp"
 
 ImageManager::ImageManager() {
     m_cb_dispatcher.connect(sigc::mem_fun(*this, &ImageManager::RunCallbacks));
@@ -13,6 +16,7 @@ void ImageManager::ClearCache() {
 }
 
 Glib::RefPtr<Gdk::Pixbuf> ImageManager::ReadFileToPixbuf(std::string path) {
+    Tracer::Span span("image decode", path);
     const auto &data = ReadWholeFile(std::move(path));
     if (data.empty()) return Glib::RefPtr<Gdk::Pixbuf>(nullptr);
     auto loader = Gdk::PixbufLoader::create();
@@ -27,6 +31,7 @@ Glib::RefPtr<Gdk::Pixbuf> ImageManager::ReadFileToPixbuf(std::string path) {
 }
 
 Glib::RefPtr<Gdk::PixbufAnimation> ImageManager::ReadFileToPixbufAnimation(std::string path, int w, int h) {
+    Tracer::Span span("image decode", path);
     const auto &data = ReadWholeFile(std::move(path));
     if (data.empty()) return Glib::RefPtr<Gdk::PixbufAnimation>(nullptr);
     auto loader = Gdk::PixbufLoader::create();
@@ -45,7 +50,7 @@ void ImageManager::LoadFromURL(const std::string &url, const callback_type &cb)
         try {
             auto buf = ReadFileToPixbuf(path);
             if (!buf)
-                printf("%s (%s) is null\n", url.c_str(), path.c_str());
+                LOG_WARN(Images, "%s (%s) is null", url.c_str(), path.c_str());
             else {
                 m_cb_mutex.lock();
                 m_cb_queue.push([signal, buf]() { signal.emit(buf); });
@@ -53,7 +58,7 @@ void ImageManager::LoadFromURL(const std::string &url, const callback_type &cb)
                 m_cb_mutex.unlock();
             }
         } catch (const std::exception &e) {
-            fprintf(stderr, "err loading pixbuf from %s: %s\n", path.c_str(), e.what());
+            LOG_ERROR(Images, "err loading pixbuf from %s: %s", path.c_str(), e.what());
         }
     });
 }
@@ -65,7 +70,7 @@ void ImageManager::LoadAnimationFromURL(const std::string &url, int w, int h, co
         try {
             auto buf = ReadFileToPixbufAnimation(path, w, h);
             if (!buf)
-                printf("%s (%s) is null\n", url.c_str(), path.c_str());
+                LOG_WARN(Images, "%s (%s) is null", url.c_str(), path.c_str());
             else {
                 m_cb_mutex.lock();
                 m_cb_queue.push([signal, buf]() { signal.emit(buf); });
@@ -73,7 +78,7 @@ void ImageManager::LoadAnimationFromURL(const std::string &url, int w, int h, co
                 m_cb_mutex.unlock();
             }
         } catch (const std::exception &e) {
-            fprintf(stderr, "err loading pixbuf animation from %s: %s\n", path.c_str(), e.what());
+            LOG_ERROR(Images, "err loading pixbuf animation from %s: %s", path.c_str(), e.what());
         }
     });
 }
@@ -83,6 +88,7 @@ void ImageManager::Prefetch(const std::string &url) {
 }
 
 void ImageManager::RunCallbacks() {
+    LoopProfiler::Scope scope("image callback");
     m_cb_mutex.lock();
     m_cb_queue.front()();
     m_cb_queue.pop();
@@ -99,7 +105,7 @@ Glib::RefPtr<Gdk::Pixbuf> ImageManager::GetPlaceholder(int size) {
         m_pixs[name] = buf;
         return buf;
     } catch (std::exception &e) {
-        fprintf(stderr, "error loading placeholder\n");
+        LOG_ERROR(Images, "error loading placeholder");
         return Glib::RefPtr<Gdk::Pixbuf>(nullptr);
     }
 }
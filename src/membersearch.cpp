@@ -0,0 +1,122 @@
+#include "membersearch.hpp"
+#include "discord/discord.hpp"
+
+MemberSearch::MemberSearch(DiscordClient &discord)
+    : m_discord(discord) {
+    m_discord.signal_gateway_ready().connect(sigc::mem_fun(*this, &MemberSearch::Clear));
+    m_discord.signal_guild_members_chunk().connect(sigc::mem_fun(*this, &MemberSearch::OnMembersChunk));
+}
+
+void MemberSearch::Clear() {
+    m_debounce_conn.disconnect();
+    m_pending.clear();
+    m_cache.clear();
+}
+
+bool MemberSearch::ShouldSearch(Snowflake guild_id) const {
+    const auto guild = m_discord.GetGuild(guild_id);
+    if (!guild.has_value()) return false;
+    const auto count = guild->MemberCount.has_value() ? guild->MemberCount : guild->ApproximateMemberCount;
+    if (!count.has_value()) return true;
+    return static_cast<size_t>(*count) > m_discord.GetUsersInGuild(guild_id).size();
+}
+
+void MemberSearch::Search(Snowflake guild_id, const Glib::ustring &query) {
+    m_debounce_conn.disconnect();
+
+    const std::string folded = query.casefold().raw();
+    if (folded.empty()) return;
+
+    bool is_exact;
+    const auto *result = FindResult(guild_id, folded, is_exact);
+    if (result != nullptr && (is_exact || result->IsComplete)) return;
+    DropExpired();
+    for (const auto &[nonce, pending] : m_pending)
+        if (pending.GuildID == guild_id && pending.Query == folded) return;
+
+    const auto cb = [this, guild_id, folded]() -> bool {
+        SendSearch(guild_id, folded);
+        return false;
+    };
+    m_debounce_conn = Glib::signal_timeout().connect(cb, DebounceMilliseconds);
+}
+
+std::optional<std::vector<Snowflake>> MemberSearch::GetResults(Snowflake guild_id, const Glib::ustring &query) const {
+    const std::string folded = query.casefold().raw();
+    bool is_exact;
+    const auto *result = FindResult(guild_id, folded, is_exact);
+    if (result == nullptr || (!is_exact && !result->IsComplete)) return std::nullopt;
+
+    std::vector<Snowflake> ret;
+    for (const auto &entry : result->Entries) {
+        if (!is_exact) {
+            bool match = false;
+            for (const auto &key : entry.Keys)
+                if (key.compare(0, folded.size(), folded) == 0) {
+                    match = true;
+                    break;
+                }
+            if (!match) continue;
+        }
+        ret.push_back(entry.UserID);
+    }
+    return ret;
+}
+
+const MemberSearch::Result *MemberSearch::FindResult(Snowflake guild_id, const std::string &folded, bool &is_exact) const {
+    const auto guild = m_cache.find(guild_id);
+    if (guild == m_cache.end()) return nullptr;
+
+    // longest cached prefix of the query
+    for (size_t len = folded.size(); len > 0; len--) {
+        const auto it = guild->second.find(folded.substr(0, len));
+        if (it == guild->second.end()) continue;
+        is_exact = len == folded.size();
+        return &it->second;
+    }
+    return nullptr;
+}
+
+void MemberSearch::SendSearch(Snowflake guild_id, const std::string &folded) {
+    const auto nonce = "abaddon-search-" + std::to_string(m_nonce_counter++);
+    m_pending[nonce] = { guild_id, folded, std::chrono::steady_clock::now() };
+    m_discord.RequestMembers(guild_id, folded, SearchLimit, nonce);
+}
+
+void MemberSearch::DropExpired() {
+    // the search can be sent again, a late chunk for a dropped nonce is ignored
+    const auto cutoff = std::chrono::steady_clock::now() - std::chrono::milliseconds(PendingTimeoutMilliseconds);
+    for (auto it = m_pending.begin(); it != m_pending.end();) {
+        if (it->second.Sent < cutoff)
+            it = m_pending.erase(it);
+        else
+            it++;
+    }
+}
+
+void MemberSearch::OnMembersChunk(const GuildMembersChunkData &data) {
+    if (!data.Nonce.has_value()) return;
+    const auto it = m_pending.find(*data.Nonce);
+    if (it == m_pending.end()) return;
+    const auto guild_id = it->second.GuildID;
+    const auto folded = it->second.Query;
+    m_pending.erase(it);
+
+    auto &result = m_cache[guild_id][folded];
+    result.Entries.clear();
+    result.IsComplete = data.Members.size() < static_cast<size_t>(SearchLimit);
+    for (const auto &member : data.Members) {
+        if (!member.User.has_value()) continue;
+        auto &entry = result.Entries.emplace_back();
+        entry.UserID = member.User->ID;
+        entry.Keys.push_back(Glib::ustring(member.User->Username).casefold().raw());
+        if (!member.Nickname.empty())
+            entry.Keys.push_back(Glib::ustring(member.Nickname).casefold().raw());
+    }
+
+    m_signal_results.emit(guild_id, folded);
+}
+
+MemberSearch::type_signal_results MemberSearch::signal_results() {
+    return m_signal_results;
+}
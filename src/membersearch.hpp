@@ -0,0 +1,70 @@
+#pragma once
+#include <chrono>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glibmm.h>
+#include "discord/snowflake.hpp"
+
+class DiscordClient;
+struct GuildMembersChunkData;
+
+// asks the gateway for members by name prefix (op 8 with a query) for guilds where we dont have every member
+// requests are debounced while typing and results are cached per guild and prefix
+class MemberSearch {
+public:
+    MemberSearch(DiscordClient &discord);
+
+    void Clear();
+
+    // only guilds with more members than we know about need to be searched
+    [[nodiscard]] bool ShouldSearch(Snowflake guild_id) const;
+
+    // nothing is sent if the cache can already answer
+    void Search(Snowflake guild_id, const Glib::ustring &query);
+
+    // cached results for the query, or the results of a shorter query narrowed down
+    // if that one wasnt cut off by the limit
+    std::optional<std::vector<Snowflake>> GetResults(Snowflake guild_id, const Glib::ustring &query) const;
+
+private:
+    struct Result {
+        struct Entry {
+            Snowflake UserID;
+            std::vector<std::string> Keys; // casefolded username and nickname
+        };
+        std::vector<Entry> Entries;
+        bool IsComplete; // fewer results than the limit so every match is in here
+    };
+
+    struct Pending {
+        Snowflake GuildID;
+        std::string Query; // casefolded
+        std::chrono::steady_clock::time_point Sent;
+    };
+
+    constexpr static int SearchLimit = 25;
+    constexpr static unsigned DebounceMilliseconds = 300;
+    constexpr static unsigned PendingTimeoutMilliseconds = 10000; // a chunk that never came back doesnt block the query forever
+
+    const Result *FindResult(Snowflake guild_id, const std::string &folded, bool &is_exact) const;
+    void SendSearch(Snowflake guild_id, const std::string &folded);
+    void DropExpired();
+    void OnMembersChunk(const GuildMembersChunkData &data);
+
+    DiscordClient &m_discord;
+
+    sigc::connection m_debounce_conn;
+    uint64_t m_nonce_counter = 0;
+    std::unordered_map<std::string, Pending> m_pending;                   // nonce
+    std::unordered_map<Snowflake, std::map<std::string, Result>> m_cache; // guild -> casefolded query
+
+public:
+    using type_signal_results = sigc::signal<void, Snowflake, Glib::ustring>; // guild id, query (casefolded)
+    type_signal_results signal_results();
+
+private:
+    type_signal_results m_signal_results;
+};
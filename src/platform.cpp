@@ -171,3 +171,35 @@ std::string Platform::FindStateCacheFolder() {
     return ".";
 }
 #endif
+
+#if defined(_WIN32)
+    #include <psapi.h>
+uint64_t Platform::GetResidentMemory() {
+    PROCESS_MEMORY_COUNTERS counters {};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.WorkingSetSize;
+    return 0;
+}
+#elif defined(__linux__)
+    #include <unistd.h>
+uint64_t Platform::GetResidentMemory() {
+    // second field is resident pages
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0, resident = 0;
+    if (!(statm >> size >> resident)) return 0;
+    return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+#elif defined(__APPLE__)
+    #include <mach/mach.h>
+uint64_t Platform::GetResidentMemory() {
+    mach_task_basic_info_data_t info {};
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+        return 0;
+    return info.resident_size;
+}
+#else
+uint64_t Platform::GetResidentMemory() {
+    return 0;
+}
+#endif
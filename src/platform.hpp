@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 
 namespace Platform {
@@ -6,4 +7,5 @@ bool SetupFonts();
 std::string FindResourceFolder();
 std::string FindConfigFile();
 std::string FindStateCacheFolder();
+uint64_t GetResidentMemory(); // bytes, 0 if it cant be read
 } // namespace Platform
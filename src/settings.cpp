@@ -47,7 +47,9 @@ void SettingsManager::ReadSettings() {
     SMSTR("discord", "gateway", GatewayURL);
     SMBOOL("discord", "memory_db", UseMemoryDB);
     SMBOOL("discord", "prefetch", Prefetch);
+    SMBOOL("discord", "prefetch_history", PrefetchHistory);
     SMBOOL("discord", "autoconnect", Autoconnect);
+    SMBOOL("discord", "resume_session", ResumeSession);
     SMSTR("gui", "css", MainCSS);
     SMBOOL("gui", "animated_guild_hover_only", AnimatedGuildHoverOnly);
     SMBOOL("gui", "animations", ShowAnimations);
@@ -59,6 +61,11 @@ void SettingsManager::ReadSettings() {
     SMBOOL("gui", "unreads", Unreads);
     SMBOOL("gui", "alt_menu", AltMenu);
     SMBOOL("gui", "hide_to_tray", HideToTray);
+    SMINT("gui", "cached_channels", CachedChannels);
+    SMBOOL("gui", "paste_jpeg_fallback", PasteJPEGFallback);
+    SMINT("gui", "stall_threshold", StallThreshold);
+    SMSTR("gui", "metrics_socket", MetricsSocket);
+    SMSTR("gui", "log_levels", LogLevels);
     SMINT("http", "concurrent", CacheHTTPConcurrency);
     SMSTR("http", "user_agent", UserAgent);
     SMSTR("style", "expandercolor", ChannelsExpanderColor);
@@ -128,7 +135,9 @@ void SettingsManager::Close() {
         SMSTR("discord", "gateway", GatewayURL);
         SMBOOL("discord", "memory_db", UseMemoryDB);
         SMBOOL("discord", "prefetch", Prefetch);
+        SMBOOL("discord", "prefetch_history", PrefetchHistory);
         SMBOOL("discord", "autoconnect", Autoconnect);
+        SMBOOL("discord", "resume_session", ResumeSession);
         SMSTR("gui", "css", MainCSS);
         SMBOOL("gui", "animated_guild_hover_only", AnimatedGuildHoverOnly);
         SMBOOL("gui", "animations", ShowAnimations);
@@ -140,6 +149,11 @@ void SettingsManager::Close() {
         SMBOOL("gui", "unreads", Unreads);
         SMBOOL("gui", "alt_menu", AltMenu);
         SMBOOL("gui", "hide_to_tray", HideToTray);
+        SMINT("gui", "cached_channels", CachedChannels);
+        SMBOOL("gui", "paste_jpeg_fallback", PasteJPEGFallback);
+        SMINT("gui", "stall_threshold", StallThreshold);
+        SMSTR("gui", "metrics_socket", MetricsSocket);
+        SMSTR("gui", "log_levels", LogLevels);
         SMINT("http", "concurrent", CacheHTTPConcurrency);
         SMSTR("http", "user_agent", UserAgent);
         SMSTR("style", "expandercolor", ChannelsExpanderColor);
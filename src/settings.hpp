@@ -12,7 +12,9 @@ public:
         std::string DiscordToken;
         bool UseMemoryDB { false };
         bool Prefetch { false };
+        bool PrefetchHistory { true };
         bool Autoconnect { false };
+        bool ResumeSession { false }; // off unless asked for, the journal keeps message contents on disk
 
         // [gui]
         std::string MainCSS { "main.css" };
@@ -30,6 +32,11 @@ public:
         bool Unreads { true };
         bool AltMenu { false };
         bool HideToTray { false };
+        int CachedChannels { 8 };
+        bool PasteJPEGFallback { true };
+        int StallThreshold { 0 };
+        std::string MetricsSocket;
+        std::string LogLevels;
 
         // [http]
         int CacheHTTPConcurrency { 20 };
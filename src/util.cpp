@@ -3,12 +3,6 @@
 #include <cstring>
 #include <filesystem>
 
-void LaunchBrowser(const Glib::ustring &url) {
-    GError *err = nullptr;
-    if (!gtk_show_uri_on_window(nullptr, url.c_str(), GDK_CURRENT_TIME, &err))
-        printf("failed to open uri: %s\n", err->message);
-}
-
 void GetImageDimensions(int inw, int inh, int &outw, int &outh, int clampw, int clamph) {
     const auto frac = static_cast<float>(inw) / static_cast<float>(inh);
 
@@ -83,24 +77,6 @@ std::string FormatISO8601(const std::string &in, int extra_offset, const std::st
     return tmp.data();
 }
 
-void ScrollListBoxToSelected(Gtk::ListBox &list) {
-    auto cb = [&list]() -> bool {
-        const auto selected = list.get_selected_row();
-        if (selected == nullptr) return false;
-        int x, y;
-        selected->translate_coordinates(list, 0, 0, x, y);
-        if (y < 0) return false;
-        const auto adj = list.get_adjustment();
-        if (!adj) return false;
-        int min, nat;
-        selected->get_preferred_height(min, nat);
-        adj->set_value(y - (adj->get_page_size() - nat) / 2.0);
-
-        return false;
-    };
-    Glib::signal_idle().connect(sigc::track_obj(cb, list));
-}
-
 // surely theres a better way to do this
 bool StringContainsCaseless(const Glib::ustring &str, const Glib::ustring &sub) {
     const auto regex = Glib::Regex::create(Glib::Regex::escape_string(sub), Glib::REGEX_CASELESS);
@@ -118,32 +94,6 @@ std::string IntToCSSColor(int color) {
     return ss.str();
 }
 
-Gdk::RGBA IntToRGBA(int color) {
-    Gdk::RGBA ret;
-    ret.set_red(((color & 0xFF0000) >> 16) / 255.0);
-    ret.set_green(((color & 0x00FF00) >> 8) / 255.0);
-    ret.set_blue(((color & 0x0000FF) >> 0) / 255.0);
-    ret.set_alpha(255.0);
-    return ret;
-}
-
-// so widgets can modify the menu before it is displayed
-// maybe theres a better way to do this idk
-void AddWidgetMenuHandler(Gtk::Widget *widget, Gtk::Menu &menu, const sigc::slot<void()> &pre_callback) {
-    sigc::signal<void()> signal;
-    signal.connect(pre_callback);
-    widget->signal_button_press_event().connect([&menu, signal](GdkEventButton *ev) -> bool {
-        if (ev->type == GDK_BUTTON_PRESS && ev->button == GDK_BUTTON_SECONDARY) {
-            signal.emit();
-            menu.popup_at_pointer(reinterpret_cast<const GdkEvent *>(ev));
-            return true;
-        }
-        return false;
-        // clang-format off
-    }, false);
-    // clang-format on
-}
-
 std::vector<std::string> StringSplit(const std::string &str, const char *delim) {
     std::vector<std::string> parts;
     char *token = std::strtok(const_cast<char *>(str.c_str()), delim);
@@ -172,15 +122,6 @@ bool IsURLViewableImage(const std::string &url) {
     return false;
 }
 
-void AddPointerCursor(Gtk::Widget &widget) {
-    widget.signal_realize().connect([&widget]() {
-        auto window = widget.get_window();
-        auto display = window->get_display();
-        auto cursor = Gdk::Cursor::create(display, "pointer");
-        window->set_cursor(cursor);
-    });
-}
-
 bool util::IsFolder(std::string_view path) {
     std::error_code ec;
     const auto status = std::filesystem::status(path, ec);
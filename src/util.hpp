@@ -13,7 +13,7 @@
 #include <condition_variable>
 #include <optional>
 #include <type_traits>
-#include <gtkmm.h>
+#include <glibmm.h>
 
 #define NOOP_CALLBACK [](...) {}
 
@@ -31,18 +31,14 @@ bool IsFile(std::string_view path);
 uint64_t TimeToEpoch(int year, int month, int day, int hour, int minute, int seconds);
 } // namespace util
 
-void LaunchBrowser(const Glib::ustring &url);
 void GetImageDimensions(int inw, int inh, int &outw, int &outh, int clampw = 400, int clamph = 300);
 std::string IntToCSSColor(int color);
-Gdk::RGBA IntToRGBA(int color);
-void AddWidgetMenuHandler(Gtk::Widget *widget, Gtk::Menu &menu, const sigc::slot<void()> &pre_callback);
 std::vector<std::string> StringSplit(const std::string &str, const char *delim);
 std::string GetExtension(std::string url);
 bool IsURLViewableImage(const std::string &url);
 std::vector<uint8_t> ReadWholeFile(const std::string &path);
 std::string HumanReadableBytes(uint64_t bytes);
 std::string FormatISO8601(const std::string &in, int extra_offset = 0, const std::string &fmt = "%x %X");
-void AddPointerCursor(Gtk::Widget &widget);
 
 template<typename T>
 struct Bitwise {
@@ -105,6 +101,4 @@ inline void AlphabeticalSort(T start, T end, std::function<std::string(const typ
     });
 }
 
-void ScrollListBoxToSelected(Gtk::ListBox &list);
-
 bool StringContainsCaseless(const Glib::ustring &str, const Glib::ustring &sub);
@@ -1,5 +1,6 @@
 #include "emojispane.hpp"
 #include "abaddon.hpp"
+#include "gtkutil.hpp"
 #include "components/cellrendererpixbufanimation.hpp"
 
 GuildSettingsEmojisPane::GuildSettingsEmojisPane(Snowflake guild_id)
@@ -1,5 +1,6 @@
 #include "infopane.hpp"
 #include "abaddon.hpp"
+#include "gtkutil.hpp"
 #include <filesystem>
 
 GuildSettingsInfoPane::GuildSettingsInfoPane(Snowflake id)
@@ -29,12 +30,11 @@ GuildSettingsInfoPane::GuildSettingsInfoPane(Snowflake id)
     m_guild_name.show();
     m_guild_name_label.show();
 
-    auto guild_update_cb = [this](Snowflake id) {
-        if (id != GuildID) return;
-        const auto guild = *Abaddon::Get().GetDiscordClient().GetGuild(id);
+    auto guild_update_cb = [this]() {
+        const auto guild = *Abaddon::Get().GetDiscordClient().GetGuild(GuildID);
         FetchGuildIcon(guild);
     };
-    discord.signal_guild_update().connect(sigc::track_obj(guild_update_cb, *this));
+    discord.signal_guild_update_by_guild().connect(GuildID, sigc::track_obj(guild_update_cb, *this));
     FetchGuildIcon(guild);
 
     AddPointerCursor(m_guild_icon_ev);
@@ -39,7 +39,7 @@ GuildSettingsMembersPaneMembers::GuildSettingsMembersPaneMembers(Snowflake id)
     m_list_scroll.set_propagate_natural_height(true);
 
     auto &discord = Abaddon::Get().GetDiscordClient();
-    auto members = discord.GetUsersInGuild(id);
+    const auto &members = discord.GetUsersInGuild(id);
     const auto guild = *discord.GetGuild(GuildID);
     for (const auto member_id : members) {
         auto member = discord.GetMember(member_id, GuildID);
@@ -106,11 +106,11 @@ GuildSettingsMembersListItem::GuildSettingsMembersListItem(const GuildData &guil
 
     DisplayTerm = member.User->Username + "#" + member.User->Discriminator;
 
-    const auto member_update_cb = [this](Snowflake guild_id, Snowflake user_id) {
-        if (user_id == UserID)
+    const auto member_update_cb = [this](Snowflake guild_id) {
+        if (guild_id == GuildID)
             UpdateColor();
     };
-    discord.signal_guild_member_update().connect(sigc::track_obj(member_update_cb, *this));
+    discord.signal_guild_member_update_by_user().connect(UserID, sigc::track_obj(member_update_cb, *this));
     UpdateColor();
 
     if (Abaddon::Get().GetSettings().ShowOwnerCrown && guild.OwnerID == member.User->ID) {
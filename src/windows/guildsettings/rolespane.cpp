@@ -1,5 +1,6 @@
 #include "rolespane.hpp"
 #include "abaddon.hpp"
+#include "gtkutil.hpp"
 
 GuildSettingsRolesPane::GuildSettingsRolesPane(Snowflake id)
     : Gtk::Box(Gtk::ORIENTATION_HORIZONTAL)
@@ -233,7 +234,7 @@ GuildSettingsRolesPaneInfo::GuildSettingsRolesPaneInfo(Snowflake guild_id)
                 dlg.run();
             }
         };
-        discord.ModifyRoleColor(GuildID, RoleID, color, cb);
+        discord.ModifyRoleColor(GuildID, RoleID, RGBAToInt(color), cb);
     });
 
     int left_ypos = 0;
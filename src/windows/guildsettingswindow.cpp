@@ -14,14 +14,13 @@ GuildSettingsWindow::GuildSettingsWindow(Snowflake id)
     auto &discord = Abaddon::Get().GetDiscordClient();
     const auto guild = *discord.GetGuild(id);
 
-    auto guild_update_cb = [this](Snowflake id) {
-        if (id != GuildID) return;
-        const auto guild = *Abaddon::Get().GetDiscordClient().GetGuild(id);
+    auto guild_update_cb = [this]() {
+        const auto guild = *Abaddon::Get().GetDiscordClient().GetGuild(GuildID);
         set_title(guild.Name);
         if (guild.HasIcon())
             Abaddon::Get().GetImageManager().LoadFromURL(guild.GetIconURL(), sigc::mem_fun(*this, &GuildSettingsWindow::set_icon));
     };
-    discord.signal_guild_update().connect(sigc::track_obj(guild_update_cb, *this));
+    discord.signal_guild_update_by_guild().connect(GuildID, sigc::track_obj(guild_update_cb, *this));
 
     set_name("guild-settings");
     set_default_size(800, 600);
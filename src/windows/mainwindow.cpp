@@ -1,5 +1,9 @@
 #include "mainwindow.hpp"
 #include "abaddon.hpp"
+#include "discord/log.hpp"
+#include "discord/loopprofiler.hpp"
+#include "discord/tracer.hpp"
+#include <sstream>
 
 MainWindow::MainWindow()
     : m_main_box(Gtk::ORIENTATION_VERTICAL)
@@ -84,6 +88,7 @@ void MainWindow::UpdateComponents() {
 
     if (!discord_active) {
         m_chat.Clear();
+        m_chat.ClearCachedViews();
         m_members.Clear();
     } else {
         m_members.UpdateMemberList();
@@ -100,10 +105,19 @@ void MainWindow::UpdateChannelListing() {
 }
 
 void MainWindow::UpdateChatWindowContents() {
-    auto &discord = Abaddon::Get().GetDiscordClient();
-    auto msgs = discord.GetMessagesForChannel(m_chat.GetActiveChannel(), 50);
-    m_chat.SetMessages(msgs);
-    m_members.UpdateMemberList();
+    // cached views are kept up to date so theres nothing to reload
+    if (!m_chat.IsActiveViewPopulated()) {
+        auto &discord = Abaddon::Get().GetDiscordClient();
+        auto msgs = discord.GetMessagesForChannel(m_chat.GetActiveChannel(), 50);
+        m_chat.SetMessages(msgs);
+    }
+    if (!m_members.IsActiveListPopulated())
+        m_members.UpdateMemberList();
+}
+
+void MainWindow::ClearCachedViews() {
+    m_chat.ClearCachedViews();
+    m_members.ClearCachedLists();
 }
 
 void MainWindow::UpdateChatActiveChannel(Snowflake id, bool expand_to) {
@@ -118,25 +132,27 @@ Snowflake MainWindow::GetChatActiveChannel() const {
 }
 
 void MainWindow::UpdateChatNewMessage(const Message &data) {
-    if (data.ChannelID == GetChatActiveChannel()) {
-        m_chat.AddNewMessage(data);
-    }
+    m_chat.AddNewMessage(data);
 }
 
 void MainWindow::UpdateChatMessageDeleted(Snowflake id, Snowflake channel_id) {
-    if (channel_id == GetChatActiveChannel())
-        m_chat.DeleteMessage(id);
+    m_chat.DeleteMessage(id, channel_id);
 }
 
 void MainWindow::UpdateChatMessageUpdated(Snowflake id, Snowflake channel_id) {
-    if (channel_id == GetChatActiveChannel())
-        m_chat.UpdateMessage(id);
+    m_chat.UpdateMessage(id, channel_id);
 }
 
 void MainWindow::UpdateChatPrependHistory(const std::vector<Message> &msgs) {
     m_chat.AddNewHistory(msgs); // given vector should be sorted ascending
 }
 
+void MainWindow::UpdateChatBackfilled(Snowflake channel_id) {
+    if (channel_id != m_chat.GetActiveChannel()) return;
+    const auto msgs = Abaddon::Get().GetDiscordClient().GetMessagesForChannel(channel_id, 50);
+    m_chat.SetMessages(msgs);
+}
+
 void MainWindow::InsertChatInput(const std::string &text) {
     m_chat.InsertChatInput(text);
 }
@@ -256,7 +272,14 @@ void MainWindow::SetupMenu() {
     m_menu_file_reload_css.set_label("Reload CSS");
     m_menu_file_clear_cache.set_label("Clear file cache");
     m_menu_file_sub.append(m_menu_file_reload_css);
+    m_menu_file_dump_timings.set_label("Dump main loop timings");
+    m_menu_file_trace.set_label("Record trace");
+    m_menu_file_trace.set_active(Tracer::Get().IsEnabled());
+    m_menu_file_metrics.set_label("Metrics");
     m_menu_file_sub.append(m_menu_file_clear_cache);
+    m_menu_file_sub.append(m_menu_file_dump_timings);
+    m_menu_file_sub.append(m_menu_file_trace);
+    m_menu_file_sub.append(m_menu_file_metrics);
 
     m_menu_view.set_label("View");
     m_menu_view.set_submenu(m_menu_view_sub);
@@ -335,6 +358,22 @@ void MainWindow::SetupMenu() {
         Abaddon::Get().GetImageManager().ClearCache();
     });
 
+    m_menu_file_dump_timings.signal_activate().connect([] {
+        // a line at a time so a long table doesnt get cut off
+        std::istringstream dump(LoopProfiler::Get().Dump());
+        std::string line;
+        while (std::getline(dump, line))
+            LOG_INFO(Profiler, "%s", line.c_str());
+    });
+
+    m_menu_file_trace.signal_toggled().connect([this] {
+        Abaddon::Get().SetTracing(m_menu_file_trace.get_active());
+    });
+
+    m_menu_file_metrics.signal_activate().connect([] {
+        Abaddon::Get().ActionViewMetrics();
+    });
+
     m_menu_discord_add_recipient.signal_activate().connect([this] {
         m_signal_action_add_recipient.emit(GetChatActiveChannel());
     });
@@ -13,12 +13,14 @@ public:
     void UpdateMembers();
     void UpdateChannelListing();
     void UpdateChatWindowContents();
+    void ClearCachedViews(); // recently viewed channels kept for fast switching
     void UpdateChatActiveChannel(Snowflake id, bool expand_to);
     Snowflake GetChatActiveChannel() const;
     void UpdateChatNewMessage(const Message &data);
     void UpdateChatMessageDeleted(Snowflake id, Snowflake channel_id);
     void UpdateChatMessageUpdated(Snowflake id, Snowflake channel_id);
     void UpdateChatPrependHistory(const std::vector<Message> &msgs);
+    void UpdateChatBackfilled(Snowflake channel_id); // reloads if its the active channel
     void InsertChatInput(const std::string &text);
     Snowflake GetChatOldestListedMessage();
     void UpdateChatReactionAdd(Snowflake id, const Glib::ustring &param);
@@ -72,6 +74,9 @@ private:
     Gtk::Menu m_menu_file_sub;
     Gtk::MenuItem m_menu_file_reload_css;
     Gtk::MenuItem m_menu_file_clear_cache;
+    Gtk::MenuItem m_menu_file_dump_timings;
+    Gtk::CheckMenuItem m_menu_file_trace;
+    Gtk::MenuItem m_menu_file_metrics;
 
     Gtk::MenuItem m_menu_view;
     Gtk::Menu m_menu_view_sub;
@@ -0,0 +1,94 @@
+#include "metricswindow.hpp"
+#include <cstdio>
+
+static Glib::ustring FormatNumber(double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.10g", value);
+    return buf;
+}
+
+static Glib::ustring FormatFixed(double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.2f", value);
+    return buf;
+}
+
+MetricsWindow::MetricsWindow()
+    : m_model(Gtk::ListStore::create(m_columns)) {
+    set_name("metrics");
+    set_default_size(800, 500);
+    set_title("Metrics");
+    set_position(Gtk::WIN_POS_CENTER);
+    get_style_context()->add_class("app-window");
+    get_style_context()->add_class("app-popup");
+    get_style_context()->add_class("metrics-window");
+
+    m_model->set_sort_column(m_columns.m_col_name, Gtk::SORT_ASCENDING);
+
+    m_view.set_enable_search(false);
+    m_view.set_model(m_model);
+    m_view.append_column("Metric", m_columns.m_col_name);
+    m_view.append_column("Labels", m_columns.m_col_labels);
+    m_view.append_column("Value", m_columns.m_col_value);
+    m_view.append_column("Per second", m_columns.m_col_rate);
+    m_view.append_column("Mean ms", m_columns.m_col_mean);
+    m_view.show();
+
+    m_scroll.set_policy(Gtk::POLICY_AUTOMATIC, Gtk::POLICY_AUTOMATIC);
+    m_scroll.add(m_view);
+    m_scroll.show();
+    add(m_scroll);
+
+    Refresh();
+    Glib::signal_timeout().connect(sigc::mem_fun(*this, &MetricsWindow::Refresh), RefreshMilliseconds);
+}
+
+bool MetricsWindow::Refresh() {
+    const auto now = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(now - m_last_refresh).count();
+    m_last_refresh = now;
+
+    for (const auto &sample : Metrics::Get().GetSamples()) {
+        const auto key = sample.Name + sample.Labels;
+        auto it = m_rows.find(key);
+        const bool is_new = it == m_rows.end();
+        if (is_new) {
+            auto row = m_model->append();
+            (*row)[m_columns.m_col_name] = sample.Name;
+            (*row)[m_columns.m_col_labels] = sample.Labels;
+            it = m_rows.emplace(key, Previous { row, sample.Value, sample.Count }).first;
+        }
+
+        auto &prev = it->second;
+        auto row = *prev.Row;
+        switch (sample.Kind) {
+            case Metrics::Type::Counter:
+                row[m_columns.m_col_value] = FormatNumber(sample.Value);
+                if (!is_new)
+                    row[m_columns.m_col_rate] = FormatFixed((sample.Value - prev.Value) / seconds);
+                break;
+            case Metrics::Type::Gauge:
+                row[m_columns.m_col_value] = FormatNumber(sample.Value);
+                break;
+            case Metrics::Type::Histogram:
+                row[m_columns.m_col_value] = FormatNumber(static_cast<double>(sample.Count));
+                if (!is_new)
+                    row[m_columns.m_col_rate] = FormatFixed(static_cast<double>(sample.Count - prev.Count) / seconds);
+                if (sample.Count > 0)
+                    row[m_columns.m_col_mean] = FormatFixed(sample.Sum / static_cast<double>(sample.Count) * 1000.0);
+                break;
+        }
+        prev.Value = sample.Value;
+        prev.Count = sample.Count;
+    }
+
+    return true;
+}
+
+MetricsWindow::ModelColumns::ModelColumns() {
+    add(m_col_name);
+    add(m_col_labels);
+    add(m_col_value);
+    add(m_col_rate);
+    add(m_col_mean);
+}
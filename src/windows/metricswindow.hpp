@@ -0,0 +1,43 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <gtkmm.h>
+#include "discord/metrics.hpp"
+
+// everything in the metrics registry, refreshed every second
+class MetricsWindow : public Gtk::Window {
+public:
+    MetricsWindow();
+
+private:
+    constexpr static unsigned RefreshMilliseconds = 1000;
+
+    bool Refresh();
+
+    struct Previous {
+        Gtk::TreeModel::iterator Row;
+        double Value;
+        uint64_t Count;
+    };
+
+    std::unordered_map<std::string, Previous> m_rows; // by name and labels
+    std::chrono::steady_clock::time_point m_last_refresh;
+
+    Gtk::ScrolledWindow m_scroll;
+    Gtk::TreeView m_view;
+
+    class ModelColumns : public Gtk::TreeModel::ColumnRecord {
+    public:
+        ModelColumns();
+
+        Gtk::TreeModelColumn<Glib::ustring> m_col_name;
+        Gtk::TreeModelColumn<Glib::ustring> m_col_labels;
+        Gtk::TreeModelColumn<Glib::ustring> m_col_value;
+        Gtk::TreeModelColumn<Glib::ustring> m_col_rate;
+        Gtk::TreeModelColumn<Glib::ustring> m_col_mean;
+    };
+
+    ModelColumns m_columns;
+    Glib::RefPtr<Gtk::ListStore> m_model;
+};
@@ -1,6 +1,7 @@
 #include "userinfopane.hpp"
 #include <unordered_set>
 #include "abaddon.hpp"
+#include "gtkutil.hpp"
 
 ConnectionItem::ConnectionItem(const ConnectionData &conn)
     : m_box(Gtk::ORIENTATION_HORIZONTAL)
@@ -1,5 +1,6 @@
 #include "profilewindow.hpp"
 #include "abaddon.hpp"
+#include "gtkutil.hpp"
 
 ProfileWindow::ProfileWindow(Snowflake user_id)
     : ID(user_id)